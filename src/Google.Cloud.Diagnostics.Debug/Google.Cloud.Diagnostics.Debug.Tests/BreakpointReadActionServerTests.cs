@@ -99,5 +99,33 @@ namespace Google.Cloud.Diagnostics.Debug.Tests
             _mockDebuggerClient.Verify(c => c.UpdateBreakpoint(sdBreakpoint), Times.Once);
             _mockLoggingClient.Verify(c => c.WriteLogEntry(sdBreakpoint), Times.Once);
         }
+
+        [Fact]
+        public void MainAction_StatusUpdate()
+        {
+            var breakpoint = new Breakpoint
+            {
+                Id = "some-id",
+                Location = new SourceLocation
+                {
+                    Line = 1,
+                    Path = "some-path"
+                },
+                LogPoint = true,
+                Activated = true,
+                Status = new Status
+                {
+                    Message = "some-message"
+                }
+            };
+            _mockBreakpointServer.Setup(s => s.ReadBreakpointAsync(It.IsAny<CancellationToken>()))
+                .Returns(Task.FromResult(breakpoint));
+            _server.MainAction();
+
+            var sdBreakpoint = breakpoint.Convert();
+            _mockDebuggerClient.Verify(c => c.UpdateBreakpoint(sdBreakpoint), Times.Once);
+            _mockLoggingClient.Verify(c => c.WriteLogEntry(
+                It.IsAny<Debugger.V2.Breakpoint>()), Times.Never);
+        }
     }
 }
@@ -208,6 +208,32 @@ namespace Google.Cloud.Diagnostics.Debug.Tests
             _pipeMock.Verify(p => p.WriteAsync(It.IsAny<byte[]>(), _cts.Token), Times.Once());
         }
 
+        [Fact]
+        public void WriteBreakpointsAsync()
+        {
+            var breakpoint1 = new Breakpoint
+            {
+                Id = "some-id-1"
+            };
+            var breakpoint2 = new Breakpoint
+            {
+                Id = "some-id-2",
+                Activated = true
+            };
+
+            var expected = new List<byte>();
+            expected.AddRange(Constants.StartBatchMessage);
+            expected.AddRange(CreateBreakpointMessage(breakpoint1));
+            expected.AddRange(CreateBreakpointMessage(breakpoint2));
+            expected.AddRange(Constants.EndBatchMessage);
+
+            _pipeMock.Setup(p => p.WriteAsync(
+                Match.Create((byte[] bytes) => bytes.SequenceEqual(expected)), _cts.Token));
+            _server.WriteBreakpointsAsync(new[] { breakpoint1, breakpoint2 }, _cts.Token);
+            _pipeMock.VerifyAll();
+            _pipeMock.Verify(p => p.WriteAsync(It.IsAny<byte[]>(), _cts.Token), Times.Once());
+        }
+
         [Fact]
         public void IndexOfSequence()
         {
@@ -41,8 +41,8 @@ namespace Google.Cloud.Diagnostics.Debug.Tests
             _server = new BreakpointWriteActionServer(_mockBreakpointServer.Object,
                 _cts, _mockDebuggerClient.Object, _breakpointManager);
 
-            _mockBreakpointServer.Setup(s => s.WriteBreakpointAsync(
-                It.IsAny<Breakpoint>(), It.IsAny<CancellationToken>()))
+            _mockBreakpointServer.Setup(s => s.WriteBreakpointsAsync(
+                It.IsAny<IEnumerable<Breakpoint>>(), It.IsAny<CancellationToken>()))
                     .Returns(Task.FromResult(true));
         }
 
@@ -55,8 +55,8 @@ namespace Google.Cloud.Diagnostics.Debug.Tests
 
             _mockDebuggerClient.Verify(c => c.ListBreakpoints(), Times.Once);
             _mockDebuggerClient.Verify(c => c.UpdateBreakpoint(It.IsAny<StackdriverBreakpoint>()), Times.Never);
-            _mockBreakpointServer.Verify(s => s.WriteBreakpointAsync(
-                It.IsAny<Breakpoint>(), It.IsAny<CancellationToken>()), Times.Never);
+            _mockBreakpointServer.Verify(s => s.WriteBreakpointsAsync(
+                It.IsAny<IEnumerable<Breakpoint>>(), It.IsAny<CancellationToken>()), Times.Never);
         }
 
         [Fact]
@@ -68,8 +68,8 @@ namespace Google.Cloud.Diagnostics.Debug.Tests
 
             _mockDebuggerClient.Verify(c => c.ListBreakpoints(), Times.Once);
             _mockDebuggerClient.Verify(c => c.UpdateBreakpoint(It.IsAny<StackdriverBreakpoint>()), Times.Never);
-            _mockBreakpointServer.Verify(s => s.WriteBreakpointAsync(
-                It.IsAny<Breakpoint>(), It.IsAny<CancellationToken>()), Times.Never);
+            _mockBreakpointServer.Verify(s => s.WriteBreakpointsAsync(
+                It.IsAny<IEnumerable<Breakpoint>>(), It.IsAny<CancellationToken>()), Times.Never);
         }
 
         [Fact]
@@ -81,8 +81,7 @@ namespace Google.Cloud.Diagnostics.Debug.Tests
 
             _mockDebuggerClient.Verify(c => c.ListBreakpoints(), Times.Once);
             _mockDebuggerClient.Verify(c => c.UpdateBreakpoint(It.IsAny<StackdriverBreakpoint>()), Times.Never);
-            _mockBreakpointServer.Verify(s => s.WriteBreakpointAsync(
-                breakpoints.Single().Convert(), It.IsAny<CancellationToken>()), Times.Once);
+            VerifyBatchWritten(breakpoints.Single().Convert());
         }
 
         [Fact]
@@ -95,8 +94,7 @@ namespace Google.Cloud.Diagnostics.Debug.Tests
 
             _mockDebuggerClient.Verify(c => c.ListBreakpoints(), Times.Once);
             _mockDebuggerClient.Verify(c => c.UpdateBreakpoint(It.IsAny<StackdriverBreakpoint>()), Times.Never);
-            _mockBreakpointServer.Verify(s => s.WriteBreakpointAsync(
-                breakpoints.Single().Convert(), It.IsAny<CancellationToken>()), Times.Once);
+            VerifyBatchWritten(breakpoints.Single().Convert());
         }
 
         [Fact]
@@ -112,8 +110,7 @@ namespace Google.Cloud.Diagnostics.Debug.Tests
             _mockDebuggerClient.Verify(c => c.ListBreakpoints(), Times.Exactly(2));
             _mockDebuggerClient.Verify(c => c.UpdateBreakpoint(It.IsAny<StackdriverBreakpoint>()), Times.Never);
             breakpoints.Single().IsFinalState = true;
-            _mockBreakpointServer.Verify(s => s.WriteBreakpointAsync(
-                breakpoints.Single().Convert(), It.IsAny<CancellationToken>()), Times.Once);
+            VerifyBatchWritten(breakpoints.Single().Convert());
         }
 
         [Fact]
@@ -124,8 +121,9 @@ namespace Google.Cloud.Diagnostics.Debug.Tests
             _mockDebuggerClient.Setup(c => c.ListBreakpoints()).Returns(breakpoints);
             _server.MainAction();
 
-            _mockBreakpointServer.Verify(s => s.WriteBreakpointAsync(
-                It.IsAny<Breakpoint>(), It.IsAny<CancellationToken>()), Times.Exactly(5));
+            _mockBreakpointServer.Verify(s => s.WriteBreakpointsAsync(
+                Match.Create((IEnumerable<Breakpoint> b) => b.Count() == 5 && b.All(bp => bp.Activated)),
+                It.IsAny<CancellationToken>()), Times.Once);
 
             _mockDebuggerClient.Reset();
             _mockBreakpointServer.Reset();
@@ -133,8 +131,21 @@ namespace Google.Cloud.Diagnostics.Debug.Tests
             _server.MainAction();
 
             _mockDebuggerClient.Verify(c => c.UpdateBreakpoint(It.IsAny<StackdriverBreakpoint>()), Times.Never);
+            _mockBreakpointServer.Verify(s => s.WriteBreakpointsAsync(
+                Match.Create((IEnumerable<Breakpoint> b) => b.Count() == 4 && b.All(bp => !bp.Activated)),
+                It.IsAny<CancellationToken>()), Times.Once);
             _mockBreakpointServer.Verify(s => s.WriteBreakpointAsync(
-                Match.Create((Breakpoint b) => !b.Activated), It.IsAny<CancellationToken>()), Times.Exactly(4));
+                It.IsAny<Breakpoint>(), It.IsAny<CancellationToken>()), Times.Never);
+        }
+
+        /// <summary>
+        /// Verifies that the breakpoint was written as the only breakpoint of a batch.
+        /// </summary>
+        private void VerifyBatchWritten(Breakpoint breakpoint)
+        {
+            _mockBreakpointServer.Verify(s => s.WriteBreakpointsAsync(
+                Match.Create((IEnumerable<Breakpoint> b) => b.SequenceEqual(new[] { breakpoint })),
+                It.IsAny<CancellationToken>()), Times.Once);
         }
 
         /// <summary>
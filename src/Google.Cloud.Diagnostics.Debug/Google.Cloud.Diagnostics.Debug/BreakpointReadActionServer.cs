@@ -61,6 +61,13 @@ namespace Google.Cloud.Diagnostics.Debug
                 return;
             }
             StackdriverBreakpoint breakpoint = readBreakpoint.Convert();
+            if (readBreakpoint.Activated)
+            {
+                // The breakpoint is still active, such as one whose module
+                // was unloaded, and only its status changed.
+                _debuggerClient.UpdateBreakpoint(breakpoint);
+                return;
+            }
             if (breakpoint.Action == StackdriverBreakpoint.Types.Action.Log)
             {
                 _loggingClient.WriteLogEntry(breakpoint);
@@ -89,10 +89,31 @@ namespace Google.Cloud.Diagnostics.Debug
         public Task WriteBreakpointAsync(Breakpoint breakpoint, CancellationToken cancellationToken = default(CancellationToken))
         {
             List<byte> bytes = new List<byte>();
+            AddBreakpointMessage(bytes, breakpoint);
+            return _pipe.WriteAsync(bytes.ToArray(), cancellationToken);
+        }
+
+        /// <inheritdoc />
+        public Task WriteBreakpointsAsync(IEnumerable<Breakpoint> breakpoints, CancellationToken cancellationToken = default(CancellationToken))
+        {
+            List<byte> bytes = new List<byte>();
+            bytes.AddRange(Constants.StartBatchMessage);
+            foreach (var breakpoint in breakpoints)
+            {
+                AddBreakpointMessage(bytes, breakpoint);
+            }
+            bytes.AddRange(Constants.EndBatchMessage);
+            return _pipe.WriteAsync(bytes.ToArray(), cancellationToken);
+        }
+
+        /// <summary>
+        /// Adds the breakpoint, surrounded by the start and end of a breakpoint message, to bytes.
+        /// </summary>
+        private static void AddBreakpointMessage(List<byte> bytes, Breakpoint breakpoint)
+        {
             bytes.AddRange(Constants.StartBreakpointMessage);
             bytes.AddRange(breakpoint.ToByteArray());
             bytes.AddRange(Constants.EndBreakpointMessage);
-            return _pipe.WriteAsync(bytes.ToArray(), cancellationToken);
         }
 
         /// <summary>
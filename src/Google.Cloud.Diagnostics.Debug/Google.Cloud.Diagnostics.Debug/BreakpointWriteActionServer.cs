@@ -13,6 +13,7 @@
 // limitations under the License.
 
 using Google.Api.Gax;
+using System.Collections.Generic;
 using System.Threading;
 
 namespace Google.Cloud.Diagnostics.Debug
@@ -55,16 +56,24 @@ namespace Google.Cloud.Diagnostics.Debug
             }
             var bpmResponse = _breakpointManager.UpdateBreakpoints(serverBreakpoints);
 
+            // Send all the changes in one batch so the debugger can apply
+            // them together rather than one breakpoint at a time.
+            var breakpoints = new List<Breakpoint>();
             foreach (var breakpointToBeRemoved in bpmResponse.Removed)
             {
                 var breakpoint = breakpointToBeRemoved.Convert();
                 breakpoint.Activated = false;
-                _server.WriteBreakpointAsync(breakpoint).Wait();
+                breakpoints.Add(breakpoint);
             }
 
             foreach (var breakpoint in bpmResponse.New)
             {
-                _server.WriteBreakpointAsync(breakpoint.Convert()).Wait();
+                breakpoints.Add(breakpoint.Convert());
+            }
+
+            if (breakpoints.Count > 0)
+            {
+                _server.WriteBreakpointsAsync(breakpoints).Wait();
             }
         }
     }
@@ -29,5 +29,11 @@ namespace Google.Cloud.Diagnostics.Debug
 
         /// <summary>The end of a breakpoint message.</summary>
         public static readonly byte[] EndBreakpointMessage = Encoding.ASCII.GetBytes("END_DEBUG_MESSAGE");
+
+        /// <summary>The start of a batch of breakpoint messages.</summary>
+        public static readonly byte[] StartBatchMessage = Encoding.ASCII.GetBytes("START_DEBUG_BATCH");
+
+        /// <summary>The end of a batch of breakpoint messages.</summary>
+        public static readonly byte[] EndBatchMessage = Encoding.ASCII.GetBytes("END_DEBUG_BATCH");
     }
 }
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 using System;
+using System.Collections.Generic;
 using System.Threading;
 using System.Threading.Tasks;
 
@@ -39,5 +40,14 @@ namespace Google.Cloud.Diagnostics.Debug
         /// <param name="cancellationToken">The token to monitor for cancellation requests.</param>
         /// <returns>A task representing the asynchronous operation.</returns>
         Task WriteBreakpointAsync(Breakpoint breakpoint, CancellationToken cancellationToken = default(CancellationToken));
+
+        /// <summary>
+        /// Write breakpoints to the client as a single batch, which the client applies
+        /// all at once.
+        /// </summary>
+        /// <param name="breakpoints">The breakpoints to write.</param>
+        /// <param name="cancellationToken">The token to monitor for cancellation requests.</param>
+        /// <returns>A task representing the asynchronous operation.</returns>
+        Task WriteBreakpointsAsync(IEnumerable<Breakpoint> breakpoints, CancellationToken cancellationToken = default(CancellationToken));
     }
 }
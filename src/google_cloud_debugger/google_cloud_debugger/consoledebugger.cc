@@ -3,18 +3,21 @@
 
 // TODO: Add cleanup to release pointer.
 
+#include <chrono>
 #include <iostream>
 #include <string>
 #include <thread>
 #include <vector>
 
 #include "debugger.h"
+#include "eval_coordinator.h"
 #include "optionparser.h"
 #include "string_stream_wrapper.h"
 #include "winerror.h"
 
 using google_cloud_debugger::ConvertStringToWCharPtr;
 using google_cloud_debugger::Debugger;
+using google_cloud_debugger::EvalCoordinator;
 using std::cerr;
 using std::cin;
 using std::endl;
@@ -39,13 +42,40 @@ const string kApplicationIDOption = "application-id";
 // The name of the pipe the debugger will use to communicate with the agent.
 const string kPipeNameOption = "pipe-name";
 
+// If given this option, the debugger will cache the indices it builds from
+// PDB files in this directory and reuse them on later runs.
+const string kPdbIndexCacheDirectoryOption = "pdb-index-cache-directory";
+
+// Comma-separated patterns of the modules whose PDB files are parsed even
+// if they match an exclude pattern.
+const string kModuleIncludeOption = "module-include";
+
+// Comma-separated patterns of the modules whose PDB files are not parsed.
+const string kModuleExcludeOption = "module-exclude";
+
+// Milliseconds a function evaluation may run before it is aborted.
+const string kEvalTimeoutOption = "eval-timeout-ms";
+
+// Milliseconds after a breakpoint hit during which its snapshot may start
+// function evaluations.
+const string kSnapshotEvalTimeoutOption = "snapshot-eval-timeout-ms";
+
+// Milliseconds a breakpoint hit may keep its thread stopped.
+const string kPauseTimeoutOption = "pause-timeout-ms";
+
 enum optionIndex {
   UNKNOWN,
   APPLICATIONSTARTCOMMAND,
   APPLICATIONID,
   PROPERTYEVALUATION,
   METHODEVALUATION,
-  PIPENAME
+  PIPENAME,
+  PDBINDEXCACHEDIRECTORY,
+  MODULEINCLUDE,
+  MODULEEXCLUDE,
+  EVALTIMEOUT,
+  SNAPSHOTEVALTIMEOUT,
+  PAUSETIMEOUT
 };
 const option::Descriptor usage[] = {
     // The first dummy Descriptor is used for unknown options,
@@ -74,9 +104,58 @@ const option::Descriptor usage[] = {
     {PIPENAME, 0, "", kPipeNameOption.c_str(), option::Arg::Optional,
      "  --pipe-name  \tThe name of the pipe the debugger will use to"
      "communicate with the agent."},
+    {PDBINDEXCACHEDIRECTORY, 0, "", kPdbIndexCacheDirectoryOption.c_str(),
+     option::Arg::Optional,
+     "  --pdb-index-cache-directory  \tDirectory where the debugger caches "
+     "the indices it builds from PDB files. Debuggers running on the same "
+     "machine share the cache files, and the memory of the indices they "
+     "map from them."},
+    {MODULEINCLUDE, 0, "", kModuleIncludeOption.c_str(),
+     option::Arg::Optional,
+     "  --module-include  \tComma-separated file name patterns (with * and ?) "
+     "of the modules whose PDB files are read even if they are excluded."},
+    {MODULEEXCLUDE, 0, "", kModuleExcludeOption.c_str(),
+     option::Arg::Optional,
+     "  --module-exclude  \tComma-separated file name patterns (with * and ?) "
+     "of the modules whose PDB files are not read. Defaults to the .NET "
+     "framework assemblies."},
+    {EVALTIMEOUT, 0, "", kEvalTimeoutOption.c_str(), option::Arg::Optional,
+     "  --eval-timeout-ms  \tMilliseconds a function evaluation (such as a "
+     "property getter) may run before it is aborted. Defaults to 1000."},
+    {SNAPSHOTEVALTIMEOUT, 0, "", kSnapshotEvalTimeoutOption.c_str(),
+     option::Arg::Optional,
+     "  --snapshot-eval-timeout-ms  \tMilliseconds after a breakpoint hit "
+     "during which its snapshot may perform function evaluations. Defaults "
+     "to 5000."},
+    {PAUSETIMEOUT, 0, "", kPauseTimeoutOption.c_str(), option::Arg::Optional,
+     "  --pause-timeout-ms  \tMilliseconds a breakpoint hit may keep its "
+     "thread stopped. Snapshots that take longer are reported as truncated. "
+     "Defaults to 10000."},
     {0, 0, 0, 0, 0, 0}  // Needs this, otherwise the parser throws error.
 };
 
+// Sets timeout to the number of milliseconds given to option, if it is
+// given. Returns false if the number is not valid.
+bool ParseTimeout(const option::Option &option,
+                  std::chrono::milliseconds *timeout) {
+  if (!option.count() || !option.arg) {
+    return true;
+  }
+
+  try {
+    int milliseconds = stoi(string(option.arg));
+    if (milliseconds <= 0) {
+      cerr << "--" << option.desc->longopt << " has to be positive.";
+      return false;
+    }
+    *timeout = std::chrono::milliseconds(milliseconds);
+    return true;
+  } catch (std::exception &ex) {
+    cerr << "--" << option.desc->longopt << " is not a valid number.";
+    return false;
+  }
+}
+
 int main(int argc, char *argv[]) {
   if (argc > 0) {
     // Skips first argument.
@@ -125,6 +204,20 @@ int main(int argc, char *argv[]) {
   Debugger debugger(pipe_name);
   HRESULT hr;
 
+  if (options[PDBINDEXCACHEDIRECTORY].count() &&
+      options[PDBINDEXCACHEDIRECTORY].arg) {
+    debugger.SetPdbIndexCacheDirectory(
+        string(options[PDBINDEXCACHEDIRECTORY].arg));
+  }
+
+  if (options[MODULEINCLUDE].count() && options[MODULEINCLUDE].arg) {
+    debugger.SetModuleIncludePatterns(string(options[MODULEINCLUDE].arg));
+  }
+
+  if (options[MODULEEXCLUDE].count() && options[MODULEEXCLUDE].arg) {
+    debugger.SetModuleExcludePatterns(string(options[MODULEEXCLUDE].arg));
+  }
+
   if (options[APPLICATIONSTARTCOMMAND].count()) {
     string command_line = string(options[APPLICATIONSTARTCOMMAND].arg);
     std::vector<WCHAR> wchar_command_line =
@@ -158,6 +251,20 @@ int main(int argc, char *argv[]) {
   debugger.SetPropertyEvaluation(property_evaluation);
   debugger.SetMethodEvaluation(method_evaluation);
 
+  std::chrono::milliseconds eval_timeout =
+      EvalCoordinator::kDefaultEvalTimeout;
+  std::chrono::milliseconds snapshot_eval_timeout =
+      EvalCoordinator::kDefaultSnapshotEvalTimeout;
+  std::chrono::milliseconds pause_timeout =
+      EvalCoordinator::kDefaultPauseTimeout;
+  if (!ParseTimeout(options[EVALTIMEOUT], &eval_timeout) ||
+      !ParseTimeout(options[SNAPSHOTEVALTIMEOUT], &snapshot_eval_timeout) ||
+      !ParseTimeout(options[PAUSETIMEOUT], &pause_timeout)) {
+    return -1;
+  }
+  debugger.SetEvalTimeouts(eval_timeout, snapshot_eval_timeout);
+  debugger.SetPauseTimeout(pause_timeout);
+
   // This will launch an infinite while loop to wait and read.
   // When the server connection of the named pipe breaks, the loop
   // will be broken and the application process will be terminated
@@ -20,6 +20,7 @@
 
 using std::cerr;
 using std::string;
+using std::vector;
 using namespace google::cloud::diagnostics::debug;
 
 namespace google_cloud_debugger {
@@ -71,6 +72,50 @@ HRESULT BreakpointClient::ReadBreakpoint(Breakpoint *breakpoint) {
   return S_OK;
 }
 
+HRESULT BreakpointClient::ReadBreakpoints(vector<Breakpoint> *breakpoints) {
+  if (!breakpoints) {
+    return E_INVALIDARG;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  string buffer;
+  std::swap(buffer, buffer_);
+  string str;
+
+  // Read until the buffer holds the whole first message. It is a batch if
+  // the start of a batch comes before the start of any breakpoint.
+  bool is_batch = false;
+  std::size_t found_end = string::npos;
+  while (true) {
+    std::size_t batch_start = buffer.find(kStartBatchMessage);
+    std::size_t breakpoint_start = buffer.find(kStartBreakpointMessage);
+    is_batch = batch_start != string::npos &&
+               (breakpoint_start == string::npos ||
+                batch_start < breakpoint_start);
+    if (is_batch) {
+      found_end = buffer.find(kEndBatchMessage, batch_start);
+    } else {
+      found_end = buffer.find(kEndBreakpointMessage);
+    }
+
+    if (found_end != string::npos) {
+      break;
+    }
+
+    HRESULT result = pipe_->Read(&str);
+    if (FAILED(result)) {
+      return result;
+    }
+    buffer += str;
+    str.clear();
+  }
+
+  found_end +=
+      is_batch ? kEndBatchMessage.size() : kEndBreakpointMessage.size();
+  buffer_.append(buffer, found_end, string::npos);
+  return ParseBreakpointMessages(buffer, 0, found_end, breakpoints);
+}
+
 HRESULT BreakpointClient::WriteBreakpoint(const Breakpoint &breakpoint) {
   string bp_str;
   if (!breakpoint.SerializeToString(&bp_str)) {
@@ -90,4 +135,31 @@ HRESULT BreakpointClient::ShutDown() {
   return S_OK;
 }
 
+HRESULT BreakpointClient::ParseBreakpointMessages(
+    const string &buffer, std::size_t start, std::size_t end,
+    vector<Breakpoint> *breakpoints) {
+  while (true) {
+    std::size_t found_start = buffer.find(kStartBreakpointMessage, start);
+    if (found_start == string::npos || found_start >= end) {
+      return S_OK;
+    }
+
+    found_start += kStartBreakpointMessage.size();
+    std::size_t found_end = buffer.find(kEndBreakpointMessage, found_start);
+    if (found_end == string::npos || found_end > end) {
+      cerr << "invalid breakpoint message" << std::endl;
+      return E_FAIL;
+    }
+
+    Breakpoint breakpoint;
+    if (!breakpoint.ParseFromArray(buffer.data() + found_start,
+                                   found_end - found_start)) {
+      cerr << "failed to serialize from protobuf" << std::endl;
+      return E_FAIL;
+    }
+    breakpoints->push_back(std::move(breakpoint));
+    start = found_end + kEndBreakpointMessage.size();
+  }
+}
+
 }  // namespace google_cloud_debugger
@@ -20,6 +20,7 @@
 #include <iostream>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #include "dbg_breakpoint.h"
 #include "constants.h"
@@ -46,6 +47,13 @@ class BreakpointClient {
   HRESULT ReadBreakpoint(
       google::cloud::diagnostics::debug::Breakpoint *breakpoint);
 
+  // Reads the next message from a breakpoint server, which is either a
+  // single breakpoint or a batch of them, and appends its breakpoints to
+  // breakpoints. This function will block until there is a message to
+  // read.
+  HRESULT ReadBreakpoints(
+      std::vector<google::cloud::diagnostics::debug::Breakpoint> *breakpoints);
+
   // Writes a breakpoint to a breakpoint server
   // and returns an HRESULT.
   HRESULT WriteBreakpoint(
@@ -55,6 +63,12 @@ class BreakpointClient {
   HRESULT ShutDown();
 
  private:
+  // Parses the breakpoint messages in buffer between positions start and
+  // end and appends them to breakpoints.
+  static HRESULT ParseBreakpointMessages(
+      const std::string &buffer, std::size_t start, std::size_t end,
+      std::vector<google::cloud::diagnostics::debug::Breakpoint> *breakpoints);
+
   // The pipe client to send messages.
   std::unique_ptr<INamedPipe> pipe_;
 
@@ -20,21 +20,61 @@
 #include <iostream>
 
 #include "breakpoint_location_collection.h"
+#include "constants.h"
 #include "dbg_object.h"
 #include "debugger_callback.h"
 #include "i_eval_coordinator.h"
+#include "method_token_table.h"
 #include "named_pipe_client.h"
+#include "string_stream_wrapper.h"
 
 using google::cloud::diagnostics::debug::Breakpoint;
 using google::cloud::diagnostics::debug::SourceLocation;
+using google_cloud_debugger_portable_pdb::IPortablePdbFile;
 using std::cerr;
 using std::cout;
+using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
 using std::vector;
 
 namespace google_cloud_debugger {
 
+namespace {
+
+// Status of the breakpoints whose module was unloaded.
+const char kUnboundBreakpointMessage[] =
+    "The module of the breakpoint was unloaded. The breakpoint is set again "
+    "if the module is loaded again.";
+
+// Removes the breakpoint with the given id from breakpoints, if any.
+void RemoveBreakpointWithId(vector<shared_ptr<DbgBreakpoint>> *breakpoints,
+                            const string &id) {
+  breakpoints->erase(
+      std::remove_if(breakpoints->begin(), breakpoints->end(),
+                     [&id](const shared_ptr<DbgBreakpoint> &breakpoint) {
+                       return breakpoint->GetId() == id;
+                     }),
+      breakpoints->end());
+}
+
+// Deactivates debug_breakpoint, if any.
+void DeactivateCorDebugBreakpoint(ICorDebugBreakpoint *debug_breakpoint) {
+  if (!debug_breakpoint) {
+    return;
+  }
+
+  HRESULT hr = debug_breakpoint->Activate(FALSE);
+  if (FAILED(hr)) {
+    cerr << "Failed to deactivate breakpoint with HRESULT: " << std::hex
+         << hr;
+  }
+}
+
+}  // namespace
+
+BreakpointCollection::~BreakpointCollection() { delete snapshot_.load(); }
+
 HRESULT BreakpointCollection::SetDebuggerCallback(
     DebuggerCallback *debugger_callback) {
   if (!debugger_callback) {
@@ -84,6 +124,7 @@ HRESULT BreakpointCollection::CreateAndInitializeBreakpointClient(
 }
 
 HRESULT BreakpointCollection::WriteBreakpoint(const Breakpoint &breakpoint) {
+  std::lock_guard<std::mutex> lock(write_mutex_);
   if (!breakpoint_client_write_) {
     HRESULT hr = CreateAndInitializeBreakpointClient(
         &breakpoint_client_write_, debugger_callback_->GetPipeName());
@@ -110,33 +151,34 @@ HRESULT BreakpointCollection::ReadBreakpoint(Breakpoint *breakpoint) {
 }
 
 HRESULT BreakpointCollection::EvaluateAndPrintBreakpoint(
-    mdMethodDef function_token, ULONG32 il_offset,
+    ICorDebugBreakpoint *debug_breakpoint,
     IEvalCoordinator *eval_coordinator, ICorDebugThread *debug_thread,
     const std::vector<
         std::shared_ptr<google_cloud_debugger_portable_pdb::IPortablePdbFile>>
         &pdb_files) {
-  HRESULT hr = S_FALSE;
-  std::vector<std::shared_ptr<DbgBreakpoint>> matched_breakpoints;
+  CComPtr<ICorDebugFunctionBreakpoint> function_breakpoint;
+  HRESULT hr = GetFunctionBreakpoint(debug_breakpoint, &function_breakpoint);
+  if (FAILED(hr)) {
+    return hr;
+  }
 
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    for (auto &&kvp : location_to_breakpoints_) {
-      // Since the breakpoints are grouped by location, if
-      // one matches, all of them do.
-      if (kvp.second->GetMethodToken() == function_token
-        && kvp.second->GetILOffset() == il_offset) {
-        matched_breakpoints = kvp.second->GetBreakpoints();
-        break;
-      }
-    }
+  // The snapshot is kept alive until the breakpoints are processed, so
+  // they are used in place instead of being copied.
+  std::size_t slot;
+  const BreakpointSnapshot *snapshot = AcquireSnapshot(&slot);
+  if (!snapshot) {
+    return S_FALSE;
   }
 
-  if (matched_breakpoints.empty()) {
+  auto location = snapshot->breakpoints.find(function_breakpoint);
+  if (location == snapshot->breakpoints.end() || location->second.empty()) {
+    ReleaseSnapshot(slot);
     return S_FALSE;
   }
 
-  hr = eval_coordinator->ProcessBreakpoints(
-      debug_thread, this, std::move(matched_breakpoints), pdb_files);
+  hr = eval_coordinator->ProcessBreakpoints(debug_thread, this,
+                                            location->second, pdb_files);
+  ReleaseSnapshot(slot);
   if (FAILED(hr)) {
     cerr << "Failed to get stack frame's information.";
   }
@@ -144,125 +186,526 @@ HRESULT BreakpointCollection::EvaluateAndPrintBreakpoint(
   return hr;
 }
 
-HRESULT BreakpointCollection::ReadAndParseBreakpoint(
-    DbgBreakpoint *breakpoint) {
-  assert(breakpoint != nullptr);
+HRESULT BreakpointCollection::RemoveBreakpointsInModule(
+    ICorDebugModule *debug_module, vector<Breakpoint> *unbound_breakpoints) {
+  if (!debug_module || !unbound_breakpoints) {
+    return E_INVALIDARG;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // The breakpoints stay active for the agent, which is only told that
+  // they are unbound. They are kept unset, without any reference to the
+  // module, until a module with their document is loaded again, such as
+  // when a collectible AssemblyLoadContext reloads the assembly. All of
+  // them are copied before the collection is changed.
+  BreakpointGroupMap unset_locations;
+  vector<Breakpoint> unbound;
+  for (const auto &location : location_to_breakpoints_) {
+    if (location.second->GetCorDebugModule() != debug_module) {
+      continue;
+    }
+
+    vector<shared_ptr<DbgBreakpoint>> &unset =
+        unset_locations[location.first];
+    for (const auto &breakpoint : location.second->GetBreakpoints()) {
+      shared_ptr<DbgBreakpoint> unset_breakpoint(new (std::nothrow)
+                                                     DbgBreakpoint);
+      if (!unset_breakpoint) {
+        return E_OUTOFMEMORY;
+      }
+
+      unset_breakpoint->Initialize(*breakpoint);
+      unset_breakpoint->SetActivated(true);
+
+      Breakpoint unbound_breakpoint;
+      HRESULT hr = unset_breakpoint->PopulateBreakpoint(&unbound_breakpoint);
+      if (FAILED(hr)) {
+        return hr;
+      }
+      unbound_breakpoint.set_activated(true);
+      SetInfoStatusMessage(&unbound_breakpoint, kUnboundBreakpointMessage);
+
+      unbound.push_back(std::move(unbound_breakpoint));
+      unset.push_back(std::move(unset_breakpoint));
+    }
+  }
+
+  if (unset_locations.empty()) {
+    return S_OK;
+  }
+
+  for (auto &location : unset_locations) {
+    vector<shared_ptr<DbgBreakpoint>> &pending =
+        pending_locations_[location.first];
+    pending.insert(pending.end(), location.second.begin(),
+                   location.second.end());
+    RemoveLocation(location_to_breakpoints_.find(location.first));
+  }
+
+  unbound_breakpoints->insert(unbound_breakpoints->end(), unbound.begin(),
+                              unbound.end());
+  return PublishSnapshot();
+}
+
+HRESULT BreakpointCollection::ReadAndParseBreakpoints(
+    vector<shared_ptr<DbgBreakpoint>> *breakpoints) {
+  assert(breakpoints != nullptr);
 
-  Breakpoint breakpoint_read;
-  HRESULT hr = ReadBreakpoint(&breakpoint_read);
+  if (!breakpoint_client_read_) {
+    HRESULT hr = CreateAndInitializeBreakpointClient(
+        &breakpoint_client_read_, debugger_callback_->GetPipeName());
+    if (FAILED(hr)) {
+      cerr << "Failed to initialize breakpoint client for reading breakpoints.";
+      return hr;
+    }
+  }
+
+  vector<Breakpoint> breakpoints_read;
+  HRESULT hr = breakpoint_client_read_->ReadBreakpoints(&breakpoints_read);
   if (FAILED(hr)) {
     cerr << "Failed to parse breakpoint.";
     return hr;
   }
 
-  SourceLocation location = breakpoint_read.location();
+  for (const Breakpoint &breakpoint_read : breakpoints_read) {
+    shared_ptr<DbgBreakpoint> breakpoint(new (std::nothrow) DbgBreakpoint);
+    if (!breakpoint) {
+      return E_OUTOFMEMORY;
+    }
+
+    const SourceLocation &location = breakpoint_read.location();
 
-  // For now, we don't have a use for column so we just assign it to 0.
-  breakpoint->Initialize(
-      location.path(), breakpoint_read.id(), location.line(), 0,
-      breakpoint_read.log_point(),
-      breakpoint_read.log_message_format(),
-      breakpoint_read.log_level(),
-      breakpoint_read.condition(),
-      std::vector<std::string>(breakpoint_read.expressions().begin(),
-                               breakpoint_read.expressions().end()));
-  breakpoint->SetActivated(breakpoint_read.activated());
-  breakpoint->SetKillServer(breakpoint_read.kill_server());
+    // For now, we don't have a use for column so we just assign it to 0.
+    breakpoint->Initialize(
+        location.path(), breakpoint_read.id(), location.line(), 0,
+        breakpoint_read.log_point(),
+        breakpoint_read.log_message_format(),
+        breakpoint_read.log_level(),
+        breakpoint_read.condition(),
+        std::vector<std::string>(breakpoint_read.expressions().begin(),
+                                 breakpoint_read.expressions().end()));
+    breakpoint->SetActivated(breakpoint_read.activated());
+    breakpoint->SetKillServer(breakpoint_read.kill_server());
+    breakpoints->push_back(std::move(breakpoint));
+  }
 
   return S_OK;
 }
 
 HRESULT BreakpointCollection::UpdateBreakpoint(
     const DbgBreakpoint &breakpoint) {
-  HRESULT hr;
-  // Find group of breakpoints at the same location.
-  std::string breakpoint_location = breakpoint.GetBreakpointLocation();
+  shared_ptr<DbgBreakpoint> update(new (std::nothrow) DbgBreakpoint);
+  if (!update) {
+    return E_OUTOFMEMORY;
+  }
+
+  update->Initialize(breakpoint);
+  update->SetActivated(breakpoint.Activated());
+  update->SetKillServer(breakpoint.GetKillServer());
+  return UpdateBreakpoints({update});
+}
 
+HRESULT BreakpointCollection::UpdateBreakpoints(
+    const vector<shared_ptr<DbgBreakpoint>> &breakpoints) {
+  std::lock_guard<std::mutex> update_lock(update_mutex_);
+  HRESULT result = S_OK;
+
+  // The activated breakpoints at locations that have no breakpoint yet,
+  // by location string.
+  BreakpointGroupMap new_locations;
   {
-    std::lock_guard<std::mutex> lock(mutex_);  
-    if (location_to_breakpoints_.find(breakpoint_location)
-      != location_to_breakpoints_.end()) {
-      hr = location_to_breakpoints_[breakpoint_location]->UpdateBreakpoints(breakpoint);
-      if (FAILED(hr)) {
-        cerr << "Failed to activate breakpoint.";
-        return hr;
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool changed = false;
+    for (const auto &breakpoint : breakpoints) {
+      string location_string = breakpoint->GetBreakpointLocation();
+      auto location = location_to_breakpoints_.find(location_string);
+      if (location != location_to_breakpoints_.end()) {
+        HRESULT hr = location->second->UpdateBreakpoints(*breakpoint);
+        if (FAILED(hr)) {
+          cerr << "Failed to update breakpoint " << breakpoint->GetId();
+          result = hr;
+          continue;
+        }
+        changed = true;
+        continue;
       }
 
-      if (hr == S_OK) {
+      // The breakpoints at a location whose module was unloaded wait for
+      // the module to be loaded again.
+      auto pending_location = pending_locations_.find(location_string);
+      if (pending_location != pending_locations_.end()) {
+        RemoveBreakpointWithId(&pending_location->second,
+                               breakpoint->GetId());
+        if (breakpoint->Activated()) {
+          pending_location->second.push_back(breakpoint);
+        }
+        if (pending_location->second.empty()) {
+          pending_locations_.erase(pending_location);
+        }
+        continue;
+      }
+
+      // A breakpoint that is removed in the batch that adds it is never
+      // set at all.
+      vector<shared_ptr<DbgBreakpoint>> &pending =
+          new_locations[location_string];
+      RemoveBreakpointWithId(&pending, breakpoint->GetId());
+      if (breakpoint->Activated()) {
+        pending.push_back(breakpoint);
+      }
+    }
+
+    if (changed) {
+      HRESULT hr = PublishSnapshot();
+      if (FAILED(hr)) {
         return hr;
       }
     }
   }
 
-  // Otherwise, we have to create a new breakpoint from scratch.
-  std::shared_ptr<DbgBreakpoint> new_breakpoint(new (std::nothrow)
-                                                    DbgBreakpoint);
-  if (!new_breakpoint) {
-    return E_OUTOFMEMORY;
+  HRESULT hr = SetNewLocations(&new_locations, true);
+  if (FAILED(hr)) {
+    result = hr;
   }
 
-  new_breakpoint->Initialize(breakpoint);
+  if (result == S_OK && !new_locations.empty()) {
+    result = S_FALSE;
+  }
+  return result;
+}
 
-  // No existing breakpoint with the same location so we have to
-  // try to set and activate the breakpoint by searching through PDB files
-  // for a matching location.
-  bool found_bp = false;
-  for (auto pdb_file : debugger_callback_->GetPdbFiles()) {
-    if (!pdb_file) {
-      continue;
+HRESULT BreakpointCollection::SetPendingBreakpoints() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_locations_.empty()) {
+      return S_FALSE;
     }
+  }
+
+  std::lock_guard<std::mutex> update_lock(update_mutex_);
+  BreakpointGroupMap pending_locations;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_locations.swap(pending_locations_);
+  }
+
+  HRESULT hr = SetNewLocations(&pending_locations, false);
+
+  // The locations that are in none of the indexed documents keep waiting.
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &location : pending_locations) {
+    vector<shared_ptr<DbgBreakpoint>> &pending =
+        pending_locations_[location.first];
+    pending.insert(pending.end(), location.second.begin(),
+                   location.second.end());
+  }
+  return hr;
+}
+
+size_t BreakpointCollection::GetLocationCount() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return location_to_breakpoints_.size();
+}
+
+size_t BreakpointCollection::GetPendingLocationCount() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pending_locations_.size();
+}
 
-    if (!pdb_file->ParsePdbFile()) {
+HRESULT BreakpointCollection::SetNewLocations(
+    BreakpointGroupMap *new_locations, bool parse_pdb_files) {
+  HRESULT result = S_OK;
+
+  // Only the first breakpoint of a new location has to be set by
+  // searching the documents of the PDB files. Group these by file path so
+  // that the documents of each file are looked up once for all of them.
+  BreakpointGroupMap unset_breakpoints;
+
+  // The location string each breakpoint in unset_breakpoints was requested
+  // at, which is its key in new_locations. Setting a breakpoint may move it
+  // to the line of the next sequence point, but it is still looked up and
+  // deactivated by this one.
+  std::unordered_map<const DbgBreakpoint *, string> requested_locations;
+  for (const auto &location : *new_locations) {
+    if (location.second.empty()) {
       continue;
     }
 
-    if (!new_breakpoint->TrySetBreakpoint(pdb_file.get())) {
-      continue;
+    shared_ptr<DbgBreakpoint> new_breakpoint(new (std::nothrow)
+                                                 DbgBreakpoint);
+    if (!new_breakpoint) {
+      return E_OUTOFMEMORY;
     }
 
-    hr = ActivateBreakpointHelper(new_breakpoint.get(), pdb_file.get());
+    new_breakpoint->Initialize(*location.second.front());
+    requested_locations[new_breakpoint.get()] = location.first;
+    unset_breakpoints[new_breakpoint->GetFilePath()].push_back(
+        std::move(new_breakpoint));
+  }
+
+  vector<shared_ptr<DbgBreakpoint>> set_breakpoints;
+  DocumentPathIndex *document_path_index =
+      debugger_callback_->GetDocumentPathIndex();
+  if (!unset_breakpoints.empty()) {
+    HRESULT hr = TrySetBreakpointsInDocuments(
+        *document_path_index, &unset_breakpoints, &set_breakpoints);
     if (FAILED(hr)) {
-      cerr << "Failed to activate breakpoint.";
-      return hr;
+      result = hr;
     }
-    found_bp = true;
-    break;
   }
 
-  if (!found_bp) {
-    return S_FALSE;
+  if (parse_pdb_files && !unset_breakpoints.empty()) {
+    // The PDB files that are not in the index yet are still queued or being
+    // parsed by the module indexer. Parse (or wait for) them one at a time,
+    // starting with the ones that are already parsed, until the locations
+    // of all the breakpoints are found.
+    std::vector<std::shared_ptr<IPortablePdbFile>> pdb_files =
+        debugger_callback_->GetPdbFiles();
+    std::stable_partition(
+        pdb_files.begin(), pdb_files.end(),
+        [](const std::shared_ptr<IPortablePdbFile> &pdb_file) {
+          return pdb_file && pdb_file->IsParsed();
+        });
+
+    for (const auto &pdb_file : pdb_files) {
+      if (!pdb_file || document_path_index->HasPdbFile(pdb_file.get())) {
+        continue;
+      }
+
+      if (!pdb_file->ParsePdbFile()) {
+        continue;
+      }
+
+      document_path_index->AddPdbFile(pdb_file);
+      HRESULT hr = TrySetBreakpointsInDocuments(
+          *document_path_index, &unset_breakpoints, &set_breakpoints);
+      if (FAILED(hr)) {
+        result = hr;
+      }
+
+      if (unset_breakpoints.empty()) {
+        break;
+      }
+    }
   }
 
-  // Create a new location collection.
-  {
+  // The locations of the breakpoints that could not be set are all that is
+  // left in new_locations once the others are added.
+  BreakpointGroupMap unset_locations;
+  for (const auto &file : unset_breakpoints) {
+    for (const auto &breakpoint : file.second) {
+      const string &location_string = requested_locations[breakpoint.get()];
+      unset_locations[location_string] =
+          std::move((*new_locations)[location_string]);
+    }
+  }
+
+  if (!set_breakpoints.empty()) {
+    // Add all the new locations before publishing a single snapshot, so
+    // that hits see either none or all of them.
     std::lock_guard<std::mutex> lock(mutex_);
-    std::unique_ptr<BreakpointLocationCollection> bp_location(new BreakpointLocationCollection());
-    hr = bp_location->AddFirstBreakpoint(std::move(new_breakpoint));
+    for (auto &new_breakpoint : set_breakpoints) {
+      // A breakpoint that cannot be added is never hit, so the
+      // ICorDebugBreakpoint activated for it is deactivated again.
+      CComPtr<ICorDebugBreakpoint> debug_breakpoint;
+      new_breakpoint->GetCorDebugBreakpoint(&debug_breakpoint);
+
+      std::unique_ptr<BreakpointLocationCollection> bp_location(
+          new (std::nothrow) BreakpointLocationCollection());
+      if (!bp_location) {
+        cerr << "Failed to create breakpoint location.";
+        DeactivateCorDebugBreakpoint(debug_breakpoint);
+        result = E_OUTOFMEMORY;
+        continue;
+      }
+
+      const string &location_string =
+          requested_locations[new_breakpoint.get()];
+      const vector<shared_ptr<DbgBreakpoint>> &pending =
+          (*new_locations)[location_string];
+      BreakpointLocationCollection *location = bp_location.get();
+      HRESULT hr = bp_location->AddFirstBreakpoint(std::move(new_breakpoint));
+      if (SUCCEEDED(hr)) {
+        hr = AddLocation(location_string, std::move(bp_location));
+      }
+
+      if (FAILED(hr)) {
+        cerr << "Failed to activate breakpoint.";
+        DeactivateCorDebugBreakpoint(debug_breakpoint);
+        result = hr;
+        continue;
+      }
+
+      // The other breakpoints at this location share the
+      // ICorDebugFunctionBreakpoint that was just set.
+      for (size_t i = 1; i < pending.size(); ++i) {
+        hr = location->UpdateBreakpoints(*pending[i]);
+        if (FAILED(hr)) {
+          cerr << "Failed to update breakpoint " << pending[i]->GetId();
+          result = hr;
+        }
+      }
+    }
+
+    HRESULT hr = PublishSnapshot();
     if (FAILED(hr)) {
-      return hr;
+      result = hr;
     }
+  }
+
+  new_locations->swap(unset_locations);
+  return result;
+}
+
+HRESULT BreakpointCollection::AddLocation(
+    const string &location_string,
+    std::unique_ptr<BreakpointLocationCollection> location) {
+  CComPtr<ICorDebugFunctionBreakpoint> function_breakpoint;
+  HRESULT hr = GetFunctionBreakpoint(location->GetCorDebugBreakpoint(),
+                                     &function_breakpoint);
+  if (FAILED(hr)) {
+    return hr;
+  }
+
+  auto existing = location_to_breakpoints_.find(location_string);
+  if (existing != location_to_breakpoints_.end()) {
+    RemoveLocation(existing);
+  }
+
+  // The location keeps a reference to the breakpoint, so the key stays
+  // valid for as long as the location is in the map.
+  function_breakpoint_to_location_[function_breakpoint] = location.get();
+  location_to_breakpoints_[location_string] = std::move(location);
+  return S_OK;
+}
+
+BreakpointCollection::LocationMap::iterator
+BreakpointCollection::RemoveLocation(LocationMap::iterator location) {
+  CComPtr<ICorDebugFunctionBreakpoint> function_breakpoint;
+  if (SUCCEEDED(GetFunctionBreakpoint(
+          location->second->GetCorDebugBreakpoint(), &function_breakpoint))) {
+    function_breakpoint_to_location_.erase(function_breakpoint);
+  }
+  return location_to_breakpoints_.erase(location);
+}
+
+HRESULT BreakpointCollection::PublishSnapshot() {
+  unique_ptr<BreakpointSnapshot> snapshot(new (std::nothrow)
+                                              BreakpointSnapshot());
+  if (!snapshot) {
+    cerr << "Cannot create breakpoint snapshot.";
+    return E_OUTOFMEMORY;
+  }
+
+  const BreakpointSnapshot *current = snapshot_.load();
+  if (current) {
+    snapshot->version = current->version + 1;
+  }
+
+  snapshot->breakpoints.reserve(function_breakpoint_to_location_.size());
+  for (const auto &location : function_breakpoint_to_location_) {
+    snapshot->breakpoints[location.first] = location.second->GetBreakpoints();
+  }
+
+  current = snapshot_.exchange(snapshot.release());
+  if (current) {
+    retired_snapshots_.emplace_back(current);
+  }
 
-    location_to_breakpoints_[breakpoint.GetBreakpointLocation()]
-      = std::move(bp_location);
+  // A hit that acquires a snapshot from now on gets the new one, so a
+  // retired snapshot that no slot holds is not read by anyone. The others
+  // are freed by a later call.
+  const BreakpointSnapshot *read_snapshots[kMaxSnapshotReaders];
+  for (std::size_t i = 0; i < kMaxSnapshotReaders; ++i) {
+    read_snapshots[i] = reader_snapshots_[i].load();
   }
+  const BreakpointSnapshot **read_snapshots_end =
+      read_snapshots + kMaxSnapshotReaders;
+  retired_snapshots_.erase(
+      std::remove_if(retired_snapshots_.begin(), retired_snapshots_.end(),
+                     [&](const unique_ptr<const BreakpointSnapshot> &retired) {
+                       return std::find(read_snapshots, read_snapshots_end,
+                                        retired.get()) == read_snapshots_end;
+                     }),
+      retired_snapshots_.end());
   return S_OK;
 }
 
+const BreakpointCollection::BreakpointSnapshot *
+BreakpointCollection::AcquireSnapshot(std::size_t *slot) {
+  const BreakpointSnapshot *snapshot = snapshot_.load();
+  if (!snapshot) {
+    return nullptr;
+  }
+
+  // Takes a free slot. All of them are busy only if more hits are in
+  // progress than kMaxSnapshotReaders, so the hit waits for one to end.
+  *slot = 0;
+  const BreakpointSnapshot *free_slot = nullptr;
+  while (!reader_snapshots_[*slot].compare_exchange_strong(free_slot,
+                                                           snapshot)) {
+    free_slot = nullptr;
+    *slot = (*slot + 1) % kMaxSnapshotReaders;
+    if (*slot == 0) {
+      std::this_thread::yield();
+    }
+  }
+
+  // The snapshot may have been retired, and even freed, before the slot
+  // was set. Once the slot holds the latest snapshot, PublishSnapshot
+  // sees it before freeing that snapshot.
+  const BreakpointSnapshot *latest = snapshot_.load();
+  while (latest != snapshot) {
+    snapshot = latest;
+    reader_snapshots_[*slot].store(snapshot);
+    latest = snapshot_.load();
+  }
+  return snapshot;
+}
+
+void BreakpointCollection::ReleaseSnapshot(std::size_t slot) {
+  reader_snapshots_[slot].store(nullptr);
+}
+
+HRESULT BreakpointCollection::GetFunctionBreakpoint(
+    ICorDebugBreakpoint *debug_breakpoint,
+    ICorDebugFunctionBreakpoint **function_breakpoint) {
+  if (!debug_breakpoint) {
+    return E_INVALIDARG;
+  }
+
+  // The callback may hand us a different interface pointer of the
+  // breakpoint than CreateBreakpoint did, but QueryInterface returns the
+  // same ICorDebugFunctionBreakpoint pointer for both.
+  HRESULT hr = debug_breakpoint->QueryInterface(
+      __uuidof(ICorDebugFunctionBreakpoint),
+      reinterpret_cast<void **>(function_breakpoint));
+  if (FAILED(hr)) {
+    cerr << "Failed to get ICorDebugFunctionBreakpoint.";
+  }
+  return hr;
+}
+
 HRESULT BreakpointCollection::SyncBreakpoints() {
-  DbgBreakpoint breakpoint;
+  vector<shared_ptr<DbgBreakpoint>> breakpoints;
   HRESULT hr = S_OK;
 
   while (true) {
-    hr = ReadAndParseBreakpoint(&breakpoint);
+    breakpoints.clear();
+    hr = ReadAndParseBreakpoints(&breakpoints);
     if (FAILED(hr)) {
       return hr;
     }
 
-    if (breakpoint.GetKillServer()) {
+    if (std::any_of(breakpoints.begin(), breakpoints.end(),
+                    [](const shared_ptr<DbgBreakpoint> &breakpoint) {
+                      return breakpoint->GetKillServer();
+                    })) {
       return S_OK;
     }
 
-    hr = UpdateBreakpoint(breakpoint);
+    hr = UpdateBreakpoints(breakpoints);
     if (FAILED(hr)) {
       cerr << "Failed to activate breakpoint.";
     }
@@ -278,7 +721,10 @@ HRESULT BreakpointCollection::CancelSyncBreakpoints() {
   // to shutdown as well.
   Breakpoint kill_breakpoint;
   kill_breakpoint.set_kill_server(true);
-  hr = breakpoint_client_write_->WriteBreakpoint(kill_breakpoint);
+  {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    hr = breakpoint_client_write_->WriteBreakpoint(kill_breakpoint);
+  }
 
   if (FAILED(hr)) {
 	  return hr;
@@ -299,6 +745,61 @@ HRESULT BreakpointCollection::CancelSyncBreakpoints() {
   return hr;
 }
 
+HRESULT BreakpointCollection::TrySetBreakpointsInDocuments(
+    const DocumentPathIndex &document_path_index,
+    BreakpointGroupMap *unset_breakpoints,
+    vector<shared_ptr<DbgBreakpoint>> *set_breakpoints) {
+  HRESULT result = S_OK;
+  auto file = unset_breakpoints->begin();
+  while (file != unset_breakpoints->end()) {
+    // The breakpoints of a file all have the same path segments.
+    vector<shared_ptr<DbgBreakpoint>> &breakpoints = file->second;
+    vector<DocumentPathMatch> matches = document_path_index.FindDocuments(
+        breakpoints.front()->GetFilePathSegments());
+
+    auto breakpoint = breakpoints.begin();
+    while (breakpoint != breakpoints.end()) {
+      HRESULT hr = TrySetBreakpointInDocuments(breakpoint->get(), matches);
+      if (hr == S_FALSE) {
+        ++breakpoint;
+        continue;
+      }
+
+      if (FAILED(hr)) {
+        cerr << "Failed to activate breakpoint " << (*breakpoint)->GetId();
+        result = hr;
+      } else {
+        set_breakpoints->push_back(std::move(*breakpoint));
+      }
+      breakpoint = breakpoints.erase(breakpoint);
+    }
+
+    if (breakpoints.empty()) {
+      file = unset_breakpoints->erase(file);
+    } else {
+      ++file;
+    }
+  }
+
+  return result;
+}
+
+HRESULT BreakpointCollection::TrySetBreakpointInDocuments(
+    DbgBreakpoint *breakpoint, const vector<DocumentPathMatch> &matches) {
+  for (const DocumentPathMatch &match : matches) {
+    const auto &document_indices = match.pdb_file->GetDocumentIndexTable();
+    if (match.document_index >= document_indices.size() ||
+        !breakpoint->TrySetBreakpoint(
+            *document_indices[match.document_index])) {
+      continue;
+    }
+
+    return ActivateBreakpointHelper(breakpoint, match.pdb_file.get());
+  }
+
+  return S_FALSE;
+}
+
 HRESULT BreakpointCollection::ActivateBreakpointHelper(
     DbgBreakpoint *breakpoint,
     google_cloud_debugger_portable_pdb::IPortablePdbFile *portable_pdb) {
@@ -328,164 +829,66 @@ HRESULT BreakpointCollection::ActivateBreakpointHelper(
     return hr;
   }
 
-  mdTypeDef type_def;
-  vector<WCHAR> method_name;
-  PCCOR_SIGNATURE signature;
-  ULONG method_virtual_addr;
-  hr = GetMethodData(metadata_import, breakpoint->GetMethodDef(), &type_def,
-                     &signature, &method_virtual_addr, &method_name);
-
+  // The method_def read from the PDB is the row of the method in the
+  // MethodDef table, which the method table of the module maps to the
+  // method token we need to set a breakpoint.
+  std::shared_ptr<const MethodTokenTable> method_tokens;
+  hr = debugger_callback_->GetMethodTokenTables()->GetTable(
+      debug_module, metadata_import, &method_tokens);
   if (FAILED(hr)) {
+    cerr << "Failed to read the methods of the module.";
     return hr;
   }
 
-  HCORENUM cor_enum = nullptr;
-  bool method_found = false;
-  bool has_error = false;
-
-  while (!method_found && !has_error) {
-    // Enumerate all the methods with the same name as this.
-    // We have to do this because given a method definition (that is parsed
-    // from a PDB file), there seems to be no function to translate
-    // that to a method token (from IMetaDataImport) and we need the
-    // method token to set a breakpoint.
-    // So what we have to do here is search for a method in
-    // IMetaDataImport->EnumMethodsWithName that has the same signature
-    // and use its method token.
-    vector<mdMethodDef> method_tokens(100, 0);
-    ULONG method_defs_returned = 0;
-    hr = metadata_import->EnumMethodsWithName(
-        &cor_enum, type_def, method_name.data(), method_tokens.data(),
-        method_tokens.size(), &method_defs_returned);
-
-    if (FAILED(hr) || method_defs_returned == 0) {
-      cerr << "Failed to get method from IMetadataImport.";
-      has_error = true;
-      break;
-    }
-
-    // For all the methods with the same name, search for the method
-    // that has the same signature and virtual address and uses its method token
-    // to activate the breakpoint.
-    for (size_t i = 0; i < method_defs_returned; ++i) {
-      ULONG temp_method_name_length;
-      DWORD temp_flags1;
-      PCCOR_SIGNATURE temp_signature;
-      ULONG temp_signature_blob;
-      ULONG temp_rva;
-      DWORD temp_flags2;
-
-      hr = metadata_import->GetMethodProps(
-          method_tokens[i], &type_def, nullptr, 0, &temp_method_name_length,
-          &temp_flags1, &temp_signature, &temp_signature_blob, &temp_rva,
-          &temp_flags2);
-
-      if (signature != temp_signature || method_virtual_addr != temp_rva) {
-        continue;
-      }
-
-      // Activates the breakpoint in this method.
-      CComPtr<ICorDebugFunction> debug_function;
-      breakpoint->SetMethodToken(method_tokens[i]);
-      hr =
-          debug_module->GetFunctionFromToken(method_tokens[i], &debug_function);
-      if (FAILED(hr)) {
-        cerr << "Failed to get function from function token "
-             << method_tokens[i] << " with HRESULT " << std::hex << hr;
-        has_error = true;
-        break;
-      }
-
-      CComPtr<ICorDebugCode> debug_code;
-      hr = debug_function->GetILCode(&debug_code);
-      if (FAILED(hr)) {
-        cerr << "Failed to get ICorDebugCode from function with hr " << std::hex
-             << hr;
-        has_error = true;
-        break;
-      }
-
-      CComPtr<ICorDebugFunctionBreakpoint> function_breakpoint;
-      hr = debug_code->CreateBreakpoint(breakpoint->GetILOffset(),
-                                        &function_breakpoint);
-
-      if (FAILED(hr)) {
-        cerr << "Failed to set breakpoint in at offset "
-             << breakpoint->GetILOffset() << " in function "
-             << breakpoint->GetMethodToken() << " with HRESULT " << std::hex
-             << hr;
-        has_error = true;
-        break;
-      }
-
-      hr = function_breakpoint->Activate(TRUE);
-      if (FAILED(hr)) {
-        cerr << "Failed to activate breakpoint in at offset "
-             << breakpoint->GetILOffset() << " in function "
-             << breakpoint->GetMethodToken() << " with HRESULT " << std::hex
-             << hr;
-        has_error = true;
-        break;
-      }
-
-      breakpoint->SetMethodName(std::move(method_name));
-      breakpoint->SetCorDebugBreakpoint(function_breakpoint);
-      method_found = true;
-      break;
-    }
-  }
-
-  if (cor_enum) {
-    metadata_import->CloseEnum(cor_enum);
+  const MethodTokenInfo *method =
+      method_tokens->FindMethod(breakpoint->GetMethodDef());
+  if (!method) {
+    cerr << "Failed to find method " << breakpoint->GetMethodDef()
+         << " in the module.";
+    return E_FAIL;
   }
 
-  if (has_error) {
+  // Activates the breakpoint in this method.
+  breakpoint->SetMethodToken(method->method_token);
+  CComPtr<ICorDebugFunction> debug_function;
+  hr = debug_module->GetFunctionFromToken(method->method_token,
+                                          &debug_function);
+  if (FAILED(hr)) {
+    cerr << "Failed to get function from function token "
+         << method->method_token << " with HRESULT " << std::hex << hr;
     return hr;
   }
 
-  if (!method_found) {
-    return E_FAIL;
-  }
-
-  return S_OK;
-}
-
-HRESULT BreakpointCollection::GetMethodData(IMetaDataImport *metadata_import,
-                                            uint32_t method_def,
-                                            mdTypeDef *type_def,
-                                            PCCOR_SIGNATURE *signature,
-                                            ULONG *virtual_address,
-                                            std::vector<WCHAR> *method_name) {
-  if (!type_def || !metadata_import || !method_name || !signature) {
-    return E_INVALIDARG;
+  CComPtr<ICorDebugCode> debug_code;
+  hr = debug_function->GetILCode(&debug_code);
+  if (FAILED(hr)) {
+    cerr << "Failed to get ICorDebugCode from function with hr " << std::hex
+         << hr;
+    return hr;
   }
 
-  HRESULT hr;
-  ULONG method_name_length;
-  DWORD flags1;
-  ULONG signature_blob;
-  ULONG rva;
-  DWORD flags2;
-
-  hr = metadata_import->GetMethodProps(
-      method_def, type_def, nullptr, 0, &method_name_length, &flags1, signature,
-      &signature_blob, virtual_address, &flags2);
+  CComPtr<ICorDebugFunctionBreakpoint> function_breakpoint;
+  hr = debug_code->CreateBreakpoint(breakpoint->GetILOffset(),
+                                    &function_breakpoint);
   if (FAILED(hr)) {
-    cerr << "Failed to get method props for method " << method_def;
+    cerr << "Failed to set breakpoint in at offset "
+         << breakpoint->GetILOffset() << " in function "
+         << breakpoint->GetMethodToken() << " with HRESULT " << std::hex << hr;
     return hr;
   }
 
-  method_name->resize(method_name_length);
-  hr = metadata_import->GetMethodProps(
-      method_def, type_def, method_name->data(), method_name->size(),
-      &method_name_length, &flags1, signature, &signature_blob, virtual_address,
-      &flags2);
-
+  hr = function_breakpoint->Activate(TRUE);
   if (FAILED(hr)) {
-    cerr << "Failed to get method props for method " << method_def;
+    cerr << "Failed to activate breakpoint in at offset "
+         << breakpoint->GetILOffset() << " in function "
+         << breakpoint->GetMethodToken() << " with HRESULT " << std::hex << hr;
+    return hr;
   }
 
-  return hr;
+  breakpoint->SetMethodName(method->name);
+  breakpoint->SetCorDebugBreakpoint(function_breakpoint);
+  breakpoint->SetCorDebugModule(debug_module);
+  return S_OK;
 }
 
 bool EqualsIgnoreCase(const std::string &first_string,
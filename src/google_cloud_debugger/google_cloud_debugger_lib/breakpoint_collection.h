@@ -15,14 +15,19 @@
 #ifndef BREAKPOINT_COLLECTION_H_
 #define BREAKPOINT_COLLECTION_H_
 
+#include <atomic>
+#include <cstdint>
+#include <map>
 #include <unordered_map>
 #include <memory>
 #include <mutex>
+#include <thread>
 #include <vector>
 
 #include "breakpoint_client.h"
 #include "ccomptr.h"
 #include "dbg_breakpoint.h"
+#include "document_path_index.h"
 #include "i_breakpoint_collection.h"
 #include "breakpoint_location_collection.h"
 
@@ -32,8 +37,17 @@ class DebuggerCallback;
 class IEvalCoordinator;
 
 // Class for managing a collection of breakpoints.
+//
+// The breakpoint sync thread and the module indexer change the collection
+// under mutex_, which is not held while they search the PDB files for a
+// new breakpoint. Breakpoint hits never take mutex_: every change
+// publishes an immutable snapshot of the breakpoints at each location,
+// and hits read the latest snapshot without any lock.
 class BreakpointCollection : public IBreakpointCollection {
  public:
+  // Frees the published snapshots.
+  ~BreakpointCollection() override;
+
   // Sets the Debugger Callback field, which is used to get a list of
   // Portable PDB files applicable to this collection.
   HRESULT SetDebuggerCallback(DebuggerCallback *debugger_callback) override;
@@ -48,6 +62,14 @@ class BreakpointCollection : public IBreakpointCollection {
   // This means duplicate breakpoints will be silently rejected.
   HRESULT UpdateBreakpoint(const DbgBreakpoint &breakpoint) override;
 
+  // Activates or deactivates all of breakpoints, as UpdateBreakpoint
+  // does, in a single pass: the documents of each file are looked up
+  // once for all the new breakpoints in it, and hits only see the new
+  // breakpoints once all of them are set. Returns S_FALSE if some
+  // breakpoints could not be set.
+  HRESULT UpdateBreakpoints(
+      const std::vector<std::shared_ptr<DbgBreakpoint>> &breakpoints) override;
+
   // Using the breakpoint_client_read_ name pipe, try to read and parse
   // any incoming breakpoints that are written to the named pipe.
   // This method will then try to activate or deactivate these breakpoints.
@@ -67,27 +89,161 @@ class BreakpointCollection : public IBreakpointCollection {
   HRESULT ReadBreakpoint(
       google::cloud::diagnostics::debug::Breakpoint *breakpoint) override;
 
-  // Evaluates and prints out the breakpoint that corresponds to
-  // the IL offset il_offset inside the function with token
-  // function_token.
+  // Evaluates and prints out the breakpoints at the location of
+  // debug_breakpoint. The location is found with a single lookup in the
+  // latest snapshot, without any lock or call to the debuggee.
   HRESULT EvaluateAndPrintBreakpoint(
-      mdMethodDef function_token, ULONG32 il_offset,
+      ICorDebugBreakpoint *debug_breakpoint,
       IEvalCoordinator *eval_coordinator, ICorDebugThread *debug_thread,
       const std::vector<
           std::shared_ptr<google_cloud_debugger_portable_pdb::IPortablePdbFile>>
           &pdb_files) override;
 
+  // Removes the breakpoints set in module debug_module, which is being
+  // unloaded, and keeps them in pending_locations_. Nothing is written to
+  // the agent here: the caller reports unbound_breakpoints, so this never
+  // blocks the debugger callback on the pipe. Nothing is changed if this
+  // fails.
+  HRESULT RemoveBreakpointsInModule(
+      ICorDebugModule *debug_module,
+      std::vector<google::cloud::diagnostics::debug::Breakpoint>
+          *unbound_breakpoints) override;
+
+  // Tries to set the breakpoints in pending_locations_ in the documents
+  // of the document path index. Called by the module indexer each time it
+  // adds a PDB file to the index.
+  HRESULT SetPendingBreakpoints() override;
+
+  // Returns the number of locations in location_to_breakpoints_.
+  std::size_t GetLocationCount() override;
+
+  // Returns the number of locations in pending_locations_.
+  std::size_t GetPendingLocationCount() override;
+
  private:
-  // Reads an incoming breakpoint from the named pipe and populates
-  // The DbgBreakpoint object based on that.
-  HRESULT ReadAndParseBreakpoint(DbgBreakpoint *breakpoint);
+  // Reads the next message from the named pipe, which is either a single
+  // breakpoint or a batch of them, and appends a DbgBreakpoint for each
+  // breakpoint in it to breakpoints.
+  HRESULT ReadAndParseBreakpoints(
+      std::vector<std::shared_ptr<DbgBreakpoint>> *breakpoints);
+
+  // Groups of breakpoints, by the file path or location string they share.
+  typedef std::map<std::string, std::vector<std::shared_ptr<DbgBreakpoint>>>
+      BreakpointGroupMap;
 
   // The underlying list of breakpoints that this collection manages.
   // std::vector<std::shared_ptr<DbgBreakpoint>> breakpoints_;
 
+  // Map of location strings to the collection of breakpoints at each
+  // location.
+  typedef std::unordered_map<std::string,
+                             std::unique_ptr<BreakpointLocationCollection>>
+      LocationMap;
+
   // A map of location to a collection of breakpoint at that location.
-  std::unordered_map<std::string, std::unique_ptr<BreakpointLocationCollection>>
-    location_to_breakpoints_;
+  LocationMap location_to_breakpoints_;
+
+  // The breakpoints at locations whose module was unloaded, by location
+  // string. None of them is set. Protected by mutex_.
+  BreakpointGroupMap pending_locations_;
+
+  // The locations in location_to_breakpoints_, by the
+  // ICorDebugFunctionBreakpoint set at each of them. Hits are reported
+  // with the breakpoint rather than its function and IL offset, and a
+  // function breakpoint belongs to a single module, so this tells apart
+  // methods with the same token in different modules.
+  std::unordered_map<ICorDebugFunctionBreakpoint *,
+                     BreakpointLocationCollection *>
+      function_breakpoint_to_location_;
+
+  // Copy of function_breakpoint_to_location_ with the breakpoints at each
+  // location. A snapshot is never changed once it is published.
+  struct BreakpointSnapshot {
+    // Number of snapshots published before this one.
+    std::uint64_t version = 0;
+
+    // The breakpoints at each location, by the ICorDebugFunctionBreakpoint
+    // set at the location.
+    std::unordered_map<ICorDebugFunctionBreakpoint *,
+                       std::vector<std::shared_ptr<DbgBreakpoint>>>
+        breakpoints;
+  };
+
+  // Builds a snapshot of function_breakpoint_to_location_ and publishes
+  // it. Never waits for the hits that are reading an older snapshot, and
+  // frees the older snapshots that no hit is reading.
+  // mutex_ must be held.
+  HRESULT PublishSnapshot();
+
+  // Loads the latest snapshot and keeps it from being freed until
+  // ReleaseSnapshot(*slot) is called. Returns nullptr, and takes no slot,
+  // if no snapshot was published yet.
+  const BreakpointSnapshot *AcquireSnapshot(std::size_t *slot);
+
+  // Called by a hit once it no longer reads the snapshot it acquired
+  // in slot.
+  void ReleaseSnapshot(std::size_t slot);
+
+  // Number of hits that can read snapshots at the same time. Hits are
+  // reported by the debugger callback thread, so there is rarely more
+  // than one.
+  static const std::size_t kMaxSnapshotReaders = 16;
+
+  // The latest snapshot, or nullptr if none was published yet.
+  std::atomic<const BreakpointSnapshot *> snapshot_{nullptr};
+
+  // The snapshot read by each hit in progress, or nullptr for free slots.
+  // A hit stores the snapshot here before reading it, and PublishSnapshot
+  // only frees retired snapshots that no slot holds.
+  std::atomic<const BreakpointSnapshot *>
+      reader_snapshots_[kMaxSnapshotReaders] = {};
+
+  // Snapshots replaced by a newer one that hits may still be reading.
+  // There are at most kMaxSnapshotReaders of them after a publish.
+  // Protected by mutex_.
+  std::vector<std::unique_ptr<const BreakpointSnapshot>> retired_snapshots_;
+
+  // Adds location to location_to_breakpoints_ under location_string, the
+  // location its breakpoints were requested at, and to
+  // function_breakpoint_to_location_, replacing any location with the same
+  // location string. Hits do not see it until the next PublishSnapshot.
+  // mutex_ must be held.
+  HRESULT AddLocation(const std::string &location_string,
+                      std::unique_ptr<BreakpointLocationCollection> location);
+
+  // Removes the location pointed to by location from both maps and
+  // returns the next one. mutex_ must be held.
+  LocationMap::iterator RemoveLocation(LocationMap::iterator location);
+
+  // Gets the ICorDebugFunctionBreakpoint interface of debug_breakpoint,
+  // which is the key of function_breakpoint_to_location_.
+  static HRESULT GetFunctionBreakpoint(
+      ICorDebugBreakpoint *debug_breakpoint,
+      ICorDebugFunctionBreakpoint **function_breakpoint);
+
+  // Sets the breakpoints of each location in new_locations, which are
+  // keyed by the location string they were requested at, and adds the
+  // locations to the collection. If parse_pdb_files is true, the PDB files
+  // that are not indexed yet are parsed until all the locations are found.
+  // On return, new_locations only has the locations that were not found.
+  // update_mutex_ must be held.
+  HRESULT SetNewLocations(BreakpointGroupMap *new_locations,
+                          bool parse_pdb_files);
+
+  // Tries to set each of unset_breakpoints, which are grouped by file
+  // path, in the documents in document_path_index that best match its
+  // file path. Moves the breakpoints that are set and activated to
+  // set_breakpoints, and drops the ones that fail to activate.
+  HRESULT TrySetBreakpointsInDocuments(
+      const DocumentPathIndex &document_path_index,
+      BreakpointGroupMap *unset_breakpoints,
+      std::vector<std::shared_ptr<DbgBreakpoint>> *set_breakpoints);
+
+  // Tries to set breakpoint in the documents of matches, in order, and
+  // activates it. Returns S_FALSE if none of these documents has the
+  // breakpoint's line.
+  HRESULT TrySetBreakpointInDocuments(
+      DbgBreakpoint *breakpoint, const std::vector<DocumentPathMatch> &matches);
 
   // Activate a breakpoint in a portable pdb file.
   // This function should only be used if breakpoint is already set, i.e.
@@ -96,13 +252,6 @@ class BreakpointCollection : public IBreakpointCollection {
       DbgBreakpoint *breakpoint,
       google_cloud_debugger_portable_pdb::IPortablePdbFile *portable_pdb);
 
-  // Helper function to get type definition token, signature, virtual address
-  // and name of a method (identified using method_def).
-  HRESULT GetMethodData(IMetaDataImport *metadata_import, uint32_t method_def,
-                        mdTypeDef *type_def, PCCOR_SIGNATURE *signature,
-                        ULONG *virtual_address,
-                        std::vector<WCHAR> *method_name);
-
   // Helper function to create and initialize a breakpoint client.
   static HRESULT CreateAndInitializeBreakpointClient(
       std::unique_ptr<BreakpointClient> *client, std::string pipe_name);
@@ -118,6 +267,16 @@ class BreakpointCollection : public IBreakpointCollection {
   // Named pipe server for writing breakpoints.
   std::unique_ptr<BreakpointClient> breakpoint_client_write_;
 
+  // Serializes writes to breakpoint_client_write_. Snapshots are written
+  // from the snapshot worker while the kill message may be written on
+  // shutdown.
+  std::mutex write_mutex_;
+
+  // Serializes the changes that set new locations, which are made by the
+  // breakpoint sync thread and the module indexer, so that two of them
+  // never set the same location. Taken before mutex_.
+  std::mutex update_mutex_;
+
   std::mutex mutex_;
 };
 
@@ -33,6 +33,7 @@ HRESULT BreakpointLocationCollection::AddFirstBreakpoint(
   method_token_ = breakpoint->GetMethodToken();
   method_name_ = breakpoint->GetMethodName();
   location_string_ = breakpoint->GetBreakpointLocation();
+  debug_module_ = breakpoint->GetCorDebugModule();
   HRESULT hr = breakpoint->GetCorDebugBreakpoint(&debug_breakpoint_);
   if (FAILED(hr)) {
     return hr;
@@ -79,6 +80,7 @@ HRESULT BreakpointLocationCollection::UpdateBreakpoints(
   new_breakpoint->SetMethodToken(method_token_);
   new_breakpoint->SetMethodName(method_name_);
   new_breakpoint->SetCorDebugBreakpoint(debug_breakpoint_);
+  new_breakpoint->SetCorDebugModule(debug_module_);
 
   hr = ActivateCorDebugBreakpointHelper(breakpoint.Activated());
   if (FAILED(hr)) {
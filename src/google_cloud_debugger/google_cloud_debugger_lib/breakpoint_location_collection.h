@@ -17,6 +17,7 @@
 
 #include <memory>
 #include <mutex>
+#include <string>
 #include <vector>
 
 #include "ccomptr.h"
@@ -60,6 +61,15 @@ class BreakpointLocationCollection {
   // Returns the method token of breakpoints at this location.
   mdMethodDef GetMethodToken() { return method_token_; }
 
+  // Returns the module of the method of breakpoints at this location.
+  ICorDebugModule *GetCorDebugModule() { return debug_module_; }
+
+  // Returns the ICorDebugBreakpoint set at this location.
+  ICorDebugBreakpoint *GetCorDebugBreakpoint() { return debug_breakpoint_; }
+
+  // Returns the string that represents this location.
+  const std::string &GetLocationString() { return location_string_; }
+
  private:
   // Mutex to protect breakpoints_ vector from multiple access.
   std::mutex mutex_;
@@ -93,6 +103,9 @@ class BreakpointLocationCollection {
   // location.
   CComPtr<ICorDebugBreakpoint> debug_breakpoint_;
 
+  // The module of the method of breakpoints at this location.
+  CComPtr<ICorDebugModule> debug_module_;
+
   // String that represents the location.
   std::string location_string_;
 };
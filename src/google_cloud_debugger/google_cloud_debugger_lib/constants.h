@@ -37,6 +37,12 @@ static const std::string kStartBreakpointMessage = "START_DEBUG_MESSAGE";
 // The end of a breakpoint message.
 static const std::string kEndBreakpointMessage = "END_DEBUG_MESSAGE";
 
+// The start of a batch of breakpoint messages.
+static const std::string kStartBatchMessage = "START_DEBUG_BATCH";
+
+// The end of a batch of breakpoint messages.
+static const std::string kEndBatchMessage = "END_DEBUG_BATCH";
+
 // File extension for dll file.
 static const std::string kDllExtension = ".dll";
 
@@ -50,6 +56,16 @@ static const std::string kBackingField = ">k__BackingField";
 // Default size of a vector that we use to retrieve objects from ICorDebugEnum.
 static const std::uint32_t kDefaultVectorSize = 100;
 
+// Number of threads used to parse the PDB files of loaded modules.
+static const std::uint32_t kModuleIndexerThreads = 4;
+
+// Maximum number of threads used to decode the methods of one PDB file.
+static const std::uint32_t kMaxPdbIndexingThreads = 8;
+
+// Number of methods of a document that a PDB indexing thread decodes at
+// a time.
+static const std::uint32_t kMethodsPerIndexingTask = 64;
+
 }  // namespace google_cloud_debugger
 
 #endif  //  CONSTANTS_H_
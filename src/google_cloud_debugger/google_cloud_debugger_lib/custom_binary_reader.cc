@@ -29,8 +29,6 @@
 using std::cerr;
 using std::ifstream;
 using std::ios;
-using std::min;
-using std::streampos;
 using std::string;
 using std::unique_ptr;
 using std::vector;
@@ -51,242 +49,231 @@ const std::uint32_t kCompressedSignedIntOneByteUncompressMask = 0xFFFFFFC0;
 const std::uint32_t kCompressedSignedIntTwoByteUncompressMask = 0xFFFFE000;
 const std::uint32_t kCompressedSignedIntFourByteUncompressMask = 0xF0000000;
 
-// Size of the buffer used by GetString to read characters into.
-const std::uint32_t kStringBufferSize = 100;
-
 bool CustomBinaryStream::ConsumeStream(std::istream *stream) {
   assert(stream != nullptr);
+  unique_ptr<std::istream> owned_stream(stream);
 
-  stream_.reset(stream);
+  mapped_file_.reset();
+  buffer_.reset();
+  data_ = nullptr;
+  position_ = 0;
+  absolute_end_ = 0;
+  relative_end_ = 0;
 
-  if (stream_->good()) {
-    stream_->unsetf(std::ios::skipws);
-    stream_->seekg(0, stream_->end);
-    absolute_end_ = stream_->tellg();
-    relative_end_ = absolute_end_;
-    stream_->seekg(0, stream_->beg);
-    begin_ = stream_->tellg();
+  if (!owned_stream->good()) {
+    cerr << "Invalid stream.";
+    return false;
+  }
 
-    return true;
+  owned_stream->seekg(0, owned_stream->end);
+  std::streamoff size = owned_stream->tellg();
+  owned_stream->seekg(0, owned_stream->beg);
+  if (size < 0 || size > UINT32_MAX) {
+    cerr << "Invalid stream.";
+    return false;
   }
 
-  cerr << "Invalid stream.";
-  return false;
+  std::shared_ptr<vector<uint8_t>> buffer(new (std::nothrow)
+                                              vector<uint8_t>(size));
+  if (!buffer) {
+    cerr << "Failed to allocate " << size << " bytes for the stream.";
+    return false;
+  }
+
+  owned_stream->read(reinterpret_cast<char *>(buffer->data()), size);
+  if (owned_stream->gcount() != size) {
+    cerr << "Failed to read the stream.";
+    return false;
+  }
+
+  buffer_ = buffer;
+  data_ = buffer_->data();
+  absolute_end_ = static_cast<uint32_t>(size);
+  relative_end_ = absolute_end_;
+  return true;
 }
 
-bool CustomBinaryStream::ConsumeFile(const string &file) {
-  unique_ptr<std::ifstream> file_stream = unique_ptr<std::ifstream>(
-      new (std::nothrow) ifstream(file, ios::in | ios::binary | ios::ate));
+bool CustomBinaryStream::ConsumeFile(const string &file, bool memory_map) {
+  if (!memory_map) {
+    unique_ptr<std::ifstream> file_stream = unique_ptr<std::ifstream>(
+        new (std::nothrow) ifstream(file, ios::in | ios::binary | ios::ate));
+    // Let the caller throws the error.
+    if (!file_stream || !file_stream->is_open() || !file_stream->good()) {
+      return false;
+    }
+
+    return ConsumeStream(file_stream.release());
+  }
+
+  std::shared_ptr<MemoryMappedFile> mapped_file(new (std::nothrow)
+                                                    MemoryMappedFile());
   // Let the caller throws the error.
-  if (!file_stream || !file_stream->is_open() || !file_stream->good()) {
+  if (!mapped_file || !mapped_file->Map(file)) {
+    return false;
+  }
+
+  buffer_.reset();
+  mapped_file_ = mapped_file;
+  data_ = mapped_file_->Data();
+  position_ = 0;
+  absolute_end_ = mapped_file_->Size();
+  relative_end_ = absolute_end_;
+  return true;
+}
+
+uint32_t CustomBinaryStream::Current() const { return position_; }
+
+uint32_t CustomBinaryStream::Remaining() const {
+  return position_ < relative_end_ ? relative_end_ - position_ : 0;
+}
+
+bool CustomBinaryStream::MoveTo(uint32_t position) {
+  if (position > absolute_end_) {
+    cerr << "Seek operation failed.";
     return false;
   }
 
-  return ConsumeStream(file_stream.release());
+  position_ = position;
+  return true;
 }
 
 bool CustomBinaryStream::ReadBytes(uint8_t *result, uint32_t bytes_to_read,
                                    uint32_t *bytes_read) {
-  assert(stream_ != nullptr);
-  if (relative_end_ - stream_->tellg() < bytes_to_read) {
+  if (position_ > relative_end_ || relative_end_ - position_ < bytes_to_read) {
     cerr << "End of stream reached.";
     return false;
   }
 
-  stream_->read(reinterpret_cast<char *>(result), bytes_to_read);
-  *bytes_read = stream_->gcount();
-  return *bytes_read == bytes_to_read;
+  memcpy(result, data_ + position_, bytes_to_read);
+  position_ += bytes_to_read;
+  *bytes_read = bytes_to_read;
+  return true;
 }
 
-bool CustomBinaryStream::HasNext() const {
-  assert(stream_ != nullptr);
-  return stream_->tellg() < relative_end_;
+bool CustomBinaryStream::ReadSpan(uint32_t size, const uint8_t **result) {
+  if (position_ > relative_end_ || relative_end_ - position_ < size) {
+    cerr << "End of stream reached.";
+    return false;
+  }
+
+  *result = data_ + position_;
+  position_ += size;
+  return true;
 }
 
+bool CustomBinaryStream::HasNext() const { return position_ < relative_end_; }
+
 bool CustomBinaryStream::Peek(uint8_t *result) const {
-  assert(stream_ != nullptr);
   if (!HasNext()) {
     cerr << "End of stream reached.";
     return false;
   }
 
-  *result = stream_->peek();
+  *result = data_[position_];
   return true;
 }
 
 bool CustomBinaryStream::SeekFromCurrent(uint32_t index) {
-  assert(stream_ != nullptr);
   // Have to take into account the end_ based on the stream
   // length that we set.
-  if (relative_end_ - stream_->tellg() < index) {
+  uint32_t position = Current();
+  if (position > relative_end_ || relative_end_ - position < index) {
     cerr << "Seeking to a position out of range of the stream.";
     return false;
   }
 
-  stream_->seekg(index, stream_->cur);
-  if (stream_->fail()) {
-    cerr << "Seek operation failed.";
-    stream_->clear();
-    return false;
-  }
-
-  return true;
+  return MoveTo(position + index);
 }
 
 bool CustomBinaryStream::SeekFromOrigin(uint32_t position) {
-  assert(stream_ != nullptr);
-
-  stream_->seekg(position, stream_->beg);
-  if (stream_->fail()) {
-    cerr << "Seek operation failed.";
-    stream_->clear();
-    return false;
-  }
-  return true;
+  return MoveTo(position);
 }
 
 bool CustomBinaryStream::SetStreamLength(uint32_t length) {
-  assert(stream_ != nullptr);
-
-  streampos cur_pos = stream_->tellg();
-  stream_->seekg(length, stream_->cur);
-  if (stream_->fail()) {
-    stream_->clear();
-    stream_->seekg(cur_pos);
+  uint32_t position = Current();
+  if (position > absolute_end_ || absolute_end_ - position < length) {
     cerr << "Setting stream length to " << length
          << " will set the relative end of the stream to a position"
          << " outside the absolute end of the stream.";
     return false;
   }
 
-  if (stream_->tellg() > relative_end_) {
-    stream_->seekg(cur_pos);
+  if (position > relative_end_ || relative_end_ - position < length) {
     cerr << "Setting stream length to " << length
          << " will set the relative end of the stream to a position"
          << " outside the relative end of the stream.";
     return false;
   }
 
-  // Sets the relative end and sets the stream back.
-  relative_end_ = stream_->tellg();
-  stream_->seekg(cur_pos);
+  relative_end_ = position + length;
   return true;
 }
 
 void CustomBinaryStream::ResetStreamLength() {
-  assert(stream_ != nullptr);
-
   relative_end_ = absolute_end_;
 }
 
-bool CustomBinaryStream::GetString(std::string *result, std::uint32_t offset) {
+bool CustomBinaryStream::GetString(std::string *result,
+                                   std::uint32_t offset) const {
   result->clear();
-  assert(stream_ != nullptr);
-
-  // Makes a copy of the current position so we can restores the stream.
-  streampos previous_pos = stream_->tellg();
-  stream_->seekg(offset, stream_->beg);
-  if (stream_->fail()) {
-    stream_->clear();
-    stream_->seekg(previous_pos);
+
+  if (offset > relative_end_) {
     cerr << "Failed to seek to the offset point.";
     return false;
   }
 
-  // Read 100 characters at a time or until the end of the stream,
-  // whichever is smaller.
-  uint32_t chars_left = relative_end_ - stream_->tellg();
-  uint32_t char_to_read = min(kStringBufferSize, chars_left);
-  vector<char> buffer(char_to_read, 0);
-
-  while (char_to_read != 0) {
-    // Reads char_to_read bytes from the buffer.
-    stream_->read(buffer.data(), char_to_read);
-    if (stream_->fail()) {
-      stream_->clear();
-      stream_->seekg(previous_pos);
-      cerr << "Failed to read characters from the stream.";
-      return false;
-    }
-
-    // Finds the null character.
-    vector<char>::iterator null_char_pos =
-        std::find(buffer.begin(), buffer.end(), 0);
-
-    result->append(buffer.begin(), null_char_pos);
-    // Stop reading if we found the null character.
-    if (null_char_pos != buffer.end()) {
-      break;
-    }
-
-    // If we didn't find the null character, continue reading.
-    chars_left = relative_end_ - stream_->tellg();
-    char_to_read = min((uint32_t)buffer.size(), chars_left);
-  }
-
-  stream_->seekg(previous_pos);
+  const uint8_t *start = data_ + offset;
+  const uint8_t *end = data_ + relative_end_;
+  result->assign(start, std::find(start, end, 0));
   return true;
 }
 
-bool CustomBinaryStream::GetBlobBytes(
-    std::uint32_t offset, std::vector<uint8_t> *result) {
+bool CustomBinaryStream::GetBlobBytes(std::uint32_t offset,
+                                      std::vector<uint8_t> *result) const {
   result->clear();
-  assert(stream_ != nullptr);
-
-  // Makes a copy of the current position so we can restores the stream.
-  streampos previous_pos = stream_->tellg();
-  stream_->seekg(offset, stream_->beg);
-  if (stream_->fail()) {
-    stream_->clear();
-    stream_->seekg(previous_pos);
+
+  // Reads through a copy so the position of this stream does not change.
+  CustomBinaryStream cursor = *this;
+  if (!cursor.MoveTo(offset)) {
     cerr << "Failed to seek to the offset point.";
     return false;
   }
 
   uint32_t const_size = 0;
-  if (!ReadCompressedUInt32(&const_size)) {
-      stream_->clear();
-      stream_->seekg(previous_pos);
-      cerr << "Failed to get length of blob.";
-      return false;
+  if (!cursor.ReadCompressedUInt32(&const_size)) {
+    cerr << "Failed to get length of blob.";
+    return false;
   }
 
-  uint32_t bytes_read;
-  result->resize(const_size);
-  if (!ReadBytes(result->data(), const_size, &bytes_read)) {
-    stream_->seekg(previous_pos);
+  if (const_size > cursor.Remaining()) {
+    cerr << "End of stream reached.";
     return false;
   }
 
-  stream_->seekg(previous_pos);
-  return true;
+  uint32_t bytes_read;
+  result->resize(const_size);
+  return cursor.ReadBytes(result->data(), const_size, &bytes_read);
 }
 
 bool CustomBinaryStream::ReadByte(uint8_t *result) {
-  uint32_t bytes_read = 0;
-  return ReadBytes(result, 1, &bytes_read);
-}
-
-bool CustomBinaryStream::ReadUInt16(uint16_t *result) {
-  uint32_t bytes_read = 0;
-  vector<uint8_t> buffer(2, 0);
-  if (!ReadBytes(buffer.data(), 2, &bytes_read)) {
+  // Most reads are single bytes so they skip ReadBytes.
+  if (position_ >= relative_end_) {
+    cerr << "End of stream reached.";
     return false;
   }
 
-  memcpy(result, buffer.data(), 2);
+  *result = data_[position_++];
   return true;
 }
 
-bool CustomBinaryStream::ReadUInt32(uint32_t *result) {
+bool CustomBinaryStream::ReadUInt16(uint16_t *result) {
   uint32_t bytes_read = 0;
-  vector<uint8_t> buffer(4, 0);
-  if (!ReadBytes(buffer.data(), 4, &bytes_read)) {
-    return false;
-  }
+  return ReadBytes(reinterpret_cast<uint8_t *>(result), 2, &bytes_read);
+}
 
-  memcpy(result, buffer.data(), 4);
-  return true;
+bool CustomBinaryStream::ReadUInt32(uint32_t *result) {
+  uint32_t bytes_read = 0;
+  return ReadBytes(reinterpret_cast<uint8_t *>(result), 4, &bytes_read);
 }
 
 bool CustomBinaryStream::ReadCompressedUInt32(uint32_t *uncompress_int) {
@@ -378,10 +365,9 @@ bool CustomBinaryStream::ReadCompressSignedInt32(int32_t *uncompressed_int) {
   return true;
 }
 
-bool CustomBinaryStream::ReadTableIndex(Heap heap, uint8_t heap_size,
-                                        uint32_t *table_index) {
-  // The Heap enum also encodes the bit mask into the heapSize value.
-  if ((heap & heap_size) != 0x0) {
+bool CustomBinaryStream::ReadIndex(uint32_t index_size,
+                                   uint32_t *table_index) {
+  if (index_size == 4) {
     return ReadUInt32(table_index);
   }
 
@@ -394,9 +380,24 @@ bool CustomBinaryStream::ReadTableIndex(Heap heap, uint8_t heap_size,
   return true;
 }
 
+bool CustomBinaryStream::ReadTableIndex(Heap heap, uint8_t heap_size,
+                                        uint32_t *table_index) {
+  return ReadIndex(GetHeapIndexSize(heap, heap_size), table_index);
+}
+
 bool CustomBinaryStream::ReadTableIndex(
     MetadataTable table, const CompressedMetadataTableHeader &metadata_header,
     uint32_t *table_index) {
+  return ReadIndex(GetTableIndexSize(table, metadata_header), table_index);
+}
+
+uint32_t GetHeapIndexSize(Heap heap, uint8_t heap_sizes) {
+  // The Heap enum also encodes the bit mask into the heapSize value.
+  return (heap & heap_sizes) != 0x0 ? 4 : 2;
+}
+
+uint32_t GetTableIndexSize(
+    MetadataTable table, const CompressedMetadataTableHeader &metadata_header) {
   if (!metadata_header.valid_mask[static_cast<int>(table)]) {
     // WARNING: If you are reading a table index into a metadata table that
     // isn't present, something is wrong.
@@ -409,13 +410,7 @@ bool CustomBinaryStream::ReadTableIndex(
     //
     // BUG: Read assembly metadata (headers at least) in addition to PDB
     // metadata. For now we assume everything is less than 2^16.
-    uint16_t temp;
-    if (!ReadUInt16(&temp)) {
-      return false;
-    }
-
-    *table_index = temp;
-    return true;
+    return 2;
   }
 
   uint32_t present_table_index = 0;
@@ -428,17 +423,7 @@ bool CustomBinaryStream::ReadTableIndex(
   uint32_t rows_present = metadata_header.num_rows[present_table_index];
   // If the table has less than 2^16 rows then it is stored using 2 bytes.
   // Otherwise, 4 bytes.
-  if (rows_present < 0x10000) {  // 2^16
-    uint16_t temp;
-    if (!ReadUInt16(&temp)) {
-      return false;
-    }
-
-    *table_index = temp;
-    return true;
-  }
-
-  return ReadUInt32(table_index);
+  return rows_present < 0x10000 ? 2 : 4;  // 2^16
 }
 
 }  // namespace google_cloud_debugger_portable_pdb
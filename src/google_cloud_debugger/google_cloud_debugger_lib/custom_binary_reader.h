@@ -24,6 +24,7 @@
 
 #include "cor.h"
 
+#include "memory_mapped_file.h"
 #include "metadata_tables.h"
 
 // typedef std::vector<uint8_t>::const_iterator binary_stream_iter;
@@ -40,15 +41,26 @@ enum Heap : std::uint8_t {
 // Class that consumes a file or a uint8_t vector and produces a
 // binary stream. This stream is used to read byte, integers,
 // compressed integers and table index.
+//
+// Files are mapped read-only into memory and decoded in place with a plain
+// cursor. Streams passed to ConsumeStream (and files consumed with
+// memory_map set to false) are read into memory once.
+//
+// The bytes never change once consumed, and copies of a stream share them.
+// A copy is a cursor of its own: its position and length can be changed
+// without affecting the stream it was copied from. So threads can read the
+// same bytes at the same time as long as each one reads through its own
+// copy.
 class CustomBinaryStream {
  public:
-  // Consumes a binary stream pointer, takes ownership
-  // of the underlying stream and makes it the underlying
-  // stream of this class.
+  // Consumes a binary stream pointer, reads it to the end and takes
+  // ownership of it.
   bool ConsumeStream(std::istream *stream);
 
   // Consumes a file and exposes the file content as a binary stream.
-  bool ConsumeFile(const std::string &file);
+  // If memory_map is false, the file is read into memory instead of being
+  // mapped.
+  bool ConsumeFile(const std::string &file, bool memory_map = true);
 
   // Returns true if there is a next byte in the stream.
   bool HasNext() const;
@@ -73,12 +85,12 @@ class CustomBinaryStream {
 
   // Gets a string starting from the offset to a null terminating character or the end of the stream.
   // This function does not change the stream pointer.
-  bool GetString(std::string *result, std::uint32_t offset);
+  bool GetString(std::string *result, std::uint32_t offset) const;
 
   // Gets blob bytes starting from offset in the stream.
   // The first byte will tell us the length of the blob.
   // This function does not change the stream pointer.
-  bool GetBlobBytes(std::uint32_t offset, std::vector<uint8_t> *result);
+  bool GetBlobBytes(std::uint32_t offset, std::vector<uint8_t> *result) const;
 
   // Reads the next byte in the stream. Returns false if the byte
   // cannot be read.
@@ -89,6 +101,11 @@ class CustomBinaryStream {
   bool ReadBytes(std::uint8_t *result, std::uint32_t bytes_to_read,
                  std::uint32_t *bytes_read);
 
+  // Points result at the next size bytes in the stream and moves past them
+  // without copying. The bytes stay valid as long as this stream or a copy
+  // of it is alive. Returns false if there are fewer than size bytes left.
+  bool ReadSpan(std::uint32_t size, const std::uint8_t **result);
+
   // Reads the next UInt16 from the stream. Returns false if the UInt16
   // cannot be read.
   bool ReadUInt16(std::uint16_t *result);
@@ -124,23 +141,50 @@ class CustomBinaryStream {
                       std::uint32_t *table_index);
 
   // Returns the current position of the stream.
-  std::streampos Current() { return stream_->tellg(); }
+  std::uint32_t Current() const;
+
+  // Returns the number of bytes left before the end of the stream.
+  std::uint32_t Remaining() const;
 
  private:
-  // The underlying binary stream.
-  std::unique_ptr<std::istream> stream_;
+  // Moves the stream to position. Returns false if position is
+  // past the absolute end of the stream.
+  bool MoveTo(std::uint32_t position);
+
+  // Reads a table index of index_size bytes, which is either 2 or 4.
+  bool ReadIndex(std::uint32_t index_size, std::uint32_t *table_index);
 
-  // The begin position of the stream.
-  std::streampos begin_;
+  // The mapped file if the stream is memory-mapped, nullptr otherwise.
+  // Shared by the copies of this stream.
+  std::shared_ptr<const MemoryMappedFile> mapped_file_;
+
+  // The bytes read from the file or stream if the stream is not
+  // memory-mapped, nullptr otherwise. Shared by the copies of this stream.
+  std::shared_ptr<const std::vector<std::uint8_t>> buffer_;
+
+  // Start of the bytes of the stream, owned by mapped_file_ or buffer_.
+  const std::uint8_t *data_ = nullptr;
+
+  // The current position in data_.
+  std::uint32_t position_ = 0;
 
   // The absolute end position of the stream.
-  std::streampos absolute_end_;
+  std::uint32_t absolute_end_ = 0;
 
   // The relative end position of the stream (sets by SetStreamLength), which
   // is as far in a PDB file as we need to read.
-  std::streampos relative_end_;
+  std::uint32_t relative_end_ = 0;
 };
 
+// Returns the size in bytes (2 or 4) of an index into heap, according to
+// II.24.2.6 "#~ stream". heap_sizes is the HeapSizes field of the #~ stream.
+std::uint32_t GetHeapIndexSize(Heap heap, std::uint8_t heap_sizes);
+
+// Returns the size in bytes (2 or 4) of an index into metadata table table,
+// according to II.24.2.6 "#~ stream".
+std::uint32_t GetTableIndexSize(
+    MetadataTable table, const CompressedMetadataTableHeader &metadata_header);
+
 }  // namespace google_cloud_debugger_portable_pdb
 
 #endif
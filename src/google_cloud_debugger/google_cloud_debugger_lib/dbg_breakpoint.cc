@@ -21,6 +21,7 @@
 #include "compiler_helpers.h"
 #include "dbg_class_property.h"
 #include "document_index.h"
+#include "document_path_index.h"
 #include "expression_evaluator.h"
 #include "expression_util.h"
 #include "i_dbg_stack_frame.h"
@@ -63,7 +64,7 @@ void DbgBreakpoint::Initialize(const string &file_path, const string &id,
   std::transform(
       file_path_.begin(), file_path_.end(), file_path_.begin(),
       [](unsigned char c) -> unsigned char { return std::tolower(c); });
-  file_path_segments_ = SplitFilePath(file_path_);
+  file_path_segments_ = SplitNormalizedFilePath(file_path_);
 
   id_ = id;
   log_point_ = log_point;
@@ -98,38 +99,26 @@ bool DbgBreakpoint::TrySetBreakpoint(
 
   int32_t current_doc_index_index = -1;
   int32_t best_match_doc_index = -1;
-  int32_t longest_match = -1;
+  size_t longest_match = 0;
 
-  // Loop through all the documents and try to find the one that
-  // best matches the breakpoint's file name.
+  // Loop through all the documents and try to find the one whose path
+  // shares the longest suffix with the breakpoint's file path.
   for (auto &&document_index : pdb_file->GetDocumentIndexTable()) {
     ++current_doc_index_index;
-    string document_name = document_index->GetFilePath();
-    // Normalize path separators. The PDB may use either Unix or Windows-style
-    // paths, but the Cloud Debugger only uses Unix.
-    std::replace(document_name.begin(), document_name.end(), '\\', '/');
-    std::transform(
-        document_name.begin(), document_name.end(), document_name.begin(),
-        [](unsigned char c) -> unsigned char { return std::tolower(c); });
-
-    std::vector<std::string> document_name_segments = SplitFilePath(document_name);
-
-    // Loop and see how many segments matches.
-    int segments_matches = 0;
-    int document_segment_idx = 0;
-    for (auto &&segment : file_path_segments_) {
-      if (document_segment_idx == document_name_segments.size()) {
-        break;
-      }
-
-      if (segment.compare(document_name_segments[document_segment_idx]) == 0) {
-        segments_matches += 1;
-      }
-
-      document_segment_idx += 1;
-    }
-
-    if (segments_matches > 0 && segments_matches > longest_match) {
+    const std::vector<const std::string *> &document_name_segments =
+        document_index->GetFilePathSegments();
+
+    auto mismatch = std::mismatch(
+        file_path_segments_.begin(),
+        file_path_segments_.begin() +
+            std::min(file_path_segments_.size(), document_name_segments.size()),
+        document_name_segments.begin(),
+        [](const std::string &segment, const std::string *document_segment) {
+          return segment == *document_segment;
+        });
+    size_t segments_matches = mismatch.first - file_path_segments_.begin();
+
+    if (segments_matches > longest_match) {
       best_match_doc_index = current_doc_index_index;
       longest_match = segments_matches;
     }
@@ -139,33 +128,28 @@ bool DbgBreakpoint::TrySetBreakpoint(
     return false;
   }
 
-  auto &&best_document_index =
-      pdb_file->GetDocumentIndexTable()[best_match_doc_index];
+  return TrySetBreakpoint(
+      *pdb_file->GetDocumentIndexTable()[best_match_doc_index]);
+}
+
+bool DbgBreakpoint::TrySetBreakpoint(
+    const google_cloud_debugger_portable_pdb::IDocumentIndex &document_index) {
   // Try to find the best matched method.
   // This is because the breakpoint can be inside method A but if
   // method A is defined inside method B then we should use method A
   // to get the local variables instead of method B. An example is a
   // delegate function that is defined inside a normal function.
-  bool found_breakpoint = false;
-  uint32_t best_matched_method_first_line = 0;
-  for (auto &&method : best_document_index->GetMethods()) {
-    if (method.first_line > line_ || method.last_line < line_) {
-      continue;
-    }
-
-    // If this method's first line is greater than the previous one,
-    // this means that this method is inside it.
-    if (method.first_line > best_matched_method_first_line) {
-      // If this is false, it means no sequence points in the method
-      // corresponds to this breakpoint.
-      if (TrySetBreakpointInMethod(method)) {
-        best_matched_method_first_line = method.first_line;
-        found_breakpoint = true;
-      }
-    }
+  const google_cloud_debugger_portable_pdb::MethodInfo *method;
+  google_cloud_debugger_portable_pdb::SequencePoint sequence_point;
+  if (!document_index.FindBreakpointLocation(line_, &method,
+                                             &sequence_point)) {
+    return false;
   }
 
-  return found_breakpoint;
+  il_offset_ = sequence_point.il_offset;
+  line_ = sequence_point.start_line;
+  method_def_ = method->method_def;
+  return true;
 }
 
 HRESULT DbgBreakpoint::EvaluateExpressions(IDbgStackFrame *stack_frame,
@@ -347,40 +331,4 @@ HRESULT DbgBreakpoint::PopulateExpression(Breakpoint *breakpoint,
   return S_OK;
 }
 
-bool DbgBreakpoint::TrySetBreakpointInMethod(
-    const google_cloud_debugger_portable_pdb::MethodInfo &method) {
-  const auto &find_seq = std::find_if(
-      method.sequence_points.begin(), method.sequence_points.end(),
-      [&](const google_cloud_debugger_portable_pdb::SequencePoint &seq) {
-        return !seq.is_hidden && seq.start_line >= line_;
-      });
-
-  if (find_seq == method.sequence_points.end()) {
-    return false;
-  }
-
-  il_offset_ = find_seq->il_offset;
-  line_ = find_seq->start_line;
-  method_def_ = method.method_def;
-  return true;
-}
-
-std::vector<std::string> DbgBreakpoint::SplitFilePath(const std::string &path) {
-  std::vector<std::string> result;
-
-  static const std::string delimiter = "/";
-  size_t delimiter_position = path.find(delimiter);
-  size_t start_offset = 0;
-
-  while (delimiter_position != std::string::npos) {
-    result.push_back(path.substr(start_offset, delimiter_position - start_offset));
-    start_offset = delimiter_position + delimiter.length();
-    delimiter_position = path.find(delimiter, start_offset);
-  }
-
-  result.push_back(path.substr(start_offset, delimiter_position));
-  std::reverse(result.begin(), result.end());
-  return result;
-}
-
 }  // namespace google_cloud_debugger
@@ -27,6 +27,7 @@
 #include "string_stream_wrapper.h"
 
 namespace google_cloud_debugger_portable_pdb {
+class IDocumentIndex;
 class IPortablePdbFile;
 struct MethodInfo;
 };  // namespace google_cloud_debugger_portable_pdb
@@ -65,6 +66,18 @@ class DbgBreakpoint : public StringStreamWrapper {
   bool TrySetBreakpoint(
       google_cloud_debugger_portable_pdb::IPortablePdbFile *pdb_file);
 
+  // Tries to set this breakpoint in document_index, which should be a
+  // document whose path matches the breakpoint's file path.
+  bool TrySetBreakpoint(
+      const google_cloud_debugger_portable_pdb::IDocumentIndex
+          &document_index);
+
+  // Returns the segments of the file path of this breakpoint, file name
+  // first (see SplitNormalizedFilePath).
+  const std::vector<std::string> &GetFilePathSegments() const {
+    return file_path_segments_;
+  }
+
   // Returns the IL Offset that corresponds to this breakpoint location.
   uint32_t GetILOffset() { return il_offset_; }
 
@@ -113,6 +126,14 @@ class DbgBreakpoint : public StringStreamWrapper {
   // Gets the ICorDebugBreakpoint that corresponds with this breakpoint.
   HRESULT GetCorDebugBreakpoint(ICorDebugBreakpoint **debug_breakpoint) const;
 
+  // Sets the module this breakpoint is set in.
+  void SetCorDebugModule(ICorDebugModule *debug_module) {
+    debug_module_ = debug_module;
+  }
+
+  // Returns the module this breakpoint is set in, if any.
+  ICorDebugModule *GetCorDebugModule() const { return debug_module_; }
+
   // Sets whether this breakpoint is activated or not.
   void SetActivated(bool activated) { activated_ = activated; };
 
@@ -205,16 +226,6 @@ class DbgBreakpoint : public StringStreamWrapper {
       google::cloud::diagnostics::debug::Breakpoint *breakpoint,
       IEvalCoordinator *eval_coordinator);
 
-  // Given a method, try to see whether we can set this breakpoint in
-  // the method.
-  bool TrySetBreakpointInMethod(
-      const google_cloud_debugger_portable_pdb::MethodInfo &method);
-
-  // Split up file path into segments (using '/' as delimiter).
-  // The returned vector will be reversed with the file name
-  // as the first item.
-  std::vector<std::string> SplitFilePath(const std::string &path);
-
   // The line number of the breakpoint.
   uint32_t line_;
 
@@ -224,7 +235,7 @@ class DbgBreakpoint : public StringStreamWrapper {
   // The file path of the breakpoint.
   std::string file_path_;
 
-  // Segments of the file path (when file_path_ is split by '/').
+  // Segments of the file path (see SplitNormalizedFilePath).
   // First item is the file name and last item is the root.
   std::vector<std::string> file_path_segments_;
 
@@ -261,6 +272,9 @@ class DbgBreakpoint : public StringStreamWrapper {
   // The ICorDebugBreakpoint that corresponds with this breakpoint.
   CComPtr<ICorDebugBreakpoint> debug_breakpoint_;
 
+  // The module this breakpoint is set in.
+  CComPtr<ICorDebugModule> debug_module_;
+
   // True if this breakpoint should kill the server it was sent to.
   bool kill_server_ = false;
 
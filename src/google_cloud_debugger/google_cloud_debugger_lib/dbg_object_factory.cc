@@ -377,6 +377,12 @@ HRESULT DbgObjectFactory::EvaluateAndCreateDbgObject(
     ICorDebugFunction *debug_function, ICorDebugEval *debug_eval,
     IEvalCoordinator *eval_coordinator,
     std::unique_ptr<DbgObject> *evaluate_result, std::ostream *err_stream) {
+  if (eval_coordinator->EvalTimeExhausted()) {
+    *err_stream << "Function evaluation skipped, the snapshot has no "
+                   "evaluation time left.";
+    return CORDBG_E_FUNC_EVAL_NOT_COMPLETE;
+  }
+
   CComPtr<ICorDebugEval2> debug_eval_2;
   HRESULT hr = debug_eval->QueryInterface(
       __uuidof(ICorDebugEval2), reinterpret_cast<void **>(&debug_eval_2));
@@ -397,6 +403,11 @@ HRESULT DbgObjectFactory::EvaluateAndCreateDbgObject(
   BOOL exception_occurred = FALSE;
   hr = eval_coordinator->WaitForEval(&exception_occurred, debug_eval,
                                      &eval_result);
+  if (hr == CORDBG_E_FUNC_EVAL_NOT_COMPLETE) {
+    *err_stream << "Function evaluation timed out.";
+    return hr;
+  }
+
   if (FAILED(hr)) {
     return hr;
   }
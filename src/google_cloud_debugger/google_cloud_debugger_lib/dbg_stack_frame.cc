@@ -498,10 +498,19 @@ HRESULT DbgStackFrame::GetDebugFunctionFromClass(
     return E_INVALIDARG;
   }
 
+  std::shared_ptr<const MethodTokenTable> method_tokens;
+  if (method_token_tables_) {
+    HRESULT hr = method_token_tables_->GetTable(debug_module, metadata_import,
+                                                &method_tokens);
+    if (FAILED(hr)) {
+      cerr << "Failed to read the methods of the module.";
+    }
+  }
+
   // First, finds the metadata token of the method.
-  mdMethodDef method_def = 0;
   HRESULT hr = method_info->PopulateMethodDefFromNameAndArguments(
-      metadata_import, class_token, this, generic_types, debug_helper_.get());
+      metadata_import, class_token, this, generic_types, debug_helper_.get(),
+      method_tokens.get());
   if (FAILED(hr) || hr == S_FALSE) {
     return hr;
   }
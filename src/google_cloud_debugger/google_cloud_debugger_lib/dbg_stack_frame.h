@@ -23,6 +23,7 @@
 
 #include "document_index.h"
 #include "i_dbg_stack_frame.h"
+#include "method_token_table.h"
 #include "type_signature.h"
 
 namespace google_cloud_debugger {
@@ -165,6 +166,13 @@ class DbgStackFrame : public IDbgStackFrame {
     class_token_ = class_token;
   }
 
+  // Sets the cache of the method tables of the loaded modules, which is
+  // used to find the methods called by expressions. Can be null.
+  void SetMethodTokenTables(
+      std::shared_ptr<MethodTokenTableCache> method_token_tables) {
+    method_token_tables_ = std::move(method_token_tables);
+  }
+
   // Sets the line number this stack frame is on.
   void SetLineNumber(std::uint32_t line_number) { line_number_ = line_number; }
 
@@ -246,6 +254,9 @@ class DbgStackFrame : public IDbgStackFrame {
   // Factory to create DbgObject.
   std::shared_ptr<IDbgObjectFactory> obj_factory_;
 
+  // Method tables of the loaded modules. Can be null.
+  std::shared_ptr<MethodTokenTableCache> method_token_tables_;
+
   // Generic types of the class the frame is in.
   std::vector<CComPtr<ICorDebugType>> class_generic_types_;
 
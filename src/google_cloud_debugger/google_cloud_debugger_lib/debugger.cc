@@ -23,6 +23,7 @@
 #include "dbgshim.h"
 #include "debugger_callback.h"
 #include "i_cor_debug_helper.h"
+#include "module_filter.h"
 
 #ifdef PLATFORM_UNIX
 // PAL is Platform Adaptation Layer which provides an abstraction
@@ -115,6 +116,14 @@ HRESULT Debugger::StartDebugging(DWORD process_id, bool kill_proc) {
     return hr;
   }
 
+  debugger_callback_->SetPdbIndexCacheDirectory(pdb_index_cache_directory_);
+  debugger_callback_->SetModuleIncludePatterns(
+      ModuleFilter::SplitPatterns(module_include_patterns_));
+  if (!module_exclude_patterns_.empty()) {
+    debugger_callback_->SetModuleExcludePatterns(
+        ModuleFilter::SplitPatterns(module_exclude_patterns_));
+  }
+
   // Using the processId, we register for debugging. If the process is ready,
   // it will call the CallbackFunction that we passed to
   // RegisterForRuntimeStartup.
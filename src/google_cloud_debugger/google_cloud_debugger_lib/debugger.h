@@ -15,6 +15,7 @@
 #ifndef DEBUGGER_H_
 #define DEBUGGER_H_
 
+#include <chrono>
 #include <string>
 
 #include "ccomptr.h"
@@ -66,10 +67,52 @@ class Debugger final {
     debugger_callback_->SetMethodEvaluation(eval);
   }
 
+  // Sets how long a function evaluation may run before it is aborted, and
+  // how long after a breakpoint hit its snapshot may start function
+  // evaluations.
+  void SetEvalTimeouts(std::chrono::milliseconds eval_timeout,
+                       std::chrono::milliseconds snapshot_eval_timeout) {
+    debugger_callback_->SetEvalTimeouts(eval_timeout, snapshot_eval_timeout);
+  }
+
+  // Sets how long a breakpoint hit may keep its thread stopped while its
+  // snapshot is captured.
+  void SetPauseTimeout(std::chrono::milliseconds pause_timeout) {
+    debugger_callback_->SetPauseTimeout(pause_timeout);
+  }
+
+  // Sets the directory where the document indices of parsed PDB files are
+  // cached. Must be called before StartDebugging.
+  void SetPdbIndexCacheDirectory(const std::string &directory) {
+    pdb_index_cache_directory_ = directory;
+  }
+
+  // Sets the comma-separated patterns of the modules whose PDB files are
+  // parsed even if they are excluded. Must be called before StartDebugging.
+  void SetModuleIncludePatterns(const std::string &patterns) {
+    module_include_patterns_ = patterns;
+  }
+
+  // Sets the comma-separated patterns of the modules whose PDB files are
+  // not parsed. If empty, framework assemblies are excluded. Must be called
+  // before StartDebugging.
+  void SetModuleExcludePatterns(const std::string &patterns) {
+    module_exclude_patterns_ = patterns;
+  }
+
  private:
   // The name of the pipe the debugger will use to communicate with the agent.
   std::string pipe_name_;
 
+  // Directory of the PDB index cache. Empty if caching is disabled.
+  std::string pdb_index_cache_directory_;
+
+  // Patterns of the modules to index even if they are excluded.
+  std::string module_include_patterns_;
+
+  // Patterns of the modules not to index. Empty to use the default ones.
+  std::string module_exclude_patterns_;
+
   // The unregister token that is used in the callback function to
   // unregister for runtime startup.
   void *unregister_token_;
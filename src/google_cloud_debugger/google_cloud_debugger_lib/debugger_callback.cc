@@ -16,6 +16,7 @@
 
 #include <stdio.h>
 
+#include <algorithm>
 #include <atomic>
 #include <iostream>
 #include <string>
@@ -25,11 +26,11 @@
 #include "constants.h"
 #include "dbg_stack_frame.h"
 #include "cor_debug_helper.h"
-#include "portable_pdb_file.h"
+#include "module_pdb_file.h"
 #include "eval_coordinator.h"
 
 using google_cloud_debugger_portable_pdb::IPortablePdbFile;
-using google_cloud_debugger_portable_pdb::PortablePdbFile;
+using google_cloud_debugger_portable_pdb::ModulePdbFile;
 using std::cerr;
 using std::cout;
 using std::string;
@@ -44,12 +45,23 @@ HRESULT DebuggerCallback::Initialize() {
 
   // TODO(quoct): We are compiling with C++11 on Linux so we don't have
   // make_unique. We should look into upgrading to C++14.
-  eval_coordinator_ =
-      std::unique_ptr<EvalCoordinator>(new (std::nothrow) EvalCoordinator);
+  if (!eval_coordinator_) {
+    std::unique_ptr<EvalCoordinator> eval_coordinator(new (std::nothrow)
+                                                          EvalCoordinator);
+    if (!eval_coordinator) {
+      cerr << "Failed to create EvalCoordinator.";
+      return E_OUTOFMEMORY;
+    }
+
+    eval_coordinator->SetMethodTokenTables(method_token_tables_);
+    eval_coordinator->SetFrameSymbolCache(frame_symbol_cache_);
+    eval_coordinator_ = std::move(eval_coordinator);
+  }
+
   breakpoint_collection_ = std::unique_ptr<IBreakpointCollection>(
       new (std::nothrow) BreakpointCollection);
-  if (!eval_coordinator_) {
-    cerr << "Failed to create EvalCoordinator.";
+  if (!breakpoint_collection_) {
+    cerr << "Failed to create BreakpointCollection.";
     return E_OUTOFMEMORY;
   }
 
@@ -61,6 +73,24 @@ HRESULT DebuggerCallback::Initialize() {
 
   debug_helper_ = std::shared_ptr<ICorDebugHelper>(new CorDebugHelper());
 
+  // An assembly reloaded by a collectible AssemblyLoadContext gets back the
+  // breakpoints of its previous load once its PDB file is indexed.
+  IBreakpointCollection *breakpoint_collection = breakpoint_collection_.get();
+  auto set_pending_breakpoints = [breakpoint_collection]() {
+    if (FAILED(breakpoint_collection->SetPendingBreakpoints())) {
+      cerr << "Failed to set the breakpoints of a reloaded module.";
+    }
+  };
+
+  module_indexer_ = std::unique_ptr<ModuleIndexer>(
+      new (std::nothrow) ModuleIndexer(kModuleIndexerThreads,
+                                       &document_path_index_, &module_filter_,
+                                       set_pending_breakpoints));
+  if (!module_indexer_) {
+    cerr << "Failed to create ModuleIndexer.";
+    return E_OUTOFMEMORY;
+  }
+
   initialized_success_ = true;
   return S_OK;
 }
@@ -111,7 +141,8 @@ ULONG STDMETHODCALLTYPE DebuggerCallback::Release(void) {
 }
 
 HRESULT STDMETHODCALLTYPE DebuggerCallback::ExitProcess(ICorDebugProcess *process) {
-	return breakpoint_collection_->CancelSyncBreakpoints();
+  module_indexer_->Shutdown();
+  return breakpoint_collection_->CancelSyncBreakpoints();
 }
 
 HRESULT STDMETHODCALLTYPE DebuggerCallback::Breakpoint(
@@ -132,23 +163,10 @@ HRESULT STDMETHODCALLTYPE DebuggerCallback::Breakpoint(
     return appdomain->Continue(FALSE);
   }
 
-  // We will get the IL frame to enumerate and print out all local variables.
-  HRESULT hr;
-  CComPtr<IMetaDataImport> metadata_import;
-
-  mdMethodDef function_token;
-  ULONG32 il_offset = 0;
-  hr = GetFunctionTokenAndILOffset(debug_breakpoint, &function_token,
-                                   &il_offset, &metadata_import);
-  if (FAILED(hr)) {
-    cerr << "Failed to get function token and IL Offset from breakpoint.";
-    appdomain->Continue(FALSE);
-    return hr;
-  }
-
-  hr = breakpoint_collection_->EvaluateAndPrintBreakpoint(
-      function_token, il_offset, eval_coordinator_.get(),
-      debug_thread, portable_pdbs_);
+  // The breakpoint collection finds the breakpoints from debug_breakpoint
+  // alone, so a hit costs no call to the debuggee before the evaluation.
+  HRESULT hr = breakpoint_collection_->EvaluateAndPrintBreakpoint(
+      debug_breakpoint, eval_coordinator_.get(), debug_thread, GetPdbFiles());
   if (FAILED(hr)) {
     cerr << "Failed to get stack frame's information.";
     appdomain->Continue(FALSE);
@@ -170,7 +188,7 @@ HRESULT STDMETHODCALLTYPE DebuggerCallback::EvalComplete(
     ICorDebugEval *eval) {
   // FinishEval method will signal to the waiting thread that we completed
   // the function evaluation.
-  eval_coordinator_->SignalFinishedEval(debug_thread);
+  eval_coordinator_->SignalFinishedEval(debug_thread, eval);
   return appdomain->Continue(FALSE);
 }
 
@@ -178,82 +196,111 @@ HRESULT STDMETHODCALLTYPE DebuggerCallback::EvalException(
     ICorDebugAppDomain *appdomain, ICorDebugThread *debug_thread,
     ICorDebugEval *eval) {
   eval_coordinator_->HandleException();
-  eval_coordinator_->SignalFinishedEval(debug_thread);
+  eval_coordinator_->SignalFinishedEval(debug_thread, eval);
   return appdomain->Continue(FALSE);
 }
 
 HRESULT DebuggerCallback::LoadModule(ICorDebugAppDomain *appdomain,
                                      ICorDebugModule *debug_module) {
-  std::unique_ptr<IPortablePdbFile> portable_pdb(new (std::nothrow)
-                                                     PortablePdbFile());
+  vector<WCHAR> module_name;
+  HRESULT hr = debug_helper_->GetModuleNameFromICorDebugModule(
+      debug_module, &module_name, &cerr);
+  if (FAILED(hr)) {
+    cerr << "Failed to get the name of the loaded module.";
+    return appdomain->Continue(FALSE);
+  }
+
+  // Framework assemblies and modules that were already found to have no
+  // PDB file are never looked at again.
+  if (!module_filter_.ShouldIndex(ConvertWCharPtrToString(module_name))) {
+    return appdomain->Continue(FALSE);
+  }
+
+  // Modules loaded from the same assembly share the parsed PDB file.
+  std::shared_ptr<IPortablePdbFile> portable_pdb;
+  if (pdb_file_factory_) {
+    portable_pdb = pdb_file_factory_();
+  } else {
+    portable_pdb.reset(new (std::nothrow)
+                           ModulePdbFile(&pdb_index_registry_));
+  }
   if (!portable_pdb) {
-    cerr << "Cannot create PortablePdbFile object.";
+    cerr << "Cannot create ModulePdbFile object.";
     appdomain->Continue(FALSE);
     return E_OUTOFMEMORY;
   }
 
-  HRESULT hr = portable_pdb->Initialize(debug_module, debug_helper_.get());
+  hr = portable_pdb->Initialize(debug_module, debug_helper_.get());
   if (FAILED(hr)) {
-    cerr << "Failed set debug module for PortablePdbFile.";
+    cerr << "Failed set debug module for ModulePdbFile.";
     return appdomain->Continue(FALSE);
   }
 
-  portable_pdbs_.push_back(std::move(portable_pdb));
+  {
+    std::lock_guard<std::mutex> lock(portable_pdbs_mutex_);
+    portable_pdbs_.push_back(portable_pdb);
+  }
 
-  return appdomain->Continue(FALSE);
-}
+  // Parse the PDB off the callback thread so the debuggee is not held up.
+  hr = module_indexer_->Enqueue(std::move(portable_pdb));
+  if (FAILED(hr)) {
+    cerr << "Failed to queue PDB file of module for parsing.";
+  }
 
-HRESULT STDMETHODCALLTYPE DebuggerCallback::CustomNotification(
-    ICorDebugThread *debug_thread, ICorDebugAppDomain *appdomain) {
   return appdomain->Continue(FALSE);
 }
 
-HRESULT DebuggerCallback::GetFunctionTokenAndILOffset(
-    ICorDebugBreakpoint *debug_breakpoint, mdMethodDef *function_token,
-    ULONG32 *il_offset, IMetaDataImport **metadata_import) {
-  CComPtr<ICorDebugFunctionBreakpoint> function_breakpoint;
-  CComPtr<ICorDebugFunction> debug_function;
-
-  HRESULT hr = debug_breakpoint->QueryInterface(
-      __uuidof(ICorDebugFunctionBreakpoint),
-      reinterpret_cast<void **>(&function_breakpoint));
-  if (FAILED(hr)) {
-    cerr << "Failed to get ICorDebugFunctionBreakpoint.";
-    return hr;
+HRESULT DebuggerCallback::UnloadModule(ICorDebugAppDomain *appdomain,
+                                       ICorDebugModule *debug_module) {
+  vector<std::shared_ptr<IPortablePdbFile>> unloaded_pdbs;
+  {
+    std::lock_guard<std::mutex> lock(portable_pdbs_mutex_);
+    auto unloaded = std::stable_partition(
+        portable_pdbs_.begin(), portable_pdbs_.end(),
+        [debug_module](const std::shared_ptr<IPortablePdbFile> &pdb_file) {
+          CComPtr<ICorDebugModule> pdb_module;
+          return FAILED(pdb_file->GetDebugModule(&pdb_module)) ||
+                 pdb_module != debug_module;
+        });
+    unloaded_pdbs.assign(unloaded, portable_pdbs_.end());
+    portable_pdbs_.erase(unloaded, portable_pdbs_.end());
   }
 
-  hr = function_breakpoint->GetFunction(&debug_function);
-  if (FAILED(hr)) {
-    cerr << "Failed to get ICorDebugFunction.";
-    return hr;
+  for (const auto &pdb_file : unloaded_pdbs) {
+    // Marking the file first keeps the module indexer and the breakpoint
+    // sync thread from adding it back to the index.
+    pdb_file->MarkUnloaded();
+    document_path_index_.RemovePdbFile(pdb_file.get());
   }
 
-  hr = debug_function->GetToken(function_token);
+  // Breakpoint names the callback of this class here.
+  vector<google::cloud::diagnostics::debug::Breakpoint> unbound_breakpoints;
+  HRESULT hr = breakpoint_collection_->RemoveBreakpointsInModule(
+      debug_module, &unbound_breakpoints);
   if (FAILED(hr)) {
-    cerr << "Failed to get function token.";
-    return hr;
+    cerr << "Failed to remove the breakpoints of unloaded module.";
   }
 
-  hr = function_breakpoint->GetOffset(il_offset);
-  if (FAILED(hr)) {
-    cerr << "Failed to get function offset.";
-    return hr;
+  if (!unbound_breakpoints.empty()) {
+    hr = eval_coordinator_->WriteBreakpointsAsync(
+        breakpoint_collection_.get(), std::move(unbound_breakpoints));
+    if (FAILED(hr)) {
+      cerr << "Failed to report the breakpoints of unloaded module.";
+    }
   }
 
-  CComPtr<ICorDebugModule> debug_module;
+  method_token_tables_->RemoveModule(debug_module);
+  frame_symbol_cache_->RemoveModule(debug_module);
 
-  hr = debug_function->GetModule(&debug_module);
-  if (FAILED(hr)) {
-    cerr << "Failed to get debug module from ICorDebugFunction.";
-    return hr;
-  }
-
-  hr = debug_helper_->GetMetadataImportFromICorDebugModule(debug_module, metadata_import,
-                                            &cerr);
-  if (FAILED(hr)) {
-    return hr;
-  }
+  // The PDB files are freed here unless a breakpoint that is being
+  // evaluated still holds on to them.
+  unloaded_pdbs.clear();
+  return appdomain->Continue(FALSE);
+}
 
-  return S_OK;
+HRESULT STDMETHODCALLTYPE DebuggerCallback::CustomNotification(
+    ICorDebugThread *debug_thread, ICorDebugAppDomain *appdomain) {
+  return appdomain->Continue(FALSE);
 }
+
 }  //  namespace google_cloud_debugger
@@ -16,14 +16,24 @@
 #define DEBUGGERCALLBACK_H_
 
 #include <atomic>
+#include <chrono>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include "i_breakpoint_collection.h"
 #include "cor.h"
 #include "cordebug.h"
 #include "corsym.h"
+#include "document_path_index.h"
+#include "frame_symbol_cache.h"
 #include "i_eval_coordinator.h"
+#include "module_filter.h"
+#include "method_token_table.h"
+#include "module_indexer.h"
+#include "pdb_index_registry.h"
 
 namespace google_cloud_debugger {
 
@@ -67,6 +77,12 @@ class DebuggerCallback final : public ICorDebugManagedCallback,
   HRESULT STDMETHODCALLTYPE LoadModule(ICorDebugAppDomain *appdomain,
                                        ICorDebugModule *debug_module) override;
 
+  // This method is called when a module is unloaded, for instance when
+  // a collectible AssemblyLoadContext is collected. Drops the PDB file of
+  // the module and the breakpoints set in it.
+  HRESULT STDMETHODCALLTYPE UnloadModule(
+      ICorDebugAppDomain *appdomain, ICorDebugModule *debug_module) override;
+
   // This method is called when the process the debugger is watching exits.
   HRESULT STDMETHODCALLTYPE ExitProcess(ICorDebugProcess *process) override;
 
@@ -96,8 +112,6 @@ class DebuggerCallback final : public ICorDebugManagedCallback,
                         ICorDebugThread *debug_thread);
   DEBUGGERCALLBACK_STUB(ExitThread, ICorDebugAppDomain,
                         ICorDebugThread *debug_thread);
-  DEBUGGERCALLBACK_STUB(UnloadModule, ICorDebugAppDomain,
-                        ICorDebugModule *debug_module);
   DEBUGGERCALLBACK_STUB(LoadClass, ICorDebugAppDomain,
                         ICorDebugClass *debug_class);
   DEBUGGERCALLBACK_STUB(UnloadClass, ICorDebugAppDomain,
@@ -168,11 +182,49 @@ class DebuggerCallback final : public ICorDebugManagedCallback,
     debug_process_ = debug_process;
   };
 
-  // Returns all the PDB files that are parsed.
-  const std::vector<
+  // Returns the PDB files of all the loaded modules, except the ones that
+  // failed to parse. Some of them may still be parsed in the background
+  // by the module indexer.
+  std::vector<
       std::shared_ptr<google_cloud_debugger_portable_pdb::IPortablePdbFile>>
-      &GetPdbFiles() const {
-    return portable_pdbs_;
+  GetPdbFiles() const {
+    std::vector<
+        std::shared_ptr<google_cloud_debugger_portable_pdb::IPortablePdbFile>>
+        pdb_files;
+    std::lock_guard<std::mutex> lock(portable_pdbs_mutex_);
+    pdb_files.reserve(portable_pdbs_.size());
+    for (const auto &pdb_file : portable_pdbs_) {
+      if (!pdb_file->HasFailedToParse()) {
+        pdb_files.push_back(pdb_file);
+      }
+    }
+    return pdb_files;
+  }
+
+  // Returns the index of the document paths of the parsed PDB files.
+  DocumentPathIndex *GetDocumentPathIndex() { return &document_path_index_; }
+
+  // Returns the method tables of the loaded modules.
+  MethodTokenTableCache *GetMethodTokenTables() {
+    return method_token_tables_.get();
+  }
+
+  // Returns the cache of the symbols and locations of the stack frames
+  // seen in breakpoint hits.
+  FrameSymbolCache *GetFrameSymbolCache() { return frame_symbol_cache_.get(); }
+
+  // Returns the collection of breakpoints, or nullptr before Initialize.
+  IBreakpointCollection *GetBreakpointCollection() {
+    return breakpoint_collection_.get();
+  }
+
+  // Returns the histogram of the time the PDB files of the loaded modules
+  // took to parse. See ModuleIndexer::GetParseLatencyHistogram.
+  std::vector<std::uint64_t> GetPdbParseLatencyHistogram() const {
+    if (!module_indexer_) {
+      return std::vector<std::uint64_t>();
+    }
+    return module_indexer_->GetParseLatencyHistogram();
   }
 
   // Reads, parses and activates/deactivates incoming breakpoints.
@@ -195,18 +247,59 @@ class DebuggerCallback final : public ICorDebugManagedCallback,
     eval_coordinator_->SetMethodEvaluation(eval);
   }
 
+  // Sets how long a function evaluation may run, and how long after a
+  // breakpoint hit its snapshot may start function evaluations.
+  void SetEvalTimeouts(std::chrono::milliseconds eval_timeout,
+                       std::chrono::milliseconds snapshot_eval_timeout) {
+    eval_coordinator_->SetEvalTimeouts(eval_timeout, snapshot_eval_timeout);
+  }
+
+  // Sets how long a breakpoint hit may keep its thread stopped.
+  void SetPauseTimeout(std::chrono::milliseconds pause_timeout) {
+    eval_coordinator_->SetPauseTimeout(pause_timeout);
+  }
+
   // Gets the name of the pipe the debugger will use to communicate with
   // the agent.
   std::string GetPipeName() { return pipe_name_; }
+
+  // Sets the directory where the document indices of parsed PDB files are
+  // cached. Must be called before any module is loaded.
+  void SetPdbIndexCacheDirectory(const std::string &directory) {
+    pdb_index_registry_.SetIndexCacheDirectory(directory);
+  }
+
+  // Sets the patterns of the modules whose PDB files are parsed even if
+  // they are excluded. See ModuleFilter.
+  void SetModuleIncludePatterns(std::vector<std::string> patterns) {
+    module_filter_.SetIncludePatterns(std::move(patterns));
+  }
+
+  // Sets the patterns of the modules whose PDB files are not parsed,
+  // replacing the default ones. See ModuleFilter.
+  void SetModuleExcludePatterns(std::vector<std::string> patterns) {
+    module_filter_.SetExcludePatterns(std::move(patterns));
+  }
+
+  // Replaces the eval coordinator that Initialize creates, so that tests
+  // do not evaluate or write breakpoints. Must be called before Initialize.
+  void SetEvalCoordinator(
+      std::unique_ptr<IEvalCoordinator> eval_coordinator) {
+    eval_coordinator_ = std::move(eval_coordinator);
+  }
+
+  // Sets the function that creates the PDB file object of each loaded
+  // module, before LoadModule initializes it with the module. By default,
+  // the PDB file next to the module is read. Must be called before any
+  // module is loaded.
+  void SetPdbFileFactory(
+      std::function<std::shared_ptr<
+          google_cloud_debugger_portable_pdb::IPortablePdbFile>()>
+          pdb_file_factory) {
+    pdb_file_factory_ = std::move(pdb_file_factory);
+  }
   
  private:
-  // Given an ICorDebugBreakpoint, gets the function token, IL offset
-  // and metadata of the function that the breakpoint is in.
-  HRESULT GetFunctionTokenAndILOffset(ICorDebugBreakpoint *debug_breakpoint,
-                                      mdMethodDef *function_token,
-                                      ULONG32 *il_offset,
-                                      IMetaDataImport **metadata_import);
-
   // An EvalCoordinator is used to coordinate between DebuggerCallback object
   // and a StackFrame object when an evaluation is needed. See the
   // EvalCoordinator class for comments on how to use it.
@@ -215,11 +308,40 @@ class DebuggerCallback final : public ICorDebugManagedCallback,
   // This field is used for reference counting (AddRef and Release).
   std::atomic<ULONG> ref_count_;
 
-  // Vector containing all the portable PDB files that are parsed.
+  // Vector containing the portable PDB files of all the loaded modules.
   std::vector<
       std::shared_ptr<google_cloud_debugger_portable_pdb::IPortablePdbFile>>
       portable_pdbs_;
 
+  // Mutex protecting portable_pdbs_. The vector is changed on the
+  // callback thread and read by the breakpoint sync thread.
+  mutable std::mutex portable_pdbs_mutex_;
+
+  // Parsed PDB files, shared between the modules loaded from the same
+  // assembly.
+  google_cloud_debugger_portable_pdb::PdbIndexRegistry pdb_index_registry_;
+
+  // Index of the document paths of all the parsed PDB files.
+  DocumentPathIndex document_path_index_;
+
+  // Method tables of the loaded modules, shared with the eval coordinator
+  // and used by the breakpoint collection.
+  std::shared_ptr<MethodTokenTableCache> method_token_tables_ =
+      std::make_shared<MethodTokenTableCache>();
+
+  // Symbols and locations of the stack frames seen in breakpoint hits,
+  // shared with the eval coordinator.
+  std::shared_ptr<FrameSymbolCache> frame_symbol_cache_ =
+      std::make_shared<FrameSymbolCache>();
+
+  // Creates the PDB file objects of loaded modules, if set.
+  std::function<
+      std::shared_ptr<google_cloud_debugger_portable_pdb::IPortablePdbFile>()>
+      pdb_file_factory_;
+
+  // Decides which modules get their PDB files parsed.
+  ModuleFilter module_filter_;
+
   // The ICorDebugProcess of the debugged process.
   CComPtr<ICorDebugProcess> debug_process_;
 
@@ -227,6 +349,11 @@ class DebuggerCallback final : public ICorDebugManagedCallback,
   // manage breakpoints.
   std::unique_ptr<IBreakpointCollection> breakpoint_collection_;
 
+  // Parses the PDB files of newly loaded modules in the background.
+  // Declared after the members its worker threads use, so that it is
+  // destroyed, and its threads stopped, before them.
+  std::unique_ptr<ModuleIndexer> module_indexer_;
+
   // Helper methods for ICorDebug objects.
   std::shared_ptr<ICorDebugHelper> debug_helper_;
 
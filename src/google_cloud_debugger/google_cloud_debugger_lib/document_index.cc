@@ -16,6 +16,7 @@
 
 #include <assert.h>
 #include <algorithm>
+#include <cctype>
 #include <iostream>
 
 #include "custom_binary_reader.h"
@@ -24,12 +25,122 @@
 using std::cerr;
 using std::max;
 using std::min;
+using std::shared_ptr;
 using std::string;
 using std::vector;
 
 namespace google_cloud_debugger_portable_pdb {
 
+namespace {
+
+// Compares rows of the LocalScope table with a method def so the rows
+// that belong to a method can be found with a binary search.
+struct LocalScopeMethodCompare {
+  bool operator()(const LocalScopeRow &row, uint32_t method_def) const {
+    return row.method_def < method_def;
+  }
+
+  bool operator()(uint32_t method_def, const LocalScopeRow &row) const {
+    return method_def < row.method_def;
+  }
+};
+
+}  // namespace
+
+vector<string> SplitNormalizedFilePath(const string &path) {
+  vector<string> result;
+  string segment;
+  for (char c : path) {
+    if (c == '/' || c == '\\') {
+      result.push_back(std::move(segment));
+      segment.clear();
+    } else {
+      segment += std::tolower(static_cast<unsigned char>(c));
+    }
+  }
+  result.push_back(std::move(segment));
+
+  std::reverse(result.begin(), result.end());
+  return result;
+}
+
+size_t GetMethodMemoryUsage(const MethodInfo &method) {
+  size_t usage = method.sequence_points.GetMemoryUsage() +
+                 method.local_scope.capacity() * sizeof(Scope);
+  for (const Scope &scope : method.local_scope) {
+    usage += scope.local_variables.capacity() * sizeof(ScopeLocalVariable) +
+             scope.local_constants.capacity() * sizeof(ScopeLocalConstant);
+  }
+  return usage;
+}
+
+vector<const string *> InternFilePathSegments(const string &path,
+                                              StringPool *string_pool) {
+  vector<string> segments = SplitNormalizedFilePath(path);
+  vector<const string *> result;
+  result.reserve(segments.size());
+  for (const string &segment : segments) {
+    result.push_back(&string_pool->Get(string_pool->Intern(segment)));
+  }
+  return result;
+}
+
+void GetScopeLocals(const Scope &scope, const StringPool &string_pool,
+                    vector<LocalVariableInfo> *local_variables,
+                    vector<LocalConstantInfo> *local_constants) {
+  for (const ScopeLocalVariable &scope_variable : scope.local_variables) {
+    LocalVariableInfo variable;
+    variable.slot = scope_variable.slot;
+    variable.name = string_pool.Get(scope_variable.name);
+    variable.debugger_hidden = scope_variable.debugger_hidden;
+    local_variables->push_back(std::move(variable));
+  }
+
+  for (const ScopeLocalConstant &scope_constant : scope.local_constants) {
+    LocalConstantInfo constant;
+    constant.name = string_pool.Get(scope_constant.name);
+    const string &signature = string_pool.Get(scope_constant.signature_data);
+    constant.signature_data.assign(signature.begin(), signature.end());
+    local_constants->push_back(std::move(constant));
+  }
+}
+
+bool FindSequencePointAtOffset(const MethodInfo &method, uint32_t il_offset,
+                               SequencePoint *sequence_point) {
+  // Sequence points are sorted by IL offset, so we can stop at the first
+  // one past il_offset.
+  bool found = false;
+  for (const SequencePoint &current : method.sequence_points) {
+    if (current.il_offset > il_offset) {
+      break;
+    }
+
+    if (!current.is_hidden) {
+      *sequence_point = current;
+      found = true;
+    }
+  }
+
+  return found;
+}
+
+DocumentIndex::DocumentIndex() : string_pool_(new StringPool()) {}
+
+DocumentIndex::DocumentIndex(shared_ptr<StringPool> string_pool)
+    : string_pool_(std::move(string_pool)) {}
+
 bool DocumentIndex::Initialize(const IPortablePdbFile &pdb, int doc_index) {
+  if (!BeginInitialize(pdb, doc_index) ||
+      !ParseMethods(pdb, 0, methods_.size())) {
+    return false;
+  }
+
+  EndInitialize();
+  return true;
+}
+
+bool DocumentIndex::BeginInitialize(const IPortablePdbFile &pdb,
+                                    int doc_index) {
   if (doc_index == 0) {
     cerr << "Document index has to be larger than 0.";
     return false;
@@ -48,6 +159,7 @@ bool DocumentIndex::Initialize(const IPortablePdbFile &pdb, int doc_index) {
     cerr << "Failed to get document name for file " << file_path_ << std::endl;
     return false;
   }
+  SplitFilePath();
 
   // See:
   // https://github.com/dotnet/corefx/blob/master/src/System.Reflection.Metadata/specs/PortablePdb-Metadata.md#document-table-0x30
@@ -73,33 +185,92 @@ bool DocumentIndex::Initialize(const IPortablePdbFile &pdb, int doc_index) {
     return false;
   }
 
-  // We rely on the 1:1 mapping between the Method and MethodDebugInfo tables.
-  vector<MethodDebugInformationRow> method_debug_info_rows =
+  // The PDB has already grouped the method debug info rows by document,
+  // so we only visit the methods in this document.
+  doc_index_ = doc_index;
+  methods_.resize(pdb.GetDocumentMethods(doc_index).size());
+  return true;
+}
+
+bool DocumentIndex::ParseMethods(const IPortablePdbFile &pdb, size_t first,
+                                 size_t last) {
+  const vector<MethodDebugInformationRow> &method_debug_info_rows =
       pdb.GetMethodDebugInfoTable();
-  size_t num_of_methods = method_debug_info_rows.size();
-  methods_.reserve(num_of_methods);
+  const vector<uint32_t> &document_methods =
+      pdb.GetDocumentMethods(doc_index_);
+  if (last > document_methods.size() || last > methods_.size()) {
+    cerr << "Method range is larger than the number of methods in document "
+         << std::to_string(doc_index_);
+    return false;
+  }
 
-  for (size_t method_def = 1; method_def < num_of_methods; ++method_def) {
-    MethodDebugInformationRow debug_info_row =
-        method_debug_info_rows[method_def];
-    // Pedantically we are ignoring methods that span multiple files.
-    if (debug_info_row.document != doc_index) {
-      continue;
+  for (size_t i = first; i < last; ++i) {
+    uint32_t method_def = document_methods[i];
+    if (method_def >= method_debug_info_rows.size()) {
+      cerr << "Method " << std::to_string(method_def)
+           << " is larger than the MethodDebugInfo Table size.";
+      return false;
     }
 
-    MethodInfo method;
-    if (!ParseMethod(&method, pdb, debug_info_row, method_def, doc_index)) {
+    const MethodDebugInformationRow &debug_info_row =
+        method_debug_info_rows[method_def];
+    if (!ParseMethod(&methods_[i], pdb, debug_info_row, method_def,
+                     doc_index_)) {
       cerr << "Failed to parse the method " << std::to_string(method_def)
-           << " in document " << std::to_string(doc_index);
+           << " in document " << std::to_string(doc_index_);
       return false;
     }
+  }
+
+  return true;
+}
+
+void DocumentIndex::EndInitialize() { line_index_.Build(methods_); }
 
-    methods_.push_back(std::move(method));
+void DocumentIndex::InitializeFromSnapshot(string file_path,
+                                           vector<MethodInfo> methods) {
+  file_path_ = std::move(file_path);
+  SplitFilePath();
+  methods_ = std::move(methods);
+  line_index_.Build(methods_);
+}
+
+void DocumentIndex::SplitFilePath() {
+  file_path_segments_ = InternFilePathSegments(file_path_, string_pool_.get());
+}
+
+bool DocumentIndex::FindBreakpointLocation(
+    uint32_t line, const MethodInfo **method,
+    SequencePoint *sequence_point) const {
+  if (!method || !sequence_point) {
+    return false;
+  }
+
+  uint32_t method_index;
+  uint32_t sequence_point_index;
+  if (!line_index_.FindBreakpointLocation(line, &method_index,
+                                          &sequence_point_index)) {
+    return false;
   }
 
+  *method = &methods_[method_index];
+  *sequence_point =
+      methods_[method_index].sequence_points.Get(sequence_point_index);
   return true;
 }
 
+size_t DocumentIndex::GetMemoryUsage() const {
+  size_t usage = sizeof(*this) + file_path_.capacity() +
+                 file_path_segments_.capacity() * sizeof(const string *) +
+                 source_language_.capacity() + hash_algorithm_.capacity() +
+                 hash_.capacity() + methods_.capacity() * sizeof(MethodInfo) +
+                 line_index_.GetMemoryUsage();
+  for (const MethodInfo &method : methods_) {
+    usage += GetMethodMemoryUsage(method);
+  }
+  return usage;
+}
+
 bool DocumentIndex::ParseMethod(MethodInfo *method, const IPortablePdbFile &pdb,
                                 const MethodDebugInformationRow &debug_info_row,
                                 uint32_t method_def, uint32_t doc_index) {
@@ -117,7 +288,6 @@ bool DocumentIndex::ParseMethod(MethodInfo *method, const IPortablePdbFile &pdb,
   }
 
   uint32_t il_offset = 0;
-  method->sequence_points.reserve(sequence_point_info.records.size());
 
   for (const auto &seq_point_record : sequence_point_info.records) {
     if (IsDocumentChange(seq_point_record)) {
@@ -140,21 +310,31 @@ bool DocumentIndex::ParseMethod(MethodInfo *method, const IPortablePdbFile &pdb,
       method->last_line = max(seq_point_record.end_line, method->last_line);
     }
 
-    method->sequence_points.push_back(std::move(seq_point));
+    method->sequence_points.push_back(seq_point);
   }
+  method->sequence_points.ShrinkToFit();
 
-  bool first_scope = true;
   const vector<LocalScopeRow> &local_scope_table = pdb.GetLocalScopeTable();
   const vector<LocalVariableRow> &local_variable_table =
       pdb.GetLocalVariableTable();
   const vector<LocalConstantRow> &local_constant_table =
       pdb.GetLocalConstantTable();
-  for (size_t index = 1; index < local_scope_table.size(); ++index) {
-    const LocalScopeRow &local_scope_row = local_scope_table[index];
-    if (local_scope_row.method_def != method_def) {
-      continue;
-    }
+  if (local_scope_table.size() <= 1) {
+    return true;
+  }
 
+  // The LocalScope table is sorted by method (see the Portable PDB spec),
+  // so the scopes of this method are a contiguous run of rows that we can
+  // find with a binary search. Row 0 is the empty row.
+  auto method_scopes =
+      std::equal_range(local_scope_table.begin() + 1, local_scope_table.end(),
+                       method_def, LocalScopeMethodCompare());
+  size_t first_scope = method_scopes.first - local_scope_table.begin();
+  size_t last_scope = method_scopes.second - local_scope_table.begin();
+  method->local_scope.reserve(last_scope - first_scope);
+
+  for (size_t index = first_scope; index < last_scope; ++index) {
+    const LocalScopeRow &local_scope_row = local_scope_table[index];
     Scope local_scope;
     if (!ParseScope(&local_scope, pdb, local_scope_row, local_scope_table,
                     local_variable_table, local_constant_table, method_def,
@@ -209,18 +389,22 @@ bool DocumentIndex::ParseScope(
     return false;
   }
 
+  local_scope->local_variables.reserve(local_scope->local_var_row_end_index -
+                                       local_scope->local_var_row_start_index);
   for (size_t var_idx = local_scope->local_var_row_start_index;
        var_idx < local_scope->local_var_row_end_index; ++var_idx) {
     const LocalVariableRow &local_variable_row = local_variable_table[var_idx];
-    LocalVariableInfo new_variable;
+    ScopeLocalVariable new_variable;
     new_variable.debugger_hidden =
         (local_variable_row.attributes == kDebuggerHidden);
     new_variable.slot = local_variable_row.index;
-    if (!pdb.GetHeapString(local_variable_row.name, &new_variable.name)) {
+    string variable_name;
+    if (!pdb.GetHeapString(local_variable_row.name, &variable_name)) {
       return false;
     }
 
-    local_scope->local_variables.push_back(std::move(new_variable));
+    new_variable.name = string_pool_->Intern(variable_name);
+    local_scope->local_variables.push_back(new_variable);
   }
 
   if ((local_scope->local_const_row_end_index <
@@ -231,21 +415,28 @@ bool DocumentIndex::ParseScope(
   }
 
   // Local constants.
+  local_scope->local_constants.reserve(
+      local_scope->local_const_row_end_index -
+      local_scope->local_const_row_start_index);
   for (size_t const_idx = local_scope->local_const_row_start_index;
        const_idx < local_scope->local_const_row_end_index; ++const_idx) {
     const LocalConstantRow &local_constant_row =
         local_constant_table[const_idx];
-    LocalConstantInfo new_const;
-    if (!pdb.GetHeapString(local_constant_row.name, &new_const.name)) {
+    string constant_name;
+    if (!pdb.GetHeapString(local_constant_row.name, &constant_name)) {
       return false;
     }
 
-    if (!pdb.GetBlobBytes(local_constant_row.signature,
-                          &(new_const.signature_data))) {
+    vector<uint8_t> signature_data;
+    if (!pdb.GetBlobBytes(local_constant_row.signature, &signature_data)) {
       return false;
     }
 
-    local_scope->local_constants.push_back(std::move(new_const));
+    ScopeLocalConstant new_const;
+    new_const.name = string_pool_->Intern(constant_name);
+    new_const.signature_data = string_pool_->Intern(
+        string(signature_data.begin(), signature_data.end()));
+    local_scope->local_constants.push_back(new_const);
   }
 
   return true;
@@ -15,39 +15,21 @@
 #ifndef DOCUMENT_INDEX_H_
 #define DOCUMENT_INDEX_H_
 
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "document_line_index.h"
 #include "metadata_tables.h"
+#include "sequence_point_list.h"
+#include "string_pool.h"
 
 namespace google_cloud_debugger_portable_pdb {
 
 class IPortablePdbFile;
 
-// Struct that represents a sequence point in a method.
-// Unlike SequencePointRecord struct, this struct has
-// the absoluate IL Offset.
-struct SequencePoint {
-  // IL Offset of this sequence point.
-  std::uint32_t il_offset = 0;
-
-  // Start line of this sequence point.
-  std::uint32_t start_line = 0;
-
-  // Start column of this sequence point.
-  std::uint32_t start_col = 0;
-
-  // End line of this sequence point.
-  std::uint32_t end_line = 0;
-
-  // End column of this sequence point.
-  std::uint32_t end_col = 0;
-
-  // True if this is a hidden or document change sequence point.
-  bool is_hidden = false;
-};
-
 // Struct that represents a local variable in a method.
 struct LocalVariableInfo {
   // The slot (index) of the variable in the method.
@@ -68,6 +50,29 @@ struct LocalConstantInfo {
   std::vector<uint8_t> signature_data;
 };
 
+// A local variable as it is stored in a Scope. Its name is an id in the
+// StringPool of the document index.
+struct ScopeLocalVariable {
+  // Id of the name of the variable.
+  std::uint32_t name = 0;
+
+  // The slot (index) of the variable in the method.
+  std::uint16_t slot = 0;
+
+  // True if the variable should be hidden from the debugger.
+  bool debugger_hidden = false;
+};
+
+// A local constant as it is stored in a Scope. Its name and signature
+// are ids in the StringPool of the document index.
+struct ScopeLocalConstant {
+  // Id of the name of the constant.
+  std::uint32_t name = 0;
+
+  // Id of the bytes containing signature data.
+  std::uint32_t signature_data = 0;
+};
+
 // Struct that represents the local scope of a method.
 // Each local scope will be mapped bijectively to a number of
 // rows in the LocalVariable table of the PDB. That means
@@ -95,10 +100,10 @@ struct Scope {
   std::uint32_t length = 0;
 
   // Local variables owned by this scope.
-  std::vector<LocalVariableInfo> local_variables;
+  std::vector<ScopeLocalVariable> local_variables;
 
   // Local constants owned by this scope.
-  std::vector<LocalConstantInfo> local_constants;
+  std::vector<ScopeLocalConstant> local_constants;
 };
 
 // Struct that represents a method in a document.
@@ -112,8 +117,8 @@ struct MethodInfo {
   // Last line of this method.
   std::uint32_t last_line = 0;
 
-  // Vector of sequence points of this method.
-  std::vector<SequencePoint> sequence_points;
+  // Sequence points of this method.
+  SequencePointList sequence_points;
 
   // Vector of local scopes of this method.
   std::vector<Scope> local_scope;
@@ -135,23 +140,124 @@ class IDocumentIndex {
   // Returns the file path of this document.
   virtual const std::string &GetFilePath() const = 0;
 
-  // Returns all the methods in this document.
+  // Returns the segments of the file path of this document, as split by
+  // SplitNormalizedFilePath. The segments are interned in the string pool
+  // of this document, so documents in the same directories share them.
+  virtual const std::vector<const std::string *> &GetFilePathSegments()
+      const = 0;
+
+  // Returns all the methods in this document. A document index loaded
+  // from a PdbIndexCache builds them all on the first call, so code that
+  // only needs a few methods should use GetMethod instead.
   virtual const std::vector<MethodInfo> &GetMethods() const = 0;
+
+  // Returns the method at position in GetMethods, or nullptr if there is
+  // none. The method stays valid as long as this document index.
+  virtual const MethodInfo *GetMethod(std::uint32_t position) const = 0;
+
+  // Finds where a breakpoint at line should be set: the innermost method
+  // containing line that has a non-hidden sequence point starting on or
+  // after line, and the first such sequence point in IL order.
+  // Returns false if there is no such method.
+  virtual bool FindBreakpointLocation(
+      std::uint32_t line, const MethodInfo **method,
+      SequencePoint *sequence_point) const = 0;
+
+  // Returns the pool holding the names and signatures of the local
+  // variables and constants of the methods of this document.
+  virtual const StringPool &GetStringPool() const = 0;
+
+  // Returns an estimate of the number of bytes used by this document
+  // index, not counting its string pool, which is shared with the other
+  // documents of the PDB.
+  virtual std::size_t GetMemoryUsage() const = 0;
 };
 
+// Returns the local variables and constants of scope, with their names
+// and signatures looked up in string_pool.
+void GetScopeLocals(const Scope &scope, const StringPool &string_pool,
+                    std::vector<LocalVariableInfo> *local_variables,
+                    std::vector<LocalConstantInfo> *local_constants);
+
+// Splits path into its segments, last segment (the file name) first.
+// The path is lowercased and both '/' and '\' are treated as separators,
+// since PDBs can have either Unix or Windows-style paths.
+std::vector<std::string> SplitNormalizedFilePath(const std::string &path);
+
+// Returns an estimate of the number of bytes allocated for the sequence
+// points, scopes and locals of method, not counting method itself.
+std::size_t GetMethodMemoryUsage(const MethodInfo &method);
+
+// Returns the segments of path, as split by SplitNormalizedFilePath,
+// interned in string_pool.
+std::vector<const std::string *> InternFilePathSegments(
+    const std::string &path, StringPool *string_pool);
+
+// Finds the last non-hidden sequence point of method whose IL offset is
+// not larger than il_offset. Returns false if there is none.
+bool FindSequencePointAtOffset(const MethodInfo &method,
+                               std::uint32_t il_offset,
+                               SequencePoint *sequence_point);
+
 // Implementation of IDocumentIndex interface.
 class DocumentIndex : public IDocumentIndex {
  public:
+  // Creates a document index with a string pool of its own.
+  DocumentIndex();
+
+  // Creates a document index that interns the names and signatures of
+  // its locals in string_pool, which can be shared with other documents.
+  explicit DocumentIndex(std::shared_ptr<StringPool> string_pool);
+
   // Initialize this document index to the document at index doc_index
   // in the DocumentTable of the Portable PDB file pdb.
   bool Initialize(const IPortablePdbFile &pdb, int doc_index);
 
+  // Initialize in three steps, so that the methods of a document can be
+  // parsed in pieces on several threads. BeginInitialize reads the
+  // document row and makes room for the methods of the document,
+  // ParseMethods parses methods [first, last) into their place and
+  // EndInitialize builds the line index once all of them are parsed.
+  // Calls to ParseMethods with ranges that do not overlap can run at the
+  // same time.
+  bool BeginInitialize(const IPortablePdbFile &pdb, int doc_index);
+  bool ParseMethods(const IPortablePdbFile &pdb, std::size_t first,
+                    std::size_t last);
+  void EndInitialize();
+
+  // Initializes this document index with a file path and methods that
+  // were loaded from a PdbIndexCache instead of parsed from the PDB.
+  // The ids in the scopes of methods must come from the string pool of
+  // this document index.
+  void InitializeFromSnapshot(std::string file_path,
+                              std::vector<MethodInfo> methods);
+
   // Returns the file path of this document.
   const std::string &GetFilePath() const { return file_path_; }
 
+  // Returns the interned segments of the file path of this document.
+  const std::vector<const std::string *> &GetFilePathSegments() const {
+    return file_path_segments_;
+  }
+
   // Returns all the methods in this document.
   const std::vector<MethodInfo> &GetMethods() const { return methods_; }
 
+  // Returns the method at position in methods_.
+  const MethodInfo *GetMethod(std::uint32_t position) const {
+    return position < methods_.size() ? &methods_[position] : nullptr;
+  }
+
+  // Finds where a breakpoint at line should be set using line_index_.
+  bool FindBreakpointLocation(std::uint32_t line, const MethodInfo **method,
+                              SequencePoint *sequence_point) const;
+
+  // Returns the string pool of this document index.
+  const StringPool &GetStringPool() const { return *string_pool_; }
+
+  // Returns an estimate of the number of bytes used by this document index.
+  std::size_t GetMemoryUsage() const;
+
  private:
   // Populate a method object that corresponds to MethodDebugInformationRow
   // debug_info_row. This function assumes that the method only spans
@@ -171,9 +277,15 @@ class DocumentIndex : public IDocumentIndex {
                   const std::vector<LocalConstantRow> &local_constant_table,
                   std::uint32_t method_def, std::uint32_t scope_index);
 
+  // Splits file_path_ into file_path_segments_.
+  void SplitFilePath();
+
   // The file path of this document.
   std::string file_path_;
 
+  // Segments of file_path_, interned in string_pool_.
+  std::vector<const std::string *> file_path_segments_;
+
   // The source language of this document.
   std::string source_language_;
 
@@ -183,8 +295,17 @@ class DocumentIndex : public IDocumentIndex {
   // The hash of this document.
   std::vector<uint8_t> hash_;
 
+  // Index of this document in the DocumentTable of the PDB.
+  std::uint32_t doc_index_ = 0;
+
   // The methods of this document.
   std::vector<MethodInfo> methods_;
+
+  // Line index over methods_, built once methods_ is populated.
+  DocumentLineIndex line_index_;
+
+  // Pool of the names and signatures of the locals of methods_.
+  std::shared_ptr<StringPool> string_pool_;
 };
 
 }  // namespace google_cloud_debugger_portable_pdb
@@ -0,0 +1,180 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "document_line_index.h"
+
+#include <algorithm>
+
+#include "document_index.h"
+
+using std::vector;
+
+namespace google_cloud_debugger_portable_pdb {
+
+void DocumentLineIndex::Build(const vector<MethodInfo> &methods) {
+  is_view_ = false;
+  methods_by_line_.clear();
+  sequence_point_lines_.clear();
+  methods_by_line_.reserve(methods.size());
+
+  for (uint32_t method_index = 0; method_index < methods.size();
+       ++method_index) {
+    const MethodInfo &method = methods[method_index];
+
+    MethodEntry entry;
+    entry.first_line = method.first_line;
+    entry.last_line = method.last_line;
+    entry.method_index = method_index;
+    entry.parent = kNoParent;
+    entry.lines_begin = sequence_point_lines_.size();
+
+    uint32_t sequence_point_index = 0;
+    for (const SequencePoint &sequence_point : method.sequence_points) {
+      if (!sequence_point.is_hidden) {
+        sequence_point_lines_.push_back(
+            {sequence_point.start_line, sequence_point_index});
+      }
+      ++sequence_point_index;
+    }
+    entry.lines_end = sequence_point_lines_.size();
+
+    auto lines_begin = sequence_point_lines_.begin() + entry.lines_begin;
+    auto lines_end = sequence_point_lines_.end();
+    std::sort(lines_begin, lines_end,
+              [](const SequencePointLine &first,
+                 const SequencePointLine &second) {
+                return first.start_line < second.start_line ||
+                       (first.start_line == second.start_line &&
+                        first.sequence_point_index <
+                            second.sequence_point_index);
+              });
+
+    // A lookup lands on the first entry that starts on or after the line,
+    // but a later entry may come first in IL order. Take the running
+    // minimum from the end so each entry holds the first one in IL order.
+    for (uint32_t i = entry.lines_end; i > entry.lines_begin + 1; --i) {
+      SequencePointLine &previous = sequence_point_lines_[i - 2];
+      previous.sequence_point_index =
+          std::min(previous.sequence_point_index,
+                   sequence_point_lines_[i - 1].sequence_point_index);
+    }
+
+    methods_by_line_.push_back(entry);
+  }
+
+  sequence_point_lines_.shrink_to_fit();
+
+  // For identical line ranges, keep the lower method index innermost so
+  // it is tried first.
+  std::sort(methods_by_line_.begin(), methods_by_line_.end(),
+            [](const MethodEntry &first, const MethodEntry &second) {
+              if (first.first_line != second.first_line) {
+                return first.first_line < second.first_line;
+              }
+              if (first.last_line != second.last_line) {
+                return first.last_line > second.last_line;
+              }
+              return first.method_index > second.method_index;
+            });
+
+  // Methods are either nested or disjoint, so the methods that enclose the
+  // current one are on a stack of the methods that are still open.
+  vector<uint32_t> open_methods;
+  for (uint32_t position = 0; position < methods_by_line_.size(); ++position) {
+    MethodEntry &entry = methods_by_line_[position];
+    while (!open_methods.empty() &&
+           methods_by_line_[open_methods.back()].last_line <
+               entry.first_line) {
+      open_methods.pop_back();
+    }
+
+    if (!open_methods.empty()) {
+      entry.parent = open_methods.back();
+    }
+    open_methods.push_back(position);
+  }
+}
+
+bool DocumentLineIndex::FindBreakpointLocation(
+    uint32_t line, uint32_t *method_index,
+    uint32_t *sequence_point_index) const {
+  if (!method_index || !sequence_point_index) {
+    return false;
+  }
+
+  const MethodEntry *entries = GetMethodEntries();
+  uint32_t num_entries = GetMethodEntryCount();
+  const SequencePointLine *lines = GetSequencePointLines();
+  uint32_t num_lines = GetSequencePointLineCount();
+
+  // The last method that starts on or before line.
+  const MethodEntry *method_it = std::upper_bound(
+      entries, entries + num_entries, line,
+      [](uint32_t line, const MethodEntry &entry) {
+        return line < entry.first_line;
+      });
+  if (method_it == entries) {
+    return false;
+  }
+
+  // Any method containing line also contains the first line of that method,
+  // so it is either that method or one of the methods enclosing it.
+  uint32_t position = method_it - entries - 1;
+  while (position != kNoParent) {
+    const MethodEntry &entry = entries[position];
+    // Enclosing methods come first, so the walk always ends. The checks
+    // only fail for the view of a corrupted table.
+    if ((entry.parent != kNoParent && entry.parent >= position) ||
+        entry.lines_begin > entry.lines_end || entry.lines_end > num_lines ||
+        (is_view_ && entry.method_index >= num_methods_)) {
+      return false;
+    }
+
+    if (entry.last_line >= line) {
+      const SequencePointLine *lines_begin = lines + entry.lines_begin;
+      const SequencePointLine *lines_end = lines + entry.lines_end;
+      const SequencePointLine *line_it = std::lower_bound(
+          lines_begin, lines_end, line,
+          [](const SequencePointLine &sequence_point_line, uint32_t line) {
+            return sequence_point_line.start_line < line;
+          });
+
+      if (line_it != lines_end) {
+        *method_index = entry.method_index;
+        *sequence_point_index = line_it->sequence_point_index;
+        return true;
+      }
+    }
+
+    position = entry.parent;
+  }
+
+  return false;
+}
+
+void DocumentLineIndex::SetView(const MethodEntry *method_entries,
+                                uint32_t num_method_entries,
+                                const SequencePointLine *lines,
+                                uint32_t num_lines, uint32_t num_methods) {
+  methods_by_line_ = vector<MethodEntry>();
+  sequence_point_lines_ = vector<SequencePointLine>();
+  is_view_ = true;
+  method_entries_view_ = method_entries;
+  num_method_entries_ = method_entries ? num_method_entries : 0;
+  lines_view_ = lines;
+  num_lines_ = lines ? num_lines : 0;
+  num_methods_ = num_methods;
+}
+
+}  // namespace google_cloud_debugger_portable_pdb
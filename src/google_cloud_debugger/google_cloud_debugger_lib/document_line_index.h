@@ -0,0 +1,161 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DOCUMENT_LINE_INDEX_H_
+#define DOCUMENT_LINE_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace google_cloud_debugger_portable_pdb {
+
+struct MethodInfo;
+
+// Index from source lines to the methods and sequence points of a document,
+// used to bind breakpoints.
+//
+// A breakpoint at a line is set in the innermost method containing the line
+// (a lambda rather than the method it is defined in) that has a non-hidden
+// sequence point starting on or after the line. Within that method, we use
+// the first such sequence point in IL order. If the innermost method has no
+// such sequence point, the enclosing methods are tried from the inside out.
+//
+// The methods are sorted by first line, and each method is linked to the
+// innermost method that encloses it. Each method also has its non-hidden
+// sequence points sorted by start line. A lookup is then a binary search for
+// the method, a walk up the (short) chain of enclosing methods and a binary
+// search for the sequence point.
+//
+// The index can also be a read-only view of method entries and sequence
+// point lines it does not own, such as the tables of a mapped PdbIndexCache
+// file (see SetView).
+class DocumentLineIndex {
+ public:
+  // A method in methods_by_line_.
+  struct MethodEntry {
+    // First line of the method.
+    std::uint32_t first_line;
+
+    // Last line of the method.
+    std::uint32_t last_line;
+
+    // Position of the method in the vector the index was built for.
+    std::uint32_t method_index;
+
+    // Position in methods_by_line_ of the innermost method enclosing this
+    // one, or kNoParent.
+    std::uint32_t parent;
+
+    // Range [lines_begin, lines_end) of the sequence point lines of this
+    // method in sequence_point_lines_.
+    std::uint32_t lines_begin;
+    std::uint32_t lines_end;
+  };
+
+  // A non-hidden sequence point in sequence_point_lines_.
+  struct SequencePointLine {
+    // Start line of the sequence point.
+    std::uint32_t start_line;
+
+    // The smallest position (that is, the first in IL order) of the
+    // non-hidden sequence points of the method that start on or after
+    // start_line.
+    std::uint32_t sequence_point_index;
+  };
+
+  // Builds the index for methods. The index refers to methods by position,
+  // so it has to be rebuilt if methods changes.
+  void Build(const std::vector<MethodInfo> &methods);
+
+  // Finds where a breakpoint at line should be set in methods, which must
+  // be the vector the index was built for. Sets method_index to the
+  // position of the method in methods and sequence_point_index to the
+  // position of the sequence point in the method. Returns false if no
+  // method has a sequence point for line.
+  bool FindBreakpointLocation(std::uint32_t line,
+                              std::uint32_t *method_index,
+                              std::uint32_t *sequence_point_index) const;
+
+  // Makes the index a view of the num_method_entries method entries at
+  // method_entries and the num_lines sequence point lines at lines, as
+  // returned by an index built for num_methods methods. Nothing is copied,
+  // so they must stay valid and unchanged as long as the index is used.
+  // FindBreakpointLocation checks every entry and line it reads, so the
+  // view of a corrupted table fails lookups instead of reading out of
+  // bounds.
+  void SetView(const MethodEntry *method_entries,
+               std::uint32_t num_method_entries,
+               const SequencePointLine *lines, std::uint32_t num_lines,
+               std::uint32_t num_methods);
+
+  // Returns the method entries of the index, sorted by first line.
+  const MethodEntry *GetMethodEntries() const {
+    return is_view_ ? method_entries_view_ : methods_by_line_.data();
+  }
+
+  // Returns the number of method entries of the index.
+  std::uint32_t GetMethodEntryCount() const {
+    return is_view_ ? num_method_entries_
+                    : static_cast<std::uint32_t>(methods_by_line_.size());
+  }
+
+  // Returns the sequence point lines of the index.
+  const SequencePointLine *GetSequencePointLines() const {
+    return is_view_ ? lines_view_ : sequence_point_lines_.data();
+  }
+
+  // Returns the number of sequence point lines of the index.
+  std::uint32_t GetSequencePointLineCount() const {
+    return is_view_ ? num_lines_
+                    : static_cast<std::uint32_t>(sequence_point_lines_.size());
+  }
+
+  // Returns the number of bytes allocated for the index. The entries and
+  // lines of a view are not counted.
+  std::size_t GetMemoryUsage() const {
+    return methods_by_line_.capacity() * sizeof(MethodEntry) +
+           sequence_point_lines_.capacity() * sizeof(SequencePointLine);
+  }
+
+ private:
+  // Value of MethodEntry::parent for methods that are not enclosed in
+  // another method.
+  static const std::uint32_t kNoParent = UINT32_MAX;
+
+  // The methods sorted by first line. Methods with the same first line are
+  // sorted by decreasing last line, so enclosing methods come first.
+  std::vector<MethodEntry> methods_by_line_;
+
+  // The non-hidden sequence points of each method sorted by start line.
+  std::vector<SequencePointLine> sequence_point_lines_;
+
+  // True if the index is a view set by SetView, in which case the fields
+  // below are used instead of methods_by_line_ and sequence_point_lines_.
+  bool is_view_ = false;
+
+  // The method entries and sequence point lines of a view.
+  const MethodEntry *method_entries_view_ = nullptr;
+  std::uint32_t num_method_entries_ = 0;
+  const SequencePointLine *lines_view_ = nullptr;
+  std::uint32_t num_lines_ = 0;
+
+  // Number of methods the index was built for. Only set for views, since
+  // the method indices of a built index are valid by construction.
+  std::uint32_t num_methods_ = 0;
+};
+
+}  // namespace google_cloud_debugger_portable_pdb
+
+#endif  // DOCUMENT_LINE_INDEX_H_
@@ -0,0 +1,168 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "document_path_index.h"
+
+#include <algorithm>
+
+using google_cloud_debugger_portable_pdb::IDocumentIndex;
+using google_cloud_debugger_portable_pdb::IPortablePdbFile;
+using std::lock_guard;
+using std::mutex;
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace google_cloud_debugger {
+
+void DocumentPathIndex::AddPdbFile(const shared_ptr<IPortablePdbFile> &pdb_file) {
+  if (!pdb_file) {
+    return;
+  }
+
+  lock_guard<mutex> lock(mutex_);
+  // The module may be unloaded while its PDB file is being parsed. Since
+  // RemovePdbFile also takes mutex_, the file is either added before it
+  // is removed or not added at all.
+  if (pdb_file->IsUnloaded() ||
+      pdb_files_.find(pdb_file.get()) != pdb_files_.end()) {
+    return;
+  }
+
+  vector<uint32_t> &pdb_documents = pdb_files_[pdb_file.get()];
+  const vector<unique_ptr<IDocumentIndex>> &document_indices =
+      pdb_file->GetDocumentIndexTable();
+  pdb_documents.reserve(document_indices.size());
+  for (uint32_t i = 0; i < document_indices.size(); ++i) {
+    uint32_t document;
+    if (free_documents_.empty()) {
+      document = documents_.size();
+      documents_.push_back({pdb_file, i});
+    } else {
+      document = free_documents_.back();
+      free_documents_.pop_back();
+      documents_[document] = {pdb_file, i};
+    }
+    pdb_documents.push_back(document);
+
+    Node *node = &root_;
+    for (const string *segment : document_indices[i]->GetFilePathSegments()) {
+      unique_ptr<Node> &child = node->children[*segment];
+      if (!child) {
+        child.reset(new Node());
+      }
+      node = child.get();
+      node->documents.push_back(document);
+    }
+  }
+}
+
+void DocumentPathIndex::RemovePdbFile(const IPortablePdbFile *pdb_file) {
+  lock_guard<mutex> lock(mutex_);
+  auto pdb_documents = pdb_files_.find(pdb_file);
+  if (pdb_documents == pdb_files_.end()) {
+    return;
+  }
+
+  for (uint32_t document : pdb_documents->second) {
+    DocumentPathMatch &match = documents_[document];
+    const vector<const string *> &segments =
+        match.pdb_file->GetDocumentIndexTable()[match.document_index]
+            ->GetFilePathSegments();
+
+    // nodes[i] is the node of the suffix made of the first i segments.
+    vector<Node *> nodes(1, &root_);
+    for (const string *segment : segments) {
+      auto child = nodes.back()->children.find(*segment);
+      if (child == nodes.back()->children.end()) {
+        break;
+      }
+
+      Node *node = child->second.get();
+      node->documents.erase(std::remove(node->documents.begin(),
+                                        node->documents.end(), document),
+                            node->documents.end());
+      nodes.push_back(node);
+    }
+
+    // A node that lists no document has no descendant that does either.
+    for (size_t i = nodes.size() - 1; i > 0; --i) {
+      if (!nodes[i]->documents.empty()) {
+        break;
+      }
+      nodes[i - 1]->children.erase(*segments[i - 1]);
+    }
+
+    match = DocumentPathMatch();
+    free_documents_.push_back(document);
+  }
+
+  pdb_files_.erase(pdb_documents);
+}
+
+bool DocumentPathIndex::HasPdbFile(const IPortablePdbFile *pdb_file) const {
+  lock_guard<mutex> lock(mutex_);
+  return pdb_files_.find(pdb_file) != pdb_files_.end();
+}
+
+vector<DocumentPathMatch> DocumentPathIndex::FindDocuments(
+    const vector<string> &path_segments) const {
+  lock_guard<mutex> lock(mutex_);
+  const Node *node = &root_;
+  for (const string &segment : path_segments) {
+    auto child = node->children.find(segment);
+    if (child == node->children.end()) {
+      break;
+    }
+    node = child->second.get();
+  }
+
+  vector<DocumentPathMatch> result;
+  result.reserve(node->documents.size());
+  for (uint32_t document : node->documents) {
+    result.push_back(documents_[document]);
+  }
+  return result;
+}
+
+size_t DocumentPathIndex::GetDocumentCount() const {
+  lock_guard<mutex> lock(mutex_);
+  return documents_.size() - free_documents_.size();
+}
+
+size_t DocumentPathIndex::GetMemoryUsage() const {
+  lock_guard<mutex> lock(mutex_);
+  size_t usage = sizeof(*this) - sizeof(root_) + GetMemoryUsage(root_) +
+                 documents_.capacity() * sizeof(DocumentPathMatch) +
+                 free_documents_.capacity() * sizeof(uint32_t) +
+                 pdb_files_.bucket_count() * sizeof(void *);
+  for (const auto &pdb_documents : pdb_files_) {
+    usage += sizeof(pdb_documents) +
+             pdb_documents.second.capacity() * sizeof(uint32_t);
+  }
+  return usage;
+}
+
+size_t DocumentPathIndex::GetMemoryUsage(const Node &node) {
+  size_t usage = sizeof(Node) + node.documents.capacity() * sizeof(uint32_t) +
+                 node.children.bucket_count() * sizeof(void *);
+  for (const auto &child : node.children) {
+    usage += sizeof(child) + child.first.capacity() +
+             GetMemoryUsage(*child.second);
+  }
+  return usage;
+}
+
+}  // namespace google_cloud_debugger
@@ -0,0 +1,127 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DOCUMENT_PATH_INDEX_H_
+#define DOCUMENT_PATH_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "document_index.h"
+#include "i_portable_pdb_file.h"
+
+namespace google_cloud_debugger {
+
+using google_cloud_debugger_portable_pdb::SplitNormalizedFilePath;
+
+// A document of a Portable PDB file.
+struct DocumentPathMatch {
+  // The PDB file containing the document.
+  std::shared_ptr<google_cloud_debugger_portable_pdb::IPortablePdbFile>
+      pdb_file;
+
+  // Position of the document in the document index table of pdb_file.
+  std::uint32_t document_index;
+};
+
+// Index of the source file paths of the documents of all the PDB files
+// loaded in the debuggee, used to find the documents a breakpoint's file
+// path refers to.
+//
+// A breakpoint's path and a document's path match if they end with the
+// same segments, and the document with the longest common suffix is the
+// best match. The index is a trie over the normalized path segments taken
+// from the file name up, so finding the best matches only walks the
+// segments of the breakpoint's path, no matter how many documents there
+// are. Each node of the trie lists the documents whose path ends with the
+// node's suffix.
+//
+// PDB files are added when they are parsed and removed when their module
+// is unloaded. All methods are thread-safe.
+class DocumentPathIndex {
+ public:
+  // Adds the documents of pdb_file, which has to be parsed already.
+  // Does nothing if pdb_file has already been added or if its module has
+  // been unloaded.
+  void AddPdbFile(
+      const std::shared_ptr<
+          google_cloud_debugger_portable_pdb::IPortablePdbFile> &pdb_file);
+
+  // Removes the documents of pdb_file. Trie nodes that no other document
+  // goes through are freed. Does nothing if pdb_file has not been added.
+  void RemovePdbFile(
+      const google_cloud_debugger_portable_pdb::IPortablePdbFile *pdb_file);
+
+  // Returns true if pdb_file has been added.
+  bool HasPdbFile(
+      const google_cloud_debugger_portable_pdb::IPortablePdbFile *pdb_file)
+      const;
+
+  // Returns the documents whose paths share the longest suffix with the
+  // path whose segments are path_segments (see SplitNormalizedFilePath),
+  // in the order they were added. Returns nothing if no document has the
+  // same file name.
+  std::vector<DocumentPathMatch> FindDocuments(
+      const std::vector<std::string> &path_segments) const;
+
+  // Returns the number of documents in the index.
+  std::size_t GetDocumentCount() const;
+
+  // Returns an estimate of the memory used by the index, in bytes.
+  std::size_t GetMemoryUsage() const;
+
+ private:
+  // Node of the trie. The path from the root to a node spells a path
+  // suffix, file name first.
+  struct Node {
+    // Children of this node, keyed by the next (parent directory) segment.
+    std::unordered_map<std::string, std::unique_ptr<Node>> children;
+
+    // Positions in documents_ of the documents whose path ends with
+    // the suffix of this node.
+    std::vector<std::uint32_t> documents;
+  };
+
+  // Returns an estimate of the memory used by node and its descendants.
+  static std::size_t GetMemoryUsage(const Node &node);
+
+  // Root of the trie, which stands for the empty suffix.
+  Node root_;
+
+  // All the documents that were added. The entries of removed documents
+  // are empty until a later document takes their place.
+  std::vector<DocumentPathMatch> documents_;
+
+  // Positions in documents_ of the entries of removed documents.
+  std::vector<std::uint32_t> free_documents_;
+
+  // The PDB files that were added and the positions of their documents
+  // in documents_.
+  std::unordered_map<const google_cloud_debugger_portable_pdb::IPortablePdbFile
+                         *,
+                     std::vector<std::uint32_t>>
+      pdb_files_;
+
+  // Mutex protecting the trie, documents_, free_documents_ and pdb_files_.
+  mutable std::mutex mutex_;
+};
+
+}  // namespace google_cloud_debugger
+
+#endif  // DOCUMENT_PATH_INDEX_H_
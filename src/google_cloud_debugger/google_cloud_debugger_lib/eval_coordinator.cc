@@ -14,10 +14,12 @@
 
 #include "eval_coordinator.h"
 
+#include <algorithm>
 #include <chrono>
-#include <future>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <string>
 #include <thread>
 
 #include "breakpoint.pb.h"
@@ -27,6 +29,7 @@
 #include "dbg_class.h"
 #include "dbg_object_factory.h"
 #include "stack_frame_collection.h"
+#include "string_stream_wrapper.h"
 
 using google::cloud::diagnostics::debug::Breakpoint;
 using std::cerr;
@@ -34,16 +37,36 @@ using std::lock_guard;
 using std::mutex;
 using std::unique_lock;
 using std::unique_ptr;
-using std::chrono::high_resolution_clock;
-using std::chrono::minutes;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
 
 namespace google_cloud_debugger {
 
-minutes EvalCoordinator::one_minute = minutes(1);
+namespace {
+
+// How long an aborted evaluation gets to wind down before it is aborted
+// more rudely, or given up on.
+const milliseconds kEvalAbortTimeout = milliseconds(1000);
+
+}  // namespace
+
+const milliseconds EvalCoordinator::kDefaultEvalTimeout = milliseconds(1000);
+
+const milliseconds EvalCoordinator::kDefaultSnapshotEvalTimeout =
+    milliseconds(5000);
+
+const milliseconds EvalCoordinator::kDefaultPauseTimeout = milliseconds(10000);
 
 HRESULT EvalCoordinator::CreateEval(ICorDebugEval **eval) {
   lock_guard<mutex> lk(mutex_);
 
+  // The debugger callback thread cannot wait for an evaluation, so the
+  // hit has to be processed again by the snapshot worker.
+  if (processing_inline_) {
+    eval_needed_inline_ = TRUE;
+    return E_ABORT;
+  }
+
   if (active_debug_thread_ == nullptr) {
     std::cerr << "Active debug thread is missing";
     return E_FAIL;
@@ -81,16 +104,40 @@ HRESULT EvalCoordinator::WaitForEval(BOOL *exception_thrown,
   debuggercallback_can_continue_ = TRUE;
   eval_exception_occurred_ = FALSE;
   HRESULT hr = CORDBG_E_FUNC_EVAL_NOT_COMPLETE;
-  auto start = high_resolution_clock::now();
+
+  // The evaluation has to finish within eval_timeout_ and before the
+  // snapshot runs out of time. Past the deadline, it is aborted, then
+  // rudely aborted, each time with kEvalAbortTimeout to finish.
+  steady_clock::time_point deadline = steady_clock::now() + eval_timeout_;
+  if (snapshot_eval_deadline_ < deadline) {
+    deadline = snapshot_eval_deadline_;
+  }
+  int aborts = 0;
 
   // Wait until evaluation is done.
   while (hr == CORDBG_E_FUNC_EVAL_NOT_COMPLETE ||
          hr == CORDBG_E_PROCESS_NOT_SYNCHRONIZED) {
-    auto current = high_resolution_clock::now();
-    if (current - start > one_minute) {
-      hr = CORDBG_E_FUNC_EVAL_NOT_COMPLETE;
-      cerr << "Timed out while trying to evaluate function.";
-      break;
+    if (steady_clock::now() >= deadline) {
+      if (aborts == 2) {
+        hr = CORDBG_E_FUNC_EVAL_NOT_COMPLETE;
+        cerr << "Timed out while trying to abort function evaluation.";
+        // Whatever the snapshot evaluates next would time out as well.
+        snapshot_eval_deadline_ = steady_clock::now();
+        // The evaluation may still finish later, when nothing waits for
+        // it any more.
+        CComPtr<ICorDebugEval> abandoned_eval;
+        abandoned_eval = eval;
+        abandoned_evals_.push_back(abandoned_eval);
+        break;
+      }
+
+      cerr << "Function evaluation timed out, aborting it.";
+      CComPtr<ICorDebugThread> debug_thread(active_debug_thread_);
+      lk.unlock();
+      AbortEval(debug_thread, eval, aborts == 1);
+      lk.lock();
+      ++aborts;
+      deadline = steady_clock::now() + kEvalAbortTimeout;
     }
 
     hr = eval->GetResult(eval_result);
@@ -99,12 +146,17 @@ HRESULT EvalCoordinator::WaitForEval(BOOL *exception_thrown,
         hr == CORDBG_E_PROCESS_NOT_SYNCHRONIZED) {
       // Wake up the debugger thread to do the evaluation.
       debugger_callback_cv_.notify_one();
-      variable_threads_cv_.wait_for(lk, one_minute);
+      variable_threads_cv_.wait_until(lk, deadline);
     } else {
       break;
     }
   }
 
+  // An aborted evaluation has no result.
+  if (hr == CORDBG_S_FUNC_EVAL_ABORTED) {
+    hr = CORDBG_E_FUNC_EVAL_NOT_COMPLETE;
+  }
+
   // We got our lock back!
   // Tells the debugger to chill out until our next eval call or we reach the
   // end.
@@ -115,9 +167,64 @@ HRESULT EvalCoordinator::WaitForEval(BOOL *exception_thrown,
   return hr;
 }
 
-void EvalCoordinator::SignalFinishedEval(ICorDebugThread *debug_thread) {
+HRESULT EvalCoordinator::AbortEval(ICorDebugThread *debug_thread,
+                                   ICorDebugEval *eval, bool rude) {
+  CComPtr<ICorDebugAppDomain> app_domain;
+  HRESULT hr = E_FAIL;
+  if (debug_thread) {
+    hr = debug_thread->GetAppDomain(&app_domain);
+  }
+
+  if (SUCCEEDED(hr)) {
+    hr = app_domain->Stop(0);
+    if (FAILED(hr)) {
+      cerr << "Failed to stop the debuggee to abort function evaluation.";
+      app_domain.Release();
+    }
+  }
+
+  HRESULT abort_hr;
+  if (rude) {
+    CComPtr<ICorDebugEval2> eval2;
+    abort_hr = eval->QueryInterface(__uuidof(ICorDebugEval2),
+                                    reinterpret_cast<void **>(&eval2));
+    if (SUCCEEDED(abort_hr)) {
+      abort_hr = eval2->RudeAbort();
+    }
+  } else {
+    abort_hr = eval->Abort();
+  }
+
+  if (FAILED(abort_hr)) {
+    cerr << "Failed to abort function evaluation with HRESULT: " << std::hex
+         << abort_hr;
+  }
+
+  if (app_domain) {
+    hr = app_domain->Continue(FALSE);
+    if (FAILED(hr)) {
+      cerr << "Failed to continue the debuggee after aborting function "
+              "evaluation.";
+    }
+  }
+
+  return abort_hr;
+}
+
+void EvalCoordinator::SignalFinishedEval(ICorDebugThread *debug_thread,
+                                         ICorDebugEval *eval) {
   unique_lock<mutex> lk(mutex_);
 
+  // No StackFrame would ever let the debugger callback continue after an
+  // evaluation that WaitForEval gave up on, and the StackFrame that is
+  // evaluating now, if any, waits for another evaluation.
+  auto abandoned_eval = std::find(abandoned_evals_.begin(),
+                                  abandoned_evals_.end(), eval);
+  if (abandoned_eval != abandoned_evals_.end()) {
+    abandoned_evals_.erase(abandoned_eval);
+    return;
+  }
+
   debuggercallback_can_continue_ = FALSE;
   active_debug_thread_ = debug_thread;
   // Wake up all variable threads and so one of them can
@@ -135,7 +242,7 @@ void EvalCoordinator::SignalFinishedEval(ICorDebugThread *debug_thread) {
 
 HRESULT EvalCoordinator::ProcessBreakpoints(
     ICorDebugThread *debug_thread, IBreakpointCollection *breakpoint_collection,
-    std::vector<std::shared_ptr<DbgBreakpoint>> breakpoints,
+    const std::vector<std::shared_ptr<DbgBreakpoint>> &breakpoints,
     const std::vector<
         std::shared_ptr<google_cloud_debugger_portable_pdb::IPortablePdbFile>>
         &pdb_files) {
@@ -145,13 +252,30 @@ HRESULT EvalCoordinator::ProcessBreakpoints(
   }
 
   active_debug_thread_ = debug_thread;
+  steady_clock::time_point hit_time = steady_clock::now();
+
+  // Without function evaluations, the hit is processed right here instead
+  // of being handed to the snapshot worker.
+  if (!MayNeedEval(breakpoints)) {
+    HRESULT hr = ProcessBreakpointsInline(hit_time, breakpoint_collection,
+                                          breakpoints, pdb_files);
+    if (hr != S_FALSE) {
+      return hr;
+    }
+  }
 
   unique_lock<mutex> lk(mutex_);
 
-  std::future<HRESULT> print_breakpoint_task = std::async(
-      std::launch::async, &EvalCoordinator::ProcessBreakpointsTask, this,
-      breakpoint_collection, std::move(breakpoints), pdb_files);
-  print_breakpoint_tasks_.push_back(std::move(print_breakpoint_task));
+  // The task may outlive this call, so it gets its own copy of the
+  // breakpoints. Only hits that may evaluate functions get here.
+  HRESULT hr = snapshot_worker_.Enqueue(
+      std::bind(&EvalCoordinator::ProcessBreakpointsTask, this, hit_time,
+                breakpoint_collection, breakpoints, pdb_files));
+  if (FAILED(hr)) {
+    // No task would ever let the debugger callback continue.
+    cerr << "Failed to queue breakpoint hit: " << std::hex << hr;
+    return hr;
+  }
 
   ready_to_print_variables_ = TRUE;
   debuggercallback_can_continue_ = FALSE;
@@ -231,52 +355,157 @@ BOOL EvalCoordinator::WaitingForEval() {
   return waiting_for_eval_;
 }
 
+void EvalCoordinator::SetEvalTimeouts(milliseconds eval_timeout,
+                                      milliseconds snapshot_eval_timeout) {
+  lock_guard<mutex> lk(mutex_);
+  eval_timeout_ = eval_timeout;
+  snapshot_eval_timeout_ = snapshot_eval_timeout;
+}
+
+BOOL EvalCoordinator::EvalTimeExhausted() {
+  lock_guard<mutex> lk(mutex_);
+  return steady_clock::now() >= snapshot_eval_deadline_;
+}
+
+void EvalCoordinator::SetPauseTimeout(milliseconds pause_timeout) {
+  lock_guard<mutex> lk(mutex_);
+  pause_timeout_ = pause_timeout;
+}
+
+BOOL EvalCoordinator::PauseTimeExhausted() {
+  lock_guard<mutex> lk(mutex_);
+  if (!pause_time_exhausted_ && steady_clock::now() >= pause_deadline_) {
+    pause_time_exhausted_ = TRUE;
+  }
+  return pause_time_exhausted_;
+}
+
 HRESULT EvalCoordinator::ProcessBreakpointsTask(
+    steady_clock::time_point hit_time,
     IBreakpointCollection *breakpoint_collection,
     std::vector<std::shared_ptr<DbgBreakpoint>> breakpoints,
     const std::vector<
         std::shared_ptr<google_cloud_debugger_portable_pdb::IPortablePdbFile>>
         &pdb_files) {
-  // Vector of PDB files that are parsed successfully.
-  std::vector<
-      std::shared_ptr<google_cloud_debugger_portable_pdb::IPortablePdbFile>>
-      parsed_pdb_files;
-  for (auto &&pdb_file : pdb_files) {
-    if (!pdb_file) {
-      continue;
+  std::vector<Breakpoint> captured_breakpoints;
+  HRESULT hr = CaptureBreakpoints(hit_time, breakpoints, pdb_files,
+                                  &captured_breakpoints);
+  SignalFinishedPrintingVariable();
+
+  // The debuggee runs again from here on.
+  HRESULT write_hr =
+      WriteBreakpoints(breakpoint_collection, captured_breakpoints);
+  return FAILED(write_hr) ? write_hr : hr;
+}
+
+HRESULT EvalCoordinator::ProcessBreakpointsInline(
+    steady_clock::time_point hit_time,
+    IBreakpointCollection *breakpoint_collection,
+    const std::vector<std::shared_ptr<DbgBreakpoint>> &breakpoints,
+    const std::vector<
+        std::shared_ptr<google_cloud_debugger_portable_pdb::IPortablePdbFile>>
+        &pdb_files) {
+  {
+    lock_guard<mutex> lk(mutex_);
+    processing_inline_ = TRUE;
+    eval_needed_inline_ = FALSE;
+    ready_to_print_variables_ = TRUE;
+  }
+
+  std::vector<Breakpoint> captured_breakpoints;
+  HRESULT hr = CaptureBreakpoints(hit_time, breakpoints, pdb_files,
+                                  &captured_breakpoints);
+
+  BOOL eval_needed;
+  {
+    lock_guard<mutex> lk(mutex_);
+    DbgClass::ClearStaticCache();
+    processing_inline_ = FALSE;
+    eval_needed = eval_needed_inline_;
+  }
+
+  if (eval_needed) {
+    // What failed for the lack of an evaluation is captured again by the
+    // snapshot worker, so none of the errors of this attempt are kept.
+    for (auto &&breakpoint : breakpoints) {
+      breakpoint->ResetErrorStream();
     }
+    return S_FALSE;
+  }
 
-    if (pdb_file->ParsePdbFile()) {
-      parsed_pdb_files.push_back(pdb_file);
+  if (!captured_breakpoints.empty()) {
+    HRESULT write_hr = WriteBreakpointsAsync(breakpoint_collection,
+                                             std::move(captured_breakpoints));
+    if (FAILED(write_hr)) {
+      return write_hr;
     }
   }
 
+  // S_FALSE from a breakpoint whose condition is not met must not be
+  // mistaken for the need of an evaluation.
+  return FAILED(hr) ? hr : S_OK;
+}
+
+HRESULT EvalCoordinator::CaptureBreakpoints(
+    steady_clock::time_point hit_time,
+    const std::vector<std::shared_ptr<DbgBreakpoint>> &breakpoints,
+    const std::vector<
+        std::shared_ptr<google_cloud_debugger_portable_pdb::IPortablePdbFile>>
+        &pdb_files,
+    std::vector<Breakpoint> *captured_breakpoints) {
   // Creates and initializes stack frame collection based on the
   // ICorDebugStackWalk object.
   unique_ptr<IStackFrameCollection> stack_frames(
       new (std::nothrow) StackFrameCollection(
           std::shared_ptr<ICorDebugHelper>(new CorDebugHelper()),
-          std::shared_ptr<IDbgObjectFactory>(new DbgObjectFactory())));
+          std::shared_ptr<IDbgObjectFactory>(new DbgObjectFactory()),
+          frame_symbol_cache_, method_token_tables_));
   if (!stack_frames) {
     cerr << "Failed to create DbgStack.";
     return E_OUTOFMEMORY;
   }
 
+  milliseconds pause_timeout;
+  {
+    lock_guard<mutex> lk(mutex_);
+    pause_timeout = pause_timeout_;
+    pause_deadline_ = hit_time + pause_timeout_;
+    pause_time_exhausted_ = FALSE;
+    // Function evaluations must not outlast the pause either.
+    snapshot_eval_deadline_ =
+        std::min(steady_clock::now() + snapshot_eval_timeout_, pause_deadline_);
+  }
+
+  // Vector of PDB files that are parsed successfully. The hit never waits
+  // for the module indexer: the PDB of the breakpoint was parsed to set it,
+  // and frames in modules whose PDB is still being parsed are reported
+  // without their local variables.
+  std::vector<
+      std::shared_ptr<google_cloud_debugger_portable_pdb::IPortablePdbFile>>
+      parsed_pdb_files;
+  for (auto &&pdb_file : pdb_files) {
+    if (pdb_file && pdb_file->IsParsed()) {
+      parsed_pdb_files.push_back(pdb_file);
+    }
+  }
+
   HRESULT hr = S_OK;
   for (auto &&breakpoint : breakpoints) {
+    // A condition cannot be told to hold without evaluating it, so the
+    // hit is not reported for breakpoints that are left with no time.
+    if (!breakpoint->GetCondition().empty() && PauseTimeExhausted()) {
+      cerr << "No pause time left to evaluate the condition of breakpoint \""
+           << breakpoint->GetId() << "\".";
+      continue;
+    }
+
     hr = stack_frames->ProcessBreakpoint(parsed_pdb_files, breakpoint.get(),
                                          this);
     if (FAILED(hr)) {
       std::cerr << "Failed to process breakpoint \"" << breakpoint->GetId()
                 << "\" with HRESULT: " << std::hex << hr;
-      Breakpoint error_breakpoint;
-      breakpoint->PopulateBreakpoint(&error_breakpoint);
-
-      hr = breakpoint_collection->WriteBreakpoint(error_breakpoint);
-      if (FAILED(hr)) {
-        cerr << "Failed to write error breakpoint: " << std::hex << hr;
-        break;
-      }
+      captured_breakpoints->emplace_back();
+      breakpoint->PopulateBreakpoint(&captured_breakpoints->back());
       continue;
     }
 
@@ -287,7 +516,8 @@ HRESULT EvalCoordinator::ProcessBreakpointsTask(
       continue;
     }
 
-    Breakpoint proto_breakpoint;
+    captured_breakpoints->emplace_back();
+    Breakpoint &proto_breakpoint = captured_breakpoints->back();
     hr = breakpoint->PopulateBreakpoint(&proto_breakpoint, stack_frames.get(),
                                         this);
     if (FAILED(hr)) {
@@ -295,16 +525,77 @@ HRESULT EvalCoordinator::ProcessBreakpointsTask(
       cerr << "Failed to print out variables: " << std::hex << hr;
     }
 
-    hr = breakpoint_collection->WriteBreakpoint(proto_breakpoint);
+    // Only a snapshot that capture had to cut short is reported as
+    // truncated, not one that merely finished late.
+    BOOL truncated;
+    {
+      lock_guard<mutex> lk(mutex_);
+      truncated = pause_time_exhausted_;
+    }
+    if (truncated && !proto_breakpoint.has_status()) {
+      SetInfoStatusMessage(&proto_breakpoint,
+                           "Snapshot truncated: the breakpoint hit used up "
+                           "its pause time of " +
+                               std::to_string(pause_timeout.count()) + " ms.");
+    }
+  }
+
+  stack_frames.reset();
+  {
+    lock_guard<mutex> lk(mutex_);
+    snapshot_eval_deadline_ = steady_clock::time_point::max();
+    pause_deadline_ = steady_clock::time_point::max();
+    pause_time_exhausted_ = FALSE;
+  }
+  return hr;
+}
+
+HRESULT EvalCoordinator::WriteBreakpoints(
+    IBreakpointCollection *breakpoint_collection,
+    const std::vector<Breakpoint> &captured_breakpoints) {
+  for (auto &&proto_breakpoint : captured_breakpoints) {
+    HRESULT hr = breakpoint_collection->WriteBreakpoint(proto_breakpoint);
     if (FAILED(hr)) {
       cerr << "Failed to write breakpoint: " << std::hex << hr;
-      break;
+      return hr;
     }
   }
 
-  stack_frames.reset();
-  SignalFinishedPrintingVariable();
+  return S_OK;
+}
+
+HRESULT EvalCoordinator::WriteBreakpointsAsync(
+    IBreakpointCollection *breakpoint_collection,
+    std::vector<Breakpoint> breakpoints) {
+  std::shared_ptr<std::vector<Breakpoint>> pending_breakpoints =
+      std::make_shared<std::vector<Breakpoint>>(std::move(breakpoints));
+  HRESULT hr =
+      write_worker_.Enqueue([breakpoint_collection, pending_breakpoints]() {
+        return WriteBreakpoints(breakpoint_collection, *pending_breakpoints);
+      });
+  if (FAILED(hr)) {
+    // The pipe cannot keep up. The breakpoints are still reported, at the
+    // cost of keeping the caller waiting while they are written.
+    hr = WriteBreakpoints(breakpoint_collection, *pending_breakpoints);
+  }
   return hr;
 }
 
+bool EvalCoordinator::MayNeedEval(
+    const std::vector<std::shared_ptr<DbgBreakpoint>> &breakpoints) {
+  if (property_evaluation_) {
+    return true;
+  }
+
+  if (!condition_evaluation_) {
+    return false;
+  }
+
+  return std::any_of(breakpoints.begin(), breakpoints.end(),
+                     [](const std::shared_ptr<DbgBreakpoint> &breakpoint) {
+                       return !breakpoint->GetCondition().empty() ||
+                              !breakpoint->GetExpressions().empty();
+                     });
+}
+
 }  //  namespace google_cloud_debugger
@@ -16,9 +16,14 @@
 #define EVAL_COORDINATOR_H_
 
 #include <chrono>
-#include <future>
+#include <memory>
+#include <vector>
 
+#include "breakpoint.pb.h"
+#include "frame_symbol_cache.h"
 #include "i_eval_coordinator.h"
+#include "method_token_table.h"
+#include "snapshot_worker.h"
 
 namespace google_cloud_debugger {
 
@@ -46,6 +51,11 @@ class IStackFrameCollection;
 // inspection on a different thread than the thread that the DebuggerCallback
 // is on. Otherwise, the DebuggerCallback thread will be blocked and
 // cannot perform evaluation.
+//
+// Hits that need no evaluation skip that hand-off: when neither property
+// nor method evaluation can be involved, the breakpoints are processed
+// directly on the DebuggerCallback thread. If an evaluation is asked for
+// anyway, the hit is processed again through the hand-off.
 class EvalCoordinator : public IEvalCoordinator {
  public:
   // This method is used to create an ICorDebugEval object
@@ -60,9 +70,11 @@ class EvalCoordinator : public IEvalCoordinator {
   HRESULT WaitForEval(BOOL *exception_thrown, ICorDebugEval *eval,
                       ICorDebugValue **eval_result) override;
 
-  // DebuggerCallback calls this function to signal that an evaluation is
-  // finished.
-  void SignalFinishedEval(ICorDebugThread *debug_thread) override;
+  // DebuggerCallback calls this function to signal that evaluation eval
+  // is finished. Returns right away if WaitForEval gave up on eval, since
+  // nothing waits for its result any more.
+  void SignalFinishedEval(ICorDebugThread *debug_thread,
+                          ICorDebugEval *eval) override;
 
   // DebuggerCallback calls this function to signal that an exception has
   // occurred.
@@ -75,7 +87,7 @@ class EvalCoordinator : public IEvalCoordinator {
   HRESULT ProcessBreakpoints(
       ICorDebugThread *debug_thread,
       IBreakpointCollection *breakpoint_collection,
-      std::vector<std::shared_ptr<DbgBreakpoint>> breakpoints,
+      const std::vector<std::shared_ptr<DbgBreakpoint>> &breakpoints,
       const std::vector<
           std::shared_ptr<google_cloud_debugger_portable_pdb::IPortablePdbFile>>
           &pdb_files) override;
@@ -114,18 +126,121 @@ class EvalCoordinator : public IEvalCoordinator {
   // Returns whether method call should be performed when evaluating condition.
   BOOL MethodEvaluation() override { return condition_evaluation_; }
 
+  // Sets the cache of the method tables of the loaded modules, which the
+  // stack frames use to find the methods that expressions call.
+  void SetMethodTokenTables(
+      std::shared_ptr<MethodTokenTableCache> method_token_tables) {
+    method_token_tables_ = std::move(method_token_tables);
+  }
+
+  // Sets the cache of the symbols and locations of the stack frames seen
+  // in breakpoint hits.
+  void SetFrameSymbolCache(
+      std::shared_ptr<FrameSymbolCache> frame_symbol_cache) {
+    frame_symbol_cache_ = std::move(frame_symbol_cache);
+  }
+
+  // Queues breakpoints on the write worker. If the queue is full, they
+  // are written right away instead.
+  HRESULT WriteBreakpointsAsync(
+      IBreakpointCollection *breakpoint_collection,
+      std::vector<google::cloud::diagnostics::debug::Breakpoint> breakpoints)
+      override;
+
+  // Sets how long a single function evaluation may run before it is
+  // aborted, and how long after a breakpoint hit its snapshot may keep
+  // starting function evaluations.
+  void SetEvalTimeouts(
+      std::chrono::milliseconds eval_timeout,
+      std::chrono::milliseconds snapshot_eval_timeout) override;
+
+  // Returns true if the snapshot being captured has no evaluation time
+  // left.
+  BOOL EvalTimeExhausted() override;
+
+  // Sets how long a breakpoint hit may keep its thread stopped. Function
+  // evaluations are cut off at the same deadline, but an evaluation that
+  // has to be aborted may overrun it by up to two abort timeouts.
+  void SetPauseTimeout(std::chrono::milliseconds pause_timeout) override;
+
+  // Returns true if the breakpoint hit being processed has used up its
+  // pause time. The snapshot is then reported as truncated.
+  BOOL PauseTimeExhausted() override;
+
+  // Default time a single function evaluation may run.
+  static const std::chrono::milliseconds kDefaultEvalTimeout;
+
+  // Default time after a breakpoint hit during which its snapshot may
+  // start function evaluations.
+  static const std::chrono::milliseconds kDefaultSnapshotEvalTimeout;
+
+  // Default time a breakpoint hit may keep its thread stopped.
+  static const std::chrono::milliseconds kDefaultPauseTimeout;
+
  private:
-  // Helper function to process a vector of multiple breakpoints at the same location
-  // using the stack frame collection. The stack frame collection
-  // will first be used to evaluate the breakpoint condition. If this succeeds,
-  // the function will proceed to get stack frame information at the breakpoint.
+  // Asks the debuggee to abort eval, running on debug_thread, with
+  // RudeAbort if rude is true. The debuggee has to be stopped to take the
+  // request, so this stops it and lets it continue again to run the abort.
+  HRESULT AbortEval(ICorDebugThread *debug_thread, ICorDebugEval *eval,
+                    bool rude);
+
+  // Task run by the snapshot worker for a breakpoint hit. Captures the
+  // snapshots of breakpoints, lets the debugger callback continue and then
+  // writes the snapshots to breakpoint_collection, so that the debuggee
+  // does not wait for them to be serialized and sent.
+  // hit_time is when the thread of the breakpoint hit stopped.
   HRESULT ProcessBreakpointsTask(
+      std::chrono::steady_clock::time_point hit_time,
       IBreakpointCollection *breakpoint_collection,
       std::vector<std::shared_ptr<DbgBreakpoint>> breakpoints,
       const std::vector<
           std::shared_ptr<google_cloud_debugger_portable_pdb::IPortablePdbFile>>
           &pdb_files);
 
+  // Captures the snapshots of breakpoints on the debugger callback thread,
+  // and queues them to be written by the snapshot worker. Returns S_FALSE
+  // if an evaluation turned out to be needed: the snapshots are then
+  // dropped and the hit has to go through ProcessBreakpointsTask.
+  HRESULT ProcessBreakpointsInline(
+      std::chrono::steady_clock::time_point hit_time,
+      IBreakpointCollection *breakpoint_collection,
+      const std::vector<std::shared_ptr<DbgBreakpoint>> &breakpoints,
+      const std::vector<
+          std::shared_ptr<google_cloud_debugger_portable_pdb::IPortablePdbFile>>
+          &pdb_files);
+
+  // Processes a vector of multiple breakpoints at the same location using
+  // a stack frame collection. The stack frame collection will first be
+  // used to evaluate the breakpoint condition. If this succeeds, the
+  // function will proceed to get stack frame information at the
+  // breakpoint. The snapshots are added to captured_breakpoints.
+  HRESULT CaptureBreakpoints(
+      std::chrono::steady_clock::time_point hit_time,
+      const std::vector<std::shared_ptr<DbgBreakpoint>> &breakpoints,
+      const std::vector<
+          std::shared_ptr<google_cloud_debugger_portable_pdb::IPortablePdbFile>>
+          &pdb_files,
+      std::vector<google::cloud::diagnostics::debug::Breakpoint>
+          *captured_breakpoints);
+
+  // Writes captured_breakpoints to breakpoint_collection.
+  static HRESULT WriteBreakpoints(
+      IBreakpointCollection *breakpoint_collection,
+      const std::vector<google::cloud::diagnostics::debug::Breakpoint>
+          &captured_breakpoints);
+
+  // Returns true if processing breakpoints may need function evaluations,
+  // which only the snapshot worker can wait for. Evaluations that are
+  // needed anyway are caught by CreateEval.
+  bool MayNeedEval(
+      const std::vector<std::shared_ptr<DbgBreakpoint>> &breakpoints);
+
+  // Maximum number of breakpoint hits waiting for the snapshot worker.
+  static const size_t kMaxQueuedSnapshots = 16;
+
+  // Maximum number of captured snapshots waiting for the write worker.
+  static const size_t kMaxQueuedWrites = 256;
+
   // If sets to true, object evaluation will be performed when evaluating property.
   BOOL property_evaluation_ = FALSE;
 
@@ -133,8 +248,14 @@ class EvalCoordinator : public IEvalCoordinator {
   // when evaluating condition.
   BOOL condition_evaluation_ = FALSE;
 
-  // The tasks that help us enumerate and print out variables.
-  std::vector<std::future<HRESULT>> print_breakpoint_tasks_;
+  // Symbols and locations of the stack frames seen in earlier breakpoint
+  // hits, shared by the stack frame collections of all hits and with the
+  // DebuggerCallback.
+  std::shared_ptr<FrameSymbolCache> frame_symbol_cache_ =
+      std::make_shared<FrameSymbolCache>();
+
+  // Method tables of the loaded modules, shared with the DebuggerCallback.
+  std::shared_ptr<MethodTokenTableCache> method_token_tables_;
 
   // The ICorDebugThread that the active StackFrame is on.
   CComPtr<ICorDebugThread> active_debug_thread_;
@@ -152,7 +273,52 @@ class EvalCoordinator : public IEvalCoordinator {
   BOOL eval_exception_occurred_ = FALSE;
   BOOL waiting_for_eval_ = FALSE;
 
-  static std::chrono::minutes one_minute;
+  // Evaluations that WaitForEval gave up on because they could not be
+  // aborted, and that have not finished since.
+  std::vector<CComPtr<ICorDebugEval>> abandoned_evals_;
+
+  // True while a breakpoint hit is processed on the debugger callback
+  // thread.
+  BOOL processing_inline_ = FALSE;
+
+  // Set if an evaluation was needed while processing_inline_ was true.
+  BOOL eval_needed_inline_ = FALSE;
+
+  // How long a single function evaluation may run.
+  std::chrono::milliseconds eval_timeout_ = kDefaultEvalTimeout;
+
+  // How long after a breakpoint hit its snapshot may start function
+  // evaluations.
+  std::chrono::milliseconds snapshot_eval_timeout_ =
+      kDefaultSnapshotEvalTimeout;
+
+  // Time after which the snapshot being captured starts no more function
+  // evaluations, and after which the one that is running is aborted.
+  std::chrono::steady_clock::time_point snapshot_eval_deadline_ =
+      std::chrono::steady_clock::time_point::max();
+
+  // How long a breakpoint hit may keep its thread stopped.
+  std::chrono::milliseconds pause_timeout_ = kDefaultPauseTimeout;
+
+  // Time after which the breakpoint hit being processed has used up its
+  // pause time.
+  std::chrono::steady_clock::time_point pause_deadline_ =
+      std::chrono::steady_clock::time_point::max();
+
+  // Set once PauseTimeExhausted has reported that the breakpoint hit being
+  // processed is out of pause time, so something was left out of its
+  // snapshot.
+  BOOL pause_time_exhausted_ = FALSE;
+
+  // Runs ProcessBreakpointsTask for each breakpoint hit. It is the last
+  // member so that its thread is stopped before the state the tasks use
+  // is destroyed.
+  SnapshotWorker snapshot_worker_{kMaxQueuedSnapshots};
+
+  // Writes the snapshots of the breakpoint hits processed on the debugger
+  // callback thread. These have a queue of their own, so a burst of them
+  // never takes the place of a hit that waits for the snapshot worker.
+  SnapshotWorker write_worker_{kMaxQueuedWrites};
 };
 
 }  //  namespace google_cloud_debugger
@@ -0,0 +1,103 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "frame_symbol_cache.h"
+
+using std::lock_guard;
+using std::mutex;
+
+namespace google_cloud_debugger {
+
+bool FrameSymbolCache::GetSymbols(ICorDebugModule *debug_module,
+                                  mdMethodDef function_token,
+                                  FrameSymbols *symbols) const {
+  lock_guard<mutex> lock(mutex_);
+  auto found = symbols_.find(SymbolsKey(debug_module, function_token));
+  if (found == symbols_.end()) {
+    return false;
+  }
+
+  *symbols = found->second;
+  return true;
+}
+
+void FrameSymbolCache::AddSymbols(ICorDebugModule *debug_module,
+                                  mdMethodDef function_token,
+                                  const FrameSymbols &symbols) {
+  lock_guard<mutex> lock(mutex_);
+  if (symbols_.size() >= kMaximumEntries) {
+    symbols_.clear();
+  }
+  AddModule(debug_module);
+  symbols_[SymbolsKey(debug_module, function_token)] = symbols;
+}
+
+bool FrameSymbolCache::GetLocation(ICorDebugModule *debug_module,
+                                   mdMethodDef function_token,
+                                   uint32_t il_offset,
+                                   FrameLocation *location) const {
+  lock_guard<mutex> lock(mutex_);
+  auto found =
+      locations_.find(LocationKey(debug_module, function_token, il_offset));
+  if (found == locations_.end()) {
+    return false;
+  }
+
+  *location = found->second;
+  return true;
+}
+
+void FrameSymbolCache::AddLocation(ICorDebugModule *debug_module,
+                                   mdMethodDef function_token,
+                                   uint32_t il_offset,
+                                   const FrameLocation &location) {
+  lock_guard<mutex> lock(mutex_);
+  if (locations_.size() >= kMaximumEntries) {
+    locations_.clear();
+  }
+  AddModule(debug_module);
+  locations_[LocationKey(debug_module, function_token, il_offset)] = location;
+}
+
+void FrameSymbolCache::RemoveModule(ICorDebugModule *debug_module) {
+  lock_guard<mutex> lock(mutex_);
+  // Both maps are sorted by module first.
+  auto symbols = symbols_.lower_bound(SymbolsKey(debug_module, 0));
+  while (symbols != symbols_.end() &&
+         std::get<0>(symbols->first) == debug_module) {
+    symbols = symbols_.erase(symbols);
+  }
+
+  auto locations = locations_.lower_bound(LocationKey(debug_module, 0, 0));
+  while (locations != locations_.end() &&
+         std::get<0>(locations->first) == debug_module) {
+    locations = locations_.erase(locations);
+  }
+
+  modules_.erase(debug_module);
+}
+
+void FrameSymbolCache::AddModule(ICorDebugModule *debug_module) {
+  CComPtr<ICorDebugModule> &module = modules_[debug_module];
+  if (!module) {
+    module = debug_module;
+  }
+}
+
+size_t FrameSymbolCache::GetEntryCount() const {
+  lock_guard<mutex> lock(mutex_);
+  return symbols_.size() + locations_.size();
+}
+
+}  //  namespace google_cloud_debugger
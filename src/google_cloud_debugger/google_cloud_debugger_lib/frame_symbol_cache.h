@@ -0,0 +1,130 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FRAME_SYMBOL_CACHE_H_
+#define FRAME_SYMBOL_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+#include "ccomptr.h"
+#include "cor.h"
+#include "cordebug.h"
+
+namespace google_cloud_debugger {
+
+// Class and method of the function of a stack frame, as read from the
+// metadata of its module.
+struct FrameSymbols {
+  // Name of the class the function is in.
+  std::string class_name;
+
+  // Name of the function.
+  std::string method_name;
+
+  // Token of the class the function is in.
+  mdTypeDef class_token = 0;
+
+  // Virtual address of the function.
+  ULONG32 virtual_address = 0;
+};
+
+// Source location of an IL offset in the function of a stack frame, as
+// read from the PDB of its module.
+struct FrameLocation {
+  // Path of the source file of the function.
+  std::string file;
+
+  // Start line of the sequence point the IL offset is in.
+  std::uint32_t line = 0;
+
+  // IL offset of the sequence point the IL offset is in. This decides
+  // which local scopes of the function are visible.
+  std::uint32_t sequence_point_il_offset = 0;
+};
+
+// Cache of what StackFrameCollection resolves for each frame, so a
+// breakpoint that is hit over and over does not query the metadata and
+// the PDB for the same functions every time.
+//
+// Symbols are keyed by module and function token. Locations are also
+// keyed by the IL offset of the frame. Modules are told apart by their
+// ICorDebugModule rather than their name, since the same assembly loaded
+// in two AssemblyLoadContexts has two modules with the same name. The
+// cache is cleared when it grows too large. All methods are thread-safe.
+class FrameSymbolCache {
+ public:
+  // Gets the symbols of function function_token in module debug_module.
+  // Returns false if they are not in the cache.
+  bool GetSymbols(ICorDebugModule *debug_module, mdMethodDef function_token,
+                  FrameSymbols *symbols) const;
+
+  // Adds the symbols of function function_token in module debug_module.
+  void AddSymbols(ICorDebugModule *debug_module, mdMethodDef function_token,
+                  const FrameSymbols &symbols);
+
+  // Gets the location of IL offset il_offset of function function_token
+  // in module debug_module. Returns false if it is not in the cache.
+  bool GetLocation(ICorDebugModule *debug_module, mdMethodDef function_token,
+                   std::uint32_t il_offset, FrameLocation *location) const;
+
+  // Adds the location of IL offset il_offset of function function_token
+  // in module debug_module.
+  void AddLocation(ICorDebugModule *debug_module, mdMethodDef function_token,
+                   std::uint32_t il_offset, const FrameLocation &location);
+
+  // Removes the symbols and locations of the functions in module
+  // debug_module, which has been unloaded.
+  void RemoveModule(ICorDebugModule *debug_module);
+
+  // Returns the number of symbols and locations in the cache.
+  std::size_t GetEntryCount() const;
+
+  // Maximum number of symbols or locations kept before the cache is
+  // cleared.
+  static const std::size_t kMaximumEntries = 10000;
+
+ private:
+  // Module and function token.
+  typedef std::tuple<ICorDebugModule *, mdMethodDef> SymbolsKey;
+
+  // Module, function token and IL offset.
+  typedef std::tuple<ICorDebugModule *, mdMethodDef, std::uint32_t>
+      LocationKey;
+
+  // Keeps a reference to debug_module until it is removed, so that its
+  // address is not reused by another module in the meantime.
+  // mutex_ must be held.
+  void AddModule(ICorDebugModule *debug_module);
+
+  // Symbols of the functions seen so far.
+  std::map<SymbolsKey, FrameSymbols> symbols_;
+
+  // Locations of the IL offsets seen so far.
+  std::map<LocationKey, FrameLocation> locations_;
+
+  // The modules of the keys of symbols_ and locations_.
+  std::map<ICorDebugModule *, CComPtr<ICorDebugModule>> modules_;
+
+  // Mutex protecting symbols_, locations_ and modules_.
+  mutable std::mutex mutex_;
+};
+
+}  //  namespace google_cloud_debugger
+
+#endif  // FRAME_SYMBOL_CACHE_H_
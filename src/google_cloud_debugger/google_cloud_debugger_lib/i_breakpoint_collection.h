@@ -53,6 +53,11 @@ class IBreakpointCollection {
   // This means duplicate breakpoints will be silently rejected.
   virtual HRESULT UpdateBreakpoint(const DbgBreakpoint &breakpoint) = 0;
 
+  // Activates or deactivates all of breakpoints, as UpdateBreakpoint
+  // does, as a single update of the collection.
+  virtual HRESULT UpdateBreakpoints(
+      const std::vector<std::shared_ptr<DbgBreakpoint>> &breakpoints) = 0;
+
   // Using the breakpoint_client_read_ name pipe, try to read and parse
   // any incoming breakpoints that are written to the named pipe.
   // This method will then try to activate or deactivate these breakpoints.
@@ -72,15 +77,35 @@ class IBreakpointCollection {
   virtual HRESULT ReadBreakpoint(
       google::cloud::diagnostics::debug::Breakpoint *breakpoint) = 0;
 
-  // Evaluates and prints out the breakpoint that corresponds to
-  // the IL offset il_offset inside the function with token
-  // function_token.
+  // Evaluates and prints out the breakpoints at the location of
+  // debug_breakpoint, which has just been hit. Returns S_FALSE if no
+  // breakpoint is set there.
   virtual HRESULT EvaluateAndPrintBreakpoint(
-      mdMethodDef function_token, ULONG32 il_offset,
+      ICorDebugBreakpoint *debug_breakpoint,
       IEvalCoordinator *eval_coordinator, ICorDebugThread *debug_thread,
       const std::vector<
           std::shared_ptr<google_cloud_debugger_portable_pdb::IPortablePdbFile>>
           &pdb_files) = 0;
+
+  // Removes the breakpoints set in module debug_module, which is being
+  // unloaded. The breakpoints are kept pending until a module with their
+  // document is loaded again. Adds the updates that report them as unbound
+  // to the agent to unbound_breakpoints.
+  virtual HRESULT RemoveBreakpointsInModule(
+      ICorDebugModule *debug_module,
+      std::vector<google::cloud::diagnostics::debug::Breakpoint>
+          *unbound_breakpoints) = 0;
+
+  // Tries to set the pending breakpoints of unloaded modules in the
+  // documents that are indexed now. Returns S_FALSE if there are none.
+  virtual HRESULT SetPendingBreakpoints() = 0;
+
+  // Returns the number of locations where breakpoints are set.
+  virtual std::size_t GetLocationCount() = 0;
+
+  // Returns the number of locations whose breakpoints wait for their
+  // module to be loaded again.
+  virtual std::size_t GetPendingLocationCount() = 0;
 };
 
 }  // namespace google_cloud_debugger
@@ -15,12 +15,15 @@
 #ifndef I_EVAL_COORDINATOR_H_
 #define I_EVAL_COORDINATOR_H_
 
+#include <chrono>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
 #include <vector>
 
+#include "breakpoint.pb.h"
 #include "cor.h"
 #include "cordebug.h"
 #include "i_portable_pdb_file.h"
@@ -70,9 +73,10 @@ class IEvalCoordinator {
   virtual HRESULT WaitForEval(BOOL *exception_thrown, ICorDebugEval *eval,
                               ICorDebugValue **eval_result) = 0;
 
-  // DebuggerCallback calls this function to signal that an evaluation is
-  // finished.
-  virtual void SignalFinishedEval(ICorDebugThread *debug_thread) = 0;
+  // DebuggerCallback calls this function to signal that evaluation eval
+  // is finished.
+  virtual void SignalFinishedEval(ICorDebugThread *debug_thread,
+                                  ICorDebugEval *eval) = 0;
 
   // DebuggerCallback calls this function to signal that an exception has
   // occurred.
@@ -82,9 +86,10 @@ class IEvalCoordinator {
   // can have different conditions and expressions).
   // Each breakpoint's condition will first be tested. If this is true,
   // stack frame information and expressions will be evaluated and reported.
+  // The breakpoints only have to stay alive until this call returns.
   virtual HRESULT ProcessBreakpoints(
       ICorDebugThread *debug_thread, IBreakpointCollection *breakpoint_collection,
-      std::vector<std::shared_ptr<DbgBreakpoint>> breakpoints,
+      const std::vector<std::shared_ptr<DbgBreakpoint>> &breakpoints,
       const std::vector<
           std::shared_ptr<google_cloud_debugger_portable_pdb::IPortablePdbFile>>
           &pdb_files) = 0;
@@ -118,6 +123,33 @@ class IEvalCoordinator {
 
   // Returns whether method call should be performed when evaluating condition.
   virtual BOOL MethodEvaluation() = 0;
+
+  // Queues breakpoints to be written to breakpoint_collection without
+  // waiting for the pipe, like the snapshots of breakpoint hits.
+  virtual HRESULT WriteBreakpointsAsync(
+      IBreakpointCollection *breakpoint_collection,
+      std::vector<google::cloud::diagnostics::debug::Breakpoint>
+          breakpoints) = 0;
+
+  // Sets how long a single function evaluation may run before it is
+  // aborted, and how long after a breakpoint hit its snapshot may keep
+  // starting function evaluations.
+  virtual void SetEvalTimeouts(
+      std::chrono::milliseconds eval_timeout,
+      std::chrono::milliseconds snapshot_eval_timeout) = 0;
+
+  // Returns true if the snapshot being captured has no evaluation time
+  // left, so no more function evaluations should be started.
+  virtual BOOL EvalTimeExhausted() = 0;
+
+  // Sets how long a breakpoint hit may keep its thread stopped while its
+  // snapshot is captured.
+  virtual void SetPauseTimeout(std::chrono::milliseconds pause_timeout) = 0;
+
+  // Returns true if the breakpoint hit being processed has used up its
+  // pause time. Capture should then stop and the snapshot is reported as
+  // truncated.
+  virtual BOOL PauseTimeExhausted() = 0;
 };
 
 }  //  namespace google_cloud_debugger
@@ -15,6 +15,7 @@
 #ifndef I_PORTABLE_PDB_H_
 #define I_PORTABLE_PDB_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -46,6 +47,9 @@ struct StreamHeader;
 // To use this class, creates a PortablePdbFile object and calls Initialize
 // with an ICorDebugModule object. Then, calls the ParsePdb method to parse
 // the PDB file for the module.
+//
+// Once ParsePdbFile has returned true, the const methods may be called
+// from any number of threads at the same time.
 class IPortablePdbFile {
  public:
   // Destructor.
@@ -57,8 +61,25 @@ class IPortablePdbFile {
 
   // Parses the pdb file. The name of the file will come from the
   // ICorDebugModule object that is used to initialize this object.
+  // This can be called from multiple threads: if another thread is
+  // already parsing the file, this call waits for it to finish.
   virtual bool ParsePdbFile() = 0;
 
+  // Returns true if the pdb file has been parsed. Never blocks.
+  virtual bool IsParsed() const = 0;
+
+  // Returns true if ParsePdbFile has failed, for instance because the
+  // module has no PDB file. ParsePdbFile then fails right away on later
+  // calls. Never blocks.
+  virtual bool HasFailedToParse() const = 0;
+
+  // Records that the module of the pdb file has been unloaded, so that it
+  // is no longer parsed in the background or added to a DocumentPathIndex.
+  virtual void MarkUnloaded() = 0;
+
+  // Returns true if MarkUnloaded has been called. Never blocks.
+  virtual bool IsUnloaded() const = 0;
+
   // Finds the stream header with a given name. Returns false if not found.
   // name is the name of the stream header.
   // stream_header is the stream header that has name name.
@@ -109,10 +130,27 @@ class IPortablePdbFile {
   virtual const std::vector<LocalConstantRow> &GetLocalConstantTable()
       const = 0;
 
+  // Returns the method defs (rows of the method debug info table) of the
+  // methods in document doc_index, in increasing order. Methods that span
+  // multiple documents are not included.
+  virtual const std::vector<std::uint32_t> &GetDocumentMethods(
+      std::uint32_t doc_index) const = 0;
+
   // Returns the document index table.
   virtual const std::vector<std::unique_ptr<IDocumentIndex>>
       &GetDocumentIndexTable() const = 0;
 
+  // Finds the method with method def method_def, which is also the row id
+  // of the MethodDef token of the method, and the document index holding
+  // it. Returns false if no document index holds the method.
+  virtual bool FindMethod(std::uint32_t method_def,
+                          const IDocumentIndex **document_index,
+                          const MethodInfo **method) const = 0;
+
+  // Returns an estimate of the number of bytes used by the document index
+  // table, including the string pools of the document indices.
+  virtual std::size_t GetIndexMemoryUsage() const = 0;
+
   // Gets the name of the module of this PDB.
   virtual const std::string &GetModuleName() const = 0;
 
@@ -0,0 +1,129 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "indexing_thread_pool.h"
+
+#include <algorithm>
+
+using std::lock_guard;
+using std::mutex;
+using std::unique_lock;
+
+namespace google_cloud_debugger_portable_pdb {
+
+void IndexingThreadPool::Job::RunTasks() {
+  while (!failed) {
+    size_t current_task = next_task++;
+    if (current_task >= task_count) {
+      return;
+    }
+
+    if (!(*task)(current_task)) {
+      failed = true;
+    }
+  }
+}
+
+IndexingThreadPool::IndexingThreadPool(size_t num_threads) {
+  threads_.reserve(num_threads);
+  for (size_t i = 0; i < num_threads; ++i) {
+    threads_.push_back(std::thread(&IndexingThreadPool::HelpWithJobs, this));
+  }
+}
+
+IndexingThreadPool::~IndexingThreadPool() {
+  {
+    lock_guard<mutex> lock(mutex_);
+    shutting_down_ = true;
+  }
+
+  jobs_cv_.notify_all();
+  for (std::thread &thread : threads_) {
+    thread.join();
+  }
+}
+
+IndexingThreadPool &IndexingThreadPool::GetShared() {
+  static IndexingThreadPool shared_pool(
+      std::max<size_t>(std::thread::hardware_concurrency(), 1) - 1);
+  return shared_pool;
+}
+
+bool IndexingThreadPool::Run(size_t task_count, size_t max_threads,
+                             const std::function<bool(size_t)> &task) {
+  Job job;
+  job.task_count = task_count;
+  job.task = &task;
+  job.max_helpers =
+      std::min({max_threads == 0 ? 0 : max_threads - 1,
+                task_count == 0 ? 0 : task_count - 1, threads_.size()});
+
+  if (job.max_helpers > 0) {
+    {
+      lock_guard<mutex> lock(mutex_);
+      jobs_.push_back(&job);
+    }
+    jobs_cv_.notify_all();
+  }
+
+  job.RunTasks();
+
+  if (job.max_helpers > 0) {
+    // No new helper can join once the job is out of jobs_, and the ones
+    // that joined have to leave before job goes out of scope.
+    unique_lock<mutex> lock(mutex_);
+    jobs_.erase(std::find(jobs_.begin(), jobs_.end(), &job));
+    helpers_cv_.wait(lock, [&job] { return job.helpers == 0; });
+  }
+
+  return !job.failed;
+}
+
+void IndexingThreadPool::HelpWithJobs() {
+  while (true) {
+    Job *job;
+    {
+      unique_lock<mutex> lock(mutex_);
+      jobs_cv_.wait(lock, [this] {
+        return shutting_down_ || FindJobToHelp() != nullptr;
+      });
+      if (shutting_down_) {
+        return;
+      }
+
+      job = FindJobToHelp();
+      ++job->helpers;
+    }
+
+    job->RunTasks();
+
+    {
+      lock_guard<mutex> lock(mutex_);
+      --job->helpers;
+    }
+    helpers_cv_.notify_all();
+  }
+}
+
+IndexingThreadPool::Job *IndexingThreadPool::FindJobToHelp() const {
+  for (Job *job : jobs_) {
+    if (job->helpers < job->max_helpers && !job->failed &&
+        job->next_task < job->task_count) {
+      return job;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace google_cloud_debugger_portable_pdb
@@ -0,0 +1,117 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INDEXING_THREAD_POOL_H_
+#define INDEXING_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace google_cloud_debugger_portable_pdb {
+
+// A fixed set of threads that help decode the methods of PDB files.
+//
+// Several PDB files are parsed at the same time (by the workers of the
+// ModuleIndexer and by breakpoints that need a PDB file right away), and
+// each of them splits its methods into many small tasks. Rather than each
+// parse starting and joining threads of its own, they all submit their
+// tasks to the pool returned by GetShared, whose threads are started once.
+//
+// The thread that calls Run takes part in its own tasks, so a Run call
+// always makes progress even if every thread of the pool is busy helping
+// other calls. All methods are thread-safe.
+class IndexingThreadPool {
+ public:
+  // Starts a pool with num_threads threads.
+  explicit IndexingThreadPool(std::size_t num_threads);
+
+  // Stops the threads of the pool. There must be no Run call in progress.
+  ~IndexingThreadPool();
+
+  // Returns the pool shared by all PDB files, with one thread per core
+  // but one, since the threads calling Run take part too. The pool is
+  // created by the first call.
+  static IndexingThreadPool &GetShared();
+
+  // Runs task(0) to task(task_count - 1) on the calling thread and on up
+  // to max_threads - 1 threads of the pool that are not busy, then waits
+  // until they are all done. Each thread keeps taking the next task nobody
+  // has taken yet. Once a task returns false, no new task is started and
+  // false is returned.
+  bool Run(std::size_t task_count, std::size_t max_threads,
+           const std::function<bool(std::size_t)> &task);
+
+  // Returns the number of threads of the pool.
+  std::size_t GetThreadCount() const { return threads_.size(); }
+
+ private:
+  // The tasks of a Run call.
+  struct Job {
+    // Number of tasks and the tasks.
+    std::size_t task_count;
+    const std::function<bool(std::size_t)> *task;
+
+    // Maximum number of threads of the pool that can help.
+    std::size_t max_helpers;
+
+    // Number of threads of the pool helping with the job. Protected by
+    // mutex_.
+    std::size_t helpers = 0;
+
+    // Next task nobody has taken yet.
+    std::atomic<std::size_t> next_task{0};
+
+    // True once a task returned false.
+    std::atomic<bool> failed{false};
+
+    // Runs tasks until there are none left or one fails.
+    void RunTasks();
+  };
+
+  // Loop run by each thread of the pool. Helps with the jobs in jobs_
+  // until the pool is destroyed.
+  void HelpWithJobs();
+
+  // Returns a job of jobs_ that can take another helper, or nullptr.
+  Job *FindJobToHelp() const;
+
+  // The threads of the pool.
+  std::vector<std::thread> threads_;
+
+  // Jobs of the Run calls in progress.
+  std::deque<Job *> jobs_;
+
+  // True if the pool is being destroyed.
+  bool shutting_down_ = false;
+
+  // Mutex protecting jobs_, shutting_down_ and the helpers of the jobs.
+  std::mutex mutex_;
+
+  // Used to wake up the threads of the pool when a job is added or when
+  // the pool is destroyed.
+  std::condition_variable jobs_cv_;
+
+  // Used to wake up Run calls when a helper leaves their job.
+  std::condition_variable helpers_cv_;
+};
+
+}  // namespace google_cloud_debugger_portable_pdb
+
+#endif  // INDEXING_THREAD_POOL_H_
@@ -0,0 +1,58 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEMORY_MAPPED_FILE_H_
+#define MEMORY_MAPPED_FILE_H_
+
+#include <cstdint>
+#include <string>
+
+namespace google_cloud_debugger_portable_pdb {
+
+// A read-only view of a whole file mapped into memory. The platform
+// specific parts live in memory_mapped_file_unix.cc (mmap) and
+// memory_mapped_file_windows.cc (MapViewOfFile). The view is released when
+// the object is destroyed.
+class MemoryMappedFile {
+ public:
+  MemoryMappedFile() = default;
+  ~MemoryMappedFile();
+
+  // Maps file into memory. Returns false if the file cannot be opened,
+  // is empty or cannot be mapped.
+  bool Map(const std::string &file);
+
+  // Returns the first byte of the view, or nullptr if nothing is mapped.
+  const std::uint8_t *Data() const { return data_; }
+
+  // Returns the size of the view in bytes.
+  std::uint32_t Size() const { return size_; }
+
+ private:
+  MemoryMappedFile(const MemoryMappedFile &) = delete;
+  MemoryMappedFile &operator=(const MemoryMappedFile &) = delete;
+
+  // Releases the current view, if any.
+  void Unmap();
+
+  // Start of the mapped view.
+  const std::uint8_t *data_ = nullptr;
+
+  // Length of the mapped view.
+  std::uint32_t size_ = 0;
+};
+
+}  // namespace google_cloud_debugger_portable_pdb
+
+#endif  //  MEMORY_MAPPED_FILE_H_
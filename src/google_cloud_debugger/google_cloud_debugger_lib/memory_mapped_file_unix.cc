@@ -0,0 +1,84 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifdef PLATFORM_UNIX
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <iostream>
+
+#include "memory_mapped_file.h"
+
+using std::cerr;
+using std::string;
+
+namespace google_cloud_debugger_portable_pdb {
+
+MemoryMappedFile::~MemoryMappedFile() { Unmap(); }
+
+bool MemoryMappedFile::Map(const string &file) {
+  Unmap();
+
+  int fd = open(file.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) == -1) {
+    cerr << "fstat error: " << strerror(errno) << std::endl;
+    close(fd);
+    return false;
+  }
+
+  // PDB offsets are 32 bits wide so anything larger cannot be a valid PDB.
+  if (file_stat.st_size <= 0 || file_stat.st_size > UINT32_MAX) {
+    cerr << "File " << file << " has an invalid size." << std::endl;
+    close(fd);
+    return false;
+  }
+
+  void *mapping = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE,
+                       fd, 0);
+  // The mapping holds its own reference to the file.
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    cerr << "mmap error: " << strerror(errno) << std::endl;
+    return false;
+  }
+
+  data_ = static_cast<const uint8_t *>(mapping);
+  size_ = static_cast<uint32_t>(file_stat.st_size);
+  return true;
+}
+
+void MemoryMappedFile::Unmap() {
+  if (data_ == nullptr) {
+    return;
+  }
+
+  if (munmap(const_cast<uint8_t *>(data_), size_) == -1) {
+    cerr << "munmap error: " << strerror(errno) << std::endl;
+  }
+  data_ = nullptr;
+  size_ = 0;
+}
+
+}  // namespace google_cloud_debugger_portable_pdb
+
+#endif  //  PLATFORM_UNIX
@@ -0,0 +1,83 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifdef _WIN32
+
+#include <windows.h>
+#include <iostream>
+
+#include "memory_mapped_file.h"
+
+using std::cerr;
+using std::string;
+
+namespace google_cloud_debugger_portable_pdb {
+
+MemoryMappedFile::~MemoryMappedFile() { Unmap(); }
+
+bool MemoryMappedFile::Map(const string &file) {
+  Unmap();
+
+  HANDLE file_handle =
+      CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file_handle == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  // PDB offsets are 32 bits wide so anything larger cannot be a valid PDB.
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart <= 0 ||
+      file_size.QuadPart > UINT32_MAX) {
+    cerr << "File " << file << " has an invalid size." << std::endl;
+    CloseHandle(file_handle);
+    return false;
+  }
+
+  HANDLE mapping_handle = CreateFileMappingA(file_handle, nullptr,
+                                             PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file_handle);
+  if (mapping_handle == nullptr) {
+    cerr << "CreateFileMapping error: " << GetLastError() << std::endl;
+    return false;
+  }
+
+  // The view holds its own reference to the mapping object.
+  void *view = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping_handle);
+  if (view == nullptr) {
+    cerr << "MapViewOfFile error: " << GetLastError() << std::endl;
+    return false;
+  }
+
+  data_ = static_cast<const uint8_t *>(view);
+  size_ = static_cast<uint32_t>(file_size.QuadPart);
+  return true;
+}
+
+void MemoryMappedFile::Unmap() {
+  if (data_ == nullptr) {
+    return;
+  }
+
+  if (!UnmapViewOfFile(data_)) {
+    cerr << "UnmapViewOfFile error: " << GetLastError() << std::endl;
+  }
+  data_ = nullptr;
+  size_ = 0;
+}
+
+}  // namespace google_cloud_debugger_portable_pdb
+
+#endif  //  _WIN32
@@ -15,6 +15,7 @@
 #include "metadata_tables.h"
 
 #include <assert.h>
+#include <cstring>
 
 #include "custom_binary_reader.h"
 #include "metadata_headers.h"
@@ -71,7 +72,7 @@ bool ParseFrom(CustomBinaryStream *binary_reader,
   assert(binary_reader != nullptr);
   assert(method_debug != nullptr);
 
-  if (!binary_reader->ReadTableIndex(Heap::BlobsHeap, header.heap_sizes,
+  if (!binary_reader->ReadTableIndex(MetadataTable::Document, header,
                                      &method_debug->document)) {
     return false;
   }
@@ -379,6 +380,201 @@ bool ParseFrom(CustomBinaryStream *binary_reader,
   return true;
 }
 
+namespace {
+
+// Reads an index of IndexSize bytes (2 or 4) from *data and moves *data
+// past it.
+template <uint32_t IndexSize>
+uint32_t TakeIndex(const uint8_t **data);
+
+template <>
+uint32_t TakeIndex<2>(const uint8_t **data) {
+  uint16_t index;
+  memcpy(&index, *data, sizeof(index));
+  *data += sizeof(index);
+  return index;
+}
+
+template <>
+uint32_t TakeIndex<4>(const uint8_t **data) {
+  uint32_t index;
+  memcpy(&index, *data, sizeof(index));
+  *data += sizeof(index);
+  return index;
+}
+
+// Row decoders. Each one is built for one combination of index sizes, so
+// kRowSize is a constant and Decode reads every column at a fixed offset.
+
+template <uint32_t BlobSize, uint32_t GuidSize>
+struct DocumentRowDecoder {
+  static const uint32_t kRowSize = 2 * BlobSize + 2 * GuidSize;
+
+  static void Decode(const uint8_t *data, DocumentRow *row) {
+    row->name = TakeIndex<BlobSize>(&data);
+    row->hash_algorithm = TakeIndex<GuidSize>(&data);
+    row->hash = TakeIndex<BlobSize>(&data);
+    row->language = TakeIndex<GuidSize>(&data);
+  }
+};
+
+template <uint32_t DocumentSize, uint32_t BlobSize>
+struct MethodDebugInformationRowDecoder {
+  static const uint32_t kRowSize = DocumentSize + BlobSize;
+
+  static void Decode(const uint8_t *data, MethodDebugInformationRow *row) {
+    row->document = TakeIndex<DocumentSize>(&data);
+    row->sequence_points = TakeIndex<BlobSize>(&data);
+  }
+};
+
+template <uint32_t MethodSize, uint32_t ImportScopeSize,
+          uint32_t VariableSize, uint32_t ConstantSize>
+struct LocalScopeRowDecoder {
+  static const uint32_t kRowSize =
+      MethodSize + ImportScopeSize + VariableSize + ConstantSize + 8;
+
+  static void Decode(const uint8_t *data, LocalScopeRow *row) {
+    row->method_def = TakeIndex<MethodSize>(&data);
+    row->import_scope = TakeIndex<ImportScopeSize>(&data);
+    row->variable_list = TakeIndex<VariableSize>(&data);
+    row->constant_list = TakeIndex<ConstantSize>(&data);
+    row->start_offset = TakeIndex<4>(&data);
+    row->length = TakeIndex<4>(&data);
+  }
+};
+
+template <uint32_t StringSize>
+struct LocalVariableRowDecoder {
+  static const uint32_t kRowSize = 4 + StringSize;
+
+  static void Decode(const uint8_t *data, LocalVariableRow *row) {
+    row->attributes = static_cast<uint16_t>(TakeIndex<2>(&data));
+    row->index = static_cast<uint16_t>(TakeIndex<2>(&data));
+    row->name = TakeIndex<StringSize>(&data);
+  }
+};
+
+template <uint32_t StringSize, uint32_t BlobSize>
+struct LocalConstantRowDecoder {
+  static const uint32_t kRowSize = StringSize + BlobSize;
+
+  static void Decode(const uint8_t *data, LocalConstantRow *row) {
+    row->name = TakeIndex<StringSize>(&data);
+    row->signature = TakeIndex<BlobSize>(&data);
+  }
+};
+
+// Decodes rows_in_table rows with Decoder into table, after an empty row 0.
+template <typename Decoder, typename TableRow>
+bool DecodeRows(CustomBinaryStream *binary_reader, uint32_t rows_in_table,
+                vector<TableRow> *table) {
+  uint64_t table_size =
+      static_cast<uint64_t>(rows_in_table) * Decoder::kRowSize;
+  const uint8_t *data;
+  if (table_size > binary_reader->Remaining() ||
+      !binary_reader->ReadSpan(static_cast<uint32_t>(table_size), &data)) {
+    return false;
+  }
+
+  table->resize(static_cast<size_t>(rows_in_table) + 1);
+  for (size_t i = 1; i <= rows_in_table; ++i) {
+    Decoder::Decode(data, &(*table)[i]);
+    data += Decoder::kRowSize;
+  }
+
+  return true;
+}
+
+// Turns the index sizes passed to Decode, which are only known at run
+// time, into template arguments of Decoder one at a time. Sizes holds the
+// ones turned so far. Once all of them are, the table is decoded with
+// Decoder<Sizes...>.
+template <template <uint32_t...> class Decoder, uint32_t... Sizes>
+struct DecoderSelector {
+  template <typename TableRow>
+  static bool Decode(CustomBinaryStream *binary_reader, uint32_t rows_in_table,
+                     vector<TableRow> *table) {
+    return DecodeRows<Decoder<Sizes...>>(binary_reader, rows_in_table, table);
+  }
+
+  template <typename TableRow, typename... IndexSizes>
+  static bool Decode(CustomBinaryStream *binary_reader, uint32_t rows_in_table,
+                     vector<TableRow> *table, uint32_t index_size,
+                     IndexSizes... index_sizes) {
+    if (index_size == 4) {
+      return DecoderSelector<Decoder, Sizes..., 4>::Decode(
+          binary_reader, rows_in_table, table, index_sizes...);
+    }
+    return DecoderSelector<Decoder, Sizes..., 2>::Decode(
+        binary_reader, rows_in_table, table, index_sizes...);
+  }
+};
+
+}  // namespace
+
+bool ParseTable(CustomBinaryStream *binary_reader,
+                const CompressedMetadataTableHeader &header,
+                uint32_t rows_in_table, vector<DocumentRow> *table) {
+  assert(binary_reader != nullptr);
+  assert(table != nullptr);
+
+  return DecoderSelector<DocumentRowDecoder>::Decode(
+      binary_reader, rows_in_table, table,
+      GetHeapIndexSize(Heap::BlobsHeap, header.heap_sizes),
+      GetHeapIndexSize(Heap::GuidsHeap, header.heap_sizes));
+}
+
+bool ParseTable(CustomBinaryStream *binary_reader,
+                const CompressedMetadataTableHeader &header,
+                uint32_t rows_in_table,
+                vector<MethodDebugInformationRow> *table) {
+  assert(binary_reader != nullptr);
+  assert(table != nullptr);
+
+  return DecoderSelector<MethodDebugInformationRowDecoder>::Decode(
+      binary_reader, rows_in_table, table,
+      GetTableIndexSize(MetadataTable::Document, header),
+      GetHeapIndexSize(Heap::BlobsHeap, header.heap_sizes));
+}
+
+bool ParseTable(CustomBinaryStream *binary_reader,
+                const CompressedMetadataTableHeader &header,
+                uint32_t rows_in_table, vector<LocalScopeRow> *table) {
+  assert(binary_reader != nullptr);
+  assert(table != nullptr);
+
+  return DecoderSelector<LocalScopeRowDecoder>::Decode(
+      binary_reader, rows_in_table, table,
+      GetTableIndexSize(MetadataTable::Method, header),
+      GetTableIndexSize(MetadataTable::ImportScope, header),
+      GetTableIndexSize(MetadataTable::LocalVariable, header),
+      GetTableIndexSize(MetadataTable::LocalConstant, header));
+}
+
+bool ParseTable(CustomBinaryStream *binary_reader,
+                const CompressedMetadataTableHeader &header,
+                uint32_t rows_in_table, vector<LocalVariableRow> *table) {
+  assert(binary_reader != nullptr);
+  assert(table != nullptr);
+
+  return DecoderSelector<LocalVariableRowDecoder>::Decode(
+      binary_reader, rows_in_table, table,
+      GetHeapIndexSize(Heap::StringsHeap, header.heap_sizes));
+}
+
+bool ParseTable(CustomBinaryStream *binary_reader,
+                const CompressedMetadataTableHeader &header,
+                uint32_t rows_in_table, vector<LocalConstantRow> *table) {
+  assert(binary_reader != nullptr);
+  assert(table != nullptr);
+
+  return DecoderSelector<LocalConstantRowDecoder>::Decode(
+      binary_reader, rows_in_table, table,
+      GetHeapIndexSize(Heap::StringsHeap, header.heap_sizes),
+      GetHeapIndexSize(Heap::BlobsHeap, header.heap_sizes));
+}
+
 const string &GetLanguageName(const string &guid) {
   static const string kCSharp = "C#";
   static const string kVBNet = "VB .NET";
@@ -244,6 +244,37 @@ bool ParseFrom(CustomBinaryStream *binary_reader,
                LocalConstantRow *local_constant);
 
 // Given a GUID, returns the appropriate language name.
+// Parses rows_in_table rows of a metadata table into table. Row ids are
+// 1-based, so table gets an empty row 0 followed by the parsed rows.
+//
+// Unlike the ParseFrom functions above, which check the size of every
+// index they read, these pick a decoder built for the index sizes given
+// by header once per table and decode the rows straight from the bytes
+// of the stream.
+bool ParseTable(CustomBinaryStream *binary_reader,
+                const CompressedMetadataTableHeader &header,
+                std::uint32_t rows_in_table, std::vector<DocumentRow> *table);
+
+bool ParseTable(CustomBinaryStream *binary_reader,
+                const CompressedMetadataTableHeader &header,
+                std::uint32_t rows_in_table,
+                std::vector<MethodDebugInformationRow> *table);
+
+bool ParseTable(CustomBinaryStream *binary_reader,
+                const CompressedMetadataTableHeader &header,
+                std::uint32_t rows_in_table,
+                std::vector<LocalScopeRow> *table);
+
+bool ParseTable(CustomBinaryStream *binary_reader,
+                const CompressedMetadataTableHeader &header,
+                std::uint32_t rows_in_table,
+                std::vector<LocalVariableRow> *table);
+
+bool ParseTable(CustomBinaryStream *binary_reader,
+                const CompressedMetadataTableHeader &header,
+                std::uint32_t rows_in_table,
+                std::vector<LocalConstantRow> *table);
+
 const std::string &GetLanguageName(const std::string &guid);
 
 // Given a GUID, returns the appropriate hash algorithm name.
@@ -0,0 +1,83 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "method_def_table.h"
+
+#include <algorithm>
+
+using std::shared_ptr;
+using std::unique_ptr;
+using std::vector;
+
+namespace google_cloud_debugger_portable_pdb {
+
+void MethodDefTable::Build(
+    const vector<unique_ptr<IDocumentIndex>> &document_indices) {
+  storage_.reset();
+  entries_view_ = nullptr;
+  num_entries_ = 0;
+
+  size_t method_count = 0;
+  for (const auto &document_index : document_indices) {
+    method_count += document_index->GetMethods().size();
+  }
+
+  entries_.clear();
+  entries_.reserve(method_count);
+  for (uint32_t document = 0; document < document_indices.size();
+       ++document) {
+    const vector<MethodInfo> &methods =
+        document_indices[document]->GetMethods();
+    for (uint32_t position = 0; position < methods.size(); ++position) {
+      entries_.push_back({methods[position].method_def, document, position});
+    }
+  }
+
+  std::sort(entries_.begin(), entries_.end(),
+            [](const Entry &first, const Entry &second) {
+              return first.method_def < second.method_def;
+            });
+}
+
+void MethodDefTable::SetView(shared_ptr<const void> storage,
+                             const Entry *entries, uint32_t num_entries) {
+  entries_ = vector<Entry>();
+  storage_ = std::move(storage);
+  entries_view_ = entries;
+  num_entries_ = entries ? num_entries : 0;
+}
+
+bool MethodDefTable::Find(uint32_t method_def, uint32_t *document,
+                          uint32_t *position) const {
+  if (!document || !position) {
+    return false;
+  }
+
+  const Entry *entries = GetEntries();
+  const Entry *entries_end = entries + GetEntryCount();
+  const Entry *found = std::lower_bound(
+      entries, entries_end, method_def,
+      [](const Entry &entry, uint32_t method_def) {
+        return entry.method_def < method_def;
+      });
+  if (found == entries_end || found->method_def != method_def) {
+    return false;
+  }
+
+  *document = found->document;
+  *position = found->position;
+  return true;
+}
+
+}  // namespace google_cloud_debugger_portable_pdb
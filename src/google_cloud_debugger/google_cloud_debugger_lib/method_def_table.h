@@ -0,0 +1,98 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef METHOD_DEF_TABLE_H_
+#define METHOD_DEF_TABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "document_index.h"
+
+namespace google_cloud_debugger_portable_pdb {
+
+// Table from the method defs of a PDB to the position of their MethodInfo
+// in its document indices. This lets a stack frame find its method from
+// its function token without going through every method of every document.
+//
+// The table can also be a read-only view of entries it does not own, such
+// as the entries of a mapped PdbIndexCache file (see SetView).
+class MethodDefTable {
+ public:
+  // Where the MethodInfo of a method def is.
+  struct Entry {
+    // Method def of the method.
+    std::uint32_t method_def;
+
+    // Position of the document index holding the method.
+    std::uint32_t document;
+
+    // Position of the method in the methods of the document index.
+    std::uint32_t position;
+  };
+
+  // Builds the table from the methods of document_indices.
+  void Build(
+      const std::vector<std::unique_ptr<IDocumentIndex>> &document_indices);
+
+  // Makes the table a view of the num_entries entries at entries, which
+  // must be sorted by method def. Nothing is copied: the entries must stay
+  // valid and unchanged as long as storage, which the table keeps alive,
+  // is. The documents and positions in the entries are not checked, so
+  // the caller has to check what Find returns.
+  void SetView(std::shared_ptr<const void> storage, const Entry *entries,
+               std::uint32_t num_entries);
+
+  // Finds the document and the position of the method with method def
+  // method_def. Returns false if there is no such method.
+  bool Find(std::uint32_t method_def, std::uint32_t *document,
+            std::uint32_t *position) const;
+
+  // Returns the entries of the table, sorted by method def.
+  const Entry *GetEntries() const {
+    return storage_ ? entries_view_ : entries_.data();
+  }
+
+  // Returns the number of entries of the table.
+  std::uint32_t GetEntryCount() const {
+    return storage_ ? num_entries_
+                    : static_cast<std::uint32_t>(entries_.size());
+  }
+
+  // Returns the number of bytes allocated for the table. The entries of
+  // a view are not counted.
+  std::size_t GetMemoryUsage() const {
+    return entries_.capacity() * sizeof(Entry);
+  }
+
+ private:
+  // The entries of the table, unless it is a view.
+  std::vector<Entry> entries_;
+
+  // What keeps the entries of a view valid, or null if the table is not
+  // a view.
+  std::shared_ptr<const void> storage_;
+
+  // The entries of a view.
+  const Entry *entries_view_ = nullptr;
+
+  // Number of entries at entries_view_.
+  std::uint32_t num_entries_ = 0;
+};
+
+}  // namespace google_cloud_debugger_portable_pdb
+
+#endif  // METHOD_DEF_TABLE_H_
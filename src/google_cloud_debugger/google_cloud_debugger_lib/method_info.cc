@@ -20,6 +20,7 @@
 
 #include "dbg_stack_frame.h"
 #include "i_cor_debug_helper.h"
+#include "method_token_table.h"
 #include "type_signature.h"
 
 namespace google_cloud_debugger {
@@ -29,14 +30,20 @@ HRESULT MethodInfo::PopulateMethodDefFromNameAndArguments(
     const mdTypeDef &class_token,
     DbgStackFrame *stack_frame,
     const std::vector<TypeSignature> &class_generic_types,
-    ICorDebugHelper *debug_helper) {
+    ICorDebugHelper *debug_helper,
+    const MethodTokenTable *method_tokens) {
   if (metadata_import == nullptr) {
     return E_INVALIDARG;
   }
 
   std::vector<mdMethodDef> method_defs;
-  HRESULT hr = GetMethodDefsFromName(metadata_import, class_token,
-                                     &method_defs, &std::cerr);
+  HRESULT hr = S_OK;
+  if (method_tokens) {
+    method_defs = method_tokens->FindMethodsByName(class_token, method_name);
+  } else {
+    hr = GetMethodDefsFromName(metadata_import, class_token, &method_defs,
+                               &std::cerr);
+  }
   if (FAILED(hr)) {
     return hr;
   }
@@ -26,6 +26,7 @@ namespace google_cloud_debugger {
 
 class DbgStackFrame;
 class ICorDebugHelper;
+class MethodTokenTable;
 
 // Utility class that contains the properties
 // of a function needed to perform a method call.
@@ -60,12 +61,16 @@ struct MethodInfo {
   // class_generic_types is needed to parse generic types
   // in the class. For example, if the class is Dictionary<string, int>
   // then class_generic_types should contain { string, int }.
+  // The methods named method_name are looked up in method_tokens, the
+  // method table of the module, or enumerated from metadata_import if
+  // method_tokens is null.
   HRESULT PopulateMethodDefFromNameAndArguments(
       IMetaDataImport *metadata_import,
       const mdTypeDef &class_token,
       DbgStackFrame *stack_frame,
       const std::vector<TypeSignature> &class_generic_types,
-      ICorDebugHelper *debug_helper);
+      ICorDebugHelper *debug_helper,
+      const MethodTokenTable *method_tokens);
 
  private:
   // Helper function to find all methods that matches the name
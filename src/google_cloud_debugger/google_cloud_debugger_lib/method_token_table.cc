@@ -0,0 +1,241 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "method_token_table.h"
+
+#include <iostream>
+
+#include "string_stream_wrapper.h"
+
+using std::cerr;
+using std::lock_guard;
+using std::mutex;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+namespace google_cloud_debugger {
+
+namespace {
+
+// Number of tokens read from the metadata at a time.
+const ULONG kEnumBatchSize = 256;
+
+// Length of the buffer method names are first read into.
+const ULONG kNameBufferLength = 256;
+
+}  // namespace
+
+HRESULT MethodTokenTable::Initialize(IMetaDataImport *metadata_import) {
+  if (!metadata_import) {
+    return E_INVALIDARG;
+  }
+
+  lock_guard<mutex> lock(mutex_);
+  metadata_import_ = metadata_import;
+  methods_.clear();
+  classes_read_.clear();
+  methods_by_name_.clear();
+  return S_OK;
+}
+
+const MethodTokenInfo *MethodTokenTable::FindMethod(
+    mdMethodDef method_def) const {
+  lock_guard<mutex> lock(mutex_);
+  const MethodTokenInfo *method = nullptr;
+  HRESULT hr =
+      ReadMethod(TokenFromRid(RidFromToken(method_def), mdtMethodDef), &method);
+  if (FAILED(hr)) {
+    return nullptr;
+  }
+  return method;
+}
+
+const vector<mdMethodDef> &MethodTokenTable::FindMethodsByName(
+    mdTypeDef class_token, const string &method_name) const {
+  static const vector<mdMethodDef> kNoMethods;
+  lock_guard<mutex> lock(mutex_);
+  if (FAILED(ReadMethodsOfClass(class_token))) {
+    return kNoMethods;
+  }
+
+  auto methods = methods_by_name_.find(NameKey(class_token, method_name));
+  if (methods == methods_by_name_.end()) {
+    return kNoMethods;
+  }
+  return methods->second;
+}
+
+std::size_t MethodTokenTable::GetMethodCount() const {
+  lock_guard<mutex> lock(mutex_);
+  return methods_.size();
+}
+
+HRESULT MethodTokenTable::ReadMethodsOfClass(mdTypeDef class_token) const {
+  if (!metadata_import_) {
+    return E_FAIL;
+  }
+
+  if (classes_read_.find(class_token) != classes_read_.end()) {
+    return S_OK;
+  }
+
+  // The names are only added once all the methods of the class are read,
+  // so that a class that fails to be read is read again in full.
+  HCORENUM cor_enum = nullptr;
+  vector<mdMethodDef> method_tokens(kEnumBatchSize, 0);
+  vector<const MethodTokenInfo *> methods;
+  HRESULT hr;
+  while (true) {
+    ULONG methods_returned = 0;
+    hr = metadata_import_->EnumMethods(&cor_enum, class_token,
+                                       method_tokens.data(),
+                                       method_tokens.size(), &methods_returned);
+    if (FAILED(hr)) {
+      cerr << "Failed to enumerate the methods of class " << class_token;
+      break;
+    }
+
+    if (methods_returned == 0) {
+      hr = S_OK;
+      break;
+    }
+
+    for (ULONG i = 0; i < methods_returned && SUCCEEDED(hr); ++i) {
+      const MethodTokenInfo *method;
+      hr = ReadMethod(method_tokens[i], &method);
+      if (SUCCEEDED(hr)) {
+        methods.push_back(method);
+      }
+    }
+
+    if (FAILED(hr)) {
+      break;
+    }
+  }
+
+  if (cor_enum) {
+    metadata_import_->CloseEnum(cor_enum);
+  }
+
+  if (FAILED(hr)) {
+    return hr;
+  }
+
+  for (const MethodTokenInfo *method : methods) {
+    methods_by_name_[NameKey(class_token,
+                             ConvertWCharPtrToString(method->name))]
+        .push_back(method->method_token);
+  }
+  classes_read_.insert(class_token);
+  return S_OK;
+}
+
+HRESULT MethodTokenTable::ReadMethod(mdMethodDef method_token,
+                                     const MethodTokenInfo **method) const {
+  auto existing = methods_.find(RidFromToken(method_token));
+  if (existing != methods_.end()) {
+    *method = &existing->second;
+    return S_OK;
+  }
+
+  if (!metadata_import_) {
+    return E_FAIL;
+  }
+
+  MethodTokenInfo new_method;
+  new_method.method_token = method_token;
+  new_method.name.resize(kNameBufferLength);
+
+  // Most names fit in the first buffer. A longer one is read again into a
+  // buffer of the right size.
+  ULONG name_length = 0;
+  DWORD impl_flags;
+  HRESULT hr = metadata_import_->GetMethodProps(
+      method_token, &new_method.class_token, new_method.name.data(),
+      new_method.name.size(), &name_length, &new_method.attributes,
+      &new_method.signature, &new_method.signature_length,
+      &new_method.virtual_address, &impl_flags);
+  if (SUCCEEDED(hr) && name_length > new_method.name.size()) {
+    new_method.name.resize(name_length);
+    hr = metadata_import_->GetMethodProps(
+        method_token, &new_method.class_token, new_method.name.data(),
+        new_method.name.size(), &name_length, &new_method.attributes,
+        &new_method.signature, &new_method.signature_length,
+        &new_method.virtual_address, &impl_flags);
+  }
+
+  if (FAILED(hr)) {
+    cerr << "Failed to get method props for method " << method_token;
+    return hr;
+  }
+
+  new_method.name.resize(name_length);
+  MethodTokenInfo &added = methods_[RidFromToken(method_token)];
+  added = std::move(new_method);
+  *method = &added;
+  return S_OK;
+}
+
+HRESULT MethodTokenTableCache::GetTable(
+    ICorDebugModule *debug_module, IMetaDataImport *metadata_import,
+    shared_ptr<const MethodTokenTable> *table) {
+  if (!debug_module || !metadata_import || !table) {
+    return E_INVALIDARG;
+  }
+
+  {
+    lock_guard<mutex> lock(mutex_);
+    auto module_table = tables_.find(debug_module);
+    if (module_table != tables_.end()) {
+      *table = module_table->second.table;
+      return S_OK;
+    }
+  }
+
+  // If two threads create the table of the same module, the first one to
+  // finish wins.
+  shared_ptr<MethodTokenTable> new_table(new (std::nothrow)
+                                             MethodTokenTable());
+  if (!new_table) {
+    cerr << "Cannot create method token table.";
+    return E_OUTOFMEMORY;
+  }
+
+  HRESULT hr = new_table->Initialize(metadata_import);
+  if (FAILED(hr)) {
+    return hr;
+  }
+
+  lock_guard<mutex> lock(mutex_);
+  ModuleTable &module_table = tables_[debug_module];
+  if (!module_table.table) {
+    module_table.debug_module = debug_module;
+    module_table.table = std::move(new_table);
+  }
+  *table = module_table.table;
+  return S_OK;
+}
+
+void MethodTokenTableCache::RemoveModule(ICorDebugModule *debug_module) {
+  lock_guard<mutex> lock(mutex_);
+  tables_.erase(debug_module);
+}
+
+std::size_t MethodTokenTableCache::GetTableCount() const {
+  lock_guard<mutex> lock(mutex_);
+  return tables_.size();
+}
+
+}  //  namespace google_cloud_debugger
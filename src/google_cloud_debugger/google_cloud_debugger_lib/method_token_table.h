@@ -0,0 +1,168 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef METHOD_TOKEN_TABLE_H_
+#define METHOD_TOKEN_TABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "ccomptr.h"
+#include "cor.h"
+#include "cordebug.h"
+
+namespace google_cloud_debugger {
+
+// Properties of a method, as read from the metadata of its module.
+struct MethodTokenInfo {
+  // Token of the method.
+  mdMethodDef method_token = 0;
+
+  // Token of the class the method is in.
+  mdTypeDef class_token = 0;
+
+  // Name of the method, including the null terminator.
+  std::vector<WCHAR> name;
+
+  // Signature of the method. It points into the metadata of the module.
+  PCCOR_SIGNATURE signature = nullptr;
+
+  // Length of signature in bytes.
+  ULONG signature_length = 0;
+
+  // Relative virtual address of the method.
+  ULONG virtual_address = 0;
+
+  // Attributes of the method (CorMethodAttr flags).
+  DWORD attributes = 0;
+};
+
+// The methods of a module, by MethodDef row and by class and name.
+//
+// A method_def read from a PDB file is the row of the method in the
+// MethodDef table, so it maps to a method token without enumerating the
+// methods of its class and comparing their signatures.
+//
+// Methods are read from the metadata the first time they are looked up:
+// a method by itself when it is looked up by row, and all the methods of
+// its class when it is looked up by name. A module with many methods,
+// such as a framework assembly, thus costs a breakpoint or a function
+// evaluation no more than the methods it uses. Methods are never removed
+// once read, so what the lookups return stays valid as long as the table.
+//
+// All methods are thread-safe.
+class MethodTokenTable {
+ public:
+  // Sets the metadata of the module the methods are read from. The table
+  // keeps metadata_import alive, since the signatures point into its
+  // metadata.
+  HRESULT Initialize(IMetaDataImport *metadata_import);
+
+  // Returns the method in the same MethodDef row as method_def, which
+  // may be a token or a bare row number, or nullptr if there is none.
+  const MethodTokenInfo *FindMethod(mdMethodDef method_def) const;
+
+  // Returns the tokens of the methods named method_name in class
+  // class_token, in metadata order.
+  const std::vector<mdMethodDef> &FindMethodsByName(
+      mdTypeDef class_token, const std::string &method_name) const;
+
+  // Returns the number of methods read so far.
+  std::size_t GetMethodCount() const;
+
+ private:
+  // Class token and method name.
+  typedef std::pair<mdTypeDef, std::string> NameKey;
+
+  // Hash of a NameKey.
+  struct NameKeyHash {
+    std::size_t operator()(const NameKey &key) const {
+      return std::hash<std::string>()(key.second) * 31 + key.first;
+    }
+  };
+
+  // Reads the methods of class class_token into the table, unless they
+  // already are. mutex_ must be held.
+  HRESULT ReadMethodsOfClass(mdTypeDef class_token) const;
+
+  // Reads method method_token into the table, unless it already is, and
+  // returns it in method. mutex_ must be held.
+  HRESULT ReadMethod(mdMethodDef method_token,
+                     const MethodTokenInfo **method) const;
+
+  // The metadata the methods are read from.
+  CComPtr<IMetaDataImport> metadata_import_;
+
+  // The methods read so far, by MethodDef row.
+  mutable std::unordered_map<std::uint32_t, MethodTokenInfo> methods_;
+
+  // The classes whose methods are all in methods_by_name_.
+  mutable std::unordered_set<mdTypeDef> classes_read_;
+
+  // The tokens of the methods of the classes in classes_read_, by class
+  // and name.
+  mutable std::unordered_map<NameKey, std::vector<mdMethodDef>, NameKeyHash>
+      methods_by_name_;
+
+  // Mutex protecting methods_, classes_read_ and methods_by_name_.
+  mutable std::mutex mutex_;
+};
+
+// The MethodTokenTables of the loaded modules. The table of a module is
+// created the first time the module is looked up and is kept, with the
+// methods read into it, until the module is unloaded.
+//
+// All methods are thread-safe.
+class MethodTokenTableCache {
+ public:
+  // Gets the table of module debug_module, whose metadata is
+  // metadata_import, and creates it if this is the first lookup.
+  HRESULT GetTable(ICorDebugModule *debug_module,
+                   IMetaDataImport *metadata_import,
+                   std::shared_ptr<const MethodTokenTable> *table);
+
+  // Removes the table of module debug_module, which has been unloaded.
+  void RemoveModule(ICorDebugModule *debug_module);
+
+  // Returns the number of modules with a table.
+  std::size_t GetTableCount() const;
+
+ private:
+  // A table and the module it belongs to. The reference to the module
+  // keeps the key of the entry from being reused by another module.
+  struct ModuleTable {
+    // The module of the table.
+    CComPtr<ICorDebugModule> debug_module;
+
+    // The methods of the module.
+    std::shared_ptr<const MethodTokenTable> table;
+  };
+
+  // The tables of the modules, by module.
+  std::unordered_map<ICorDebugModule *, ModuleTable> tables_;
+
+  // Mutex protecting tables_.
+  mutable std::mutex mutex_;
+};
+
+}  //  namespace google_cloud_debugger
+
+#endif  //  METHOD_TOKEN_TABLE_H_
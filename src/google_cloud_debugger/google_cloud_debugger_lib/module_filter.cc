@@ -0,0 +1,138 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "module_filter.h"
+
+#include <cctype>
+
+using std::lock_guard;
+using std::mutex;
+using std::string;
+using std::vector;
+
+namespace google_cloud_debugger {
+
+namespace {
+
+// Returns the file name of the module at path module_name.
+string GetFileName(const string &module_name) {
+  size_t separator = module_name.find_last_of("/\\");
+  if (separator == string::npos) {
+    return module_name;
+  }
+  return module_name.substr(separator + 1);
+}
+
+// Returns true if the two characters are the same, ignoring case.
+bool SameCharacter(char first, char second) {
+  return std::tolower(static_cast<unsigned char>(first)) ==
+         std::tolower(static_cast<unsigned char>(second));
+}
+
+}  // namespace
+
+ModuleFilter::ModuleFilter()
+    : exclude_patterns_({"System.*", "Microsoft.*", "mscorlib.dll",
+                         "netstandard.dll", "WindowsBase.dll"}) {}
+
+void ModuleFilter::SetIncludePatterns(vector<string> patterns) {
+  lock_guard<mutex> lock(mutex_);
+  include_patterns_ = std::move(patterns);
+}
+
+void ModuleFilter::SetExcludePatterns(vector<string> patterns) {
+  lock_guard<mutex> lock(mutex_);
+  exclude_patterns_ = std::move(patterns);
+}
+
+bool ModuleFilter::ShouldIndex(const string &module_name) const {
+  string file_name = GetFileName(module_name);
+  lock_guard<mutex> lock(mutex_);
+  if (modules_without_pdb_.find(module_name) != modules_without_pdb_.end()) {
+    return false;
+  }
+
+  return !MatchAnyPattern(exclude_patterns_, file_name) ||
+         MatchAnyPattern(include_patterns_, file_name);
+}
+
+void ModuleFilter::AddModuleWithoutPdb(const string &module_name) {
+  lock_guard<mutex> lock(mutex_);
+  modules_without_pdb_.insert(module_name);
+}
+
+vector<string> ModuleFilter::SplitPatterns(const string &patterns) {
+  vector<string> result;
+  size_t start = 0;
+  while (start <= patterns.size()) {
+    size_t end = patterns.find(',', start);
+    if (end == string::npos) {
+      end = patterns.size();
+    }
+
+    if (end > start) {
+      result.push_back(patterns.substr(start, end - start));
+    }
+    start = end + 1;
+  }
+
+  return result;
+}
+
+bool ModuleFilter::MatchPattern(const string &pattern,
+                                const string &file_name) {
+  size_t pattern_index = 0;
+  size_t name_index = 0;
+  // Position of the last '*' seen in pattern and of the character of
+  // file_name it was matched against first, so we can backtrack and let
+  // it match one more character when the rest does not match.
+  size_t star_index = string::npos;
+  size_t star_name_index = 0;
+
+  while (name_index < file_name.size()) {
+    if (pattern_index < pattern.size() &&
+        (pattern[pattern_index] == '?' ||
+         (pattern[pattern_index] != '*' &&
+          SameCharacter(pattern[pattern_index], file_name[name_index])))) {
+      ++pattern_index;
+      ++name_index;
+    } else if (pattern_index < pattern.size() &&
+               pattern[pattern_index] == '*') {
+      star_index = pattern_index++;
+      star_name_index = name_index;
+    } else if (star_index != string::npos) {
+      pattern_index = star_index + 1;
+      name_index = ++star_name_index;
+    } else {
+      return false;
+    }
+  }
+
+  while (pattern_index < pattern.size() && pattern[pattern_index] == '*') {
+    ++pattern_index;
+  }
+  return pattern_index == pattern.size();
+}
+
+bool ModuleFilter::MatchAnyPattern(const vector<string> &patterns,
+                                   const string &file_name) {
+  for (const string &pattern : patterns) {
+    if (MatchPattern(pattern, file_name)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  //  namespace google_cloud_debugger
@@ -0,0 +1,85 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MODULE_FILTER_H_
+#define MODULE_FILTER_H_
+
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace google_cloud_debugger {
+
+// Decides which loaded modules get a PortablePdbFile, and remembers the
+// modules that turned out to have no usable PDB file.
+//
+// Every application loads hundreds of framework assemblies that almost
+// never come with a PDB file, so they are excluded by default. A module
+// is skipped if its file name matches an exclude pattern and no include
+// pattern, or if an earlier load of the same module found no PDB file.
+//
+// Patterns are matched against the file name of the module, without its
+// directory, ignoring case. '*' matches any run of characters and '?'
+// matches any single character.
+//
+// All methods are thread-safe.
+class ModuleFilter {
+ public:
+  // Creates a filter that excludes the framework assemblies.
+  ModuleFilter();
+
+  // Sets the patterns of the modules to index even if they match an
+  // exclude pattern. There are none by default.
+  void SetIncludePatterns(std::vector<std::string> patterns);
+
+  // Sets the patterns of the modules to skip, replacing the default ones.
+  void SetExcludePatterns(std::vector<std::string> patterns);
+
+  // Returns true if the PDB file of module module_name, which is the path
+  // of the module, should be parsed.
+  bool ShouldIndex(const std::string &module_name) const;
+
+  // Remembers that module module_name has no usable PDB file, so that
+  // ShouldIndex returns false for it from now on.
+  void AddModuleWithoutPdb(const std::string &module_name);
+
+  // Splits a comma-separated list of patterns, dropping empty ones.
+  static std::vector<std::string> SplitPatterns(const std::string &patterns);
+
+  // Returns true if file_name matches pattern, ignoring case.
+  static bool MatchPattern(const std::string &pattern,
+                           const std::string &file_name);
+
+ private:
+  // Returns true if file_name matches one of patterns.
+  static bool MatchAnyPattern(const std::vector<std::string> &patterns,
+                              const std::string &file_name);
+
+  // Patterns of the modules to index even if they are excluded.
+  std::vector<std::string> include_patterns_;
+
+  // Patterns of the modules to skip.
+  std::vector<std::string> exclude_patterns_;
+
+  // Paths of the modules known to have no usable PDB file.
+  std::unordered_set<std::string> modules_without_pdb_;
+
+  // Mutex protecting the patterns and modules_without_pdb_.
+  mutable std::mutex mutex_;
+};
+
+}  //  namespace google_cloud_debugger
+
+#endif  //  MODULE_FILTER_H_
@@ -0,0 +1,136 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "module_indexer.h"
+
+using google_cloud_debugger_portable_pdb::IPortablePdbFile;
+using std::lock_guard;
+using std::mutex;
+using std::shared_ptr;
+using std::unique_lock;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
+
+namespace google_cloud_debugger {
+
+ModuleIndexer::ModuleIndexer(size_t num_workers,
+                             DocumentPathIndex *document_path_index,
+                             ModuleFilter *module_filter,
+                             std::function<void()> pdb_file_indexed)
+    : num_workers_(num_workers == 0 ? 1 : num_workers),
+      document_path_index_(document_path_index),
+      module_filter_(module_filter),
+      pdb_file_indexed_(std::move(pdb_file_indexed)) {}
+
+ModuleIndexer::~ModuleIndexer() { Shutdown(); }
+
+HRESULT ModuleIndexer::Enqueue(shared_ptr<IPortablePdbFile> pdb_file) {
+  if (!pdb_file) {
+    return E_INVALIDARG;
+  }
+
+  {
+    lock_guard<mutex> lock(mutex_);
+    if (shutting_down_) {
+      return E_ABORT;
+    }
+
+    queue_.push_back(std::move(pdb_file));
+
+    if (workers_.size() < num_workers_) {
+      workers_.push_back(std::thread(&ModuleIndexer::ParsePdbFiles, this));
+    }
+  }
+
+  queue_cv_.notify_one();
+  return S_OK;
+}
+
+void ModuleIndexer::Shutdown() {
+  std::vector<std::thread> workers;
+  {
+    lock_guard<mutex> lock(mutex_);
+    shutting_down_ = true;
+    queue_.clear();
+    workers.swap(workers_);
+  }
+
+  queue_cv_.notify_all();
+  for (auto &&worker : workers) {
+    worker.join();
+  }
+}
+
+std::vector<std::uint64_t> ModuleIndexer::GetParseLatencyHistogram() const {
+  lock_guard<mutex> lock(mutex_);
+  return parse_latency_histogram_;
+}
+
+size_t ModuleIndexer::GetParseLatencyBucket(microseconds parse_time) {
+  size_t bucket = 0;
+  for (auto limit = microseconds(1000);
+       parse_time >= limit && bucket + 1 < kNumParseLatencyBuckets;
+       limit *= 2) {
+    ++bucket;
+  }
+  return bucket;
+}
+
+void ModuleIndexer::ParsePdbFiles() {
+  while (true) {
+    shared_ptr<IPortablePdbFile> pdb_file;
+    {
+      unique_lock<mutex> lock(mutex_);
+      queue_cv_.wait(lock, [this] { return shutting_down_ || !queue_.empty(); });
+      if (shutting_down_) {
+        return;
+      }
+
+      pdb_file = std::move(queue_.front());
+      queue_.pop_front();
+    }
+
+    // The module was unloaded before its turn came.
+    if (pdb_file->IsUnloaded()) {
+      continue;
+    }
+
+    // Modules without a PDB fail here quietly. Later loads of the same
+    // module are not indexed at all.
+    steady_clock::time_point start = steady_clock::now();
+    if (!pdb_file->ParsePdbFile()) {
+      if (module_filter_) {
+        module_filter_->AddModuleWithoutPdb(pdb_file->GetModuleName());
+      }
+      continue;
+    }
+
+    size_t bucket = GetParseLatencyBucket(
+        duration_cast<microseconds>(steady_clock::now() - start));
+    {
+      lock_guard<mutex> lock(mutex_);
+      ++parse_latency_histogram_[bucket];
+    }
+
+    if (document_path_index_) {
+      document_path_index_->AddPdbFile(pdb_file);
+      if (pdb_file_indexed_) {
+        pdb_file_indexed_();
+      }
+    }
+  }
+}
+
+}  // namespace google_cloud_debugger
@@ -0,0 +1,134 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MODULE_INDEXER_H_
+#define MODULE_INDEXER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "document_path_index.h"
+#include "i_portable_pdb_file.h"
+#include "module_filter.h"
+
+namespace google_cloud_debugger {
+
+// A pool of worker threads that parses the Portable PDB files of loaded
+// modules in the background.
+//
+// DebuggerCallback::LoadModule enqueues every new PDB file here so the
+// parsing happens off the callback thread, and most PDB files are already
+// parsed by the time a breakpoint needs them. A caller that needs a PDB file
+// that is still queued or being parsed simply calls ParsePdbFile on it:
+// the call parses the file right away (or waits for the worker that is
+// parsing it) without waiting for any other PDB file.
+//
+// Once parsed, the documents of a PDB file are added to the
+// DocumentPathIndex given to the constructor, if any. Modules whose PDB
+// file cannot be parsed are added to the ModuleFilter given to the
+// constructor, if any, so they are not indexed again. PDB files whose
+// module is unloaded before a worker gets to them are skipped. The
+// pdb_file_indexed callback given to the constructor, if any, is then run
+// on the worker thread, so that breakpoints waiting for the module can be
+// set.
+//
+// The time each PDB file takes to parse is recorded in a histogram, which
+// GetParseLatencyHistogram returns.
+class ModuleIndexer {
+ public:
+  // Number of buckets of the parse latency histogram. Bucket 0 counts the
+  // PDB files parsed in less than 1 ms, and bucket i > 0 the ones parsed in
+  // 2^(i-1) ms to 2^i ms. The last bucket also counts all slower ones.
+  static const size_t kNumParseLatencyBuckets = 16;
+
+  // Creates an indexer with up to num_workers worker threads.
+  // The threads are started by the calls to Enqueue.
+  // document_path_index and module_filter may be null and must outlive
+  // the indexer. pdb_file_indexed is called after each PDB file is added
+  // to document_path_index.
+  ModuleIndexer(size_t num_workers, DocumentPathIndex *document_path_index,
+                ModuleFilter *module_filter,
+                std::function<void()> pdb_file_indexed = nullptr);
+
+  // Stops the worker threads.
+  ~ModuleIndexer();
+
+  // Queues pdb_file to be parsed by one of the worker threads.
+  HRESULT Enqueue(
+      std::shared_ptr<google_cloud_debugger_portable_pdb::IPortablePdbFile>
+          pdb_file);
+
+  // Stops the worker threads and drops the PDB files that are still queued.
+  // Blocks until the PDB files that are being parsed are done.
+  void Shutdown();
+
+  // Returns the parse latency histogram of the PDB files parsed by the
+  // worker threads so far, with kNumParseLatencyBuckets buckets.
+  std::vector<std::uint64_t> GetParseLatencyHistogram() const;
+
+  // Returns the bucket of the parse latency histogram that a PDB file
+  // parsed in parse_time belongs to.
+  static size_t GetParseLatencyBucket(std::chrono::microseconds parse_time);
+
+ private:
+  // Loop run by each worker thread. Parses PDB files from the queue until
+  // the indexer shuts down.
+  void ParsePdbFiles();
+
+  // Maximum number of worker threads.
+  size_t num_workers_;
+
+  // Index the documents of parsed PDB files are added to.
+  DocumentPathIndex *document_path_index_;
+
+  // Filter the modules without a usable PDB file are added to.
+  ModuleFilter *module_filter_;
+
+  // Called after a PDB file is added to document_path_index_.
+  std::function<void()> pdb_file_indexed_;
+
+  // The worker threads.
+  std::vector<std::thread> workers_;
+
+  // PDB files waiting to be parsed.
+  std::deque<
+      std::shared_ptr<google_cloud_debugger_portable_pdb::IPortablePdbFile>>
+      queue_;
+
+  // True if the indexer is shutting down.
+  bool shutting_down_ = false;
+
+  // Number of PDB files parsed in the time range of each bucket.
+  std::vector<std::uint64_t> parse_latency_histogram_ =
+      std::vector<std::uint64_t>(kNumParseLatencyBuckets);
+
+  // Mutex protecting workers_, queue_, shutting_down_ and
+  // parse_latency_histogram_.
+  mutable std::mutex mutex_;
+
+  // Used to wake up the worker threads when a PDB file is queued
+  // or when the indexer shuts down.
+  std::condition_variable queue_cv_;
+};
+
+}  // namespace google_cloud_debugger
+
+#endif  //  MODULE_INDEXER_H_
@@ -0,0 +1,86 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "module_pdb_file.h"
+
+#include <iostream>
+
+#include "i_cor_debug_helper.h"
+#include "string_stream_wrapper.h"
+
+using std::string;
+using std::vector;
+
+namespace google_cloud_debugger_portable_pdb {
+
+HRESULT ModulePdbFile::Initialize(ICorDebugModule *debug_module,
+    google_cloud_debugger::ICorDebugHelper *debug_helper) {
+  if (!debug_module) {
+    return E_INVALIDARG;
+  }
+
+  HRESULT hr = debug_helper->GetMetadataImportFromICorDebugModule(
+      debug_module, &metadata_import_, &std::cerr);
+  if (FAILED(hr)) {
+    return hr;
+  }
+
+  vector<WCHAR> module_name;
+  hr = debug_helper->GetModuleNameFromICorDebugModule(debug_module,
+                                                      &module_name,
+                                                      &std::cerr);
+  if (FAILED(hr)) {
+    return hr;
+  }
+
+  module_name_ = google_cloud_debugger::ConvertWCharPtrToString(module_name);
+  debug_module_ = debug_module;
+
+  pdb_file_ = registry_->GetPdbFile(module_name_);
+  if (!pdb_file_) {
+    return E_OUTOFMEMORY;
+  }
+
+  return S_OK;
+}
+
+HRESULT ModulePdbFile::GetDebugModule(ICorDebugModule **debug_module) const {
+  if (!debug_module) {
+    return E_INVALIDARG;
+  }
+
+  if (debug_module_) {
+    *debug_module = debug_module_;
+    debug_module_->AddRef();
+    return S_OK;
+  }
+  return E_FAIL;
+}
+
+HRESULT ModulePdbFile::GetMetaDataImport(
+    IMetaDataImport **metadata_import) const {
+  if (!metadata_import) {
+    return E_INVALIDARG;
+  }
+
+  if (metadata_import_) {
+    (*metadata_import) = metadata_import_;
+    metadata_import_->AddRef();
+    return S_OK;
+  }
+
+  return E_FAIL;
+}
+
+}  // namespace google_cloud_debugger_portable_pdb
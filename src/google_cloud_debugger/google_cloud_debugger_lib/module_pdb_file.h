@@ -0,0 +1,179 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MODULE_PDB_FILE_H_
+#define MODULE_PDB_FILE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "i_portable_pdb_file.h"
+#include "pdb_index_registry.h"
+#include "portable_pdb_file.h"
+
+namespace google_cloud_debugger_portable_pdb {
+
+// The PDB file of one loaded module.
+//
+// A ModulePdbFile only holds what is specific to its module: the name,
+// the ICorDebugModule, the IMetaDataImport and whether the module has been
+// unloaded. Everything read from the PDB file itself is forwarded to a
+// PortablePdbFile obtained from a PdbIndexRegistry, which is shared with
+// the other modules loaded from the same PDB file, so that the PDB file
+// is parsed and indexed only once.
+//
+// Initialize must succeed before any other method is called.
+class ModulePdbFile : public IPortablePdbFile {
+ public:
+  // Creates a ModulePdbFile that gets its PortablePdbFile from registry,
+  // which must outlive it.
+  explicit ModulePdbFile(PdbIndexRegistry *registry) : registry_(registry) {}
+
+  // Populates the name, metadata import and debug module, and gets the
+  // shared PortablePdbFile of the module from the registry.
+  HRESULT Initialize(ICorDebugModule *debug_module,
+                     google_cloud_debugger::ICorDebugHelper *debug_helper);
+
+  // Parses the shared PortablePdbFile if no other module did already.
+  bool ParsePdbFile() { return pdb_file_->ParsePdbFile(); }
+
+  // Returns true if the pdb file has been parsed.
+  bool IsParsed() const { return pdb_file_->IsParsed(); }
+
+  // Returns true if ParsePdbFile has failed.
+  bool HasFailedToParse() const { return pdb_file_->HasFailedToParse(); }
+
+  // Records that this module has been unloaded. Other modules sharing the
+  // same PortablePdbFile are not affected.
+  void MarkUnloaded() { unloaded_ = true; }
+
+  // Returns true if this module has been unloaded.
+  bool IsUnloaded() const { return unloaded_; }
+
+  bool GetStream(const std::string &name,
+                 StreamHeader *stream_header) const {
+    return pdb_file_->GetStream(name, stream_header);
+  }
+
+  bool GetHeapString(std::uint32_t index, std::string *result) const {
+    return pdb_file_->GetHeapString(index, result);
+  }
+
+  bool GetBlobBytes(std::uint32_t index,
+                    std::vector<uint8_t> *result) const {
+    return pdb_file_->GetBlobBytes(index, result);
+  }
+
+  bool GetDocumentName(std::uint32_t index, std::string *doc_name) const {
+    return pdb_file_->GetDocumentName(index, doc_name);
+  }
+
+  bool GetHeapGuid(std::uint32_t index, std::string *guid) const {
+    return pdb_file_->GetHeapGuid(index, guid);
+  }
+
+  bool GetHash(std::uint32_t index, std::vector<std::uint8_t> *hash) const {
+    return pdb_file_->GetHash(index, hash);
+  }
+
+  bool GetMethodSeqInfo(
+      std::uint32_t doc_index, std::uint32_t sequence_index,
+      MethodSequencePointInformation *sequence_point_info) const {
+    return pdb_file_->GetMethodSeqInfo(doc_index, sequence_index,
+                                       sequence_point_info);
+  }
+
+  const std::vector<DocumentRow> &GetDocumentTable() const {
+    return pdb_file_->GetDocumentTable();
+  }
+
+  const std::vector<LocalScopeRow> &GetLocalScopeTable() const {
+    return pdb_file_->GetLocalScopeTable();
+  }
+
+  const std::vector<LocalVariableRow> &GetLocalVariableTable() const {
+    return pdb_file_->GetLocalVariableTable();
+  }
+
+  const std::vector<MethodDebugInformationRow> &GetMethodDebugInfoTable()
+      const {
+    return pdb_file_->GetMethodDebugInfoTable();
+  }
+
+  const std::vector<LocalConstantRow> &GetLocalConstantTable() const {
+    return pdb_file_->GetLocalConstantTable();
+  }
+
+  const std::vector<std::uint32_t> &GetDocumentMethods(
+      std::uint32_t doc_index) const {
+    return pdb_file_->GetDocumentMethods(doc_index);
+  }
+
+  const std::vector<std::unique_ptr<IDocumentIndex>> &GetDocumentIndexTable()
+      const {
+    return pdb_file_->GetDocumentIndexTable();
+  }
+
+  bool FindMethod(std::uint32_t method_def,
+                  const IDocumentIndex **document_index,
+                  const MethodInfo **method) const {
+    return pdb_file_->FindMethod(method_def, document_index, method);
+  }
+
+  std::size_t GetIndexMemoryUsage() const {
+    return pdb_file_->GetIndexMemoryUsage();
+  }
+
+  // Gets the name of this module.
+  const std::string &GetModuleName() const { return module_name_; }
+
+  // Gets the ICorDebugModule of this module.
+  HRESULT GetDebugModule(ICorDebugModule **debug_module) const;
+
+  // Gets the MetadataImport of this module.
+  HRESULT GetMetaDataImport(IMetaDataImport **metadata_import) const;
+
+  // Returns the PortablePdbFile shared with the other modules loaded from
+  // the same PDB file.
+  const std::shared_ptr<PortablePdbFile> &GetSharedPdbFile() const {
+    return pdb_file_;
+  }
+
+ private:
+  // Registry the shared PortablePdbFile comes from.
+  PdbIndexRegistry *registry_;
+
+  // The parsed PDB file, shared between modules.
+  std::shared_ptr<PortablePdbFile> pdb_file_;
+
+  // Name of this module.
+  std::string module_name_;
+
+  // The ICorDebugModule of this module.
+  google_cloud_debugger::CComPtr<ICorDebugModule> debug_module_;
+
+  // The IMetaDataImport of this module.
+  google_cloud_debugger::CComPtr<IMetaDataImport> metadata_import_;
+
+  // True if this module has been unloaded.
+  std::atomic<bool> unloaded_{false};
+};
+
+}  // namespace google_cloud_debugger_portable_pdb
+
+#endif  // MODULE_PDB_FILE_H_
@@ -0,0 +1,785 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pdb_index_cache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "custom_binary_reader.h"
+#include "document_line_index.h"
+
+using std::array;
+using std::cerr;
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace google_cloud_debugger_portable_pdb {
+
+namespace {
+
+// First and last 4 bytes of a cache file ("GPIX" in little endian).
+const uint32_t kCacheMagic = 0x58495047;
+
+// Version of the cache file layout. Bump this whenever the layout or the
+// content of MethodInfo changes so stale cache files are ignored.
+const uint32_t kCacheVersion = 3;
+
+// Extension of cache files.
+const char kCacheExtension[] = ".pdbidx";
+
+// Strings and byte arrays are padded to a multiple of this many bytes, so
+// that the tables after them are aligned.
+const uint32_t kAlignment = sizeof(uint32_t);
+
+// Size in bytes of the smallest string and document. Used to reject
+// corrupted counts before allocating memory for them.
+const uint32_t kStringSize = sizeof(uint32_t);
+const uint32_t kDocumentSize = 8 * sizeof(uint32_t);
+
+// The tables of a cache file are arrays of the records below, which Load
+// uses in place. They only have 4-byte fields, so they have no padding and
+// can be read at any aligned position of the file.
+
+// A method of a document.
+struct MethodRecord {
+  // Method def, first line and last line of the method.
+  uint32_t method_def;
+  uint32_t first_line;
+  uint32_t last_line;
+
+  // Number of sequence points of the method, and where their encoded bytes
+  // are in the sequence point bytes of the document.
+  uint32_t num_sequence_points;
+  uint32_t sequence_points_offset;
+  uint32_t sequence_points_size;
+
+  // Range of the scopes of the method in the scope table of the document.
+  uint32_t first_scope;
+  uint32_t num_scopes;
+};
+
+// A scope of a method. The fields up to length are those of Scope.
+struct ScopeRecord {
+  uint32_t index;
+  uint32_t local_var_row_start_index;
+  uint32_t local_var_row_end_index;
+  uint32_t local_const_row_start_index;
+  uint32_t local_const_row_end_index;
+  uint32_t start_offset;
+  uint32_t length;
+
+  // Ranges of the locals of the scope in the local variable and local
+  // constant tables of the document.
+  uint32_t first_local_variable;
+  uint32_t num_local_variables;
+  uint32_t first_local_constant;
+  uint32_t num_local_constants;
+};
+
+// A local variable of a scope. The name is an id in the strings of the
+// cache file.
+struct LocalVariableRecord {
+  uint32_t name;
+  uint32_t slot;
+  uint32_t debugger_hidden;
+};
+
+// A local constant of a scope. The name and signature are ids in the
+// strings of the cache file.
+struct LocalConstantRecord {
+  uint32_t name;
+  uint32_t signature_data;
+};
+
+static_assert(sizeof(MethodRecord) == 8 * sizeof(uint32_t),
+              "MethodRecord must not have padding.");
+static_assert(sizeof(ScopeRecord) == 11 * sizeof(uint32_t),
+              "ScopeRecord must not have padding.");
+static_assert(sizeof(LocalVariableRecord) == 3 * sizeof(uint32_t),
+              "LocalVariableRecord must not have padding.");
+static_assert(sizeof(LocalConstantRecord) == 2 * sizeof(uint32_t),
+              "LocalConstantRecord must not have padding.");
+static_assert(sizeof(DocumentLineIndex::MethodEntry) == 6 * sizeof(uint32_t),
+              "DocumentLineIndex::MethodEntry must not have padding.");
+static_assert(
+    sizeof(DocumentLineIndex::SequencePointLine) == 2 * sizeof(uint32_t),
+    "DocumentLineIndex::SequencePointLine must not have padding.");
+static_assert(sizeof(MethodDefTable::Entry) == 3 * sizeof(uint32_t),
+              "MethodDefTable::Entry must not have padding.");
+
+// Returns the number of padding bytes written after size bytes.
+uint32_t PaddingSize(uint32_t size) {
+  return (kAlignment - size % kAlignment) % kAlignment;
+}
+
+// Returns true if [first, first + count) is a range of [0, size).
+bool IsInRange(uint32_t first, uint32_t count, uint32_t size) {
+  return first <= size && count <= size - first;
+}
+
+// Appends the bytes of a cache file to a buffer.
+class CacheWriter {
+ public:
+  void WriteUInt32(uint32_t value) {
+    buffer_.append(reinterpret_cast<const char *>(&value), sizeof(value));
+  }
+
+  void WriteBytes(const uint8_t *bytes, uint32_t size) {
+    buffer_.append(reinterpret_cast<const char *>(bytes), size);
+  }
+
+  // Pads the buffer to a multiple of kAlignment bytes.
+  void WritePadding() { buffer_.append(PaddingSize(buffer_.size()), 0); }
+
+  void WriteString(const string &value) {
+    WriteUInt32(value.size());
+    buffer_.append(value);
+    WritePadding();
+  }
+
+  // Writes count records as they are in memory.
+  template <typename Record>
+  void WriteRecords(const Record *records, uint32_t count) {
+    WriteBytes(reinterpret_cast<const uint8_t *>(records),
+               count * sizeof(Record));
+  }
+
+  void WriteBuffer(const CacheWriter &other) { buffer_.append(other.buffer_); }
+
+  const string &Buffer() const { return buffer_; }
+
+ private:
+  string buffer_;
+};
+
+// Reads the number of elements of a list that follows in binary_stream.
+// Returns false if the rest of the stream cannot hold that many elements
+// of at least element_size bytes.
+bool ReadCount(CustomBinaryStream *binary_stream, uint32_t element_size,
+               uint32_t *count) {
+  if (!binary_stream->ReadUInt32(count)) {
+    return false;
+  }
+
+  return *count <= binary_stream->Remaining() / element_size;
+}
+
+// Moves binary_stream past the padding written after size bytes.
+bool SkipPadding(CustomBinaryStream *binary_stream, uint32_t size) {
+  const uint8_t *padding;
+  return binary_stream->ReadSpan(PaddingSize(size), &padding);
+}
+
+bool ReadString(CustomBinaryStream *binary_stream, string *result) {
+  uint32_t size;
+  const uint8_t *bytes;
+  if (!ReadCount(binary_stream, 1, &size) ||
+      !binary_stream->ReadSpan(size, &bytes) ||
+      !SkipPadding(binary_stream, size)) {
+    return false;
+  }
+
+  result->assign(reinterpret_cast<const char *>(bytes), size);
+  return true;
+}
+
+// Points records at the next count records of binary_stream, without
+// copying them. Since everything before a table is padded and the mapped
+// file starts on a page, the records are aligned.
+template <typename Record>
+bool ReadRecords(CustomBinaryStream *binary_stream, uint32_t count,
+                 const Record **records) {
+  const uint8_t *bytes;
+  if (count > binary_stream->Remaining() / sizeof(Record) ||
+      !binary_stream->ReadSpan(count * sizeof(Record), &bytes)) {
+    return false;
+  }
+
+  *records = reinterpret_cast<const Record *>(bytes);
+  return true;
+}
+
+// Writes a document as:
+//   file path,
+//   number of methods, scopes, local variables, local constants, bytes of
+//   encoded sequence points, line index method entries and line index
+//   sequence point lines,
+//   the MethodRecord of each method, the ScopeRecord of each scope, the
+//   LocalVariableRecord of each local variable, the LocalConstantRecord of
+//   each local constant, the sequence points of all the methods as encoded
+//   by SequencePointList, and the method entries and sequence point lines
+//   of the DocumentLineIndex of the methods.
+// The string ids of document_index are mapped to the strings of the cache
+// file with file_string_pool.
+void WriteDocument(const IDocumentIndex &document_index,
+                   StringPool *file_string_pool, CacheWriter *writer) {
+  const StringPool &string_pool = document_index.GetStringPool();
+  const vector<MethodInfo> &methods = document_index.GetMethods();
+  vector<MethodRecord> method_records;
+  vector<ScopeRecord> scope_records;
+  vector<LocalVariableRecord> variable_records;
+  vector<LocalConstantRecord> constant_records;
+  vector<uint8_t> sequence_point_bytes;
+  method_records.reserve(methods.size());
+  for (const MethodInfo &method : methods) {
+    MethodRecord method_record;
+    method_record.method_def = method.method_def;
+    method_record.first_line = method.first_line;
+    method_record.last_line = method.last_line;
+    method_record.num_sequence_points = method.sequence_points.size();
+    method_record.sequence_points_offset = sequence_point_bytes.size();
+    method_record.sequence_points_size =
+        method.sequence_points.GetEncodedSize();
+    sequence_point_bytes.insert(sequence_point_bytes.end(),
+                                method.sequence_points.GetEncodedData(),
+                                method.sequence_points.GetEncodedData() +
+                                    method.sequence_points.GetEncodedSize());
+    method_record.first_scope = scope_records.size();
+    method_record.num_scopes = method.local_scope.size();
+    method_records.push_back(method_record);
+
+    for (const Scope &scope : method.local_scope) {
+      ScopeRecord scope_record;
+      scope_record.index = scope.index;
+      scope_record.local_var_row_start_index = scope.local_var_row_start_index;
+      scope_record.local_var_row_end_index = scope.local_var_row_end_index;
+      scope_record.local_const_row_start_index =
+          scope.local_const_row_start_index;
+      scope_record.local_const_row_end_index = scope.local_const_row_end_index;
+      scope_record.start_offset = scope.start_offset;
+      scope_record.length = scope.length;
+      scope_record.first_local_variable = variable_records.size();
+      scope_record.num_local_variables = scope.local_variables.size();
+      scope_record.first_local_constant = constant_records.size();
+      scope_record.num_local_constants = scope.local_constants.size();
+      scope_records.push_back(scope_record);
+
+      for (const ScopeLocalVariable &variable : scope.local_variables) {
+        variable_records.push_back(
+            {file_string_pool->Intern(string_pool.Get(variable.name)),
+             variable.slot, variable.debugger_hidden ? 1u : 0u});
+      }
+
+      for (const ScopeLocalConstant &constant : scope.local_constants) {
+        constant_records.push_back(
+            {file_string_pool->Intern(string_pool.Get(constant.name)),
+             file_string_pool->Intern(
+                 string_pool.Get(constant.signature_data))});
+      }
+    }
+  }
+
+  // The line index is cheap to rebuild from the methods, and storing it
+  // saves sorting the sequence points of every method on load.
+  DocumentLineIndex line_index;
+  line_index.Build(methods);
+
+  writer->WriteString(document_index.GetFilePath());
+  writer->WriteUInt32(method_records.size());
+  writer->WriteUInt32(scope_records.size());
+  writer->WriteUInt32(variable_records.size());
+  writer->WriteUInt32(constant_records.size());
+  writer->WriteUInt32(sequence_point_bytes.size());
+  writer->WriteUInt32(line_index.GetMethodEntryCount());
+  writer->WriteUInt32(line_index.GetSequencePointLineCount());
+  writer->WriteRecords(method_records.data(), method_records.size());
+  writer->WriteRecords(scope_records.data(), scope_records.size());
+  writer->WriteRecords(variable_records.data(), variable_records.size());
+  writer->WriteRecords(constant_records.data(), constant_records.size());
+  writer->WriteBytes(sequence_point_bytes.data(), sequence_point_bytes.size());
+  writer->WritePadding();
+  writer->WriteRecords(line_index.GetMethodEntries(),
+                       line_index.GetMethodEntryCount());
+  writer->WriteRecords(line_index.GetSequencePointLines(),
+                       line_index.GetSequencePointLineCount());
+}
+
+// A document index that uses the tables of a document in a cache file in
+// place. The MethodInfo of a method is built from its records the first
+// time it is looked up, and its sequence points are a view of the file.
+// All methods are thread-safe.
+class CachedDocumentIndex : public IDocumentIndex {
+ public:
+  // Creates a document index whose local names and signatures are ids in
+  // string_pool, which holds the strings of the cache file.
+  explicit CachedDocumentIndex(shared_ptr<StringPool> string_pool)
+      : string_pool_(std::move(string_pool)) {}
+
+  // Reads the document written by WriteDocument at the position of
+  // binary_stream. Only the file path is copied: the index keeps a copy
+  // of binary_stream, and with it the file, for its tables.
+  bool Read(CustomBinaryStream *binary_stream);
+
+  // Document indices of a cache file are never initialized from a PDB.
+  bool Initialize(const IPortablePdbFile &pdb, int doc_index) {
+    return false;
+  }
+
+  // Returns the file path of this document.
+  const string &GetFilePath() const { return file_path_; }
+
+  // Returns the interned segments of the file path of this document.
+  const vector<const string *> &GetFilePathSegments() const {
+    return file_path_segments_;
+  }
+
+  // Builds all the methods of this document on the first call.
+  const vector<MethodInfo> &GetMethods() const;
+
+  // Builds the method at position on the first call, unless GetMethods
+  // has built it.
+  const MethodInfo *GetMethod(uint32_t position) const;
+
+  // Finds where a breakpoint at line should be set using line_index_,
+  // which only builds the method it finds.
+  bool FindBreakpointLocation(uint32_t line, const MethodInfo **method,
+                              SequencePoint *sequence_point) const;
+
+  // Returns the string pool of the cache file.
+  const StringPool &GetStringPool() const { return *string_pool_; }
+
+  // Returns an estimate of the number of bytes used by this document
+  // index. The tables in the file are not counted.
+  size_t GetMemoryUsage() const;
+
+ private:
+  // Builds the method at position from its records. Returns false if the
+  // records are corrupted.
+  bool BuildMethod(uint32_t position, MethodInfo *method) const;
+
+  // Copy of the stream of the cache file, which keeps the file mapped.
+  CustomBinaryStream file_;
+
+  // The file path of this document.
+  string file_path_;
+
+  // Segments of file_path_, interned in string_pool_.
+  vector<const string *> file_path_segments_;
+
+  // The tables of this document in the cache file.
+  const MethodRecord *methods_ = nullptr;
+  uint32_t num_methods_ = 0;
+  const ScopeRecord *scopes_ = nullptr;
+  uint32_t num_scopes_ = 0;
+  const LocalVariableRecord *local_variables_ = nullptr;
+  uint32_t num_local_variables_ = 0;
+  const LocalConstantRecord *local_constants_ = nullptr;
+  uint32_t num_local_constants_ = 0;
+  const uint8_t *sequence_point_bytes_ = nullptr;
+  uint32_t num_sequence_point_bytes_ = 0;
+
+  // View of the line index of this document in the cache file.
+  DocumentLineIndex line_index_;
+
+  // The strings of the cache file.
+  shared_ptr<StringPool> string_pool_;
+
+  // Methods built by GetMethod, by position. Empty until the first call.
+  mutable vector<unique_ptr<MethodInfo>> built_methods_;
+
+  // Methods built by GetMethods.
+  mutable vector<MethodInfo> all_methods_;
+
+  // True once GetMethods has built all_methods_.
+  mutable bool all_methods_built_ = false;
+
+  // Mutex protecting built_methods_, all_methods_ and all_methods_built_.
+  mutable std::mutex mutex_;
+};
+
+bool CachedDocumentIndex::Read(CustomBinaryStream *binary_stream) {
+  file_ = *binary_stream;
+
+  uint32_t num_method_entries;
+  uint32_t num_sequence_point_lines;
+  const DocumentLineIndex::MethodEntry *method_entries;
+  const DocumentLineIndex::SequencePointLine *sequence_point_lines;
+  if (!ReadString(binary_stream, &file_path_) ||
+      !binary_stream->ReadUInt32(&num_methods_) ||
+      !binary_stream->ReadUInt32(&num_scopes_) ||
+      !binary_stream->ReadUInt32(&num_local_variables_) ||
+      !binary_stream->ReadUInt32(&num_local_constants_) ||
+      !binary_stream->ReadUInt32(&num_sequence_point_bytes_) ||
+      !binary_stream->ReadUInt32(&num_method_entries) ||
+      !binary_stream->ReadUInt32(&num_sequence_point_lines) ||
+      !ReadRecords(binary_stream, num_methods_, &methods_) ||
+      !ReadRecords(binary_stream, num_scopes_, &scopes_) ||
+      !ReadRecords(binary_stream, num_local_variables_, &local_variables_) ||
+      !ReadRecords(binary_stream, num_local_constants_, &local_constants_) ||
+      !binary_stream->ReadSpan(num_sequence_point_bytes_,
+                               &sequence_point_bytes_) ||
+      !SkipPadding(binary_stream, num_sequence_point_bytes_) ||
+      !ReadRecords(binary_stream, num_method_entries, &method_entries) ||
+      !ReadRecords(binary_stream, num_sequence_point_lines,
+                   &sequence_point_lines)) {
+    return false;
+  }
+
+  file_path_segments_ = InternFilePathSegments(file_path_, string_pool_.get());
+  line_index_.SetView(method_entries, num_method_entries,
+                      sequence_point_lines, num_sequence_point_lines,
+                      num_methods_);
+  return true;
+}
+
+const vector<MethodInfo> &CachedDocumentIndex::GetMethods() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!all_methods_built_) {
+    all_methods_built_ = true;
+    vector<MethodInfo> methods(num_methods_);
+    for (uint32_t position = 0; position < num_methods_; ++position) {
+      if (!BuildMethod(position, &methods[position])) {
+        cerr << "PDB index cache of " << file_path_ << " is corrupted."
+             << std::endl;
+        return all_methods_;
+      }
+    }
+    all_methods_ = std::move(methods);
+  }
+
+  return all_methods_;
+}
+
+const MethodInfo *CachedDocumentIndex::GetMethod(uint32_t position) const {
+  if (position >= num_methods_) {
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Once all the methods are built, we return those so that GetMethod and
+  // GetMethods agree.
+  if (!all_methods_.empty()) {
+    return &all_methods_[position];
+  }
+
+  if (built_methods_.empty()) {
+    built_methods_.resize(num_methods_);
+  }
+
+  unique_ptr<MethodInfo> &method = built_methods_[position];
+  if (!method) {
+    unique_ptr<MethodInfo> built(new (std::nothrow) MethodInfo());
+    if (!built || !BuildMethod(position, built.get())) {
+      cerr << "PDB index cache of " << file_path_ << " is corrupted."
+           << std::endl;
+      return nullptr;
+    }
+    method = std::move(built);
+  }
+
+  return method.get();
+}
+
+bool CachedDocumentIndex::FindBreakpointLocation(
+    uint32_t line, const MethodInfo **method,
+    SequencePoint *sequence_point) const {
+  if (!method || !sequence_point) {
+    return false;
+  }
+
+  uint32_t method_index;
+  uint32_t sequence_point_index;
+  if (!line_index_.FindBreakpointLocation(line, &method_index,
+                                          &sequence_point_index)) {
+    return false;
+  }
+
+  const MethodInfo *found = GetMethod(method_index);
+  if (!found || sequence_point_index >= found->sequence_points.size()) {
+    return false;
+  }
+
+  *method = found;
+  *sequence_point = found->sequence_points.Get(sequence_point_index);
+  return true;
+}
+
+size_t CachedDocumentIndex::GetMemoryUsage() const {
+  size_t usage = sizeof(*this) + file_path_.capacity() +
+                 file_path_segments_.capacity() * sizeof(const string *) +
+                 line_index_.GetMemoryUsage();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  usage += built_methods_.capacity() * sizeof(unique_ptr<MethodInfo>) +
+           all_methods_.capacity() * sizeof(MethodInfo);
+  for (const auto &method : built_methods_) {
+    if (method) {
+      usage += sizeof(MethodInfo) + GetMethodMemoryUsage(*method);
+    }
+  }
+  for (const MethodInfo &method : all_methods_) {
+    usage += GetMethodMemoryUsage(method);
+  }
+  return usage;
+}
+
+bool CachedDocumentIndex::BuildMethod(uint32_t position,
+                                      MethodInfo *method) const {
+  const MethodRecord &record = methods_[position];
+  if (!IsInRange(record.sequence_points_offset, record.sequence_points_size,
+                 num_sequence_point_bytes_) ||
+      !IsInRange(record.first_scope, record.num_scopes, num_scopes_) ||
+      !method->sequence_points.SetEncodedView(
+          record.num_sequence_points,
+          sequence_point_bytes_ + record.sequence_points_offset,
+          record.sequence_points_size)) {
+    return false;
+  }
+
+  method->method_def = record.method_def;
+  method->first_line = record.first_line;
+  method->last_line = record.last_line;
+
+  // The scopes and locals of a method are few, so they are copied into
+  // the usual structures.
+  uint32_t num_strings = string_pool_->Size();
+  method->local_scope.resize(record.num_scopes);
+  for (uint32_t i = 0; i < record.num_scopes; ++i) {
+    const ScopeRecord &scope_record = scopes_[record.first_scope + i];
+    if (!IsInRange(scope_record.first_local_variable,
+                   scope_record.num_local_variables, num_local_variables_) ||
+        !IsInRange(scope_record.first_local_constant,
+                   scope_record.num_local_constants, num_local_constants_)) {
+      return false;
+    }
+
+    Scope &scope = method->local_scope[i];
+    scope.index = scope_record.index;
+    scope.local_var_row_start_index = scope_record.local_var_row_start_index;
+    scope.local_var_row_end_index = scope_record.local_var_row_end_index;
+    scope.local_const_row_start_index =
+        scope_record.local_const_row_start_index;
+    scope.local_const_row_end_index = scope_record.local_const_row_end_index;
+    scope.start_offset = scope_record.start_offset;
+    scope.length = scope_record.length;
+
+    scope.local_variables.resize(scope_record.num_local_variables);
+    for (uint32_t j = 0; j < scope_record.num_local_variables; ++j) {
+      const LocalVariableRecord &variable_record =
+          local_variables_[scope_record.first_local_variable + j];
+      if (variable_record.name >= num_strings ||
+          variable_record.slot > UINT16_MAX) {
+        return false;
+      }
+
+      ScopeLocalVariable &variable = scope.local_variables[j];
+      variable.name = variable_record.name;
+      variable.slot = static_cast<uint16_t>(variable_record.slot);
+      variable.debugger_hidden = variable_record.debugger_hidden != 0;
+    }
+
+    scope.local_constants.resize(scope_record.num_local_constants);
+    for (uint32_t j = 0; j < scope_record.num_local_constants; ++j) {
+      const LocalConstantRecord &constant_record =
+          local_constants_[scope_record.first_local_constant + j];
+      if (constant_record.name >= num_strings ||
+          constant_record.signature_data >= num_strings) {
+        return false;
+      }
+
+      ScopeLocalConstant &constant = scope.local_constants[j];
+      constant.name = constant_record.name;
+      constant.signature_data = constant_record.signature_data;
+    }
+  }
+
+  return true;
+}
+
+}  // namespace
+
+string PdbIndexCache::GetCacheFilePath(const array<uint8_t, 20> &pdb_id) const {
+  static const char kHexDigits[] = "0123456789abcdef";
+
+  string path = directory_;
+  if (!path.empty() && path.back() != '/' && path.back() != '\\') {
+    path += '/';
+  }
+
+  for (uint8_t byte : pdb_id) {
+    path += kHexDigits[byte >> 4];
+    path += kHexDigits[byte & 0xF];
+  }
+
+  return path + kCacheExtension;
+}
+
+bool PdbIndexCache::Load(const array<uint8_t, 20> &pdb_id,
+                         vector<unique_ptr<IDocumentIndex>> *document_indices,
+                         MethodDefTable *method_defs) const {
+  if (!document_indices || !method_defs) {
+    return false;
+  }
+
+  CustomBinaryStream binary_stream;
+  // A missing cache file is the common case on a cold start.
+  if (!binary_stream.ConsumeFile(GetCacheFilePath(pdb_id))) {
+    return false;
+  }
+
+  uint32_t magic;
+  uint32_t version;
+  array<uint8_t, 20> cached_pdb_id;
+  uint32_t bytes_read;
+  if (!binary_stream.ReadUInt32(&magic) || magic != kCacheMagic ||
+      !binary_stream.ReadUInt32(&version) || version != kCacheVersion ||
+      !binary_stream.ReadBytes(cached_pdb_id.data(), cached_pdb_id.size(),
+                               &bytes_read) ||
+      cached_pdb_id != pdb_id) {
+    cerr << "PDB index cache file " << GetCacheFilePath(pdb_id)
+         << " does not match the PDB." << std::endl;
+    return false;
+  }
+
+  // All the documents share one string pool, like the documents of
+  // the PDB file. The strings are the only part of the file we copy.
+  shared_ptr<StringPool> string_pool(new (std::nothrow) StringPool());
+  uint32_t num_strings;
+  if (!string_pool ||
+      !ReadCount(&binary_stream, kStringSize, &num_strings)) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < num_strings; ++i) {
+    string value;
+    if (!ReadString(&binary_stream, &value) ||
+        string_pool->Intern(value) != i) {
+      cerr << "PDB index cache file " << GetCacheFilePath(pdb_id)
+           << " is corrupted." << std::endl;
+      return false;
+    }
+  }
+
+  uint32_t num_documents;
+  if (!ReadCount(&binary_stream, kDocumentSize, &num_documents)) {
+    return false;
+  }
+
+  vector<unique_ptr<IDocumentIndex>> cached_indices;
+  cached_indices.reserve(num_documents);
+  for (uint32_t i = 0; i < num_documents; ++i) {
+    unique_ptr<CachedDocumentIndex> document_index(
+        new (std::nothrow) CachedDocumentIndex(string_pool));
+    if (!document_index) {
+      return false;
+    }
+
+    if (!document_index->Read(&binary_stream)) {
+      cerr << "PDB index cache file " << GetCacheFilePath(pdb_id)
+           << " is corrupted." << std::endl;
+      return false;
+    }
+    cached_indices.push_back(std::move(document_index));
+  }
+
+  uint32_t num_method_defs;
+  const MethodDefTable::Entry *method_def_entries;
+  if (!binary_stream.ReadUInt32(&num_method_defs) ||
+      !ReadRecords(&binary_stream, num_method_defs, &method_def_entries) ||
+      !binary_stream.ReadUInt32(&magic) || magic != kCacheMagic ||
+      binary_stream.HasNext()) {
+    cerr << "PDB index cache file " << GetCacheFilePath(pdb_id)
+         << " is corrupted." << std::endl;
+    return false;
+  }
+
+  // The method def table keeps a stream of its own over the file, in case
+  // it outlives the document indices.
+  shared_ptr<CustomBinaryStream> method_defs_storage(
+      new (std::nothrow) CustomBinaryStream(binary_stream));
+  if (!method_defs_storage) {
+    return false;
+  }
+
+  method_defs->SetView(method_defs_storage, method_def_entries,
+                       num_method_defs);
+  document_indices->swap(cached_indices);
+  return true;
+}
+
+bool PdbIndexCache::Store(
+    const array<uint8_t, 20> &pdb_id,
+    const vector<unique_ptr<IDocumentIndex>> &document_indices) const {
+  // The strings are written before the documents, so we collect them
+  // while writing the documents to a separate buffer.
+  StringPool file_string_pool;
+  CacheWriter documents_writer;
+  documents_writer.WriteUInt32(document_indices.size());
+  for (const auto &document_index : document_indices) {
+    WriteDocument(*document_index, &file_string_pool, &documents_writer);
+  }
+
+  MethodDefTable method_defs;
+  method_defs.Build(document_indices);
+  documents_writer.WriteUInt32(method_defs.GetEntryCount());
+  documents_writer.WriteRecords(method_defs.GetEntries(),
+                                method_defs.GetEntryCount());
+
+  CacheWriter writer;
+  writer.WriteUInt32(kCacheMagic);
+  writer.WriteUInt32(kCacheVersion);
+  writer.WriteBytes(pdb_id.data(), pdb_id.size());
+  writer.WriteUInt32(file_string_pool.Size());
+  for (uint32_t i = 0; i < file_string_pool.Size(); ++i) {
+    writer.WriteString(file_string_pool.Get(i));
+  }
+  writer.WriteBuffer(documents_writer);
+  writer.WriteUInt32(kCacheMagic);
+
+  // Another process may be loading or writing the same cache file, so we
+  // write to a file of our own and rename it in place when it is complete.
+  string cache_file_path = GetCacheFilePath(pdb_id);
+  string temp_file_path =
+      cache_file_path + "." +
+      std::to_string(
+          std::hash<std::thread::id>()(std::this_thread::get_id()) ^
+          std::chrono::steady_clock::now().time_since_epoch().count());
+  {
+    std::ofstream temp_file(temp_file_path,
+                            std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!temp_file) {
+      cerr << "Failed to create PDB index cache file " << temp_file_path
+           << std::endl;
+      return false;
+    }
+
+    temp_file.write(writer.Buffer().data(), writer.Buffer().size());
+    if (!temp_file) {
+      cerr << "Failed to write PDB index cache file " << temp_file_path
+           << std::endl;
+      temp_file.close();
+      std::remove(temp_file_path.c_str());
+      return false;
+    }
+  }
+
+  // On Windows, rename fails if the cache file exists, which means another
+  // process already wrote the same content.
+  if (std::rename(temp_file_path.c_str(), cache_file_path.c_str()) != 0) {
+    std::remove(temp_file_path.c_str());
+  }
+
+  return true;
+}
+
+}  // namespace google_cloud_debugger_portable_pdb
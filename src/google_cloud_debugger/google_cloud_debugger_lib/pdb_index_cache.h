@@ -0,0 +1,93 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PDB_INDEX_CACHE_H_
+#define PDB_INDEX_CACHE_H_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "document_index.h"
+#include "method_def_table.h"
+
+namespace google_cloud_debugger_portable_pdb {
+
+// On-disk cache of the document indices built from Portable PDB files.
+//
+// Building the document indices of a large PDB means decoding every
+// metadata table row and sequence point blob in it. Since a PDB never
+// changes once it is built, we store a snapshot of its document indices
+// (file paths, methods, sequence points, scopes, local variables and
+// constants) in a cache file named after the PDB id of the #Pdb stream.
+// Later runs, including other debugger processes on the same machine,
+// map the cache file read-only instead of decoding the PDB.
+//
+// The methods, scopes, locals, sequence points and line indices of the
+// documents and the method def table of the PDB are stored as fixed-size
+// records that the loaded indices read in place, so Load neither copies
+// nor decodes them, and the processes that load the same cache file share
+// its pages. The MethodInfo of a method is only built from its records the
+// first time it is looked up, with its sequence points still in the file.
+// Only the strings are copied into a StringPool, since they are few.
+//
+// Cache files are written to a temporary file that is then renamed, so
+// readers never see a partially written cache. A cache file is only used
+// if its format version and PDB id match; otherwise Load returns false and
+// the caller should build the document indices from the PDB.
+//
+// The layout of a cache file is (all integers are 4-byte in host byte
+// order):
+//   magic, format version, PDB id (20 bytes),
+//   number of strings, then the strings of the string pool shared by the
+//   documents,
+//   number of documents, then for each document its file path and tables,
+//   number of methods, then the entries of the MethodDefTable of the PDB,
+//   then magic again to detect truncated files.
+// Strings are written as their length followed by the bytes. Strings and
+// byte arrays are padded to a multiple of 4 bytes, so that every table is
+// aligned in the mapped file. See pdb_index_cache.cc for the tables of a
+// document.
+class PdbIndexCache {
+ public:
+  // Creates a cache that stores its files in directory.
+  explicit PdbIndexCache(const std::string &directory)
+      : directory_(directory) {}
+
+  // Returns the path of the cache file for the PDB with id pdb_id.
+  std::string GetCacheFilePath(const std::array<std::uint8_t, 20> &pdb_id) const;
+
+  // Loads the document indices and the method def table of the PDB with
+  // id pdb_id from its cache file into document_indices and method_defs,
+  // which keep the file mapped as long as they are alive. Returns false,
+  // without touching them, if there is no valid cache file for pdb_id.
+  bool Load(const std::array<std::uint8_t, 20> &pdb_id,
+            std::vector<std::unique_ptr<IDocumentIndex>> *document_indices,
+            MethodDefTable *method_defs) const;
+
+  // Writes document_indices to the cache file of the PDB with id pdb_id.
+  bool Store(const std::array<std::uint8_t, 20> &pdb_id,
+             const std::vector<std::unique_ptr<IDocumentIndex>>
+                 &document_indices) const;
+
+ private:
+  // Directory containing the cache files.
+  std::string directory_;
+};
+
+}  // namespace google_cloud_debugger_portable_pdb
+
+#endif  // PDB_INDEX_CACHE_H_
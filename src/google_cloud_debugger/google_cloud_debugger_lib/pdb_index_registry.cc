@@ -0,0 +1,100 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pdb_index_registry.h"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+using std::lock_guard;
+using std::mutex;
+using std::shared_ptr;
+using std::string;
+
+namespace google_cloud_debugger_portable_pdb {
+
+shared_ptr<PortablePdbFile> PdbIndexRegistry::GetPdbFile(
+    const string &module_name) {
+  // A PDB file we cannot stat fails to parse anyway, so there is nothing
+  // worth sharing.
+  string pdb_file_path;
+  struct stat pdb_file_stat;
+  bool shareable =
+      PortablePdbFile::GetPdbFilePath(module_name, &pdb_file_path) &&
+      stat(pdb_file_path.c_str(), &pdb_file_stat) == 0;
+
+  lock_guard<mutex> lock(mutex_);
+  PdbFileKey key;
+  if (shareable) {
+    key = PdbFileKey(pdb_file_path, pdb_file_stat.st_size,
+                     pdb_file_stat.st_mtime);
+    auto pdb_file_it = pdb_files_.find(key);
+    if (pdb_file_it != pdb_files_.end()) {
+      shared_ptr<PortablePdbFile> pdb_file = pdb_file_it->second.lock();
+      if (pdb_file) {
+        return pdb_file;
+      }
+    }
+  }
+
+  shared_ptr<PortablePdbFile> pdb_file(new (std::nothrow) PortablePdbFile());
+  if (!pdb_file) {
+    return nullptr;
+  }
+
+  pdb_file->SetModuleName(module_name);
+  pdb_file->SetIndexCacheDirectory(index_cache_directory_);
+  if (!shareable) {
+    return pdb_file;
+  }
+
+  pdb_files_[key] = pdb_file;
+  // Sweeping once the map has had as many insertions as it has entries
+  // keeps it proportional to the number of loaded PDB files, at an
+  // amortized constant cost per load.
+  if (++added_since_cleanup_ >= pdb_files_.size()) {
+    RemoveExpiredPdbFiles();
+  }
+  return pdb_file;
+}
+
+void PdbIndexRegistry::SetIndexCacheDirectory(const string &directory) {
+  lock_guard<mutex> lock(mutex_);
+  index_cache_directory_ = directory;
+}
+
+size_t PdbIndexRegistry::GetPdbFileCount() const {
+  lock_guard<mutex> lock(mutex_);
+  size_t count = 0;
+  for (const auto &pdb_file : pdb_files_) {
+    if (!pdb_file.second.expired()) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+void PdbIndexRegistry::RemoveExpiredPdbFiles() {
+  for (auto pdb_file_it = pdb_files_.begin();
+       pdb_file_it != pdb_files_.end();) {
+    if (pdb_file_it->second.expired()) {
+      pdb_file_it = pdb_files_.erase(pdb_file_it);
+    } else {
+      ++pdb_file_it;
+    }
+  }
+  added_since_cleanup_ = 0;
+}
+
+}  // namespace google_cloud_debugger_portable_pdb
@@ -0,0 +1,81 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PDB_INDEX_REGISTRY_H_
+#define PDB_INDEX_REGISTRY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+#include "portable_pdb_file.h"
+
+namespace google_cloud_debugger_portable_pdb {
+
+// Registry of the parsed PDB files of the loaded modules.
+//
+// The same assembly can be loaded more than once, for example into several
+// load contexts or when a test host reloads it. Rather than parsing the
+// same PDB file once per module, the registry hands out one
+// PortablePdbFile per PDB file, identified by its path, size and last
+// modification time. Each module binds its ICorDebugModule and
+// IMetaDataImport to the shared PortablePdbFile through a ModulePdbFile.
+//
+// The registry only holds weak references: a PortablePdbFile is freed
+// once the last module using it is unloaded, and a PDB file that was
+// rebuilt in between gets a new PortablePdbFile.
+//
+// All methods are thread-safe.
+class PdbIndexRegistry {
+ public:
+  // Returns the PortablePdbFile of the PDB file of module module_name,
+  // which is the path of the module. The PortablePdbFile is shared with
+  // every other module loaded from the same PDB file and may already be
+  // parsed. Returns nullptr if we run out of memory.
+  std::shared_ptr<PortablePdbFile> GetPdbFile(const std::string &module_name);
+
+  // Sets the directory of the PdbIndexCache of the PortablePdbFile objects
+  // created from now on. See PortablePdbFile::SetIndexCacheDirectory.
+  void SetIndexCacheDirectory(const std::string &directory);
+
+  // Returns the number of PDB files that are in use by some module.
+  std::size_t GetPdbFileCount() const;
+
+ private:
+  // Path, size and last modification time of a PDB file.
+  typedef std::tuple<std::string, std::int64_t, std::int64_t> PdbFileKey;
+
+  // Removes the PDB files that are no longer used by any module.
+  void RemoveExpiredPdbFiles();
+
+  // PortablePdbFile objects handed out, by PDB file.
+  std::map<PdbFileKey, std::weak_ptr<PortablePdbFile>> pdb_files_;
+
+  // Number of PDB files added since RemoveExpiredPdbFiles last ran.
+  std::size_t added_since_cleanup_ = 0;
+
+  // Directory of the PdbIndexCache. Empty if caching is disabled.
+  std::string index_cache_directory_;
+
+  // Mutex protecting the members above.
+  mutable std::mutex mutex_;
+};
+
+}  // namespace google_cloud_debugger_portable_pdb
+
+#endif  // PDB_INDEX_REGISTRY_H_
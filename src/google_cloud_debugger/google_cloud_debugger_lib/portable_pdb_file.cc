@@ -19,16 +19,22 @@
 #include <array>
 #include <iostream>
 #include <memory>
+#include <thread>
+#include <unordered_set>
 
 #include "constants.h"
 #include "custom_binary_reader.h"
 #include "dbg_object.h"
 #include "i_cor_debug_helper.h"
+#include "indexing_thread_pool.h"
 #include "metadata_headers.h"
 #include "metadata_tables.h"
+#include "pdb_index_cache.h"
 
 using google_cloud_debugger::CComPtr;
 using google_cloud_debugger::kDllExtension;
+using google_cloud_debugger::kMaxPdbIndexingThreads;
+using google_cloud_debugger::kMethodsPerIndexingTask;
 using google_cloud_debugger::kPdbExtension;
 using std::array;
 using std::streampos;
@@ -78,16 +84,54 @@ bool PortablePdbFile::ParsePdbFile() {
     return true;
   }
 
-  string module_name = GetModuleName();
-  size_t last_dll_extension_pos = module_name.rfind(kDllExtension);
-  if (last_dll_extension_pos != module_name.size() - kDllExtension.size()) {
+  if (failed_to_parse_) {
     return false;
   }
 
-  module_name.replace(last_dll_extension_pos, kDllExtension.size(),
-                      kPdbExtension);
+  std::lock_guard<std::mutex> lock(parse_mutex_);
+  // Another thread may have parsed the file (or failed to) while we were
+  // waiting.
+  if (parsed) {
+    return true;
+  }
+
+  if (failed_to_parse_) {
+    return false;
+  }
+
+  // The PDB file does not change while the module is loaded, so there is
+  // no point in trying again if this fails.
+  if (!ReadPdbFile()) {
+    failed_to_parse_ = true;
+    return false;
+  }
 
-  if (!pdb_file_binary_stream_.ConsumeFile(module_name)) {
+  parsed = true;
+  return true;
+}
+
+bool PortablePdbFile::GetPdbFilePath(const string &module_name,
+                                     string *pdb_file_path) {
+  if (module_name.size() < kDllExtension.size() ||
+      module_name.compare(module_name.size() - kDllExtension.size(),
+                          kDllExtension.size(), kDllExtension) != 0) {
+    return false;
+  }
+
+  *pdb_file_path = module_name;
+  pdb_file_path->replace(module_name.size() - kDllExtension.size(),
+                         kDllExtension.size(), kPdbExtension);
+  return true;
+}
+
+bool PortablePdbFile::ReadPdbFile() {
+  string pdb_file_path;
+  if (!GetPdbFilePath(GetModuleName(), &pdb_file_path)) {
+    return false;
+  }
+
+  if (!pdb_file_binary_stream_.ConsumeFile(pdb_file_path,
+                                           memory_map_pdb_file_)) {
     return false;
   }
 
@@ -110,57 +154,244 @@ bool PortablePdbFile::ParsePdbFile() {
     return false;
   }
 
-  if (!ParseCompressedMetadataTableStream() || !ParsePortablePdbStream()) {
+  if (!ParsePortablePdbStream()) {
     return false;
   }
 
-  if (document_table_.size() > 1) {
-    document_indices_.reserve(document_table_.size() - 1);
-    for (size_t i = 1; i < document_table_.size(); ++i) {
-      unique_ptr<DocumentIndex> document_index(new (std::nothrow)
-                                                   DocumentIndex());
-      if (!document_index || !document_index->Initialize(*this, i)) {
-        return false;
-      }
-      document_indices_.push_back(std::move(document_index));
+  // If an earlier run cached the document indices of this PDB, we do not
+  // need the metadata tables at all.
+  if (!index_cache_directory_.empty()) {
+    PdbIndexCache index_cache(index_cache_directory_);
+    if (index_cache.Load(pdb_metadata_header_.pdb_id, &document_indices_,
+                         &method_defs_)) {
+      return true;
     }
   }
 
-  parsed = true;
+  if (!ParseCompressedMetadataTableStream()) {
+    return false;
+  }
+
+  GroupMethodsByDocument();
+
+  if (!DecodeDocumentNameParts() || !IndexDocuments()) {
+    return false;
+  }
+
+  if (!index_cache_directory_.empty()) {
+    PdbIndexCache index_cache(index_cache_directory_);
+    index_cache.Store(pdb_metadata_header_.pdb_id, document_indices_);
+  }
+
+  method_defs_.Build(document_indices_);
   return true;
 }
 
+bool PortablePdbFile::IndexDocuments() {
+  if (document_table_.size() <= 1) {
+    return true;
+  }
+
+  // Local names repeat a lot across the methods of a module, so all the
+  // documents intern them in the same pool.
+  std::shared_ptr<StringPool> string_pool(new (std::nothrow) StringPool());
+  if (!string_pool) {
+    return false;
+  }
+
+  // Methods [first, last) of a document, decoded by one task.
+  struct MethodRange {
+    DocumentIndex *document_index;
+    size_t first;
+    size_t last;
+  };
+
+  vector<unique_ptr<IDocumentIndex>> document_indices;
+  vector<DocumentIndex *> documents;
+  vector<MethodRange> method_ranges;
+  document_indices.reserve(document_table_.size() - 1);
+  documents.reserve(document_table_.size() - 1);
+  for (size_t i = 1; i < document_table_.size(); ++i) {
+    unique_ptr<DocumentIndex> document_index(
+        new (std::nothrow) DocumentIndex(string_pool));
+    if (!document_index || !document_index->BeginInitialize(*this, i)) {
+      return false;
+    }
+
+    size_t method_count = document_index->GetMethods().size();
+    for (size_t first = 0; first < method_count;
+         first += kMethodsPerIndexingTask) {
+      size_t last = std::min<size_t>(first + kMethodsPerIndexingTask,
+                                     method_count);
+      method_ranges.push_back({document_index.get(), first, last});
+    }
+
+    documents.push_back(document_index.get());
+    document_indices.push_back(std::move(document_index));
+  }
+
+  size_t threads = indexing_threads_;
+  if (threads == 0) {
+    threads = std::min<size_t>(std::thread::hardware_concurrency(),
+                               kMaxPdbIndexingThreads);
+  }
+
+  // The sequence point blobs of the methods are independent and each
+  // DocumentIndex::ParseMethods call reads the PDB through cursors of its
+  // own, so the ranges can be decoded in any order on any thread. The
+  // threads of the shared pool help the other PDB files that are parsed
+  // at the same time once they are done with ours.
+  IndexingThreadPool &thread_pool = IndexingThreadPool::GetShared();
+  bool decoded = thread_pool.Run(
+      method_ranges.size(), threads, [this, &method_ranges](size_t task) {
+        const MethodRange &range = method_ranges[task];
+        return range.document_index->ParseMethods(*this, range.first,
+                                                  range.last);
+      });
+  if (!decoded) {
+    return false;
+  }
+
+  thread_pool.Run(documents.size(), threads, [&documents](size_t task) {
+    documents[task]->EndInitialize();
+    return true;
+  });
+
+  document_indices_ = std::move(document_indices);
+  return true;
+}
+
+bool PortablePdbFile::FindMethod(uint32_t method_def,
+                                 const IDocumentIndex **document_index,
+                                 const MethodInfo **method) const {
+  if (!document_index || !method) {
+    return false;
+  }
+
+  // The entries of a table loaded from a cache file are not checked, so a
+  // corrupted one can point anywhere.
+  uint32_t document;
+  uint32_t position;
+  if (!method_defs_.Find(method_def, &document, &position) ||
+      document >= document_indices_.size()) {
+    return false;
+  }
+
+  const MethodInfo *found = document_indices_[document]->GetMethod(position);
+  if (!found || found->method_def != method_def) {
+    return false;
+  }
+
+  *document_index = document_indices_[document].get();
+  *method = found;
+  return true;
+}
+
+size_t PortablePdbFile::GetIndexMemoryUsage() const {
+  size_t usage =
+      document_indices_.capacity() * sizeof(unique_ptr<IDocumentIndex>) +
+      method_defs_.GetMemoryUsage();
+  std::unordered_set<const StringPool *> string_pools;
+  for (const auto &document_index : document_indices_) {
+    usage += document_index->GetMemoryUsage();
+    const StringPool &string_pool = document_index->GetStringPool();
+    if (string_pools.insert(&string_pool).second) {
+      usage += string_pool.GetMemoryUsage();
+    }
+  }
+  return usage;
+}
+
+void PortablePdbFile::GroupMethodsByDocument() {
+  document_methods_.clear();
+  document_methods_.resize(document_table_.size());
+
+  // We rely on the 1:1 mapping between the Method and MethodDebugInfo tables.
+  for (uint32_t method_def = 1; method_def < method_debug_info_table_.size();
+       ++method_def) {
+    uint32_t document = method_debug_info_table_[method_def].document;
+    // Pedantically we are ignoring methods that span multiple files.
+    if (document == 0 || document >= document_methods_.size()) {
+      continue;
+    }
+
+    document_methods_[document].push_back(method_def);
+  }
+}
+
+const vector<uint32_t> &PortablePdbFile::GetDocumentMethods(
+    uint32_t doc_index) const {
+  static const vector<uint32_t> kNoMethods;
+  if (doc_index >= document_methods_.size()) {
+    return kNoMethods;
+  }
+
+  return document_methods_[doc_index];
+}
+
 bool PortablePdbFile::InitializeBlobHeap() {
   static const string kBlobHeapName = "#Blob";
   return GetStream(kBlobHeapName, &blob_heap_header_);
 }
 
 bool PortablePdbFile::GetDocumentName(uint32_t index, string *doc_name) const {
+  uint8_t separator;
+  vector<uint32_t> part_indices;
+  if (!ReadDocumentNamePartIndices(index, &separator, &part_indices)) {
+    return false;
+  }
+
+  // The parts of the documents of this PDB were decoded while parsing.
+  string result;
+  for (uint32_t part_index : part_indices) {
+    // 0 means empty string.
+    if (part_index != 0) {
+      auto part = document_name_parts_.find(part_index);
+      if (part != document_name_parts_.end()) {
+        result += part->second;
+      } else {
+        string part_string;
+        if (!ReadDocumentNamePart(part_index, &part_string)) {
+          return false;
+        }
+        result += part_string;
+      }
+    }
+
+    result += separator;
+  }
+
+  result.pop_back();
+  *doc_name = std::move(result);
+
+  return true;
+}
+
+bool PortablePdbFile::ReadDocumentNamePartIndices(
+    uint32_t index, uint8_t *separator, vector<uint32_t> *part_indices) const {
   if (index == 0) {
     return false;
   }
 
-  pdb_file_binary_stream_.SeekFromOrigin(blob_heap_header_.offset + index);
+  CustomBinaryStream binary_stream = pdb_file_binary_stream_;
+  if (!binary_stream.SeekFromOrigin(blob_heap_header_.offset + index)) {
+    return false;
+  }
+
   uint32_t index_stream_length;
-  if (!pdb_file_binary_stream_.ReadCompressedUInt32(&index_stream_length)) {
+  if (!binary_stream.ReadCompressedUInt32(&index_stream_length)) {
     return false;
   }
 
-  if (!pdb_file_binary_stream_.SetStreamLength(index_stream_length)) {
+  if (!binary_stream.SetStreamLength(index_stream_length)) {
     std::cerr << "Failed to set stream length to " << index_stream_length;
     return false;
   }
 
-  uint8_t separator;
-  if (!pdb_file_binary_stream_.ReadByte(&separator)) {
-    pdb_file_binary_stream_.ResetStreamLength();
+  if (!binary_stream.ReadByte(separator)) {
     return false;
   }
 
-  string result;
-  // Vector containing index into blob heaps of the components of the document
-  // name.
-  vector<uint32_t> part_indices;
   // We essentially have 2 streams, 1 for reading the index of the
   // components of the document name and 1 for getting the components itself.
   // The first stream is of the form "(separator) (part_index)+", which is a
@@ -169,56 +400,74 @@ bool PortablePdbFile::GetDocumentName(uint32_t index, string *doc_name) const {
   // index, we can extract out the part string.
   // The document name is a concatenation of the parts separated by the
   // separator.
-  while (pdb_file_binary_stream_.HasNext()) {
+  part_indices->clear();
+  while (binary_stream.HasNext()) {
     uint32_t part_index;
-    if (!pdb_file_binary_stream_.ReadCompressedUInt32(&part_index)) {
-      pdb_file_binary_stream_.ResetStreamLength();
+    if (!binary_stream.ReadCompressedUInt32(&part_index)) {
       return false;
     }
-    part_indices.push_back(part_index);
+    part_indices->push_back(part_index);
   }
 
-  // Now we retrieves the components using part_indices.
-  pdb_file_binary_stream_.ResetStreamLength();
-  for (uint32_t part_index : part_indices) {
-    // 0 means empty string.
-    if (part_index != 0) {
-      if (!pdb_file_binary_stream_.SeekFromOrigin(blob_heap_header_.offset +
-                                                  part_index)) {
-        return false;
-      }
+  return true;
+}
 
-      uint32_t component_string_length;
-      if (!pdb_file_binary_stream_.ReadCompressedUInt32(
-              &component_string_length)) {
-        return false;
+bool PortablePdbFile::ReadDocumentNamePart(uint32_t part_index,
+                                           string *part) const {
+  CustomBinaryStream binary_stream = pdb_file_binary_stream_;
+  if (!binary_stream.SeekFromOrigin(blob_heap_header_.offset + part_index)) {
+    return false;
+  }
+
+  uint32_t part_length;
+  if (!binary_stream.ReadCompressedUInt32(&part_length)) {
+    return false;
+  }
+
+  string part_string(part_length, '\0');
+  uint32_t bytes_read;
+  if (!binary_stream.ReadBytes(reinterpret_cast<uint8_t *>(&part_string[0]),
+                               part_length, &bytes_read)) {
+    return false;
+  }
+
+  *part = std::move(part_string);
+  return true;
+}
+
+bool PortablePdbFile::DecodeDocumentNameParts() {
+  document_name_parts_.clear();
+  uint8_t separator;
+  vector<uint32_t> part_indices;
+  for (size_t i = 1; i < document_table_.size(); ++i) {
+    if (!ReadDocumentNamePartIndices(document_table_[i].name, &separator,
+                                     &part_indices)) {
+      return false;
+    }
+
+    for (uint32_t part_index : part_indices) {
+      if (part_index == 0 || document_name_parts_.find(part_index) !=
+                                 document_name_parts_.end()) {
+        continue;
       }
 
-      uint32_t bytes_read;
-      vector<uint8_t> component_string(component_string_length, 0);
-      if (!pdb_file_binary_stream_.ReadBytes(
-              component_string.data(), component_string_length, &bytes_read)) {
+      string part;
+      if (!ReadDocumentNamePart(part_index, &part)) {
         return false;
       }
-
-      result.append(component_string.begin(), component_string.end());
+      document_name_parts_.emplace(part_index, std::move(part));
     }
-
-    result += separator;
   }
 
-  result.pop_back();
-  *doc_name = result;
-
   return true;
 }
 
 bool PortablePdbFile::GetHeapGuid(uint32_t index, string *guid) const {
+  CustomBinaryStream binary_stream = pdb_file_binary_stream_;
   // GUID are 16 bytes. Index is 1-based so we have to minus 1.
   uint32_t offset = (index - 1) * 16;
 
-  if (!pdb_file_binary_stream_.SeekFromOrigin(guid_heap_header_.offset +
-                                              offset)) {
+  if (!binary_stream.SeekFromOrigin(guid_heap_header_.offset + offset)) {
     return false;
   }
 
@@ -226,8 +475,8 @@ bool PortablePdbFile::GetHeapGuid(uint32_t index, string *guid) const {
   vector<uint8_t> bytes_read(16, 0);
   uint32_t num_bytes_read;
 
-  if (!pdb_file_binary_stream_.ReadBytes(bytes_read.data(), bytes_read.size(),
-                                         &num_bytes_read)) {
+  if (!binary_stream.ReadBytes(bytes_read.data(), bytes_read.size(),
+                               &num_bytes_read)) {
     std::cerr << "Failed to read from GUID heap.";
     return false;
   }
@@ -237,20 +486,19 @@ bool PortablePdbFile::GetHeapGuid(uint32_t index, string *guid) const {
 }
 
 bool PortablePdbFile::GetHash(uint32_t index, vector<uint8_t> *hash) const {
-  if (!pdb_file_binary_stream_.SeekFromOrigin(blob_heap_header_.offset +
-                                              index)) {
+  CustomBinaryStream binary_stream = pdb_file_binary_stream_;
+  if (!binary_stream.SeekFromOrigin(blob_heap_header_.offset + index)) {
     return false;
   }
 
   uint32_t data_length;
-  if (!pdb_file_binary_stream_.ReadCompressedUInt32(&data_length)) {
+  if (!binary_stream.ReadCompressedUInt32(&data_length)) {
     return false;
   }
 
   hash->resize(data_length);
   uint32_t bytes_read = 0;
-  if (!pdb_file_binary_stream_.ReadBytes(hash->data(), hash->size(),
-                                         &bytes_read)) {
+  if (!binary_stream.ReadBytes(hash->data(), hash->size(), &bytes_read)) {
     std::cerr << "Failed to read the hash from the heap blob stream.";
     return false;
   }
@@ -261,24 +509,22 @@ bool PortablePdbFile::GetHash(uint32_t index, vector<uint8_t> *hash) const {
 bool PortablePdbFile::GetMethodSeqInfo(
     uint32_t doc_index, uint32_t sequence_index,
     MethodSequencePointInformation *sequence_point_info) const {
-  if (!pdb_file_binary_stream_.SeekFromOrigin(blob_heap_header_.offset +
-                                              sequence_index)) {
+  CustomBinaryStream binary_stream = pdb_file_binary_stream_;
+  if (!binary_stream.SeekFromOrigin(blob_heap_header_.offset +
+                                    sequence_index)) {
     return false;
   }
 
   uint32_t data_length;
-  if (!pdb_file_binary_stream_.ReadCompressedUInt32(&data_length)) {
+  if (!binary_stream.ReadCompressedUInt32(&data_length)) {
     return false;
   }
 
-  if (!pdb_file_binary_stream_.SetStreamLength(data_length)) {
+  if (!binary_stream.SetStreamLength(data_length)) {
     return false;
   }
 
-  bool result =
-      ParseFrom(doc_index, &pdb_file_binary_stream_, sequence_point_info);
-  pdb_file_binary_stream_.ResetStreamLength();
-  return result;
+  return ParseFrom(doc_index, &binary_stream, sequence_point_info);
 }
 
 bool PortablePdbFile::InitializeGuidHeap() {
@@ -345,44 +591,44 @@ bool PortablePdbFile::ParseCompressedMetadataTableStream() {
   }
 
   // Confirm the PDB only contains PDB-related metadata tables.
-  for (size_t i = 0; i < rows_per_table[MetadataTable::Document]; i++) {
+  for (size_t i = 0; i < MetadataTable::Document; i++) {
     if (rows_per_table[i] != 0) {
       pdb_file_binary_stream_.ResetStreamLength();
       return false;
     }
   }
 
-  if (!ParseMetadataTableRow<DocumentRow>(
-          rows_per_table[MetadataTable::Document], &pdb_file_binary_stream_,
-          &document_table_)) {
+  if (!ParseTable(&pdb_file_binary_stream_, metadata_table_header_,
+                  rows_per_table[MetadataTable::Document],
+                  &document_table_)) {
     pdb_file_binary_stream_.ResetStreamLength();
     return false;
   }
 
-  if (!ParseMetadataTableRow<MethodDebugInformationRow>(
-          rows_per_table[MetadataTable::MethodDebugInformation],
-          &pdb_file_binary_stream_, &method_debug_info_table_)) {
+  if (!ParseTable(&pdb_file_binary_stream_, metadata_table_header_,
+                  rows_per_table[MetadataTable::MethodDebugInformation],
+                  &method_debug_info_table_)) {
     pdb_file_binary_stream_.ResetStreamLength();
     return false;
   }
 
-  if (!ParseMetadataTableRow<LocalScopeRow>(
-          rows_per_table[MetadataTable::LocalScope], &pdb_file_binary_stream_,
-          &local_scope_table_)) {
+  if (!ParseTable(&pdb_file_binary_stream_, metadata_table_header_,
+                  rows_per_table[MetadataTable::LocalScope],
+                  &local_scope_table_)) {
     pdb_file_binary_stream_.ResetStreamLength();
     return false;
   }
 
-  if (!ParseMetadataTableRow<LocalVariableRow>(
-          rows_per_table[MetadataTable::LocalVariable],
-          &pdb_file_binary_stream_, &local_variable_table_)) {
+  if (!ParseTable(&pdb_file_binary_stream_, metadata_table_header_,
+                  rows_per_table[MetadataTable::LocalVariable],
+                  &local_variable_table_)) {
     pdb_file_binary_stream_.ResetStreamLength();
     return false;
   }
 
-  if (!ParseMetadataTableRow<LocalConstantRow>(
-          rows_per_table[MetadataTable::LocalConstant],
-          &pdb_file_binary_stream_, &local_constant_table_)) {
+  if (!ParseTable(&pdb_file_binary_stream_, metadata_table_header_,
+                  rows_per_table[MetadataTable::LocalConstant],
+                  &local_constant_table_)) {
     pdb_file_binary_stream_.ResetStreamLength();
     return false;
   }
@@ -15,13 +15,18 @@
 #ifndef PORTABLE_PDB_H_
 #define PORTABLE_PDB_H_
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "custom_binary_reader.h"
 #include "i_portable_pdb_file.h"
 #include "metadata_headers.h"
+#include "method_def_table.h"
 
 namespace google_cloud_debugger_portable_pdb {
 
@@ -37,6 +42,11 @@ namespace google_cloud_debugger_portable_pdb {
 // To use this class, creates a PortablePdbFile object and calls Initialize
 // with an ICorDebugModule object. Then, calls the ParsePdb method to parse
 // the PDB file for the module.
+//
+// The debugger itself does not bind PortablePdbFile objects to modules:
+// it gets them from a PdbIndexRegistry, which shares one parsed PDB file
+// between all the modules loaded from the same assembly, and binds each
+// module through a ModulePdbFile.
 class PortablePdbFile : public IPortablePdbFile {
  public:
   // Populates the name, metadata import and debug module.
@@ -47,8 +57,45 @@ class PortablePdbFile : public IPortablePdbFile {
 
   // Parses the pdb file. The name of the file will come from the
   // ICorDebugModule object that is used to initialize this object.
+  // If another thread is already parsing the file, waits for it to finish.
   bool ParsePdbFile();
 
+  // Returns true if the pdb file has been parsed.
+  bool IsParsed() const { return parsed; }
+
+  // Returns true if ParsePdbFile has failed. ParsePdbFile does not try
+  // again after a failure.
+  bool HasFailedToParse() const { return failed_to_parse_; }
+
+  // Records that the module of the pdb file has been unloaded.
+  void MarkUnloaded() { unloaded_ = true; }
+
+  // Returns true if the module of the pdb file has been unloaded.
+  bool IsUnloaded() const { return unloaded_; }
+
+  // Sets whether ParsePdbFile maps the PDB file into memory (the default)
+  // or reads it through a std::ifstream.
+  void SetMemoryMapPdbFile(bool memory_map) {
+    memory_map_pdb_file_ = memory_map;
+  }
+
+  // Sets the directory of the PdbIndexCache used by ParsePdbFile.
+  // If directory is empty (the default), the document indices are always
+  // built from the PDB file and never cached. Note that when the document
+  // indices are loaded from the cache, the metadata tables are not parsed
+  // and the table getters below return empty tables.
+  void SetIndexCacheDirectory(const std::string &directory) {
+    index_cache_directory_ = directory;
+  }
+
+  // Sets the maximum number of threads ParsePdbFile uses to decode the
+  // methods of the PDB: the calling thread and threads of the shared
+  // IndexingThreadPool. 0 (the default) means one per core, up to
+  // kMaxPdbIndexingThreads.
+  void SetIndexingThreads(std::size_t threads) {
+    indexing_threads_ = threads;
+  }
+
   // Finds the stream header with a given name. Returns false if not found.
   // name is the name of the stream header.
   // stream_header is the stream header that has name name.
@@ -102,15 +149,41 @@ class PortablePdbFile : public IPortablePdbFile {
     return local_constant_table_;
   }
 
+  // Returns the method defs of the methods in document doc_index.
+  const std::vector<std::uint32_t> &GetDocumentMethods(
+      std::uint32_t doc_index) const;
+
   // Returns the document index table.
   const std::vector<std::unique_ptr<IDocumentIndex>> &GetDocumentIndexTable()
       const {
     return document_indices_;
   }
 
+  // Finds the method with method def method_def using method_defs_.
+  bool FindMethod(std::uint32_t method_def,
+                  const IDocumentIndex **document_index,
+                  const MethodInfo **method) const;
+
+  // Returns an estimate of the number of bytes used by the document
+  // index table.
+  std::size_t GetIndexMemoryUsage() const;
+
   // Gets the name of the module of this PDB.
   const std::string &GetModuleName() const { return module_name_; }
 
+  // Sets the name of the module of this PDB without binding it to an
+  // ICorDebugModule. This is how PdbIndexRegistry creates the parsed PDB
+  // files it shares between modules.
+  void SetModuleName(const std::string &module_name) {
+    module_name_ = module_name;
+  }
+
+  // Sets pdb_file_path to the path of the PDB file of module module_name,
+  // which is the module path with ".dll" replaced by ".pdb". Returns false
+  // if module_name does not end with ".dll".
+  static bool GetPdbFilePath(const std::string &module_name,
+                             std::string *pdb_file_path);
+
   // Gets the ICorDebugModule of the module of this PDB.
   HRESULT GetDebugModule(ICorDebugModule **debug_module) const;
 
@@ -121,8 +194,10 @@ class PortablePdbFile : public IPortablePdbFile {
   // Name of the module that corresponds to this PDB.
   std::string module_name_;
 
-  // Binary Stream contents of the PE file.
-  mutable CustomBinaryStream pdb_file_binary_stream_;
+  // Binary Stream contents of the PE file. Only ParsePdbFile moves this
+  // stream; const methods read through copies of it, which are cursors
+  // of their own over the same bytes, so they can run concurrently.
+  CustomBinaryStream pdb_file_binary_stream_;
 
   // Not all PDB-specific metadata tables implemented/exposed.
   MetadataRootHeader root_header_;
@@ -151,6 +226,19 @@ class PortablePdbFile : public IPortablePdbFile {
   std::vector<LocalVariableRow> local_variable_table_;
   std::vector<LocalConstantRow> local_constant_table_;
 
+  // Method defs of the methods in each document, indexed by document row.
+  // This lets each DocumentIndex find its methods without scanning the
+  // whole method debug info table.
+  std::vector<std::vector<std::uint32_t>> document_methods_;
+
+  // Where the methods of document_indices_ are, by method def.
+  MethodDefTable method_defs_;
+
+  // Decoded parts of the document names, by index in the Blob heap.
+  // Filled in once while parsing, before the documents are indexed, and
+  // only read afterwards, so lookups need no lock.
+  std::unordered_map<std::uint32_t, std::string> document_name_parts_;
+
   // Vectors that contains all the strings in the Strings Heap.
   // This vector is used to cache the strings.
   mutable std::vector<std::string> heap_strings_;
@@ -164,28 +252,20 @@ class PortablePdbFile : public IPortablePdbFile {
   // The IMetaDataImport of the module of this PDB.
   google_cloud_debugger::CComPtr<IMetaDataImport> metadata_import_;
 
-  // Template function to parse row for a specific metadata table.
-  template <typename TableRow>
-  bool ParseMetadataTableRow(uint32_t rows_in_table,
-                             CustomBinaryStream *binary_stream,
-                             std::vector<TableRow> *table) {
-    if (!binary_stream || !table) {
-      return false;
-    }
-
-    // Metadata row indicies are all 1-indexed. So always leave a 0th row that
-    // is empty.
-    table->resize(rows_in_table + 1);
-    for (size_t i = 0; i < rows_in_table; i++) {
-      TableRow row;
-      if (!ParseFrom(binary_stream, metadata_table_header_, &row)) {
-        return false;
-      }
-      (*table)[i + 1] = std::move(row);
-    }
-
-    return true;
-  }
+  // Reads the separator and the Blob heap indices of the parts of the
+  // document name at index index of the Blob heap.
+  bool ReadDocumentNamePartIndices(
+      std::uint32_t index, std::uint8_t *separator,
+      std::vector<std::uint32_t> *part_indices) const;
+
+  // Decodes the document name part at index part_index of the Blob heap.
+  bool ReadDocumentNamePart(std::uint32_t part_index,
+                            std::string *part) const;
+
+  // Decodes the parts of the names of all the documents into
+  // document_name_parts_. Documents in the same directories share their
+  // directory parts, so each part is only decoded once.
+  bool DecodeDocumentNameParts();
 
   // Parses the Blobs heap.
   bool InitializeBlobHeap();
@@ -202,8 +282,38 @@ class PortablePdbFile : public IPortablePdbFile {
   // Parses the compressed metadata tables stream.
   bool ParseCompressedMetadataTableStream();
 
+  // Groups the rows of the method debug info table by document in a single
+  // pass and stores the result in document_methods_.
+  void GroupMethodsByDocument();
+
+  // Does the work of ParsePdbFile, with parse_mutex_ held.
+  bool ReadPdbFile();
+
+  // Builds document_indices_ from the metadata tables. The methods of the
+  // documents are decoded in parallel, split into tasks of
+  // kMethodsPerIndexingTask methods.
+  bool IndexDocuments();
+
   // True if ParsePdbFile method is already called.
-  bool parsed = false;
+  std::atomic<bool> parsed{false};
+
+  // True if ParsePdbFile failed.
+  std::atomic<bool> failed_to_parse_{false};
+
+  // True if the module of the pdb file has been unloaded.
+  std::atomic<bool> unloaded_{false};
+
+  // Serializes calls to ParsePdbFile.
+  std::mutex parse_mutex_;
+
+  // True if ParsePdbFile should memory-map the PDB file.
+  bool memory_map_pdb_file_ = true;
+
+  // Directory of the PdbIndexCache. Empty if caching is disabled.
+  std::string index_cache_directory_;
+
+  // Maximum number of threads used to decode methods, 0 for one per core.
+  std::size_t indexing_threads_ = 0;
 };
 
 }  // namespace google_cloud_debugger_portable_pdb
@@ -0,0 +1,246 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sequence_point_list.h"
+
+#include <assert.h>
+
+using std::vector;
+
+namespace google_cloud_debugger_portable_pdb {
+
+namespace {
+
+// Maps the difference between two unsigned integers, taken as a signed
+// integer, to an unsigned integer so small differences of either sign
+// are small numbers: 0, -1, 1, -2, 2... become 0, 1, 2, 3, 4...
+uint32_t ZigZagEncode(uint32_t difference) {
+  return (difference << 1) ^ (0u - (difference >> 31));
+}
+
+uint32_t ZigZagDecode(uint32_t value) {
+  return (value >> 1) ^ (0u - (value & 1));
+}
+
+// Appends value to bytes 7 bits at a time, lowest bits first. The high bit
+// of each byte is set if more bytes follow.
+void WriteVarUInt(uint64_t value, vector<uint8_t> *bytes) {
+  while (value >= 0x80) {
+    bytes->push_back(static_cast<uint8_t>(value) | 0x80);
+    value >>= 7;
+  }
+  bytes->push_back(static_cast<uint8_t>(value));
+}
+
+// Reads a value written by WriteVarUInt from the bytes in [position, end).
+// Returns the position after the value, or nullptr if the value is
+// truncated or does not fit in 64 bits.
+const uint8_t *ReadVarUInt(const uint8_t *position, const uint8_t *end,
+                           uint64_t *value) {
+  *value = 0;
+  for (uint32_t shift = 0; shift < 64; shift += 7) {
+    if (position == end) {
+      return nullptr;
+    }
+
+    uint8_t byte = *position++;
+    *value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return position;
+    }
+  }
+
+  return nullptr;
+}
+
+// Reads a zigzag-encoded 32-bit difference from [position, end).
+const uint8_t *ReadDifference(const uint8_t *position, const uint8_t *end,
+                              uint32_t *difference) {
+  uint64_t value;
+  position = ReadVarUInt(position, end, &value);
+  if (!position || value > UINT32_MAX) {
+    return nullptr;
+  }
+
+  *difference = ZigZagDecode(static_cast<uint32_t>(value));
+  return position;
+}
+
+}  // namespace
+
+SequencePointList::Iterator::Iterator(const uint8_t *position,
+                                      const uint8_t *end, uint32_t remaining)
+    : position_(position), end_(end), remaining_(remaining) {
+  if (remaining_ != 0) {
+    position_ = Decode(position_, end_, &current_);
+    assert(position_ != nullptr);
+  }
+}
+
+SequencePointList::Iterator &SequencePointList::Iterator::operator++() {
+  assert(remaining_ != 0);
+  if (--remaining_ != 0) {
+    position_ = Decode(position_, end_, &current_);
+    assert(position_ != nullptr);
+  }
+  return *this;
+}
+
+SequencePointList::Iterator SequencePointList::Iterator::operator++(int) {
+  Iterator previous = *this;
+  ++*this;
+  return previous;
+}
+
+SequencePointList::Iterator SequencePointList::begin() const {
+  const uint8_t *data = GetEncodedData();
+  return Iterator(data, data + GetEncodedSize(), size_);
+}
+
+SequencePointList::Iterator SequencePointList::end() const {
+  const uint8_t *data_end = GetEncodedData() + GetEncodedSize();
+  return Iterator(data_end, data_end, 0);
+}
+
+void SequencePointList::push_back(const SequencePoint &sequence_point) {
+  assert(view_ == nullptr);
+  // The hidden flag takes the lowest bit of the IL offset difference.
+  uint64_t il_offset_difference =
+      ZigZagEncode(sequence_point.il_offset - last_il_offset_);
+  WriteVarUInt((il_offset_difference << 1) | (sequence_point.is_hidden ? 1 : 0),
+               &bytes_);
+  WriteVarUInt(ZigZagEncode(sequence_point.start_line - last_start_line_),
+               &bytes_);
+  WriteVarUInt(ZigZagEncode(sequence_point.start_col - last_start_col_),
+               &bytes_);
+  WriteVarUInt(
+      ZigZagEncode(sequence_point.end_line - sequence_point.start_line),
+      &bytes_);
+  WriteVarUInt(ZigZagEncode(sequence_point.end_col - sequence_point.start_col),
+               &bytes_);
+
+  last_il_offset_ = sequence_point.il_offset;
+  last_start_line_ = sequence_point.start_line;
+  last_start_col_ = sequence_point.start_col;
+  ++size_;
+}
+
+SequencePoint SequencePointList::Get(uint32_t index) const {
+  assert(index < size_);
+  Iterator it = begin();
+  for (uint32_t i = 0; i < index; ++i) {
+    ++it;
+  }
+  return *it;
+}
+
+void SequencePointList::ShrinkToFit() { bytes_.shrink_to_fit(); }
+
+bool SequencePointList::SetEncodedBytes(uint32_t size, vector<uint8_t> bytes) {
+  if (!Validate(size, bytes.data(), bytes.size())) {
+    return false;
+  }
+
+  bytes_ = std::move(bytes);
+  return true;
+}
+
+bool SequencePointList::SetEncodedView(uint32_t size, const uint8_t *bytes,
+                                       uint32_t num_bytes) {
+  if (!Validate(size, bytes, num_bytes)) {
+    return false;
+  }
+
+  // Only a non-empty view is marked as one, so an empty view stays a list
+  // that points can be added to, and GetEncodedData never returns null for
+  // a list that has points.
+  if (num_bytes != 0) {
+    bytes_ = vector<uint8_t>();
+    view_ = bytes;
+    view_size_ = num_bytes;
+  }
+  return true;
+}
+
+bool SequencePointList::Validate(uint32_t size, const uint8_t *bytes,
+                                 uint32_t num_bytes) {
+  bytes_.clear();
+  view_ = nullptr;
+  view_size_ = 0;
+  size_ = 0;
+  last_il_offset_ = 0;
+  last_start_line_ = 0;
+  last_start_col_ = 0;
+
+  // Decodes everything once so iterating over the list never reads past
+  // the bytes, even if they come from a corrupted file.
+  SequencePoint sequence_point;
+  const uint8_t *position = bytes;
+  const uint8_t *end = bytes + num_bytes;
+  for (uint32_t i = 0; i < size; ++i) {
+    position = Decode(position, end, &sequence_point);
+    if (!position) {
+      return false;
+    }
+  }
+
+  if (position != end) {
+    return false;
+  }
+
+  size_ = size;
+  last_il_offset_ = sequence_point.il_offset;
+  last_start_line_ = sequence_point.start_line;
+  last_start_col_ = sequence_point.start_col;
+  return true;
+}
+
+const uint8_t *SequencePointList::Decode(const uint8_t *position,
+                                         const uint8_t *end,
+                                         SequencePoint *sequence_point) {
+  uint64_t il_offset_value;
+  uint32_t start_line_difference;
+  uint32_t start_col_difference;
+  uint32_t end_line_difference;
+  uint32_t end_col_difference;
+  position = ReadVarUInt(position, end, &il_offset_value);
+  if (!position || (il_offset_value >> 1) > UINT32_MAX) {
+    return nullptr;
+  }
+
+  position = ReadDifference(position, end, &start_line_difference);
+  if (position) {
+    position = ReadDifference(position, end, &start_col_difference);
+  }
+  if (position) {
+    position = ReadDifference(position, end, &end_line_difference);
+  }
+  if (position) {
+    position = ReadDifference(position, end, &end_col_difference);
+  }
+  if (!position) {
+    return nullptr;
+  }
+
+  sequence_point->is_hidden = (il_offset_value & 1) != 0;
+  sequence_point->il_offset +=
+      ZigZagDecode(static_cast<uint32_t>(il_offset_value >> 1));
+  sequence_point->start_line += start_line_difference;
+  sequence_point->start_col += start_col_difference;
+  sequence_point->end_line = sequence_point->start_line + end_line_difference;
+  sequence_point->end_col = sequence_point->start_col + end_col_difference;
+  return position;
+}
+
+}  // namespace google_cloud_debugger_portable_pdb
@@ -0,0 +1,193 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SEQUENCE_POINT_LIST_H_
+#define SEQUENCE_POINT_LIST_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+namespace google_cloud_debugger_portable_pdb {
+
+// Struct that represents a sequence point in a method.
+// Unlike SequencePointRecord struct, this struct has
+// the absoluate IL Offset.
+struct SequencePoint {
+  // IL Offset of this sequence point.
+  std::uint32_t il_offset = 0;
+
+  // Start line of this sequence point.
+  std::uint32_t start_line = 0;
+
+  // Start column of this sequence point.
+  std::uint32_t start_col = 0;
+
+  // End line of this sequence point.
+  std::uint32_t end_line = 0;
+
+  // End column of this sequence point.
+  std::uint32_t end_col = 0;
+
+  // True if this is a hidden or document change sequence point.
+  bool is_hidden = false;
+};
+
+// Compact list of the sequence points of a method.
+//
+// Sequence points are the bulk of a document index, so instead of storing
+// them as SequencePoint structs (24 bytes each), we delta-encode them in a
+// byte array, much like the sequence point blobs of the PDB itself: the IL
+// offset, start line and start column are stored as the difference from
+// the previous sequence point, and the end line and end column as the
+// difference from the start line and start column. Each difference is a
+// zigzag-encoded variable-length integer, so a typical sequence point takes
+// 5 or 6 bytes.
+//
+// Sequence points can only be appended, and are decoded in order when the
+// list is iterated. Get decodes a single sequence point, but has to decode
+// all the sequence points before it.
+//
+// A list can also be a read-only view of encoded bytes it does not own,
+// such as the bytes of a mapped PdbIndexCache file (see SetEncodedView).
+class SequencePointList {
+ public:
+  // Forward iterator over the decoded sequence points of a list.
+  class Iterator {
+   public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef SequencePoint value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const SequencePoint *pointer;
+    typedef const SequencePoint &reference;
+
+    const SequencePoint &operator*() const { return current_; }
+    const SequencePoint *operator->() const { return &current_; }
+
+    Iterator &operator++();
+    Iterator operator++(int);
+
+    bool operator==(const Iterator &other) const {
+      return remaining_ == other.remaining_;
+    }
+    bool operator!=(const Iterator &other) const { return !(*this == other); }
+
+   private:
+    friend class SequencePointList;
+
+    // Creates an iterator that decodes remaining sequence points
+    // from the bytes in [position, end).
+    Iterator(const std::uint8_t *position, const std::uint8_t *end,
+             std::uint32_t remaining);
+
+    // Next byte to decode.
+    const std::uint8_t *position_;
+
+    // End of the encoded bytes.
+    const std::uint8_t *end_;
+
+    // Number of sequence points left, including current_.
+    std::uint32_t remaining_;
+
+    // The sequence point the iterator is on.
+    SequencePoint current_;
+  };
+
+  // Returns an iterator to the first sequence point.
+  Iterator begin() const;
+
+  // Returns the past-the-end iterator.
+  Iterator end() const;
+
+  // Returns the number of sequence points.
+  std::uint32_t size() const { return size_; }
+
+  // Returns true if there are no sequence points.
+  bool empty() const { return size_ == 0; }
+
+  // Appends sequence_point to the list, which must not be a view.
+  void push_back(const SequencePoint &sequence_point);
+
+  // Returns the sequence point at position index, which has to be
+  // smaller than size().
+  SequencePoint Get(std::uint32_t index) const;
+
+  // Frees the memory reserved for sequence points that were not added.
+  void ShrinkToFit();
+
+  // Returns the encoded sequence points.
+  const std::uint8_t *GetEncodedData() const {
+    return view_ ? view_ : bytes_.data();
+  }
+
+  // Returns the number of bytes of the encoded sequence points.
+  std::uint32_t GetEncodedSize() const {
+    return view_ ? view_size_ : static_cast<std::uint32_t>(bytes_.size());
+  }
+
+  // Replaces the sequence points with size sequence points encoded in
+  // bytes, as returned by GetEncodedData. Returns false, leaving the list
+  // empty, if bytes does not hold exactly size sequence points.
+  bool SetEncodedBytes(std::uint32_t size, std::vector<std::uint8_t> bytes);
+
+  // Makes the list a view of size sequence points encoded in the num_bytes
+  // bytes at bytes, without copying them. The bytes must stay valid and
+  // unchanged as long as the list or a copy of it is used. Returns false,
+  // leaving the list empty, if the bytes do not hold exactly size sequence
+  // points.
+  bool SetEncodedView(std::uint32_t size, const std::uint8_t *bytes,
+                      std::uint32_t num_bytes);
+
+  // Returns the number of bytes allocated for the encoded sequence points.
+  // The bytes of a view are not counted.
+  std::size_t GetMemoryUsage() const { return bytes_.capacity(); }
+
+ private:
+  // Clears the list and checks that the num_bytes bytes at bytes hold
+  // exactly size sequence points. If they do, sets size_ and the last_*
+  // fields from them and returns true.
+  bool Validate(std::uint32_t size, const std::uint8_t *bytes,
+                std::uint32_t num_bytes);
+
+  // Decodes the sequence point at position into sequence_point, which has
+  // to hold the previous sequence point (or be value-initialized for the
+  // first one). Returns the position of the next sequence point, or nullptr
+  // if the bytes up to end are not a valid sequence point.
+  static const std::uint8_t *Decode(const std::uint8_t *position,
+                                    const std::uint8_t *end,
+                                    SequencePoint *sequence_point);
+
+  // The encoded sequence points, unless the list is a view.
+  std::vector<std::uint8_t> bytes_;
+
+  // The encoded sequence points if the list is a view, otherwise nullptr.
+  const std::uint8_t *view_ = nullptr;
+
+  // Number of bytes at view_.
+  std::uint32_t view_size_ = 0;
+
+  // Number of sequence points.
+  std::uint32_t size_ = 0;
+
+  // IL offset, start line and start column of the last sequence point,
+  // which the next one is encoded against.
+  std::uint32_t last_il_offset_ = 0;
+  std::uint32_t last_start_line_ = 0;
+  std::uint32_t last_start_col_ = 0;
+};
+
+}  // namespace google_cloud_debugger_portable_pdb
+
+#endif  // SEQUENCE_POINT_LIST_H_
@@ -0,0 +1,111 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "snapshot_worker.h"
+
+#include <iostream>
+
+using std::cerr;
+using std::lock_guard;
+using std::mutex;
+using std::unique_lock;
+
+namespace google_cloud_debugger {
+
+SnapshotWorker::SnapshotWorker(size_t max_queued_tasks)
+    : max_queued_tasks_(max_queued_tasks == 0 ? 1 : max_queued_tasks) {}
+
+SnapshotWorker::~SnapshotWorker() { Shutdown(); }
+
+HRESULT SnapshotWorker::Enqueue(std::function<HRESULT()> task) {
+  if (!task) {
+    return E_INVALIDARG;
+  }
+
+  {
+    lock_guard<mutex> lock(mutex_);
+    if (shutting_down_) {
+      return E_ABORT;
+    }
+
+    if (queue_.size() >= max_queued_tasks_) {
+      cerr << "Snapshot worker queue is full, dropping the task.";
+      return E_FAIL;
+    }
+
+    queue_.push_back(std::move(task));
+
+    if (!worker_.joinable()) {
+      worker_ = std::thread(&SnapshotWorker::RunTasks, this);
+    }
+  }
+
+  queue_cv_.notify_one();
+  return S_OK;
+}
+
+void SnapshotWorker::Shutdown() {
+  std::thread worker;
+  {
+    lock_guard<mutex> lock(mutex_);
+    shutting_down_ = true;
+    queue_.clear();
+    worker.swap(worker_);
+  }
+
+  queue_cv_.notify_all();
+  if (worker.joinable()) {
+    worker.join();
+  }
+}
+
+size_t SnapshotWorker::GetQueuedTaskCount() {
+  lock_guard<mutex> lock(mutex_);
+  return queue_.size();
+}
+
+std::uint64_t SnapshotWorker::GetCompletedTaskCount() {
+  lock_guard<mutex> lock(mutex_);
+  return completed_tasks_;
+}
+
+void SnapshotWorker::RunTasks() {
+  while (true) {
+    std::function<HRESULT()> task;
+    {
+      unique_lock<mutex> lock(mutex_);
+      queue_cv_.wait(lock,
+                     [this] { return shutting_down_ || !queue_.empty(); });
+      if (shutting_down_) {
+        return;
+      }
+
+      task = std::move(queue_.front());
+      queue_.pop_front();
+    }
+
+    HRESULT hr = task();
+    if (FAILED(hr)) {
+      cerr << "Snapshot task failed with HRESULT: " << std::hex << hr;
+    }
+
+    // The task is released before it is counted, so that whatever it
+    // holds is gone once GetCompletedTaskCount reports it.
+    task = nullptr;
+    lock_guard<mutex> lock(mutex_);
+    ++completed_tasks_;
+  }
+}
+
+}  // namespace google_cloud_debugger
@@ -0,0 +1,96 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SNAPSHOT_WORKER_H_
+#define SNAPSHOT_WORKER_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "cor.h"
+
+namespace google_cloud_debugger {
+
+// A single long-lived thread that runs the snapshot tasks of breakpoint
+// hits, one after the other.
+//
+// EvalCoordinator hands every breakpoint hit to this worker instead of
+// starting a new thread for it. The debugger callback thread blocks until
+// the task of a hit lets it continue, so at most a couple of tasks are
+// ever queued. The queue is bounded anyway: a task that does not fit is
+// rejected instead of piling up behind a stuck one.
+//
+// A second worker writes the snapshots of the hits that EvalCoordinator
+// processes on the debugger callback thread, so that these never take up
+// the queue of the hits that need this one.
+//
+// Tasks report their own errors; the worker only logs failed HRESULTs.
+class SnapshotWorker {
+ public:
+  // Creates a worker that queues at most max_queued_tasks tasks.
+  // The thread is started by the first call to Enqueue.
+  explicit SnapshotWorker(size_t max_queued_tasks);
+
+  // Stops the worker thread.
+  ~SnapshotWorker();
+
+  // Queues task to be run by the worker thread. Returns E_FAIL if the
+  // queue is full and E_ABORT if the worker is shutting down.
+  HRESULT Enqueue(std::function<HRESULT()> task);
+
+  // Stops the worker thread and drops the tasks that are still queued.
+  // Blocks until the task that is running, if any, is done.
+  void Shutdown();
+
+  // Returns the number of tasks waiting to be run.
+  size_t GetQueuedTaskCount();
+
+  // Returns the number of tasks the worker has finished running.
+  std::uint64_t GetCompletedTaskCount();
+
+ private:
+  // Loop run by the worker thread. Runs tasks from the queue until the
+  // worker shuts down.
+  void RunTasks();
+
+  // Maximum number of queued tasks.
+  size_t max_queued_tasks_;
+
+  // The worker thread.
+  std::thread worker_;
+
+  // Tasks waiting to be run.
+  std::deque<std::function<HRESULT()>> queue_;
+
+  // Number of tasks the worker has finished running.
+  std::uint64_t completed_tasks_ = 0;
+
+  // True if the worker is shutting down.
+  bool shutting_down_ = false;
+
+  // Mutex protecting worker_, queue_, completed_tasks_ and shutting_down_.
+  std::mutex mutex_;
+
+  // Used to wake up the worker thread when a task is queued or when the
+  // worker shuts down.
+  std::condition_variable queue_cv_;
+};
+
+}  // namespace google_cloud_debugger
+
+#endif  //  SNAPSHOT_WORKER_H_
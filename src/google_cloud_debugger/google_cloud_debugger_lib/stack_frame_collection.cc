@@ -28,20 +28,27 @@ using google::cloud::diagnostics::debug::Breakpoint;
 using google::cloud::diagnostics::debug::SourceLocation;
 using google::cloud::diagnostics::debug::StackFrame;
 using google::cloud::diagnostics::debug::Variable;
+using google_cloud_debugger_portable_pdb::FindSequencePointAtOffset;
+using google_cloud_debugger_portable_pdb::GetScopeLocals;
+using google_cloud_debugger_portable_pdb::IDocumentIndex;
 using google_cloud_debugger_portable_pdb::LocalConstantInfo;
 using google_cloud_debugger_portable_pdb::LocalVariableInfo;
 using google_cloud_debugger_portable_pdb::SequencePoint;
 using std::cerr;
 using std::cout;
-using std::max;
 using std::string;
 using std::vector;
 
 namespace google_cloud_debugger {
 StackFrameCollection::StackFrameCollection(
     std::shared_ptr<ICorDebugHelper> debug_helper,
-    std::shared_ptr<IDbgObjectFactory> obj_factory)
-    : debug_helper_(debug_helper), obj_factory_(obj_factory) {}
+    std::shared_ptr<IDbgObjectFactory> obj_factory,
+    std::shared_ptr<FrameSymbolCache> frame_symbol_cache,
+    std::shared_ptr<MethodTokenTableCache> method_token_tables)
+    : debug_helper_(debug_helper),
+      obj_factory_(obj_factory),
+      frame_symbol_cache_(frame_symbol_cache),
+      method_token_tables_(method_token_tables) {}
 
 HRESULT StackFrameCollection::ProcessBreakpoint(
     const vector<
@@ -133,6 +140,11 @@ HRESULT StackFrameCollection::PopulateStackFrames(
     frame_location->set_line(dbg_stack_frame->GetLineNumber());
     frame_location->set_path(dbg_stack_frame->GetFile());
 
+    // Out of pause time, the remaining frames only get their locations.
+    if (eval_coordinator->PauseTimeExhausted()) {
+      continue;
+    }
+
     hr = dbg_stack_frame->PopulateStackFrame(frame, frame_max_size,
                                              eval_coordinator);
     if (FAILED(hr)) {
@@ -180,6 +192,7 @@ HRESULT StackFrameCollection::PopulateAsyncStackFrameInfo(
 
   std::shared_ptr<DbgStackFrame> real_method_stack_frame(
       new DbgStackFrame(debug_helper_, obj_factory_));
+  real_method_stack_frame->SetMethodTokenTables(method_token_tables_);
   hr = PopulateDbgStackFrameHelper(parsed_pdb_files, real_method_frame,
                                    real_method_stack_frame.get(), false);
   if (FAILED(hr)) {
@@ -196,7 +209,8 @@ HRESULT StackFrameCollection::PopulateAsyncStackFrameInfo(
 
 HRESULT StackFrameCollection::PopulateLocalVarsAndMethodArgs(
     mdMethodDef target_function_token, DbgStackFrame *dbg_stack_frame,
-    ICorDebugILFrame *il_frame, IMetaDataImport *metadata_import,
+    ICorDebugILFrame *il_frame, ICorDebugModule *debug_module,
+    IMetaDataImport *metadata_import,
     google_cloud_debugger_portable_pdb::IPortablePdbFile *pdb_file) {
   if (!dbg_stack_frame || !il_frame || !pdb_file) {
     return E_INVALIDARG;
@@ -219,94 +233,77 @@ HRESULT StackFrameCollection::PopulateLocalVarsAndMethodArgs(
     return S_FALSE;
   }
 
-  // Loops through all methods in all the documents of the pdb file to find
-  // a MethodInfo object that corresponds with the method at this breakpoint.
-  for (auto &&document_index : pdb_file->GetDocumentIndexTable()) {
-    for (auto &&method : document_index->GetMethods()) {
-      PCCOR_SIGNATURE current_method_signature = 0;
-      ULONG current_method_virtual_addr = 0;
-      mdTypeDef type_def = 0;
-      ULONG method_name_length = 0;
-      DWORD flags1 = 0;
-      ULONG signature_blob;
-      DWORD flags2 = 0;
-
-      hr = metadata_import->GetMethodProps(
-          method.method_def, &type_def, nullptr, 0, &method_name_length,
-          &flags1, &current_method_signature, &signature_blob,
-          &current_method_virtual_addr, &flags2);
-      if (FAILED(hr)) {
-        cerr << "Failed to extract method info from method "
-             << method.method_def;
-        return hr;
-      }
-
-      // Checks that the virtual address of this method matches the one of the
-      // stack frame.
-      if (current_method_virtual_addr !=
-          dbg_stack_frame->GetFuncVirtualAddr()) {
-        continue;
-      }
-
-      // Sets the file path since we know we are in the correct function.
-      dbg_stack_frame->SetFile(document_index->GetFilePath());
+  // The method debug information of a method has the same row id as its
+  // MethodDef token, so there is no need to compare virtual addresses.
+  const IDocumentIndex *document_index;
+  const google_cloud_debugger_portable_pdb::MethodInfo *method;
+  if (!pdb_file->FindMethod(RidFromToken(target_function_token),
+                            &document_index, &method)) {
+    return S_OK;
+  }
 
-      long matching_sequence_point_position = -1;
+  // Sets the file path since we know we are in the correct function.
+  dbg_stack_frame->SetFile(document_index->GetFilePath());
 
-      // We find the first non-hidden sequence point that is just larger than
-      // the ip offset.
-      for (long index = 0; index < method.sequence_points.size(); index++) {
-        if (!method.sequence_points[index].is_hidden &&
-            method.sequence_points[index].il_offset <= ip_offset) {
-          matching_sequence_point_position =
-              max(matching_sequence_point_position, index);
-        }
-      }
+  FrameLocation location;
+  if (!frame_symbol_cache_ ||
+      !frame_symbol_cache_->GetLocation(debug_module, target_function_token,
+                                        ip_offset, &location)) {
+    // We find the last non-hidden sequence point whose IL offset is not
+    // larger than the ip offset.
+    SequencePoint sequence_point;
+    if (!FindSequencePointAtOffset(*method, ip_offset, &sequence_point)) {
+      return S_OK;
+    }
 
-      // If we find the matching sequence point, populates the list of local
-      // variables in dbg_stack_frame from the local variable's vector of the
-      // matching sequence point.
-      if (matching_sequence_point_position != -1) {
-        SequencePoint sequence_point =
-            method.sequence_points[matching_sequence_point_position];
-
-        dbg_stack_frame->SetLineNumber(sequence_point.start_line);
-        vector<LocalVariableInfo> local_variables;
-        vector<LocalConstantInfo> local_constants;
-        for (auto &&local_scope : method.local_scope) {
-          if (local_scope.start_offset > sequence_point.il_offset ||
-              local_scope.start_offset + local_scope.length <
-                  sequence_point.il_offset) {
-            continue;
-          }
-
-          local_variables.insert(local_variables.end(),
-                                 local_scope.local_variables.begin(),
-                                 local_scope.local_variables.end());
-          local_constants.insert(local_constants.end(),
-                                 local_scope.local_constants.begin(),
-                                 local_scope.local_constants.end());
-        }
-
-        hr = dbg_stack_frame->Initialize(il_frame, local_variables,
-                                         local_constants, target_function_token,
-                                         metadata_import);
-      }
+    location.file = document_index->GetFilePath();
+    location.line = sequence_point.start_line;
+    location.sequence_point_il_offset = sequence_point.il_offset;
+    if (frame_symbol_cache_) {
+      frame_symbol_cache_->AddLocation(debug_module, target_function_token,
+                                       ip_offset, location);
+    }
+  }
 
-      return S_OK;
+  // Populates the list of local variables in dbg_stack_frame from the local
+  // scopes of the method that contain the matching sequence point.
+  dbg_stack_frame->SetLineNumber(location.line);
+  vector<LocalVariableInfo> local_variables;
+  vector<LocalConstantInfo> local_constants;
+  for (auto &&local_scope : method->local_scope) {
+    if (local_scope.start_offset > location.sequence_point_il_offset ||
+        local_scope.start_offset + local_scope.length <
+            location.sequence_point_il_offset) {
+      continue;
     }
+
+    GetScopeLocals(local_scope, document_index->GetStringPool(),
+                   &local_variables, &local_constants);
   }
 
+  hr = dbg_stack_frame->Initialize(il_frame, local_variables, local_constants,
+                                   target_function_token, metadata_import);
   return S_OK;
 }
 
 HRESULT StackFrameCollection::PopulateModuleClassAndFunctionName(
     DbgStackFrame *dbg_stack_frame, mdMethodDef function_token,
-    IMetaDataImport *metadata_import) {
+    ICorDebugModule *debug_module, IMetaDataImport *metadata_import) {
   if (!dbg_stack_frame || !metadata_import) {
     return E_INVALIDARG;
   }
 
+  FrameSymbols symbols;
+  if (frame_symbol_cache_ &&
+      frame_symbol_cache_->GetSymbols(debug_module, function_token,
+                                      &symbols)) {
+    dbg_stack_frame->SetMethod(symbols.method_name);
+    dbg_stack_frame->SetClass(symbols.class_name);
+    dbg_stack_frame->SetClassToken(symbols.class_token);
+    dbg_stack_frame->SetFuncVirtualAddr(symbols.virtual_address);
+    return S_OK;
+  }
+
   HRESULT hr;
   mdTypeDef type_def = 0;
   ULONG method_name_length = 0;
@@ -368,6 +365,14 @@ HRESULT StackFrameCollection::PopulateModuleClassAndFunctionName(
   dbg_stack_frame->SetClassToken(type_def);
   dbg_stack_frame->SetFuncVirtualAddr(target_method_virtual_addr);
 
+  if (frame_symbol_cache_) {
+    symbols.method_name = dbg_stack_frame->GetMethod();
+    symbols.class_name = dbg_stack_frame->GetClass();
+    symbols.class_token = type_def;
+    symbols.virtual_address = target_method_virtual_addr;
+    frame_symbol_cache_->AddSymbols(debug_module, function_token, symbols);
+  }
+
   return S_OK;
 }
 
@@ -406,8 +411,10 @@ HRESULT StackFrameCollection::WalkStackAndProcessStackFrame(
 
   // Walks through the stack and populates stack_frames_ vector.
   while (SUCCEEDED(hr)) {
-    // Don't parse too many stack frames.
-    if (frame_parsed_so_far >= kMaximumStackFrames) {
+    // Don't parse too many stack frames, or keep the thread stopped for
+    // too long.
+    if (frame_parsed_so_far >= kMaximumStackFrames ||
+        eval_coordinator->PauseTimeExhausted()) {
       stack_walked_ = true;
       return S_OK;
     }
@@ -430,6 +437,7 @@ HRESULT StackFrameCollection::WalkStackAndProcessStackFrame(
 
     std::shared_ptr<DbgStackFrame> stack_frame(
         new DbgStackFrame(debug_helper_, obj_factory_));
+    stack_frame->SetMethodTokenTables(method_token_tables_);
     hr = PopulateDbgStackFrameHelper(parsed_pdb_files, frame, stack_frame.get(),
                                      process_il_frame);
     if (FAILED(hr)) {
@@ -533,6 +541,7 @@ HRESULT StackFrameCollection::ProcessFirstStack(
 
   first_stack_ = std::shared_ptr<DbgStackFrame>(
       new DbgStackFrame(debug_helper_, obj_factory_));
+  first_stack_->SetMethodTokenTables(method_token_tables_);
   hr = PopulateDbgStackFrameHelper(parsed_pdb_files, debug_frame,
                                    first_stack_.get(), true);
   if (FAILED(hr)) {
@@ -626,7 +635,7 @@ HRESULT StackFrameCollection::PopulateDbgStackFrameHelper(
   // so we can report this even if we don't have local variables or
   // method arguments.
   hr = PopulateModuleClassAndFunctionName(stack_frame, target_function_token,
-                                          metadata_import);
+                                          frame_module, metadata_import);
   if (FAILED(hr)) {
     return hr;
   }
@@ -659,8 +668,8 @@ HRESULT StackFrameCollection::PopulateDbgStackFrameHelper(
 
     // Tries to populate local variables and method arguments of this frame.
     hr = PopulateLocalVarsAndMethodArgs(target_function_token, stack_frame,
-                                        il_frame, metadata_import,
-                                        pdb_file.get());
+                                        il_frame, frame_module,
+                                        metadata_import, pdb_file.get());
     if (FAILED(hr)) {
       cerr << "Failed to populate stack frame information.";
       return hr;
@@ -18,14 +18,24 @@
 #include <vector>
 
 #include "dbg_stack_frame.h"
+#include "frame_symbol_cache.h"
 #include "i_stack_frame_collection.h"
+#include "method_token_table.h"
 
 namespace google_cloud_debugger {
 
 class StackFrameCollection : public IStackFrameCollection {
  public:
-  StackFrameCollection(std::shared_ptr<ICorDebugHelper> debug_helper,
-                       std::shared_ptr<IDbgObjectFactory> obj_factory);
+  // frame_symbol_cache is shared by the stack frame collections of all
+  // the breakpoint hits, so frames seen before are resolved without
+  // querying the metadata and the PDBs again. method_token_tables is
+  // given to the stack frames to find the methods that expressions call.
+  // Both can be null.
+  StackFrameCollection(
+      std::shared_ptr<ICorDebugHelper> debug_helper,
+      std::shared_ptr<IDbgObjectFactory> obj_factory,
+      std::shared_ptr<FrameSymbolCache> frame_symbol_cache,
+      std::shared_ptr<MethodTokenTableCache> method_token_tables);
 
   // This function first checks whether breakpoint has a condition.
   // If the condition evaluated to false, do nothing.
@@ -53,6 +63,12 @@ class StackFrameCollection : public IStackFrameCollection {
   // Factory for creating DbgObject.
   std::shared_ptr<IDbgObjectFactory> obj_factory_;
 
+  // Cache of the symbols and locations of the frames. Can be null.
+  std::shared_ptr<FrameSymbolCache> frame_symbol_cache_;
+
+  // Method tables of the loaded modules. Can be null.
+  std::shared_ptr<MethodTokenTableCache> method_token_tables_;
+
   // Populates the stack frame information for an async frame.
   // We need to do this because the async frame does not have information
   // like method name, class name and class token as it is a
@@ -67,17 +83,23 @@ class StackFrameCollection : public IStackFrameCollection {
   // Given a PDB file, this function tries to find the metadata of the function
   // with token target_function_token in the PDB file. If found, this function
   // will populate dbg_stack_frame using the metadata found and the
-  // ICorDebugILFrame il_frame object.
+  // ICorDebugILFrame il_frame object. The method is looked up by the row id
+  // of target_function_token and the source location is cached in
+  // frame_symbol_cache_ under debug_module, the module of the frame.
   HRESULT PopulateLocalVarsAndMethodArgs(
       mdMethodDef target_function_token, DbgStackFrame *dbg_stack_frame,
-      ICorDebugILFrame *il_frame, IMetaDataImport *metadata_import,
+      ICorDebugILFrame *il_frame, ICorDebugModule *debug_module,
+      IMetaDataImport *metadata_import,
       google_cloud_debugger_portable_pdb::IPortablePdbFile *pdb_files);
 
   // Populates the module, class and function name of a stack frame
   // using function_token (represents function the frame is in)
   // and IMetaDataImport (from the module the frame is in).
+  // The names are taken from frame_symbol_cache_ if they are there
+  // for debug_module, the module of the frame.
   HRESULT PopulateModuleClassAndFunctionName(DbgStackFrame *dbg_stack_frame,
                                              mdMethodDef function_token,
+                                             ICorDebugModule *debug_module,
                                              IMetaDataImport *metadata_import);
 
   // Helper function to walk the stack, process each frame and store them
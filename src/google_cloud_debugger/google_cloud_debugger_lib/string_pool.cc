@@ -0,0 +1,61 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "string_pool.h"
+
+using std::lock_guard;
+using std::mutex;
+using std::string;
+
+namespace google_cloud_debugger_portable_pdb {
+
+uint32_t StringPool::Intern(const string &value) {
+  lock_guard<mutex> lock(mutex_);
+  auto inserted = ids_.insert({value, static_cast<uint32_t>(strings_.size())});
+  if (inserted.second) {
+    strings_.push_back(&inserted.first->first);
+  }
+  return inserted.first->second;
+}
+
+const string &StringPool::Get(uint32_t id) const {
+  static const string kEmptyString;
+
+  lock_guard<mutex> lock(mutex_);
+  if (id >= strings_.size()) {
+    return kEmptyString;
+  }
+  return *strings_[id];
+}
+
+uint32_t StringPool::Size() const {
+  lock_guard<mutex> lock(mutex_);
+  return strings_.size();
+}
+
+size_t StringPool::GetMemoryUsage() const {
+  lock_guard<mutex> lock(mutex_);
+  // Each string is a node of ids_, a bucket of ids_ and a pointer in
+  // strings_. We count the characters of the string as if they were
+  // always allocated on the heap.
+  size_t usage = sizeof(*this) + strings_.capacity() * sizeof(string *) +
+                 ids_.bucket_count() * sizeof(void *);
+  for (const string *value : strings_) {
+    usage += sizeof(std::pair<const string, uint32_t>) + sizeof(void *) +
+             value->size() + 1;
+  }
+  return usage;
+}
+
+}  // namespace google_cloud_debugger_portable_pdb
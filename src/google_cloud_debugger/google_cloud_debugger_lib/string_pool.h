@@ -0,0 +1,62 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STRING_POOL_H_
+#define STRING_POOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace google_cloud_debugger_portable_pdb {
+
+// Pool of interned strings, such as the names of the local variables and
+// the signatures of the local constants of the methods of a module.
+// The same few names ("i", "result", "this"...) come up in most methods,
+// so each distinct string is stored once and referred to by a 4-byte id.
+//
+// Ids are assigned in the order the strings are first interned, starting
+// from 0. All methods are thread-safe.
+class StringPool {
+ public:
+  // Returns the id of value, adding value to the pool if it is not there.
+  std::uint32_t Intern(const std::string &value);
+
+  // Returns the string with id id, or an empty string if there is none.
+  const std::string &Get(std::uint32_t id) const;
+
+  // Returns the number of strings in the pool.
+  std::uint32_t Size() const;
+
+  // Returns an estimate of the number of bytes used by the pool.
+  std::size_t GetMemoryUsage() const;
+
+ private:
+  // Maps each string to its id. The strings are the keys, whose addresses
+  // do not change when the map grows.
+  std::unordered_map<std::string, std::uint32_t> ids_;
+
+  // The strings in ids_, ordered by id.
+  std::vector<const std::string *> strings_;
+
+  // Mutex protecting ids_ and strings_.
+  mutable std::mutex mutex_;
+};
+
+}  // namespace google_cloud_debugger_portable_pdb
+
+#endif  // STRING_POOL_H_
@@ -53,6 +53,17 @@ void SetErrorStatusMessage(
   breakpoint->set_allocated_status(status.release());
 }
 
+void SetInfoStatusMessage(
+    google::cloud::diagnostics::debug::Breakpoint *breakpoint,
+    const std::string &message) {
+  assert(breakpoint != nullptr);
+
+  std::unique_ptr<Status> status(new (std::nothrow) Status());
+  status->set_message(message);
+  status->set_iserror(false);
+  breakpoint->set_allocated_status(status.release());
+}
+
 vector<WCHAR> ConvertStringToWCharPtr(const std::string &target_string) {
   if (target_string.size() == 0) {
     return vector<WCHAR>();
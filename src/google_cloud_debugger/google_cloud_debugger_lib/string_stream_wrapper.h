@@ -76,6 +76,12 @@ void SetErrorStatusMessage(
     google::cloud::diagnostics::debug::Breakpoint *breakpoint,
     const std::string &err_string);
 
+// Sets the Status field of breakpoint to message without marking it as an
+// error, for snapshots that were captured only in part.
+void SetInfoStatusMessage(
+    google::cloud::diagnostics::debug::Breakpoint *breakpoint,
+    const std::string &message);
+
 // Helper function to convert a string to null-terminated WCHAR vector.
 // If target_string is empty or if there are failures,
 // this function returns an empty vector.
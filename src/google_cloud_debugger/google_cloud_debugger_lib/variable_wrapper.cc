@@ -18,6 +18,7 @@
 #include <queue>
 #include <vector>
 
+#include "i_eval_coordinator.h"
 #include "string_stream_wrapper.h"
 
 using google::cloud::diagnostics::debug::Variable;
@@ -53,6 +54,11 @@ HRESULT VariableWrapper::PerformBFS(queue<VariableWrapper>* bfs_queue,
       return S_OK;
     }
 
+    // Stops expanding objects once the breakpoint hit is out of pause time.
+    if (eval_coordinator && eval_coordinator->PauseTimeExhausted()) {
+      return S_OK;
+    }
+
     VariableWrapper current_variable = bfs_queue->front();
     // Populates the type of the variable into the variable proto.
     hr = current_variable.PopulateType();
@@ -49,7 +49,8 @@ public:
   // queue by populating their variable_proto_ with the underlying
   // object variable_value_.
   // Until the queue is empty, this method:
-  //  1. Checks if terminate_condition is true. If so, returns.
+  //  1. Checks if terminate_condition is true or if eval_coordinator
+  // is out of pause time. If so, returns.
   //  2. Pops out an item X.
   //  3. If X is null, continues with the loop.
   //  4. If the BFS level of X is kDefaultObjectEvalDepth,
@@ -145,6 +145,67 @@ TEST(BreakpointClientTest, ReadBreakpointError) {
   EXPECT_EQ(client.ReadBreakpoint(&read_breakpoint), E_ACCESSDENIED);
 }
 
+// Tests that ReadBreakpoints reads a batch of breakpoints, which arrives
+// in chunks, and then the single breakpoint that follows it.
+TEST(BreakpointClientTest, ReadBreakpoints) {
+  Breakpoint first_breakpoint;
+  Breakpoint second_breakpoint;
+  Breakpoint third_breakpoint;
+  string message = google_cloud_debugger::kStartBatchMessage +
+                   SetBreakpointAndSerialize(&first_breakpoint, true, 10,
+                                             "First Path") +
+                   SetBreakpointAndSerialize(&second_breakpoint, true, 20,
+                                             "Second Path") +
+                   google_cloud_debugger::kEndBatchMessage +
+                   SetBreakpointAndSerialize(&third_breakpoint, true, 30,
+                                             "Third Path");
+
+  vector<string> message_chunks;
+  int32_t chunk_size = 7;
+  for (string::size_type i = 0; i < message.length(); i += chunk_size) {
+    message_chunks.push_back(message.substr(i, chunk_size));
+  }
+
+  std::reverse(begin(message_chunks), end(message_chunks));
+
+  unique_ptr<INamedPipeMock> named_pipe(new (std::nothrow) INamedPipeMock());
+  assert(named_pipe != nullptr);
+
+  EXPECT_CALL(*named_pipe, Read(_))
+      .WillRepeatedly(
+          DoAll(ReadFromStringVectorToArg0(&message_chunks), Return(S_OK)));
+  BreakpointClient client(std::move(named_pipe));
+
+  vector<Breakpoint> read_breakpoints;
+  EXPECT_EQ(client.ReadBreakpoints(&read_breakpoints), S_OK);
+  ASSERT_EQ(read_breakpoints.size(), 2);
+  EXPECT_EQ(read_breakpoints[0].location().line(), 10);
+  EXPECT_EQ(read_breakpoints[0].location().path(), "First Path");
+  EXPECT_EQ(read_breakpoints[1].location().line(), 20);
+  EXPECT_EQ(read_breakpoints[1].location().path(), "Second Path");
+
+  read_breakpoints.clear();
+  EXPECT_EQ(client.ReadBreakpoints(&read_breakpoints), S_OK);
+  ASSERT_EQ(read_breakpoints.size(), 1);
+  EXPECT_EQ(read_breakpoints[0].location().line(), 30);
+  EXPECT_EQ(read_breakpoints[0].location().path(), "Third Path");
+}
+
+// Tests error case of ReadBreakpoints function of BreakpointClient.
+TEST(BreakpointClientTest, ReadBreakpointsError) {
+  unique_ptr<INamedPipeMock> named_pipe(new (std::nothrow) INamedPipeMock());
+  assert(named_pipe != nullptr);
+
+  EXPECT_CALL(*named_pipe, Read(_))
+      .Times(1)
+      .WillRepeatedly(Return(E_ACCESSDENIED));
+  BreakpointClient client(std::move(named_pipe));
+
+  vector<Breakpoint> read_breakpoints;
+  EXPECT_EQ(client.ReadBreakpoints(&read_breakpoints), E_ACCESSDENIED);
+  EXPECT_TRUE(read_breakpoints.empty());
+}
+
 // Tests WriteBreakpoint function of BreakpointClient.
 TEST(BreakpointClientTest, WriteBreakpoint) {
   Breakpoint breakpoint;
@@ -0,0 +1,473 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "breakpoint_collection.h"
+#include "ccomptr.h"
+#include "dbg_breakpoint.h"
+#include "debugger_callback.h"
+#include "i_cor_debug_mocks.h"
+#include "i_eval_coordinator_mock.h"
+#include "i_metadata_import_mock.h"
+#include "i_portable_pdb_mocks.h"
+
+using google::cloud::diagnostics::debug::Breakpoint;
+using google::cloud::diagnostics::debug::Breakpoint_LogLevel;
+using google_cloud_debugger::BreakpointCollection;
+using google_cloud_debugger::CComPtr;
+using google_cloud_debugger::DbgBreakpoint;
+using google_cloud_debugger::DebuggerCallback;
+using google_cloud_debugger::IBreakpointCollection;
+using google_cloud_debugger_portable_pdb::IPortablePdbFile;
+using google_cloud_debugger_portable_pdb::MethodInfo;
+using google_cloud_debugger_portable_pdb::SequencePoint;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using std::weak_ptr;
+using ::testing::_;
+using ::testing::DoAll;
+using ::testing::Invoke;
+using ::testing::Return;
+using ::testing::SetArgPointee;
+
+namespace google_cloud_debugger_test {
+
+// Token of the only method of the module.
+const mdMethodDef kMethodToken = 0x06000001;
+
+// File path of the breakpoints.
+const char kFilePath[] = "C:/Src/Test/Program.cs";
+
+// Test Fixture for BreakpointCollection. The PDB file of the module has
+// one document with a method whose sequence points start on lines 10, 14
+// and 20, so a breakpoint on line 12 is set on line 14.
+class BreakpointCollectionTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    MethodInfo method;
+    method.method_def = kMethodToken;
+    method.first_line = 10;
+    method.last_line = 30;
+    AddSequencePoint(&method, 10, 0);
+    AddSequencePoint(&method, 14, 8);
+    AddSequencePoint(&method, 20, 16);
+
+    IDocumentIndexFixture document;
+    document.file_name_ = kFilePath;
+    document.methods_.push_back(method);
+    pdb_fixture_.documents_.push_back(document);
+
+    pdb_file_ = std::make_shared<IPortablePdbFileMock>();
+    pdb_fixture_.SetUpIPortablePDBFile(pdb_file_.get());
+    ON_CALL(*pdb_file_, GetDebugModule(_))
+        .WillByDefault(DoAll(SetArgPointee<0>(&debug_module_), Return(S_OK)));
+    ON_CALL(*pdb_file_, GetMetaDataImport(_))
+        .WillByDefault(
+            DoAll(SetArgPointee<0>(&metadata_import_), Return(S_OK)));
+
+    // The module has a single global method.
+    ON_CALL(metadata_import_, EnumMethods(_, mdTypeDefNil, _, _, _))
+        .WillByDefault(Invoke([](HCORENUM *cor_enum, mdTypeDef class_token,
+                                 mdMethodDef method_tokens[], ULONG max_tokens,
+                                 ULONG *tokens_returned) {
+          *tokens_returned = *cor_enum ? 0 : 1;
+          *cor_enum = reinterpret_cast<HCORENUM>(1);
+          method_tokens[0] = kMethodToken;
+          return S_OK;
+        }));
+    ON_CALL(metadata_import_, GetMethodProps(_, _, _, _, _, _, _, _, _, _))
+        .WillByDefault(Invoke([](mdMethodDef method_token,
+                                 mdTypeDef *class_token, LPWSTR name,
+                                 ULONG name_length, ULONG *actual_name_length,
+                                 DWORD *attributes, PCCOR_SIGNATURE *signature,
+                                 ULONG *signature_length,
+                                 ULONG *virtual_address, DWORD *impl_flags) {
+          *class_token = mdTypeDefNil;
+          *actual_name_length = 1;
+          if (name && name_length > 0) {
+            name[0] = 0;
+          }
+          *attributes = 0;
+          *signature = nullptr;
+          *signature_length = 0;
+          *virtual_address = 0;
+          *impl_flags = 0;
+          return S_OK;
+        }));
+
+    ON_CALL(debug_module_, GetFunctionFromToken(kMethodToken, _))
+        .WillByDefault(
+            DoAll(SetArgPointee<1>(&debug_function_), Return(S_OK)));
+    ON_CALL(debug_function_, GetILCode(_))
+        .WillByDefault(DoAll(SetArgPointee<0>(&debug_code_), Return(S_OK)));
+    SetUpFunctionBreakpoint(&function_breakpoint_,
+                            &function_breakpoint_active_);
+    SetUpFunctionBreakpoint(&other_function_breakpoint_,
+                            &other_function_breakpoint_active_);
+    ON_CALL(debug_code_, CreateBreakpoint(_, _))
+        .WillByDefault(DoAll(SetArgPointee<1>(&function_breakpoint_),
+                             Return(S_OK)));
+
+    callback_ = new DebuggerCallback("pipe-name");
+    callback_->GetDocumentPathIndex()->AddPdbFile(pdb_file_);
+    collection_.reset(new BreakpointCollection());
+    HRESULT hr = collection_->SetDebuggerCallback(callback_);
+    EXPECT_TRUE(SUCCEEDED(hr)) << "Failed with hr: " << hr;
+  }
+
+  virtual void TearDown() { collection_.reset(); }
+
+  // Adds a sequence point that starts on line at il_offset to method.
+  static void AddSequencePoint(MethodInfo *method, uint32_t line,
+                               uint32_t il_offset) {
+    SequencePoint sequence_point;
+    sequence_point.start_line = line;
+    sequence_point.end_line = line;
+    sequence_point.il_offset = il_offset;
+    method->sequence_points.push_back(sequence_point);
+  }
+
+  // Makes breakpoint report itself as its ICorDebugFunctionBreakpoint
+  // and keep whether it is active in active.
+  static void SetUpFunctionBreakpoint(
+      ICorDebugFunctionBreakpointMock *breakpoint, bool *active) {
+    ON_CALL(*breakpoint, QueryInterface(_, _))
+        .WillByDefault(DoAll(SetArgPointee<1>(breakpoint), Return(S_OK)));
+    ON_CALL(*breakpoint, Activate(_))
+        .WillByDefault(Invoke([active](BOOL activate) {
+          *active = activate;
+          return S_OK;
+        }));
+    ON_CALL(*breakpoint, IsActive(_))
+        .WillByDefault(Invoke([active](BOOL *is_active) {
+          *is_active = *active;
+          return S_OK;
+        }));
+  }
+
+  // Returns a breakpoint with the given id on line of kFilePath.
+  static shared_ptr<DbgBreakpoint> MakeBreakpoint(const string &id,
+                                                  uint32_t line,
+                                                  bool activated) {
+    shared_ptr<DbgBreakpoint> breakpoint(new DbgBreakpoint());
+    breakpoint->Initialize(kFilePath, id, line, 0, false, "",
+                           Breakpoint_LogLevel::Breakpoint_LogLevel_INFO, "",
+                           vector<string>());
+    breakpoint->SetActivated(activated);
+    return breakpoint;
+  }
+
+  // Hits function_breakpoint and returns the ids of the breakpoints the
+  // collection hands to the eval coordinator, in ids.
+  HRESULT Hit(ICorDebugFunctionBreakpointMock *function_breakpoint,
+              vector<string> *ids) {
+    ids->clear();
+    ON_CALL(eval_coordinator_, ProcessBreakpoints(_, _, _, _))
+        .WillByDefault(Invoke(
+            [ids](ICorDebugThread *debug_thread,
+                  IBreakpointCollection *breakpoint_collection,
+                  const vector<shared_ptr<DbgBreakpoint>> &breakpoints,
+                  const vector<shared_ptr<IPortablePdbFile>> &pdb_files) {
+              for (const auto &breakpoint : breakpoints) {
+                ids->push_back(breakpoint->GetId());
+              }
+              return S_OK;
+            }));
+    return collection_->EvaluateAndPrintBreakpoint(
+        function_breakpoint, &eval_coordinator_, &debug_thread_,
+        vector<shared_ptr<IPortablePdbFile>>());
+  }
+
+  // Fixture for the PDB file of the module.
+  PortablePDBFileFixture pdb_fixture_;
+
+  // Mocks of the module and of its method.
+  ICorDebugModuleMock debug_module_;
+  IMetaDataImportMock metadata_import_;
+  ICorDebugFunctionMock debug_function_;
+  ICorDebugCodeMock debug_code_;
+
+  // ICorDebugFunctionBreakpoints created by debug_code_, and whether each
+  // of them is active.
+  ICorDebugFunctionBreakpointMock function_breakpoint_;
+  bool function_breakpoint_active_ = false;
+  ICorDebugFunctionBreakpointMock other_function_breakpoint_;
+  bool other_function_breakpoint_active_ = false;
+
+  // Thread and eval coordinator that hits are processed with.
+  ICorDebugThreadMock debug_thread_;
+  IEvalCoordinatorMock eval_coordinator_;
+
+  // The PDB file of the module.
+  shared_ptr<IPortablePdbFileMock> pdb_file_;
+
+  // Debugger callback holding the document path index of pdb_file_.
+  CComPtr<DebuggerCallback> callback_;
+
+  // The breakpoint collection being tested.
+  std::unique_ptr<BreakpointCollection> collection_;
+};
+
+// Tests that a breakpoint set on a later line than the one it was
+// requested at is deactivated by the line it was requested at.
+TEST_F(BreakpointCollectionTest, DeactivateMovedBreakpoint) {
+  EXPECT_CALL(debug_code_, CreateBreakpoint(8, _));
+  HRESULT hr = collection_->UpdateBreakpoint(*MakeBreakpoint("a", 12, true));
+  EXPECT_EQ(hr, S_OK);
+  EXPECT_TRUE(function_breakpoint_active_);
+
+  vector<string> ids;
+  EXPECT_EQ(Hit(&function_breakpoint_, &ids), S_OK);
+  EXPECT_EQ(ids, vector<string>({"a"}));
+
+  hr = collection_->UpdateBreakpoint(*MakeBreakpoint("a", 12, false));
+  EXPECT_EQ(hr, S_OK);
+  EXPECT_FALSE(function_breakpoint_active_);
+  EXPECT_EQ(Hit(&function_breakpoint_, &ids), S_FALSE);
+}
+
+// Tests that breakpoints requested at different lines that are set on the
+// same line are kept and deactivated separately.
+TEST_F(BreakpointCollectionTest, BreakpointsMovedToSameLine) {
+  EXPECT_CALL(debug_code_, CreateBreakpoint(8, _))
+      .WillOnce(DoAll(SetArgPointee<1>(&function_breakpoint_), Return(S_OK)))
+      .WillOnce(DoAll(SetArgPointee<1>(&other_function_breakpoint_),
+                      Return(S_OK)));
+  EXPECT_EQ(collection_->UpdateBreakpoint(*MakeBreakpoint("a", 12, true)),
+            S_OK);
+  EXPECT_EQ(collection_->UpdateBreakpoint(*MakeBreakpoint("b", 13, true)),
+            S_OK);
+
+  vector<string> ids;
+  EXPECT_EQ(Hit(&function_breakpoint_, &ids), S_OK);
+  EXPECT_EQ(ids, vector<string>({"a"}));
+  EXPECT_EQ(Hit(&other_function_breakpoint_, &ids), S_OK);
+  EXPECT_EQ(ids, vector<string>({"b"}));
+
+  EXPECT_EQ(collection_->UpdateBreakpoint(*MakeBreakpoint("a", 12, false)),
+            S_OK);
+  EXPECT_FALSE(function_breakpoint_active_);
+  EXPECT_TRUE(other_function_breakpoint_active_);
+  EXPECT_EQ(Hit(&function_breakpoint_, &ids), S_FALSE);
+  EXPECT_EQ(Hit(&other_function_breakpoint_, &ids), S_OK);
+  EXPECT_EQ(ids, vector<string>({"b"}));
+}
+
+// Tests that all the breakpoints of a batch at a new location are set,
+// including when the location moves to a later line.
+TEST_F(BreakpointCollectionTest, UpdateBreakpointsAtMovedLocation) {
+  EXPECT_CALL(debug_code_, CreateBreakpoint(8, _));
+  HRESULT hr = collection_->UpdateBreakpoints(
+      {MakeBreakpoint("a", 12, true), MakeBreakpoint("b", 12, true),
+       MakeBreakpoint("c", 12, true)});
+  EXPECT_EQ(hr, S_OK);
+
+  vector<string> ids;
+  EXPECT_EQ(Hit(&function_breakpoint_, &ids), S_OK);
+  EXPECT_EQ(ids, vector<string>({"a", "b", "c"}));
+
+  // The breakpoints stay at the location they were requested at.
+  hr = collection_->UpdateBreakpoints(
+      {MakeBreakpoint("a", 12, false), MakeBreakpoint("c", 12, false)});
+  EXPECT_EQ(hr, S_OK);
+  EXPECT_TRUE(function_breakpoint_active_);
+  EXPECT_EQ(Hit(&function_breakpoint_, &ids), S_OK);
+  EXPECT_EQ(ids, vector<string>({"b"}));
+}
+
+// Tests that the breakpoints of an unloaded module are set again once a
+// module with their document is indexed, and are still deactivated by the
+// line they were requested at.
+TEST_F(BreakpointCollectionTest, UnloadAndReloadModule) {
+  EXPECT_CALL(debug_code_, CreateBreakpoint(8, _))
+      .WillOnce(DoAll(SetArgPointee<1>(&function_breakpoint_), Return(S_OK)))
+      .WillOnce(DoAll(SetArgPointee<1>(&other_function_breakpoint_),
+                      Return(S_OK)));
+  HRESULT hr = collection_->UpdateBreakpoints(
+      {MakeBreakpoint("a", 12, true), MakeBreakpoint("b", 12, true)});
+  EXPECT_EQ(hr, S_OK);
+  EXPECT_EQ(collection_->SetPendingBreakpoints(), S_FALSE);
+
+  // The breakpoints are reported to the agent as unbound, but active.
+  vector<Breakpoint> unbound_breakpoints;
+  hr = collection_->RemoveBreakpointsInModule(&debug_module_,
+                                              &unbound_breakpoints);
+  EXPECT_EQ(hr, S_OK);
+  ASSERT_EQ(unbound_breakpoints.size(), 2);
+  EXPECT_EQ(unbound_breakpoints[0].id(), "a");
+  EXPECT_EQ(unbound_breakpoints[1].id(), "b");
+  for (const Breakpoint &unbound_breakpoint : unbound_breakpoints) {
+    EXPECT_TRUE(unbound_breakpoint.activated());
+    EXPECT_EQ(unbound_breakpoint.location().line(), 12);
+    EXPECT_FALSE(unbound_breakpoint.status().iserror());
+    EXPECT_FALSE(unbound_breakpoint.status().message().empty());
+    EXPECT_EQ(unbound_breakpoint.stack_frames_size(), 0);
+  }
+  vector<string> ids;
+  EXPECT_EQ(Hit(&function_breakpoint_, &ids), S_FALSE);
+
+  // Nothing is left to report when the module is unloaded again.
+  unbound_breakpoints.clear();
+  EXPECT_EQ(collection_->RemoveBreakpointsInModule(&debug_module_,
+                                                   &unbound_breakpoints),
+            S_OK);
+  EXPECT_TRUE(unbound_breakpoints.empty());
+
+  hr = collection_->SetPendingBreakpoints();
+  EXPECT_EQ(hr, S_OK);
+  EXPECT_TRUE(other_function_breakpoint_active_);
+  EXPECT_EQ(Hit(&other_function_breakpoint_, &ids), S_OK);
+  EXPECT_EQ(ids, vector<string>({"a", "b"}));
+  EXPECT_EQ(collection_->SetPendingBreakpoints(), S_FALSE);
+
+  hr = collection_->UpdateBreakpoints(
+      {MakeBreakpoint("a", 12, false), MakeBreakpoint("b", 12, false)});
+  EXPECT_EQ(hr, S_OK);
+  EXPECT_EQ(Hit(&other_function_breakpoint_, &ids), S_FALSE);
+}
+
+// Tests that the ICorDebugBreakpoint of a breakpoint that cannot be added
+// to the collection is deactivated again.
+TEST_F(BreakpointCollectionTest, DeactivateBreakpointThatFailsToAdd) {
+  EXPECT_CALL(debug_code_, CreateBreakpoint(8, _));
+  EXPECT_CALL(function_breakpoint_,
+              QueryInterface(__uuidof(ICorDebugFunctionBreakpoint), _))
+      .WillRepeatedly(Return(E_NOINTERFACE));
+
+  HRESULT hr = collection_->UpdateBreakpoint(*MakeBreakpoint("a", 12, true));
+  EXPECT_EQ(hr, E_NOINTERFACE);
+  EXPECT_FALSE(function_breakpoint_active_);
+  EXPECT_EQ(collection_->GetLocationCount(), 0);
+}
+
+// Tests that the breakpoints of an unloaded module that are deactivated
+// before the module is loaded again are never set.
+TEST_F(BreakpointCollectionTest, DeactivateBreakpointOfUnloadedModule) {
+  EXPECT_CALL(debug_code_, CreateBreakpoint(8, _));
+  EXPECT_EQ(collection_->UpdateBreakpoint(*MakeBreakpoint("a", 12, true)),
+            S_OK);
+  vector<Breakpoint> unbound_breakpoints;
+  EXPECT_EQ(collection_->RemoveBreakpointsInModule(&debug_module_,
+                                                   &unbound_breakpoints),
+            S_OK);
+
+  EXPECT_EQ(collection_->UpdateBreakpoint(*MakeBreakpoint("a", 12, false)),
+            S_OK);
+  EXPECT_EQ(collection_->SetPendingBreakpoints(), S_FALSE);
+}
+
+// Tests that a hit after an update sees the breakpoints of that update.
+TEST_F(BreakpointCollectionTest, HitSeesLatestSnapshot) {
+  EXPECT_CALL(debug_code_, CreateBreakpoint(8, _));
+  EXPECT_EQ(collection_->UpdateBreakpoint(*MakeBreakpoint("a", 12, true)),
+            S_OK);
+  vector<string> ids;
+  EXPECT_EQ(Hit(&function_breakpoint_, &ids), S_OK);
+  EXPECT_EQ(ids, vector<string>({"a"}));
+
+  EXPECT_EQ(collection_->UpdateBreakpoint(*MakeBreakpoint("b", 12, true)),
+            S_OK);
+  EXPECT_EQ(Hit(&function_breakpoint_, &ids), S_OK);
+  EXPECT_EQ(ids, vector<string>({"a", "b"}));
+
+  EXPECT_EQ(collection_->UpdateBreakpoint(*MakeBreakpoint("a", 12, false)),
+            S_OK);
+  EXPECT_EQ(Hit(&function_breakpoint_, &ids), S_OK);
+  EXPECT_EQ(ids, vector<string>({"b"}));
+}
+
+// Tests that a snapshot replaced while no hit is in progress is freed.
+TEST_F(BreakpointCollectionTest, RetiredSnapshotIsFreed) {
+  EXPECT_CALL(debug_code_, CreateBreakpoint(8, _));
+  EXPECT_EQ(collection_->UpdateBreakpoints(
+                {MakeBreakpoint("a", 12, true), MakeBreakpoint("b", 12, true)}),
+            S_OK);
+
+  // Only the collection and its snapshot hold breakpoint a once the hit
+  // is processed.
+  weak_ptr<DbgBreakpoint> breakpoint_a;
+  ON_CALL(eval_coordinator_, ProcessBreakpoints(_, _, _, _))
+      .WillByDefault(Invoke(
+          [&breakpoint_a](
+              ICorDebugThread *debug_thread,
+              IBreakpointCollection *breakpoint_collection,
+              const vector<shared_ptr<DbgBreakpoint>> &breakpoints,
+              const vector<shared_ptr<IPortablePdbFile>> &pdb_files) {
+            breakpoint_a = breakpoints.front();
+            return S_OK;
+          }));
+  EXPECT_EQ(collection_->EvaluateAndPrintBreakpoint(
+                &function_breakpoint_, &eval_coordinator_, &debug_thread_,
+                vector<shared_ptr<IPortablePdbFile>>()),
+            S_OK);
+  ASSERT_FALSE(breakpoint_a.expired());
+  EXPECT_EQ(breakpoint_a.lock()->GetId(), "a");
+
+  // Removing a publishes a snapshot without it. No hit is reading the
+  // snapshot that held a, so it is freed right away.
+  EXPECT_EQ(collection_->UpdateBreakpoint(*MakeBreakpoint("a", 12, false)),
+            S_OK);
+  EXPECT_TRUE(breakpoint_a.expired());
+
+  vector<string> ids;
+  EXPECT_EQ(Hit(&function_breakpoint_, &ids), S_OK);
+  EXPECT_EQ(ids, vector<string>({"b"}));
+}
+
+// Tests that a snapshot replaced while a hit reads it stays alive until
+// the hit ends, and is freed by the next update after that.
+TEST_F(BreakpointCollectionTest, SnapshotRetiredDuringHitIsFreed) {
+  EXPECT_CALL(debug_code_, CreateBreakpoint(8, _));
+  EXPECT_EQ(collection_->UpdateBreakpoints(
+                {MakeBreakpoint("a", 12, true), MakeBreakpoint("b", 12, true)}),
+            S_OK);
+
+  // Removes a while the hit is processing the snapshot that holds it.
+  weak_ptr<DbgBreakpoint> breakpoint_a;
+  ON_CALL(eval_coordinator_, ProcessBreakpoints(_, _, _, _))
+      .WillByDefault(Invoke(
+          [this, &breakpoint_a](
+              ICorDebugThread *debug_thread,
+              IBreakpointCollection *breakpoint_collection,
+              const vector<shared_ptr<DbgBreakpoint>> &breakpoints,
+              const vector<shared_ptr<IPortablePdbFile>> &pdb_files) {
+            breakpoint_a = breakpoints.front();
+            EXPECT_EQ(
+                collection_->UpdateBreakpoint(*MakeBreakpoint("a", 12, false)),
+                S_OK);
+            EXPECT_EQ(breakpoints.front()->GetId(), "a");
+            return S_OK;
+          }));
+  EXPECT_EQ(collection_->EvaluateAndPrintBreakpoint(
+                &function_breakpoint_, &eval_coordinator_, &debug_thread_,
+                vector<shared_ptr<IPortablePdbFile>>()),
+            S_OK);
+  EXPECT_FALSE(breakpoint_a.expired());
+
+  EXPECT_EQ(collection_->UpdateBreakpoint(*MakeBreakpoint("c", 12, true)),
+            S_OK);
+  EXPECT_TRUE(breakpoint_a.expired());
+
+  vector<string> ids;
+  EXPECT_EQ(Hit(&function_breakpoint_, &ids), S_OK);
+  EXPECT_EQ(ids, vector<string>({"b", "c"}));
+}
+
+}  // namespace google_cloud_debugger_test
@@ -15,7 +15,11 @@
 #include <gtest/gtest.h>
 
 #include <array>
+#include <cstdio>
+#include <fstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "custom_binary_reader.h"
 
@@ -23,6 +27,7 @@ using std::array;
 using std::string;
 using std::stringstream;
 using std::unique_ptr;
+using std::vector;
 
 namespace google_cloud_debugger_test {
 
@@ -170,4 +175,135 @@ TEST(BinaryReader, GetStringTest) {
   EXPECT_EQ(second_string, "def");
 }
 
+// Tests that a memory-mapped file can be read the same way as a stream.
+TEST(BinaryReader, MemoryMappedFileTest) {
+  char test_data[] = {'a', 'b', 'c', 0,    0x02, 0x80, 0x80, 0x7F,
+                      0x03, 0x01, 0x02, 0x03};
+  string file_name = "custom_binary_stream_test.bin";
+  {
+    std::ofstream file(file_name, std::ios::out | std::ios::binary);
+    file.write(test_data, sizeof(test_data));
+  }
+
+  google_cloud_debugger_portable_pdb::CustomBinaryStream binary_stream;
+  EXPECT_FALSE(binary_stream.ConsumeFile("file_that_does_not_exist.bin"));
+  EXPECT_TRUE(binary_stream.ConsumeFile(file_name));
+
+  std::string result_string;
+  EXPECT_TRUE(binary_stream.GetString(&result_string, 0));
+  EXPECT_EQ(result_string, "abc");
+  EXPECT_EQ(binary_stream.Current(), 0);
+
+  EXPECT_FALSE(binary_stream.SeekFromOrigin(20));
+  EXPECT_TRUE(binary_stream.SeekFromOrigin(4));
+
+  uint8_t byte;
+  EXPECT_TRUE(binary_stream.Peek(&byte));
+  EXPECT_EQ(byte, 0x02);
+  EXPECT_TRUE(binary_stream.ReadByte(&byte));
+  EXPECT_EQ(byte, 0x02);
+
+  uint32_t unsigned_int;
+  EXPECT_TRUE(binary_stream.ReadCompressedUInt32(&unsigned_int));
+  EXPECT_EQ(unsigned_int, 0x80);
+
+  // The stream ends right after the 0x7F byte.
+  EXPECT_FALSE(binary_stream.SetStreamLength(10));
+  EXPECT_TRUE(binary_stream.SetStreamLength(1));
+  EXPECT_TRUE(binary_stream.ReadCompressedUInt32(&unsigned_int));
+  EXPECT_EQ(unsigned_int, 0x7F);
+  EXPECT_FALSE(binary_stream.HasNext());
+  EXPECT_FALSE(binary_stream.ReadByte(&byte));
+  binary_stream.ResetStreamLength();
+
+  std::vector<uint8_t> blob;
+  EXPECT_TRUE(binary_stream.GetBlobBytes(8, &blob));
+  EXPECT_EQ(blob, std::vector<uint8_t>({0x01, 0x02, 0x03}));
+  EXPECT_EQ(binary_stream.Current(), 8);
+
+  std::remove(file_name.c_str());
+}
+
+// Tests that a copy of a stream is a cursor of its own over the same bytes.
+TEST(BinaryReader, CopyTest) {
+  char test_data[] = {0x01, 0x02, 0x03, 0x04};
+  unique_ptr<stringstream> test_stream =
+      SetUpStream(test_data, sizeof(test_data));
+  google_cloud_debugger_portable_pdb::CustomBinaryStream binary_stream;
+
+  EXPECT_TRUE(binary_stream.ConsumeStream(test_stream.release()));
+  EXPECT_TRUE(binary_stream.SeekFromOrigin(1));
+  EXPECT_TRUE(binary_stream.SetStreamLength(2));
+
+  // The copy starts where the original is, with the same length.
+  google_cloud_debugger_portable_pdb::CustomBinaryStream copy = binary_stream;
+  uint8_t byte;
+  EXPECT_TRUE(copy.ReadByte(&byte));
+  EXPECT_EQ(byte, 0x02);
+  EXPECT_TRUE(copy.ReadByte(&byte));
+  EXPECT_EQ(byte, 0x03);
+  EXPECT_FALSE(copy.HasNext());
+
+  // Moving the copy does not move the original.
+  EXPECT_EQ(binary_stream.Current(), 1);
+  EXPECT_EQ(binary_stream.Remaining(), 2);
+  copy.ResetStreamLength();
+  EXPECT_TRUE(copy.ReadByte(&byte));
+  EXPECT_EQ(byte, 0x04);
+  EXPECT_EQ(binary_stream.Remaining(), 2);
+}
+
+// Tests that threads can read the same bytes at the same time, each
+// through its own copy of the stream.
+TEST(BinaryReader, ConcurrentReadTest) {
+  const int kNumThreads = 8;
+  const int kNumReads = 2000;
+  char test_data[] = {'a',  'b',  'c',  0,    0x03, 0x01,
+                      0x02, 0x03, 0x80, 0x80, 0xAE, 0x57};
+  unique_ptr<stringstream> test_stream =
+      SetUpStream(test_data, sizeof(test_data));
+  google_cloud_debugger_portable_pdb::CustomBinaryStream binary_stream;
+  EXPECT_TRUE(binary_stream.ConsumeStream(test_stream.release()));
+
+  vector<std::thread> threads;
+  vector<int> failures(kNumThreads, 0);
+  for (int thread = 0; thread < kNumThreads; ++thread) {
+    threads.push_back(std::thread([&binary_stream, &failures, thread]() {
+      for (int i = 0; i < kNumReads; ++i) {
+        string result_string;
+        if (!binary_stream.GetString(&result_string, 0) ||
+            result_string != "abc") {
+          ++failures[thread];
+        }
+
+        vector<uint8_t> blob;
+        if (!binary_stream.GetBlobBytes(4, &blob) ||
+            blob != vector<uint8_t>({0x01, 0x02, 0x03})) {
+          ++failures[thread];
+        }
+
+        google_cloud_debugger_portable_pdb::CustomBinaryStream cursor =
+            binary_stream;
+        uint32_t first_int;
+        uint32_t second_int;
+        if (!cursor.SeekFromOrigin(8) ||
+            !cursor.ReadCompressedUInt32(&first_int) ||
+            !cursor.ReadCompressedUInt32(&second_int) || first_int != 0x80 ||
+            second_int != 0x2E57 || cursor.HasNext()) {
+          ++failures[thread];
+        }
+      }
+    }));
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  for (int thread = 0; thread < kNumThreads; ++thread) {
+    EXPECT_EQ(failures[thread], 0);
+  }
+  // The shared stream itself never moved.
+  EXPECT_EQ(binary_stream.Current(), 0);
+}
+
 }  // namespace google_cloud_debugger_test
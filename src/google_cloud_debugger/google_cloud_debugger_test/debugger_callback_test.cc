@@ -14,30 +14,63 @@
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <chrono>
+#include <functional>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "ccomptr.h"
 #include "common_action_mocks.h"
+#include "dbg_breakpoint.h"
 #include "debugger_callback.h"
 #include "i_cor_debug_mocks.h"
 #include "i_eval_coordinator_mock.h"
 #include "i_metadata_import_mock.h"
+#include "i_portable_pdb_mocks.h"
 
 using ::testing::_;
 using ::testing::AtLeast;
 using ::testing::DoAll;
+using ::testing::Invoke;
 using ::testing::Return;
 using ::testing::SetArgPointee;
 using ::testing::SetArrayArgument;
+using google::cloud::diagnostics::debug::Breakpoint_LogLevel;
 using google_cloud_debugger::CComPtr;
 using google_cloud_debugger::ConvertStringToWCharPtr;
+using google_cloud_debugger::DbgBreakpoint;
 using google_cloud_debugger::DebuggerCallback;
+using google_cloud_debugger::DocumentPathIndex;
+using google_cloud_debugger::FrameLocation;
+using google_cloud_debugger::FrameSymbolCache;
+using google_cloud_debugger::FrameSymbols;
+using google_cloud_debugger::IBreakpointCollection;
+using google_cloud_debugger::IEvalCoordinator;
+using google_cloud_debugger::MethodTokenTableCache;
+using google_cloud_debugger_portable_pdb::IPortablePdbFile;
+using google_cloud_debugger_portable_pdb::MethodInfo;
+using google_cloud_debugger_portable_pdb::SequencePoint;
+using std::shared_ptr;
 using std::string;
 using std::vector;
+using std::weak_ptr;
 
 namespace google_cloud_debugger_test {
 
+// Number of times a module is loaded and unloaded in LoadAndUnloadModule.
+const int kLoadUnloadCycles = 1000;
+
+// Path of the module loaded and unloaded by the tests.
+const char kModulePath[] = "/app/plugins/Plugin.dll";
+
+// Token of the only method of the module.
+const mdMethodDef kMethodToken = 0x06000001;
+
+// File path of the only document of the PDB file of the module.
+const char kFilePath[] = "C:/Src/Test/Program.cs";
+
 // Test Fixture for DebuggerCallback.
 // Contains various ICorDebug mock objects needed.
 class DebuggerCallbackTest : public ::testing::Test {
@@ -65,27 +98,143 @@ class DebuggerCallbackTest : public ::testing::Test {
         .Times(AtLeast(1))
         .WillRepeatedly(Return(S_OK));
 
-    EXPECT_CALL(debug_breakpoint_mock_, GetFunction(_))
-        .Times(1)
+    // The breakpoints are looked up from the ICorDebugBreakpoint itself,
+    // without asking the debuggee for its function or IL offset.
+    EXPECT_CALL(debug_breakpoint_mock_, GetFunction(_)).Times(0);
+    EXPECT_CALL(debug_breakpoint_mock_, GetOffset(_)).Times(0);
+    EXPECT_CALL(debug_module_, GetMetaDataInterface(_, _)).Times(0);
+  }
+
+  // Sets up debug_module_ as module kModulePath, with a single global
+  // method whose code creates function_breakpoint_.
+  void SetUpModule() {
+    module_name_ = ConvertStringToWCharPtr(kModulePath);
+    ULONG32 module_name_len = module_name_.size();
+    EXPECT_CALL(debug_module_, GetName(0, _, nullptr))
         .WillRepeatedly(
-            DoAll(SetArgPointee<0>(&debug_function_), Return(S_OK)));
+            DoAll(SetArgPointee<1>(module_name_len), Return(S_OK)));
+    EXPECT_CALL(debug_module_, GetName(module_name_len, _, _))
+        .WillRepeatedly(DoAll(
+            SetArgPointee<1>(module_name_len),
+            SetArg2ToWcharArray(module_name_.data(), module_name_len),
+            Return(S_OK)));
 
-    EXPECT_CALL(debug_function_, GetToken(_))
-        .Times(1)
-        .WillRepeatedly(Return(S_OK));
+    ON_CALL(metadata_import_, EnumMethods(_, mdTypeDefNil, _, _, _))
+        .WillByDefault(Invoke([](HCORENUM *cor_enum, mdTypeDef class_token,
+                                 mdMethodDef method_tokens[], ULONG max_tokens,
+                                 ULONG *tokens_returned) {
+          *tokens_returned = *cor_enum ? 0 : 1;
+          *cor_enum = reinterpret_cast<HCORENUM>(1);
+          method_tokens[0] = kMethodToken;
+          return S_OK;
+        }));
+    ON_CALL(metadata_import_, GetMethodProps(_, _, _, _, _, _, _, _, _, _))
+        .WillByDefault(Invoke([](mdMethodDef method_token,
+                                 mdTypeDef *class_token, LPWSTR name,
+                                 ULONG name_length, ULONG *actual_name_length,
+                                 DWORD *attributes, PCCOR_SIGNATURE *signature,
+                                 ULONG *signature_length,
+                                 ULONG *virtual_address, DWORD *impl_flags) {
+          *class_token = mdTypeDefNil;
+          *actual_name_length = 1;
+          if (name && name_length > 0) {
+            name[0] = 0;
+          }
+          *attributes = 0;
+          *signature = nullptr;
+          *signature_length = 0;
+          *virtual_address = 0;
+          *impl_flags = 0;
+          return S_OK;
+        }));
 
-    EXPECT_CALL(debug_breakpoint_mock_, GetOffset(_))
-        .Times(1)
-        .WillRepeatedly(Return(S_OK));
+    ON_CALL(debug_module_, GetFunctionFromToken(kMethodToken, _))
+        .WillByDefault(
+            DoAll(SetArgPointee<1>(&debug_function_), Return(S_OK)));
+    ON_CALL(debug_function_, GetILCode(_))
+        .WillByDefault(DoAll(SetArgPointee<0>(&debug_code_), Return(S_OK)));
+    ON_CALL(debug_code_, CreateBreakpoint(8, _))
+        .WillByDefault(DoAll(SetArgPointee<1>(&function_breakpoint_),
+                             Return(S_OK)));
 
-    EXPECT_CALL(debug_function_, GetModule(_))
-        .Times(1)
-        .WillRepeatedly(DoAll(SetArgPointee<0>(&debug_module_), Return(S_OK)));
+    bool *active = &function_breakpoint_active_;
+    ON_CALL(function_breakpoint_, QueryInterface(_, _))
+        .WillByDefault(
+            DoAll(SetArgPointee<1>(&function_breakpoint_), Return(S_OK)));
+    ON_CALL(function_breakpoint_, Activate(_))
+        .WillByDefault(Invoke([active](BOOL activate) {
+          *active = activate;
+          return S_OK;
+        }));
+    ON_CALL(function_breakpoint_, IsActive(_))
+        .WillByDefault(Invoke([active](BOOL *is_active) {
+          *is_active = *active;
+          return S_OK;
+        }));
+  }
 
-    EXPECT_CALL(debug_module_, GetMetaDataInterface(_, _))
-        .Times(1)
-        .WillRepeatedly(
-            DoAll(SetArgPointee<1>(&metadata_import_), Return(S_OK)));
+  // Returns a PDB file of debug_module_ set up by pdb_fixture, with one
+  // document at kFilePath. Its method has sequence points on lines 10, 14
+  // and 20, so a breakpoint on line 12 is set on line 14.
+  shared_ptr<IPortablePdbFileMock> CreatePdbFile(
+      PortablePDBFileFixture *pdb_fixture) {
+    MethodInfo method;
+    method.method_def = kMethodToken;
+    method.first_line = 10;
+    method.last_line = 30;
+    for (uint32_t line : {10, 14, 20}) {
+      SequencePoint sequence_point;
+      sequence_point.start_line = line;
+      sequence_point.end_line = line;
+      sequence_point.il_offset = method.sequence_points.size() * 8;
+      method.sequence_points.push_back(sequence_point);
+    }
+
+    IDocumentIndexFixture document;
+    document.file_name_ = kFilePath;
+    document.methods_.push_back(method);
+    pdb_fixture->documents_.push_back(document);
+    pdb_fixture->module_name_ = kModulePath;
+
+    shared_ptr<IPortablePdbFileMock> pdb_file =
+        std::make_shared<IPortablePdbFileMock>();
+    pdb_fixture->SetUpIPortablePDBFile(pdb_file.get());
+    ON_CALL(*pdb_file, GetDebugModule(_))
+        .WillByDefault(DoAll(SetArgPointee<0>(&debug_module_), Return(S_OK)));
+    ON_CALL(*pdb_file, GetMetaDataImport(_))
+        .WillByDefault(
+            DoAll(SetArgPointee<0>(&metadata_import_), Return(S_OK)));
+
+    shared_ptr<bool> unloaded = std::make_shared<bool>(false);
+    ON_CALL(*pdb_file, MarkUnloaded())
+        .WillByDefault(Invoke([unloaded]() { *unloaded = true; }));
+    ON_CALL(*pdb_file, IsUnloaded())
+        .WillByDefault(Invoke([unloaded]() { return *unloaded; }));
+    return pdb_file;
+  }
+
+  // Returns an activated breakpoint on line 12 of kFilePath.
+  static shared_ptr<DbgBreakpoint> MakeBreakpoint() {
+    shared_ptr<DbgBreakpoint> breakpoint(new DbgBreakpoint());
+    breakpoint->Initialize(kFilePath, "a", 12, 0, false, "",
+                           Breakpoint_LogLevel::Breakpoint_LogLevel_INFO, "",
+                           vector<string>());
+    breakpoint->SetActivated(true);
+    return breakpoint;
+  }
+
+  // Waits up to a few seconds for condition to become true, and returns
+  // whether it did.
+  static bool WaitFor(std::function<bool()> condition) {
+    auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!condition()) {
+      if (std::chrono::steady_clock::now() > deadline) {
+        return false;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
   }
 
   // The debugger callback object being tested.
@@ -103,14 +252,23 @@ class DebuggerCallbackTest : public ::testing::Test {
   // Breakpoint used by callback functions.
   ICorDebugFunctionBreakpointMock debug_breakpoint_mock_;
 
-  // Function that the breakpoint above is in.
-  ICorDebugFunctionMock debug_function_;
-
-  // Module that the function above is in.
+  // Module loaded and unloaded by the tests.
   ICorDebugModuleMock debug_module_;
 
   // MetaDataImport from the module above.
   IMetaDataImportMock metadata_import_;
+
+  // Name of debug_module_.
+  vector<WCHAR> module_name_;
+
+  // The method of debug_module_ and its code.
+  ICorDebugFunctionMock debug_function_;
+  ICorDebugCodeMock debug_code_;
+
+  // ICorDebugFunctionBreakpoint created by debug_code_, and whether it
+  // is active.
+  ICorDebugFunctionBreakpointMock function_breakpoint_;
+  bool function_breakpoint_active_ = false;
 };
 
 // Tests Breakpoint callback function of DbgArray.
@@ -130,9 +288,10 @@ TEST_F(DebuggerCallbackTest, BreakpointError) {
   HRESULT hr = callback->Initialize();
   EXPECT_TRUE(SUCCEEDED(hr)) << "Failed with hr: " << hr;
 
-  // Makes ICorDebugFunctionBreakpoint returns error when GetFunction is called.
-  EXPECT_CALL(debug_breakpoint_mock_, GetFunction(_))
-      .WillRepeatedly(Return(CORDBG_E_FUNCTION_NOT_IL));
+  // Makes the breakpoint fail to return its ICorDebugFunctionBreakpoint.
+  EXPECT_CALL(debug_breakpoint_mock_,
+              QueryInterface(__uuidof(ICorDebugFunctionBreakpoint), _))
+      .WillRepeatedly(Return(E_NOINTERFACE));
 
   // Even if there are error, Continue should still be called.
   EXPECT_CALL(app_domain_mock_, Continue(FALSE))
@@ -141,7 +300,102 @@ TEST_F(DebuggerCallbackTest, BreakpointError) {
 
   hr = callback->Breakpoint(&app_domain_mock_, &debug_thread_mock_,
                            &debug_breakpoint_mock_);
-  EXPECT_EQ(hr, CORDBG_E_FUNCTION_NOT_IL);
+  EXPECT_EQ(hr, E_NOINTERFACE);
+}
+
+// Tests that a module that is loaded and unloaded over and over, like
+// the modules of a collectible AssemblyLoadContext, leaves nothing behind
+// even though a breakpoint is bound in it on every load.
+TEST_F(DebuggerCallbackTest, LoadAndUnloadModule) {
+  IEvalCoordinatorMock *eval_coordinator = new IEvalCoordinatorMock();
+  EXPECT_CALL(*eval_coordinator, WriteBreakpointsAsync(_, _))
+      .Times(kLoadUnloadCycles)
+      .WillRepeatedly(Return(S_OK));
+  callback->SetEvalCoordinator(
+      std::unique_ptr<IEvalCoordinator>(eval_coordinator));
+
+  // Each load gets a PDB file of its own. The fixtures outlive the PDB
+  // files, which return references into them.
+  vector<std::unique_ptr<PortablePDBFileFixture>> pdb_fixtures;
+  vector<weak_ptr<IPortablePdbFileMock>> pdb_files;
+  callback->SetPdbFileFactory([this, &pdb_fixtures, &pdb_files]() {
+    std::unique_ptr<PortablePDBFileFixture> pdb_fixture(
+        new PortablePDBFileFixture());
+    shared_ptr<IPortablePdbFileMock> pdb_file =
+        CreatePdbFile(pdb_fixture.get());
+    pdb_fixtures.push_back(std::move(pdb_fixture));
+    pdb_files.push_back(pdb_file);
+    return shared_ptr<IPortablePdbFile>(pdb_file);
+  });
+
+  HRESULT hr = callback->Initialize();
+  ASSERT_TRUE(SUCCEEDED(hr)) << "Failed with hr: " << hr;
+
+  SetUpModule();
+  EXPECT_CALL(app_domain_mock_, Continue(FALSE))
+      .Times(2 * kLoadUnloadCycles)
+      .WillRepeatedly(Return(S_OK));
+
+  DocumentPathIndex *document_path_index = callback->GetDocumentPathIndex();
+  MethodTokenTableCache *method_token_tables =
+      callback->GetMethodTokenTables();
+  FrameSymbolCache *frame_symbol_cache = callback->GetFrameSymbolCache();
+  IBreakpointCollection *breakpoint_collection =
+      callback->GetBreakpointCollection();
+  size_t index_memory = document_path_index->GetMemoryUsage();
+  size_t document_count = document_path_index->GetDocumentCount();
+  size_t table_count = method_token_tables->GetTableCount();
+  size_t frame_entry_count = frame_symbol_cache->GetEntryCount();
+
+  for (int i = 0; i < kLoadUnloadCycles; ++i) {
+    EXPECT_EQ(callback->LoadModule(&app_domain_mock_, &debug_module_), S_OK);
+    ASSERT_EQ(pdb_files.size(), i + 1u);
+    shared_ptr<IPortablePdbFileMock> pdb_file = pdb_files.back().lock();
+    ASSERT_TRUE(pdb_file);
+
+    // The module indexer adds the PDB file to the index, and sets again
+    // the breakpoint that was pending since the previous unload.
+    ASSERT_TRUE(WaitFor([document_path_index, &pdb_file]() {
+      return document_path_index->HasPdbFile(pdb_file.get());
+    }));
+    if (i == 0) {
+      EXPECT_EQ(breakpoint_collection->UpdateBreakpoint(*MakeBreakpoint()),
+                S_OK);
+    }
+    ASSERT_TRUE(WaitFor([breakpoint_collection]() {
+      return breakpoint_collection->GetLocationCount() == 1;
+    }));
+    EXPECT_EQ(breakpoint_collection->GetPendingLocationCount(), 0);
+    EXPECT_TRUE(function_breakpoint_active_);
+
+    // A hit in the module fills the frame symbol cache.
+    frame_symbol_cache->AddSymbols(&debug_module_, kMethodToken,
+                                   FrameSymbols());
+    frame_symbol_cache->AddLocation(&debug_module_, kMethodToken, 8,
+                                    FrameLocation());
+
+    EXPECT_GT(document_path_index->GetDocumentCount(), document_count);
+    EXPECT_EQ(callback->GetPdbFiles().size(), 1);
+    EXPECT_GT(method_token_tables->GetTableCount(), table_count);
+    EXPECT_GT(frame_symbol_cache->GetEntryCount(), frame_entry_count);
+
+    EXPECT_EQ(callback->UnloadModule(&app_domain_mock_, &debug_module_),
+              S_OK);
+    EXPECT_EQ(document_path_index->GetDocumentCount(), document_count);
+    ASSERT_TRUE(callback->GetPdbFiles().empty());
+    EXPECT_EQ(method_token_tables->GetTableCount(), table_count);
+    EXPECT_EQ(frame_symbol_cache->GetEntryCount(), frame_entry_count);
+    EXPECT_EQ(breakpoint_collection->GetLocationCount(), 0);
+    EXPECT_EQ(breakpoint_collection->GetPendingLocationCount(), 1);
+    EXPECT_FALSE(function_breakpoint_active_);
+
+    // The module indexer may still be returning from its callback.
+    pdb_file.reset();
+    EXPECT_TRUE(
+        WaitFor([&pdb_files]() { return pdb_files.back().expired(); }));
+  }
+
+  EXPECT_EQ(document_path_index->GetMemoryUsage(), index_memory);
 }
 
 }  // namespace google_cloud_debugger_test
@@ -0,0 +1,340 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "document_index.h"
+#include "i_portable_pdb_mocks.h"
+
+using ::testing::_;
+using ::testing::DoAll;
+using ::testing::Invoke;
+using ::testing::Return;
+using ::testing::ReturnRef;
+using ::testing::SetArgPointee;
+using google_cloud_debugger_portable_pdb::DocumentIndex;
+using google_cloud_debugger_portable_pdb::DocumentRow;
+using google_cloud_debugger_portable_pdb::FindSequencePointAtOffset;
+using google_cloud_debugger_portable_pdb::LocalConstantRow;
+using google_cloud_debugger_portable_pdb::LocalScopeRow;
+using google_cloud_debugger_portable_pdb::LocalVariableRow;
+using google_cloud_debugger_portable_pdb::MethodDebugInformationRow;
+using google_cloud_debugger_portable_pdb::MethodInfo;
+using google_cloud_debugger_portable_pdb::MethodSequencePointInformation;
+using google_cloud_debugger_portable_pdb::SequencePoint;
+using google_cloud_debugger_portable_pdb::SequencePointRecord;
+using google_cloud_debugger_portable_pdb::StringPool;
+using std::string;
+using std::vector;
+
+namespace google_cloud_debugger_test {
+
+// Number of methods in the synthetic PDB.
+const uint32_t kNumMethods = 2000;
+
+// Number of scopes each method has in the synthetic PDB.
+const uint32_t kScopesPerMethod = 3;
+
+// Test Fixture for DocumentIndex.
+// Sets up an IPortablePdbFileMock with synthetic metadata tables for
+// 2 documents and kNumMethods methods. Odd methods are in document 1 and
+// even methods are in document 2. Every method has kScopesPerMethod scopes,
+// each of which owns 1 local variable. The first scope of every method also
+// owns 1 local constant.
+class DocumentIndexTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    // Metadata tables are 1-indexed so row 0 is always empty.
+    document_table_.resize(3);
+    method_debug_info_table_.resize(kNumMethods + 1);
+    local_scope_table_.resize(1);
+    local_variable_table_.resize(1);
+    local_constant_table_.resize(1);
+    document_methods_.resize(3);
+
+    for (uint32_t method_def = 1; method_def <= kNumMethods; ++method_def) {
+      uint32_t document = (method_def % 2 == 1) ? 1 : 2;
+      method_debug_info_table_[method_def].document = document;
+      method_debug_info_table_[method_def].sequence_points = method_def;
+      document_methods_[document].push_back(method_def);
+
+      // The LocalScope table is sorted by method.
+      for (uint32_t scope = 0; scope < kScopesPerMethod; ++scope) {
+        LocalScopeRow scope_row;
+        scope_row.method_def = method_def;
+        scope_row.import_scope = 0;
+        scope_row.variable_list = local_variable_table_.size();
+        scope_row.constant_list = local_constant_table_.size();
+        scope_row.start_offset = scope * 10;
+        scope_row.length = 10;
+        local_scope_table_.push_back(scope_row);
+
+        LocalVariableRow variable_row;
+        variable_row.attributes = 0;
+        variable_row.index = scope;
+        // The name index encodes both the method and the slot.
+        variable_row.name = method_def * kScopesPerMethod + scope;
+        local_variable_table_.push_back(variable_row);
+
+        if (scope == 0) {
+          LocalConstantRow constant_row;
+          constant_row.name = method_def * kScopesPerMethod;
+          constant_row.signature = 0;
+          local_constant_table_.push_back(constant_row);
+        }
+      }
+    }
+
+    ON_CALL(pdb_file_mock_, GetDocumentTable())
+        .WillByDefault(ReturnRef(document_table_));
+    ON_CALL(pdb_file_mock_, GetMethodDebugInfoTable())
+        .WillByDefault(ReturnRef(method_debug_info_table_));
+    ON_CALL(pdb_file_mock_, GetLocalScopeTable())
+        .WillByDefault(ReturnRef(local_scope_table_));
+    ON_CALL(pdb_file_mock_, GetLocalVariableTable())
+        .WillByDefault(ReturnRef(local_variable_table_));
+    ON_CALL(pdb_file_mock_, GetLocalConstantTable())
+        .WillByDefault(ReturnRef(local_constant_table_));
+    ON_CALL(pdb_file_mock_, GetDocumentMethods(1))
+        .WillByDefault(ReturnRef(document_methods_[1]));
+    ON_CALL(pdb_file_mock_, GetDocumentMethods(2))
+        .WillByDefault(ReturnRef(document_methods_[2]));
+
+    ON_CALL(pdb_file_mock_, GetDocumentName(_, _))
+        .WillByDefault(DoAll(SetArgPointee<1>(file_name_), Return(true)));
+    ON_CALL(pdb_file_mock_, GetHeapGuid(_, _)).WillByDefault(Return(true));
+    ON_CALL(pdb_file_mock_, GetHash(_, _)).WillByDefault(Return(true));
+    ON_CALL(pdb_file_mock_, GetBlobBytes(_, _)).WillByDefault(Return(true));
+
+    // Each method has a single sequence point on the line that is the
+    // same as its method def.
+    ON_CALL(pdb_file_mock_, GetMethodSeqInfo(_, _, _))
+        .WillByDefault(Invoke([](uint32_t doc_index, uint32_t sequence_index,
+                                 MethodSequencePointInformation *info) {
+          SequencePointRecord record;
+          record.start_line = sequence_index;
+          record.end_line = sequence_index;
+          record.start_col = 1;
+          record.end_col = 2;
+          info->records.push_back(record);
+          return true;
+        }));
+
+    ON_CALL(pdb_file_mock_, GetHeapString(_, _))
+        .WillByDefault(Invoke([](uint32_t index, string *result) {
+          *result = "var" + std::to_string(index);
+          return true;
+        }));
+  }
+
+  // Checks that the methods of document are the methods with
+  // method defs first_method_def, first_method_def + 2, ...
+  void CheckMethods(const DocumentIndex &document, uint32_t first_method_def) {
+    const vector<MethodInfo> &methods = document.GetMethods();
+    ASSERT_EQ(methods.size(), kNumMethods / 2);
+
+    uint32_t method_def = first_method_def;
+    for (const MethodInfo &method : methods) {
+      EXPECT_EQ(method.method_def, method_def);
+      EXPECT_EQ(method.first_line, method_def);
+      EXPECT_EQ(method.last_line, method_def);
+      ASSERT_EQ(method.sequence_points.size(), 1);
+
+      ASSERT_EQ(method.local_scope.size(), kScopesPerMethod);
+      for (uint32_t scope = 0; scope < kScopesPerMethod; ++scope) {
+        const auto &local_scope = method.local_scope[scope];
+        EXPECT_EQ(local_scope.start_offset, scope * 10);
+        ASSERT_EQ(local_scope.local_variables.size(), 1);
+        EXPECT_EQ(local_scope.local_variables[0].slot, scope);
+        EXPECT_EQ(document.GetStringPool().Get(
+                      local_scope.local_variables[0].name),
+                  "var" + std::to_string(method_def * kScopesPerMethod +
+                                         scope));
+        EXPECT_EQ(local_scope.local_constants.size(), scope == 0 ? 1 : 0);
+      }
+
+      method_def += 2;
+    }
+  }
+
+  // Name of the documents.
+  string file_name_ = "Program.cs";
+
+  // Synthetic metadata tables.
+  vector<DocumentRow> document_table_;
+  vector<MethodDebugInformationRow> method_debug_info_table_;
+  vector<LocalScopeRow> local_scope_table_;
+  vector<LocalVariableRow> local_variable_table_;
+  vector<LocalConstantRow> local_constant_table_;
+
+  // Method defs of the methods in each document.
+  vector<vector<uint32_t>> document_methods_;
+
+  IPortablePdbFileMock pdb_file_mock_;
+};
+
+// Tests that DocumentIndex finds the methods, scopes, variables and
+// constants of each document in a PDB with many methods.
+TEST_F(DocumentIndexTest, ManyMethods) {
+  DocumentIndex first_document;
+  EXPECT_TRUE(first_document.Initialize(pdb_file_mock_, 1));
+  EXPECT_EQ(first_document.GetFilePath(), file_name_);
+  CheckMethods(first_document, 1);
+
+  DocumentIndex second_document;
+  EXPECT_TRUE(second_document.Initialize(pdb_file_mock_, 2));
+  CheckMethods(second_document, 2);
+}
+
+// Tests that the methods of a document can be parsed in ranges on
+// several threads.
+TEST_F(DocumentIndexTest, ParseMethodsInParallel) {
+  const size_t kMethodsPerRange = 64;
+  DocumentIndex document;
+  ASSERT_TRUE(document.BeginInitialize(pdb_file_mock_, 1));
+  ASSERT_EQ(document.GetMethods().size(), kNumMethods / 2);
+
+  // Not a vector<bool>, whose elements cannot be written concurrently.
+  vector<int> parsed((kNumMethods / 2 + kMethodsPerRange - 1) /
+                     kMethodsPerRange);
+  vector<std::thread> threads;
+  for (size_t range = 0; range < parsed.size(); ++range) {
+    threads.push_back(std::thread([this, &document, &parsed, range]() {
+      size_t first = range * kMethodsPerRange;
+      size_t last = std::min<size_t>(first + kMethodsPerRange, kNumMethods / 2);
+      if (document.ParseMethods(pdb_file_mock_, first, last)) {
+        parsed[range] = 1;
+      }
+    }));
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  document.EndInitialize();
+
+  for (size_t range = 0; range < parsed.size(); ++range) {
+    EXPECT_EQ(parsed[range], 1);
+  }
+  CheckMethods(document, 1);
+
+  // The line index covers the methods parsed by every thread.
+  const MethodInfo *method;
+  SequencePoint sequence_point;
+  EXPECT_TRUE(document.FindBreakpointLocation(kNumMethods - 1, &method,
+                                              &sequence_point));
+  EXPECT_EQ(method->method_def, kNumMethods - 1);
+
+  // Ranges past the end of the document are rejected.
+  EXPECT_FALSE(document.ParseMethods(pdb_file_mock_, 0, kNumMethods / 2 + 1));
+}
+
+// Tests that methods without any local scope are handled.
+TEST_F(DocumentIndexTest, MethodsWithoutScopes) {
+  // Removes the scopes of every other method in the first document.
+  vector<LocalScopeRow> local_scope_table(1);
+  for (size_t i = 1; i < local_scope_table_.size(); ++i) {
+    if (local_scope_table_[i].method_def % 4 != 1) {
+      local_scope_table.push_back(local_scope_table_[i]);
+    }
+  }
+  local_scope_table_ = local_scope_table;
+
+  DocumentIndex document;
+  EXPECT_TRUE(document.Initialize(pdb_file_mock_, 1));
+
+  const vector<MethodInfo> &methods = document.GetMethods();
+  ASSERT_EQ(methods.size(), kNumMethods / 2);
+  for (const MethodInfo &method : methods) {
+    EXPECT_EQ(method.local_scope.size(),
+              method.method_def % 4 == 1 ? 0 : kScopesPerMethod);
+  }
+}
+
+// Tests that the segments of the file paths of documents that share a
+// string pool are interned in it.
+TEST_F(DocumentIndexTest, FilePathSegments) {
+  std::shared_ptr<StringPool> string_pool(new StringPool());
+  ON_CALL(pdb_file_mock_, GetDocumentName(_, _))
+      .WillByDefault(DoAll(SetArgPointee<1>("/App/Models/Person.cs"),
+                           Return(true)));
+  DocumentIndex first_document(string_pool);
+  ASSERT_TRUE(first_document.Initialize(pdb_file_mock_, 1));
+
+  ON_CALL(pdb_file_mock_, GetDocumentName(_, _))
+      .WillByDefault(DoAll(SetArgPointee<1>("C:\\App\\Models\\Order.cs"),
+                           Return(true)));
+  DocumentIndex second_document(string_pool);
+  ASSERT_TRUE(second_document.Initialize(pdb_file_mock_, 2));
+
+  const vector<const string *> &first_segments =
+      first_document.GetFilePathSegments();
+  ASSERT_EQ(first_segments.size(), 4);
+  EXPECT_EQ(*first_segments[0], "person.cs");
+  EXPECT_EQ(*first_segments[1], "models");
+  EXPECT_EQ(*first_segments[2], "app");
+  EXPECT_EQ(*first_segments[3], "");
+
+  // Both documents point to the same "models" and "app" strings.
+  const vector<const string *> &second_segments =
+      second_document.GetFilePathSegments();
+  ASSERT_EQ(second_segments.size(), 4);
+  EXPECT_EQ(*second_segments[0], "order.cs");
+  EXPECT_EQ(second_segments[1], first_segments[1]);
+  EXPECT_EQ(second_segments[2], first_segments[2]);
+  EXPECT_EQ(*second_segments[3], "c:");
+}
+
+// Tests that initializing a document index fails if the document
+// index is out of range.
+TEST_F(DocumentIndexTest, InvalidDocument) {
+  DocumentIndex document;
+  EXPECT_FALSE(document.Initialize(pdb_file_mock_, 0));
+  EXPECT_FALSE(document.Initialize(pdb_file_mock_, 3));
+}
+
+// Tests that FindSequencePointAtOffset returns the last non-hidden
+// sequence point at or before an IL offset.
+TEST(FindSequencePointAtOffsetTest, SkipsHiddenSequencePoints) {
+  MethodInfo method;
+  uint32_t il_offsets[] = {0, 6, 10, 18};
+  bool hidden[] = {false, true, false, false};
+  for (int i = 0; i < 4; ++i) {
+    SequencePoint sequence_point;
+    sequence_point.il_offset = il_offsets[i];
+    sequence_point.start_line = 100 + i;
+    sequence_point.is_hidden = hidden[i];
+    method.sequence_points.push_back(sequence_point);
+  }
+
+  SequencePoint sequence_point;
+  ASSERT_TRUE(FindSequencePointAtOffset(method, 0, &sequence_point));
+  EXPECT_EQ(sequence_point.start_line, 100);
+  ASSERT_TRUE(FindSequencePointAtOffset(method, 8, &sequence_point));
+  EXPECT_EQ(sequence_point.start_line, 100);
+  ASSERT_TRUE(FindSequencePointAtOffset(method, 17, &sequence_point));
+  EXPECT_EQ(sequence_point.start_line, 102);
+  ASSERT_TRUE(FindSequencePointAtOffset(method, 500, &sequence_point));
+  EXPECT_EQ(sequence_point.start_line, 103);
+
+  MethodInfo empty_method;
+  EXPECT_FALSE(FindSequencePointAtOffset(empty_method, 8, &sequence_point));
+}
+
+}  // namespace google_cloud_debugger_test
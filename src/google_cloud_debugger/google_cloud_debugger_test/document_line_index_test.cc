@@ -0,0 +1,244 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "document_index.h"
+#include "document_line_index.h"
+
+using google_cloud_debugger_portable_pdb::DocumentLineIndex;
+using google_cloud_debugger_portable_pdb::MethodInfo;
+using google_cloud_debugger_portable_pdb::SequencePoint;
+using std::vector;
+
+namespace google_cloud_debugger_test {
+
+// Returns a method spanning first_line to last_line with a sequence point
+// on each line in lines, in that (IL) order. The sequence point at
+// position hidden_position, if any, is hidden.
+MethodInfo MakeMethod(uint32_t method_def, uint32_t first_line,
+                      uint32_t last_line, const vector<uint32_t> &lines,
+                      uint32_t hidden_position = UINT32_MAX) {
+  MethodInfo method;
+  method.method_def = method_def;
+  method.first_line = first_line;
+  method.last_line = last_line;
+  for (uint32_t line : lines) {
+    SequencePoint sequence_point;
+    sequence_point.il_offset = method.sequence_points.size() * 2;
+    sequence_point.start_line = line;
+    sequence_point.end_line = line;
+    sequence_point.is_hidden =
+        method.sequence_points.size() == hidden_position;
+    method.sequence_points.push_back(sequence_point);
+  }
+  return method;
+}
+
+// Tests lookups in methods that do not overlap.
+TEST(DocumentLineIndexTest, DisjointMethods) {
+  vector<MethodInfo> methods;
+  methods.push_back(MakeMethod(1, 20, 25, {20, 22, 25}));
+  methods.push_back(MakeMethod(2, 10, 15, {10, 12, 15}));
+
+  DocumentLineIndex line_index;
+  line_index.Build(methods);
+
+  uint32_t method_index;
+  uint32_t sequence_point_index;
+  EXPECT_TRUE(line_index.FindBreakpointLocation(11, &method_index,
+                                                &sequence_point_index));
+  EXPECT_EQ(method_index, 1);
+  EXPECT_EQ(sequence_point_index, 1);
+
+  EXPECT_TRUE(line_index.FindBreakpointLocation(25, &method_index,
+                                                &sequence_point_index));
+  EXPECT_EQ(method_index, 0);
+  EXPECT_EQ(sequence_point_index, 2);
+
+  // Before, between and after the methods.
+  EXPECT_FALSE(line_index.FindBreakpointLocation(5, &method_index,
+                                                 &sequence_point_index));
+  EXPECT_FALSE(line_index.FindBreakpointLocation(17, &method_index,
+                                                 &sequence_point_index));
+  EXPECT_FALSE(line_index.FindBreakpointLocation(30, &method_index,
+                                                 &sequence_point_index));
+}
+
+// Tests that the innermost method is chosen and that enclosing methods
+// are used when the innermost one has no sequence point for the line.
+TEST(DocumentLineIndexTest, NestedMethods) {
+  vector<MethodInfo> methods;
+  // A method with a lambda on lines 12 to 14 and another on line 16.
+  methods.push_back(MakeMethod(1, 10, 20, {10, 11, 12, 16, 18, 20}));
+  methods.push_back(MakeMethod(2, 12, 14, {13}));
+  methods.push_back(MakeMethod(3, 16, 16, {16}));
+
+  DocumentLineIndex line_index;
+  line_index.Build(methods);
+
+  uint32_t method_index;
+  uint32_t sequence_point_index;
+  EXPECT_TRUE(line_index.FindBreakpointLocation(13, &method_index,
+                                                &sequence_point_index));
+  EXPECT_EQ(method_index, 1);
+  EXPECT_EQ(sequence_point_index, 0);
+
+  // Line 14 is in the first lambda, but it has no sequence point there.
+  EXPECT_TRUE(line_index.FindBreakpointLocation(14, &method_index,
+                                                &sequence_point_index));
+  EXPECT_EQ(method_index, 0);
+  EXPECT_EQ(sequence_point_index, 3);
+
+  EXPECT_TRUE(line_index.FindBreakpointLocation(16, &method_index,
+                                                &sequence_point_index));
+  EXPECT_EQ(method_index, 2);
+  EXPECT_EQ(sequence_point_index, 0);
+
+  EXPECT_TRUE(line_index.FindBreakpointLocation(17, &method_index,
+                                                &sequence_point_index));
+  EXPECT_EQ(method_index, 0);
+  EXPECT_EQ(sequence_point_index, 4);
+}
+
+// Tests that the first matching sequence point in IL order is chosen and
+// that hidden sequence points are skipped.
+TEST(DocumentLineIndexTest, SequencePointOrder) {
+  vector<MethodInfo> methods;
+  // A loop: the condition on line 12 comes after the body in IL.
+  methods.push_back(MakeMethod(1, 10, 20, {10, 14, 15, 12, 20}, 1));
+
+  DocumentLineIndex line_index;
+  line_index.Build(methods);
+
+  uint32_t method_index;
+  uint32_t sequence_point_index;
+  EXPECT_TRUE(line_index.FindBreakpointLocation(11, &method_index,
+                                                &sequence_point_index));
+  EXPECT_EQ(sequence_point_index, 2);
+
+  EXPECT_TRUE(line_index.FindBreakpointLocation(13, &method_index,
+                                                &sequence_point_index));
+  EXPECT_EQ(sequence_point_index, 2);
+
+  EXPECT_TRUE(line_index.FindBreakpointLocation(16, &method_index,
+                                                &sequence_point_index));
+  EXPECT_EQ(sequence_point_index, 4);
+}
+
+// Tests that the first of several methods with the same lines is chosen.
+TEST(DocumentLineIndexTest, SameLines) {
+  vector<MethodInfo> methods;
+  // Getter and setter of an auto-implemented property.
+  methods.push_back(MakeMethod(1, 10, 10, {10}));
+  methods.push_back(MakeMethod(2, 10, 10, {10}));
+
+  DocumentLineIndex line_index;
+  line_index.Build(methods);
+
+  uint32_t method_index;
+  uint32_t sequence_point_index;
+  EXPECT_TRUE(line_index.FindBreakpointLocation(10, &method_index,
+                                                &sequence_point_index));
+  EXPECT_EQ(method_index, 0);
+}
+
+// Tests a document with many methods and methods without sequence points.
+TEST(DocumentLineIndexTest, ManyMethods) {
+  const uint32_t kNumMethods = 5000;
+  vector<MethodInfo> methods;
+  methods.push_back(MethodInfo());
+  // Methods without sequence points have their first line after
+  // their last line.
+  methods.back().first_line = UINT32_MAX;
+  for (uint32_t i = 0; i < kNumMethods; ++i) {
+    uint32_t first_line = (kNumMethods - i) * 10;
+    methods.push_back(MakeMethod(i, first_line, first_line + 5,
+                                 {first_line + 1, first_line + 5}));
+  }
+
+  DocumentLineIndex line_index;
+  line_index.Build(methods);
+
+  for (uint32_t i = 0; i < kNumMethods; ++i) {
+    uint32_t first_line = (kNumMethods - i) * 10;
+    uint32_t method_index;
+    uint32_t sequence_point_index;
+    EXPECT_TRUE(line_index.FindBreakpointLocation(
+        first_line + 2, &method_index, &sequence_point_index));
+    EXPECT_EQ(method_index, i + 1);
+    EXPECT_EQ(sequence_point_index, 1);
+
+    EXPECT_FALSE(line_index.FindBreakpointLocation(
+        first_line + 7, &method_index, &sequence_point_index));
+  }
+}
+
+// Tests that a view of the tables of an index finds the same locations,
+// and that a view of corrupted tables fails lookups instead of reading out
+// of bounds.
+TEST(DocumentLineIndexTest, View) {
+  vector<MethodInfo> methods;
+  methods.push_back(MakeMethod(1, 10, 30, {10, 12, 30}));
+  methods.push_back(MakeMethod(2, 15, 20, {16, 18}));
+
+  DocumentLineIndex line_index;
+  line_index.Build(methods);
+  vector<DocumentLineIndex::MethodEntry> entries(
+      line_index.GetMethodEntries(),
+      line_index.GetMethodEntries() + line_index.GetMethodEntryCount());
+  vector<DocumentLineIndex::SequencePointLine> lines(
+      line_index.GetSequencePointLines(),
+      line_index.GetSequencePointLines() +
+          line_index.GetSequencePointLineCount());
+
+  DocumentLineIndex view;
+  view.SetView(entries.data(), entries.size(), lines.data(), lines.size(),
+               methods.size());
+  EXPECT_EQ(view.GetMemoryUsage(), 0);
+  EXPECT_EQ(view.GetMethodEntries(), entries.data());
+
+  uint32_t method_index;
+  uint32_t sequence_point_index;
+  for (uint32_t line = 5; line < 35; ++line) {
+    uint32_t expected_method_index;
+    uint32_t expected_sequence_point_index;
+    bool found = line_index.FindBreakpointLocation(
+        line, &expected_method_index, &expected_sequence_point_index);
+    EXPECT_EQ(view.FindBreakpointLocation(line, &method_index,
+                                          &sequence_point_index),
+              found);
+    if (found) {
+      EXPECT_EQ(method_index, expected_method_index);
+      EXPECT_EQ(sequence_point_index, expected_sequence_point_index);
+    }
+  }
+
+  // The nested method links to itself, and its lines end past the table.
+  entries[1].parent = 1;
+  EXPECT_FALSE(view.FindBreakpointLocation(19, &method_index,
+                                           &sequence_point_index));
+  entries[1].parent = 0;
+  entries[1].lines_end = lines.size() + 1;
+  EXPECT_FALSE(view.FindBreakpointLocation(17, &method_index,
+                                           &sequence_point_index));
+  entries[1].lines_end = entries[1].lines_begin;
+  entries[1].method_index = 2;
+  EXPECT_FALSE(view.FindBreakpointLocation(17, &method_index,
+                                           &sequence_point_index));
+}
+
+}  // namespace google_cloud_debugger_test
@@ -0,0 +1,198 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "document_path_index.h"
+#include "i_portable_pdb_mocks.h"
+
+using google_cloud_debugger::DocumentPathIndex;
+using google_cloud_debugger::DocumentPathMatch;
+using google_cloud_debugger::SplitNormalizedFilePath;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using std::weak_ptr;
+using ::testing::Return;
+
+namespace google_cloud_debugger_test {
+
+// Number of times a module is loaded and unloaded in LoadUnloadCycles.
+const int kLoadUnloadCycles = 10000;
+
+// Test Fixture for DocumentPathIndex.
+// Sets up two PDB files whose documents have overlapping paths.
+class DocumentPathIndexTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    first_pdb_fixture_.documents_.resize(2);
+    first_pdb_fixture_.documents_[0].file_name_ = "/app/Program.cs";
+    first_pdb_fixture_.documents_[1].file_name_ = "/app/Models/Person.cs";
+    first_pdb_fixture_.SetUpIPortablePDBFile(first_pdb_.get());
+
+    second_pdb_fixture_.documents_.resize(2);
+    second_pdb_fixture_.documents_[0].file_name_ = "C:\\Lib\\Program.cs";
+    second_pdb_fixture_.documents_[1].file_name_ = "C:\\Lib\\Models\\Person.cs";
+    second_pdb_fixture_.SetUpIPortablePDBFile(second_pdb_.get());
+
+    path_index_.AddPdbFile(first_pdb_);
+    path_index_.AddPdbFile(second_pdb_);
+  }
+
+  // Returns the matches of path in path_index_.
+  vector<DocumentPathMatch> FindDocuments(const string &path) {
+    return path_index_.FindDocuments(SplitNormalizedFilePath(path));
+  }
+
+  PortablePDBFileFixture first_pdb_fixture_;
+  PortablePDBFileFixture second_pdb_fixture_;
+  shared_ptr<IPortablePdbFileMock> first_pdb_{new IPortablePdbFileMock()};
+  shared_ptr<IPortablePdbFileMock> second_pdb_{new IPortablePdbFileMock()};
+  DocumentPathIndex path_index_;
+};
+
+// Tests that paths are split from the file name up and normalized.
+TEST(SplitNormalizedFilePathTest, Split) {
+  EXPECT_EQ(SplitNormalizedFilePath("/App/Models/Person.cs"),
+            vector<string>({"person.cs", "models", "app", ""}));
+  EXPECT_EQ(SplitNormalizedFilePath("C:\\App\\Person.cs"),
+            vector<string>({"person.cs", "app", "c:"}));
+  EXPECT_EQ(SplitNormalizedFilePath("Person.cs"),
+            vector<string>({"person.cs"}));
+}
+
+// Tests that the documents with the longest common suffix are returned.
+TEST_F(DocumentPathIndexTest, LongestSuffix) {
+  vector<DocumentPathMatch> matches = FindDocuments("lib/models/person.cs");
+  ASSERT_EQ(matches.size(), 1);
+  EXPECT_EQ(matches[0].pdb_file, second_pdb_);
+  EXPECT_EQ(matches[0].document_index, 1);
+
+  matches = FindDocuments("/src/APP/Program.cs");
+  ASSERT_EQ(matches.size(), 1);
+  EXPECT_EQ(matches[0].pdb_file, first_pdb_);
+  EXPECT_EQ(matches[0].document_index, 0);
+}
+
+// Tests that all the documents with the longest common suffix are
+// returned, in the order they were added.
+TEST_F(DocumentPathIndexTest, SeveralMatches) {
+  vector<DocumentPathMatch> matches = FindDocuments("src/models/person.cs");
+  ASSERT_EQ(matches.size(), 2);
+  EXPECT_EQ(matches[0].pdb_file, first_pdb_);
+  EXPECT_EQ(matches[0].document_index, 1);
+  EXPECT_EQ(matches[1].pdb_file, second_pdb_);
+  EXPECT_EQ(matches[1].document_index, 1);
+
+  matches = FindDocuments("Program.cs");
+  ASSERT_EQ(matches.size(), 2);
+  EXPECT_EQ(matches[0].pdb_file, first_pdb_);
+  EXPECT_EQ(matches[1].pdb_file, second_pdb_);
+}
+
+// Tests that nothing matches a path with a different file name.
+TEST_F(DocumentPathIndexTest, NoMatch) {
+  EXPECT_TRUE(FindDocuments("/app/Models/Program2.cs").empty());
+  EXPECT_TRUE(FindDocuments("").empty());
+}
+
+// Tests that adding a PDB file twice does not duplicate its documents.
+TEST_F(DocumentPathIndexTest, AddPdbFileTwice) {
+  EXPECT_TRUE(path_index_.HasPdbFile(first_pdb_.get()));
+  path_index_.AddPdbFile(first_pdb_);
+  EXPECT_EQ(FindDocuments("Program.cs").size(), 2);
+
+  IPortablePdbFileMock other_pdb;
+  EXPECT_FALSE(path_index_.HasPdbFile(&other_pdb));
+}
+
+// Tests that removing a PDB file removes its documents only.
+TEST_F(DocumentPathIndexTest, RemovePdbFile) {
+  path_index_.RemovePdbFile(first_pdb_.get());
+  EXPECT_FALSE(path_index_.HasPdbFile(first_pdb_.get()));
+
+  vector<DocumentPathMatch> matches = FindDocuments("/app/Program.cs");
+  ASSERT_EQ(matches.size(), 1);
+  EXPECT_EQ(matches[0].pdb_file, second_pdb_);
+
+  matches = FindDocuments("Models/Person.cs");
+  ASSERT_EQ(matches.size(), 1);
+  EXPECT_EQ(matches[0].pdb_file, second_pdb_);
+  EXPECT_EQ(matches[0].document_index, 1);
+
+  // Removing it again does nothing.
+  path_index_.RemovePdbFile(first_pdb_.get());
+  EXPECT_EQ(FindDocuments("Program.cs").size(), 1);
+
+  // It can be added back.
+  path_index_.AddPdbFile(first_pdb_);
+  EXPECT_EQ(FindDocuments("Program.cs").size(), 2);
+}
+
+// Tests that the PDB file of an unloaded module is not added.
+TEST_F(DocumentPathIndexTest, UnloadedPdbFile) {
+  PortablePDBFileFixture pdb_fixture;
+  pdb_fixture.documents_.resize(1);
+  pdb_fixture.documents_[0].file_name_ = "/plugin/Program.cs";
+  shared_ptr<IPortablePdbFileMock> pdb(new IPortablePdbFileMock());
+  pdb_fixture.SetUpIPortablePDBFile(pdb.get());
+  EXPECT_CALL(*pdb, IsUnloaded()).WillRepeatedly(Return(true));
+
+  path_index_.AddPdbFile(pdb);
+  EXPECT_FALSE(path_index_.HasPdbFile(pdb.get()));
+  EXPECT_EQ(FindDocuments("Program.cs").size(), 2);
+}
+
+// Tests that loading and unloading modules over and over neither grows
+// the index nor keeps the PDB files alive. Every module has its own
+// directory, so the trie nodes of unloaded modules have to be freed.
+TEST_F(DocumentPathIndexTest, LoadUnloadCycles) {
+  PortablePDBFileFixture pdb_fixture;
+  pdb_fixture.documents_.resize(2);
+
+  size_t memory_usage = 0;
+  for (int i = 0; i < kLoadUnloadCycles; ++i) {
+    string directory = "/plugin" + std::to_string(i);
+    pdb_fixture.documents_[0].file_name_ = directory + "/Program.cs";
+    pdb_fixture.documents_[1].file_name_ = directory + "/Views/Index.cs";
+    shared_ptr<IPortablePdbFileMock> pdb(
+        new ::testing::NiceMock<IPortablePdbFileMock>());
+    pdb_fixture.document_indices_.clear();
+    pdb_fixture.SetUpIPortablePDBFile(pdb.get());
+    weak_ptr<IPortablePdbFileMock> weak_pdb = pdb;
+
+    path_index_.AddPdbFile(pdb);
+    ASSERT_EQ(FindDocuments("Views/Index.cs").size(), 1);
+    path_index_.RemovePdbFile(pdb.get());
+    ASSERT_TRUE(FindDocuments("Views/Index.cs").empty());
+
+    pdb.reset();
+    ASSERT_TRUE(weak_pdb.expired());
+
+    if (i == 0) {
+      memory_usage = path_index_.GetMemoryUsage();
+    } else {
+      ASSERT_EQ(path_index_.GetMemoryUsage(), memory_usage);
+    }
+  }
+
+  EXPECT_EQ(FindDocuments("Program.cs").size(), 2);
+}
+
+}  // namespace google_cloud_debugger_test
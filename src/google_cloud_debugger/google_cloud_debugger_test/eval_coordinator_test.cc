@@ -14,9 +14,13 @@
 
 #include <gtest/gtest.h>
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <fstream>
+#include <future>
 #include <memory>
 #include <string>
+#include <thread>
 
 #include "ccomptr.h"
 #include "common_action_mocks.h"
@@ -24,13 +28,18 @@
 #include "debugger_callback.h"
 #include "eval_coordinator.h"
 #include "i_breakpoint_collection_mock.h"
+#include "i_portable_pdb_mocks.h"
 
 using ::testing::_;
 using ::testing::DoAll;
+using ::testing::Invoke;
 using ::testing::Return;
+using ::testing::SetArgPointee;
+using google::cloud::diagnostics::debug::Breakpoint;
 using google_cloud_debugger::CComPtr;
 using google_cloud_debugger::EvalCoordinator;
 using std::chrono::high_resolution_clock;
+using std::chrono::milliseconds;
 using std::chrono::minutes;
 using std::chrono::seconds;
 using std::string;
@@ -40,6 +49,25 @@ using std::vector;
 
 namespace google_cloud_debugger_test {
 
+// Number of breakpoint hits simulated by the stress test.
+const int kStressHits = 1000000;
+
+// Number of hits before the stress test takes its first measurements.
+const int kStressWarmUpHits = 10000;
+
+// Returns the value of field (for example "Threads:") in
+// /proc/self/status, or -1 if it cannot be read.
+static long ReadProcessStatus(const string &field) {
+  std::ifstream status("/proc/self/status");
+  string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, field.size(), field) == 0) {
+      return std::stol(line.substr(field.size()));
+    }
+  }
+  return -1;
+}
+
 // Test fixture for EvalCoordinator tests.
 class EvalCoordinatorTest : public ::testing::Test {
  protected:
@@ -64,6 +92,9 @@ class EvalCoordinatorTest : public ::testing::Test {
   // The ICorDebugEval being evaluated.
   ICorDebugEvalMock eval_;
 
+  // The ICorDebugEval2 of eval_, used to rudely abort it.
+  ICorDebugEval2Mock eval2_;
+
   // The ICorDebugStackWalk passed to PrintBreakpoint function.
   ICorDebugStackWalkMock debug_stack_walk_;
 
@@ -95,23 +126,97 @@ TEST_F(EvalCoordinatorTest, TestWaitForEvalError) {
   EXPECT_EQ(hr, CORDBG_E_BAD_REFERENCE_VALUE);
 }
 
-// Tests that WaitForEval will time out after one minute.
+// Tests that WaitForEval aborts an evaluation that runs past its timeout,
+// then rudely aborts it, then gives up on it.
 TEST_F(EvalCoordinatorTest, TestWaitForEvalTimeOut) {
+  eval_coordinator_.SetEvalTimeouts(milliseconds(100), seconds(10));
+
   // If GetResult returns this, WaitForEval will keep trying until time out.
   EXPECT_CALL(eval_, GetResult(_))
       .WillRepeatedly(Return(CORDBG_E_FUNC_EVAL_NOT_COMPLETE));
+  EXPECT_CALL(eval_, Abort()).Times(1).WillOnce(Return(S_OK));
+  EXPECT_CALL(eval_, QueryInterface(_, _))
+      .WillOnce(DoAll(SetArgPointee<1>(&eval2_), Return(S_OK)));
+  EXPECT_CALL(eval2_, RudeAbort()).Times(1).WillOnce(Return(S_OK));
   auto start = high_resolution_clock::now();
-  minutes one_minute = minutes(1);
 
   HRESULT hr =
       eval_coordinator_.WaitForEval(&exception_thrown, &eval_, &eval_result_);
   auto end = high_resolution_clock::now();
-  // Checks that the WaitForEval times out after 1 minute.
-  EXPECT_TRUE(end - start > one_minute);
+  // Checks that WaitForEval gives up after the evaluation timeout and
+  // the time it gives each abort.
+  EXPECT_TRUE(end - start > milliseconds(100));
+  EXPECT_TRUE(end - start < seconds(10));
+
+  EXPECT_EQ(hr, CORDBG_E_FUNC_EVAL_NOT_COMPLETE);
+}
+
+// Tests that an evaluation that WaitForEval gave up on does not block the
+// debugger callback when it finishes later.
+TEST_F(EvalCoordinatorTest, TestAbandonedEvalFinishes) {
+  eval_coordinator_.SetEvalTimeouts(milliseconds(100), seconds(10));
+
+  EXPECT_CALL(eval_, GetResult(_))
+      .WillRepeatedly(Return(CORDBG_E_FUNC_EVAL_NOT_COMPLETE));
+  EXPECT_CALL(eval_, Abort()).WillOnce(Return(E_FAIL));
+  EXPECT_CALL(eval_, QueryInterface(_, _))
+      .WillOnce(DoAll(SetArgPointee<1>(&eval2_), Return(S_OK)));
+  EXPECT_CALL(eval2_, RudeAbort()).WillOnce(Return(E_FAIL));
+
+  HRESULT hr =
+      eval_coordinator_.WaitForEval(&exception_thrown, &eval_, &eval_result_);
+  EXPECT_EQ(hr, CORDBG_E_FUNC_EVAL_NOT_COMPLETE);
+
+  std::future<void> signaled = std::async(std::launch::async, [this]() {
+    eval_coordinator_.SignalFinishedEval(&debug_thread_, &eval_);
+  });
+  bool returned = signaled.wait_for(seconds(5)) == std::future_status::ready;
+  if (!returned) {
+    // Lets the debugger callback go so that the test can end.
+    eval_coordinator_.SignalFinishedPrintingVariable();
+  }
+  EXPECT_TRUE(returned);
+}
+
+// Tests that an evaluation that ends once aborted is reported as not
+// complete, without a rude abort.
+TEST_F(EvalCoordinatorTest, TestWaitForEvalAborted) {
+  eval_coordinator_.SetEvalTimeouts(milliseconds(100), seconds(10));
 
+  bool aborted = false;
+  EXPECT_CALL(eval_, GetResult(_))
+      .WillRepeatedly(Invoke([&aborted](ICorDebugValue **) {
+        return aborted ? CORDBG_S_FUNC_EVAL_ABORTED
+                       : CORDBG_E_FUNC_EVAL_NOT_COMPLETE;
+      }));
+  EXPECT_CALL(eval_, Abort()).Times(1).WillOnce(Invoke([&aborted]() {
+    aborted = true;
+    return S_OK;
+  }));
+  EXPECT_CALL(eval2_, RudeAbort()).Times(0);
+
+  HRESULT hr =
+      eval_coordinator_.WaitForEval(&exception_thrown, &eval_, &eval_result_);
   EXPECT_EQ(hr, CORDBG_E_FUNC_EVAL_NOT_COMPLETE);
 }
 
+// Tests that there is no snapshot evaluation deadline outside of a
+// breakpoint hit.
+TEST_F(EvalCoordinatorTest, TestEvalTimeExhausted) {
+  EXPECT_FALSE(eval_coordinator_.EvalTimeExhausted());
+  eval_coordinator_.SetEvalTimeouts(milliseconds(1), milliseconds(1));
+  std::this_thread::sleep_for(milliseconds(10));
+  EXPECT_FALSE(eval_coordinator_.EvalTimeExhausted());
+}
+
+// Tests that there is no pause deadline outside of a breakpoint hit.
+TEST_F(EvalCoordinatorTest, TestPauseTimeExhausted) {
+  EXPECT_FALSE(eval_coordinator_.PauseTimeExhausted());
+  eval_coordinator_.SetPauseTimeout(milliseconds(1));
+  std::this_thread::sleep_for(milliseconds(10));
+  EXPECT_FALSE(eval_coordinator_.PauseTimeExhausted());
+}
+
 // Tests that ProcessBreakpoint will return.
 TEST_F(EvalCoordinatorTest, TestProcessBreakpoint) {
   EXPECT_CALL(debug_stack_walk_, GetFrame(_)).WillRepeatedly(Return(S_FALSE));
@@ -129,4 +234,214 @@ TEST_F(EvalCoordinatorTest, TestProcessBreakpoint) {
   std::this_thread::sleep_for(minutes(1));
 }
 
+// Tests that snapshots are written to the agent only after the debugger
+// callback has been let go.
+TEST_F(EvalCoordinatorTest, TestWriteBreakpointAfterContinue) {
+  shared_ptr<google_cloud_debugger::DbgBreakpoint> breakpoint(
+      new google_cloud_debugger::DbgBreakpoint());
+  breakpoint->Initialize("Program.cs", "BreakpointId", 10, 0, false, "",
+                         Breakpoint::INFO, "", {});
+  breakpoints_.push_back(breakpoint);
+
+  // The stack walk cannot be created, so an error snapshot is captured.
+  EXPECT_CALL(debug_thread_, QueryInterface(_, _))
+      .WillRepeatedly(Return(E_NOINTERFACE));
+
+  std::promise<void> callback_returned;
+  std::shared_future<void> callback_returned_future =
+      callback_returned.get_future().share();
+  std::promise<bool> written_after_continue;
+  EXPECT_CALL(breakpoint_collection_, WriteBreakpoint(_))
+      .WillOnce(Invoke([&](const Breakpoint &written) {
+        EXPECT_EQ(written.id(), "BreakpointId");
+        written_after_continue.set_value(
+            callback_returned_future.wait_for(seconds(10)) ==
+            std::future_status::ready);
+        return S_OK;
+      }));
+
+  HRESULT hr = eval_coordinator_.ProcessBreakpoints(
+      &debug_thread_, &breakpoint_collection_, breakpoints_, pdb_files_);
+  EXPECT_EQ(hr, S_OK);
+  callback_returned.set_value();
+
+  std::future<bool> written = written_after_continue.get_future();
+  ASSERT_EQ(written.wait_for(seconds(20)), std::future_status::ready);
+  EXPECT_TRUE(written.get());
+}
+
+// Tests that hits are processed on the debugger callback thread unless
+// they may need function evaluations.
+TEST_F(EvalCoordinatorTest, TestProcessBreakpointsInline) {
+  shared_ptr<google_cloud_debugger::DbgBreakpoint> breakpoint(
+      new google_cloud_debugger::DbgBreakpoint());
+  breakpoint->Initialize("Program.cs", "BreakpointId", 10, 0, false, "",
+                         Breakpoint::INFO, "", {});
+  breakpoints_.push_back(breakpoint);
+
+  // The stack walk cannot be created, so error snapshots are captured.
+  std::thread::id capture_thread;
+  EXPECT_CALL(debug_thread_, QueryInterface(_, _))
+      .WillRepeatedly(Invoke([&capture_thread](REFIID, void **) {
+        capture_thread = std::this_thread::get_id();
+        return E_NOINTERFACE;
+      }));
+
+  std::promise<void> first_write;
+  std::promise<void> second_write;
+  EXPECT_CALL(breakpoint_collection_, WriteBreakpoint(_))
+      .WillOnce(Invoke([&first_write](const Breakpoint &) {
+        first_write.set_value();
+        return S_OK;
+      }))
+      .WillOnce(Invoke([&second_write](const Breakpoint &) {
+        second_write.set_value();
+        return S_OK;
+      }));
+
+  EXPECT_EQ(eval_coordinator_.ProcessBreakpoints(
+                &debug_thread_, &breakpoint_collection_, breakpoints_,
+                pdb_files_),
+            S_OK);
+  EXPECT_EQ(capture_thread, std::this_thread::get_id());
+  ASSERT_EQ(first_write.get_future().wait_for(seconds(20)),
+            std::future_status::ready);
+
+  // Properties are evaluated by the snapshot worker.
+  eval_coordinator_.SetPropertyEvaluation(TRUE);
+  EXPECT_EQ(eval_coordinator_.ProcessBreakpoints(
+                &debug_thread_, &breakpoint_collection_, breakpoints_,
+                pdb_files_),
+            S_OK);
+  EXPECT_NE(capture_thread, std::this_thread::get_id());
+  ASSERT_EQ(second_write.get_future().wait_for(seconds(20)),
+            std::future_status::ready);
+}
+
+// Tests that a breakpoint hit does not wait for the PDB files that the
+// module indexer has not parsed yet.
+TEST_F(EvalCoordinatorTest, TestHitDoesNotParsePdbFiles) {
+  shared_ptr<google_cloud_debugger::DbgBreakpoint> breakpoint(
+      new google_cloud_debugger::DbgBreakpoint());
+  breakpoint->Initialize("Program.cs", "BreakpointId", 10, 0, false, "",
+                         Breakpoint::INFO, "", {});
+  breakpoints_.push_back(breakpoint);
+
+  shared_ptr<IPortablePdbFileMock> pdb_file(new IPortablePdbFileMock());
+  EXPECT_CALL(*pdb_file, IsParsed()).WillRepeatedly(Return(false));
+  EXPECT_CALL(*pdb_file, ParsePdbFile()).Times(0);
+  pdb_files_.push_back(pdb_file);
+
+  // The stack walk cannot be created, so an error snapshot is captured.
+  EXPECT_CALL(debug_thread_, QueryInterface(_, _))
+      .WillRepeatedly(Return(E_NOINTERFACE));
+  std::promise<void> written;
+  EXPECT_CALL(breakpoint_collection_, WriteBreakpoint(_))
+      .WillOnce(Invoke([&written](const Breakpoint &) {
+        written.set_value();
+        return S_OK;
+      }));
+
+  EXPECT_EQ(eval_coordinator_.ProcessBreakpoints(
+                &debug_thread_, &breakpoint_collection_, breakpoints_,
+                pdb_files_),
+            S_OK);
+  ASSERT_EQ(written.get_future().wait_for(seconds(20)),
+            std::future_status::ready);
+}
+
+// Tests that a burst of breakpoint hits processed on the debugger callback
+// thread, whose snapshots are not written yet, neither takes the place of
+// a hit that needs the snapshot worker nor writes on the callback thread.
+TEST_F(EvalCoordinatorTest, TestInlineBurstDoesNotFillSnapshotQueue) {
+  shared_ptr<google_cloud_debugger::DbgBreakpoint> breakpoint(
+      new google_cloud_debugger::DbgBreakpoint());
+  breakpoint->Initialize("Program.cs", "BreakpointId", 10, 0, false, "",
+                         Breakpoint::INFO, "", {});
+  breakpoints_.push_back(breakpoint);
+
+  // The stack walk cannot be created, so error snapshots are captured.
+  EXPECT_CALL(debug_thread_, QueryInterface(_, _))
+      .WillRepeatedly(Return(E_NOINTERFACE));
+
+  // Four times as many hits as the snapshot worker queues. Every write
+  // waits until the whole burst is processed.
+  const int burst_hits = 4 * 16;
+  std::promise<void> release_writes;
+  std::shared_future<void> writes_released =
+      release_writes.get_future().share();
+  std::atomic<int> writes(0);
+  std::atomic<int> callback_thread_writes(0);
+  std::thread::id callback_thread = std::this_thread::get_id();
+  EXPECT_CALL(breakpoint_collection_, WriteBreakpoint(_))
+      .Times(burst_hits + 1)
+      .WillRepeatedly(Invoke([&](const Breakpoint &) {
+        if (std::this_thread::get_id() == callback_thread) {
+          ++callback_thread_writes;
+        }
+        writes_released.wait();
+        ++writes;
+        return S_OK;
+      }));
+
+  for (int i = 0; i < burst_hits; ++i) {
+    ASSERT_EQ(eval_coordinator_.ProcessBreakpoints(
+                  &debug_thread_, &breakpoint_collection_, breakpoints_,
+                  pdb_files_),
+              S_OK);
+  }
+
+  // Properties are evaluated by the snapshot worker.
+  eval_coordinator_.SetPropertyEvaluation(TRUE);
+  EXPECT_EQ(eval_coordinator_.ProcessBreakpoints(
+                &debug_thread_, &breakpoint_collection_, breakpoints_,
+                pdb_files_),
+            S_OK);
+
+  release_writes.set_value();
+  for (int i = 0; i < 2000 && writes < burst_hits + 1; ++i) {
+    std::this_thread::sleep_for(milliseconds(10));
+  }
+  EXPECT_EQ(writes, burst_hits + 1);
+  EXPECT_EQ(callback_thread_writes, 0);
+}
+
+// Tests that breakpoint hits reuse the same worker thread and do not
+// accumulate memory, over a million hits.
+TEST_F(EvalCoordinatorTest, ProcessBreakpointsStress) {
+  EXPECT_CALL(debug_thread_, AddRef()).WillRepeatedly(Return(1));
+  EXPECT_CALL(debug_thread_, Release()).WillRepeatedly(Return(1));
+  EXPECT_CALL(breakpoint_collection_, WriteBreakpoint(_)).Times(0);
+
+  // Property evaluation keeps the hits on the snapshot worker.
+  eval_coordinator_.SetPropertyEvaluation(TRUE);
+
+  for (int i = 0; i < kStressWarmUpHits; ++i) {
+    ASSERT_EQ(eval_coordinator_.ProcessBreakpoints(
+                  &debug_thread_, &breakpoint_collection_, breakpoints_,
+                  pdb_files_),
+              S_OK);
+  }
+
+  long threads_before = ReadProcessStatus("Threads:");
+  long memory_before = ReadProcessStatus("VmRSS:");
+  for (int i = 0; i < kStressHits; ++i) {
+    ASSERT_EQ(eval_coordinator_.ProcessBreakpoints(
+                  &debug_thread_, &breakpoint_collection_, breakpoints_,
+                  pdb_files_),
+              S_OK);
+  }
+
+  // /proc is only there on Linux.
+  if (threads_before >= 0) {
+    EXPECT_EQ(ReadProcessStatus("Threads:"), threads_before);
+  }
+
+  // A thread or a future per hit would take hundreds of MB here.
+  if (memory_before >= 0) {
+    EXPECT_LT(ReadProcessStatus("VmRSS:") - memory_before, 16 * 1024)
+        << "Resident memory grew from " << memory_before << " kB.";
+  }
+}
+
 }  // namespace google_cloud_debugger_test
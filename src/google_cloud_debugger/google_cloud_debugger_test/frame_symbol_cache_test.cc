@@ -0,0 +1,135 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include "frame_symbol_cache.h"
+#include "i_cor_debug_mocks.h"
+
+using google_cloud_debugger::FrameLocation;
+using google_cloud_debugger::FrameSymbolCache;
+using google_cloud_debugger::FrameSymbols;
+
+namespace google_cloud_debugger_test {
+
+// Tests that symbols are keyed by module and function token.
+TEST(FrameSymbolCacheTest, Symbols) {
+  FrameSymbolCache cache;
+  ICorDebugModuleMock app_module;
+  ICorDebugModuleMock lib_module;
+  FrameSymbols symbols;
+  EXPECT_FALSE(cache.GetSymbols(&app_module, 0x06000001, &symbols));
+
+  symbols.class_name = "Program";
+  symbols.method_name = "Main";
+  symbols.class_token = 0x02000002;
+  symbols.virtual_address = 0x2050;
+  cache.AddSymbols(&app_module, 0x06000001, symbols);
+
+  FrameSymbols cached;
+  ASSERT_TRUE(cache.GetSymbols(&app_module, 0x06000001, &cached));
+  EXPECT_EQ(cached.class_name, "Program");
+  EXPECT_EQ(cached.method_name, "Main");
+  EXPECT_EQ(cached.class_token, 0x02000002);
+  EXPECT_EQ(cached.virtual_address, 0x2050);
+
+  EXPECT_FALSE(cache.GetSymbols(&app_module, 0x06000002, &cached));
+  EXPECT_FALSE(cache.GetSymbols(&lib_module, 0x06000001, &cached));
+}
+
+// Tests that locations are keyed by module, function token and IL offset.
+TEST(FrameSymbolCacheTest, Locations) {
+  FrameSymbolCache cache;
+  ICorDebugModuleMock app_module;
+  FrameLocation location;
+  location.file = "/app/Program.cs";
+  location.line = 12;
+  location.sequence_point_il_offset = 6;
+  cache.AddLocation(&app_module, 0x06000001, 8, location);
+
+  FrameLocation cached;
+  ASSERT_TRUE(cache.GetLocation(&app_module, 0x06000001, 8, &cached));
+  EXPECT_EQ(cached.file, "/app/Program.cs");
+  EXPECT_EQ(cached.line, 12);
+  EXPECT_EQ(cached.sequence_point_il_offset, 6);
+
+  EXPECT_FALSE(cache.GetLocation(&app_module, 0x06000001, 6, &cached));
+  EXPECT_FALSE(cache.GetLocation(&app_module, 0x06000002, 8, &cached));
+}
+
+// Tests that two modules loaded from the same assembly, for example by two
+// AssemblyLoadContexts, do not share their entries.
+TEST(FrameSymbolCacheTest, ModulesWithTheSameName) {
+  FrameSymbolCache cache;
+  ICorDebugModuleMock first_plugin_module;
+  ICorDebugModuleMock second_plugin_module;
+  FrameSymbols symbols;
+  symbols.method_name = "Run";
+  cache.AddSymbols(&first_plugin_module, 0x06000001, symbols);
+  symbols.method_name = "Stop";
+  cache.AddSymbols(&second_plugin_module, 0x06000001, symbols);
+
+  FrameSymbols cached;
+  ASSERT_TRUE(cache.GetSymbols(&first_plugin_module, 0x06000001, &cached));
+  EXPECT_EQ(cached.method_name, "Run");
+  ASSERT_TRUE(cache.GetSymbols(&second_plugin_module, 0x06000001, &cached));
+  EXPECT_EQ(cached.method_name, "Stop");
+
+  cache.RemoveModule(&first_plugin_module);
+  EXPECT_FALSE(cache.GetSymbols(&first_plugin_module, 0x06000001, &cached));
+  EXPECT_TRUE(cache.GetSymbols(&second_plugin_module, 0x06000001, &cached));
+}
+
+// Tests that the cache does not grow past kMaximumEntries.
+TEST(FrameSymbolCacheTest, Bounded) {
+  FrameSymbolCache cache;
+  ICorDebugModuleMock app_module;
+  FrameSymbols symbols;
+  for (size_t i = 0; i < FrameSymbolCache::kMaximumEntries; ++i) {
+    cache.AddSymbols(&app_module, i, symbols);
+  }
+  EXPECT_TRUE(cache.GetSymbols(&app_module, 0, &symbols));
+
+  cache.AddSymbols(&app_module, FrameSymbolCache::kMaximumEntries, symbols);
+  EXPECT_FALSE(cache.GetSymbols(&app_module, 0, &symbols));
+  EXPECT_TRUE(cache.GetSymbols(&app_module, FrameSymbolCache::kMaximumEntries,
+                               &symbols));
+}
+
+// Tests that removing a module only drops the entries of that module.
+TEST(FrameSymbolCacheTest, RemoveModule) {
+  FrameSymbolCache cache;
+  ICorDebugModuleMock app_module;
+  ICorDebugModuleMock plugin_module;
+  ICorDebugModuleMock other_module;
+  FrameSymbols symbols;
+  FrameLocation location;
+  cache.AddSymbols(&app_module, 0x06000001, symbols);
+  cache.AddSymbols(&app_module, 0x06000002, symbols);
+  cache.AddSymbols(&plugin_module, 0x06000001, symbols);
+  cache.AddLocation(&app_module, 0x06000001, 8, location);
+  cache.AddLocation(&plugin_module, 0x06000001, 8, location);
+
+  cache.RemoveModule(&app_module);
+  EXPECT_FALSE(cache.GetSymbols(&app_module, 0x06000001, &symbols));
+  EXPECT_FALSE(cache.GetSymbols(&app_module, 0x06000002, &symbols));
+  EXPECT_FALSE(cache.GetLocation(&app_module, 0x06000001, 8, &location));
+  EXPECT_TRUE(cache.GetSymbols(&plugin_module, 0x06000001, &symbols));
+  EXPECT_TRUE(cache.GetLocation(&plugin_module, 0x06000001, 8, &location));
+
+  cache.RemoveModule(&other_module);
+  EXPECT_TRUE(cache.GetSymbols(&plugin_module, 0x06000001, &symbols));
+}
+
+}  // namespace google_cloud_debugger_test
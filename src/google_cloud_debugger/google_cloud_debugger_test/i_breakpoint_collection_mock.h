@@ -39,6 +39,11 @@ class IBreakpointCollectionMock
       HRESULT(google_cloud_debugger::DebuggerCallback *debugger_callback));
   MOCK_METHOD1(UpdateBreakpoint,
                HRESULT(const google_cloud_debugger::DbgBreakpoint &breakpoint));
+  MOCK_METHOD1(
+      UpdateBreakpoints,
+      HRESULT(const std::vector<
+              std::shared_ptr<google_cloud_debugger::DbgBreakpoint>>
+                  &breakpoints));
   MOCK_METHOD0(SyncBreakpoints, HRESULT());
   MOCK_METHOD0(CancelSyncBreakpoints, HRESULT());
   MOCK_METHOD1(
@@ -47,14 +52,22 @@ class IBreakpointCollectionMock
   MOCK_METHOD1(
       ReadBreakpoint,
       HRESULT(google::cloud::diagnostics::debug::Breakpoint *breakpoint));
-  MOCK_METHOD5(
+  MOCK_METHOD4(
       EvaluateAndPrintBreakpoint,
-      HRESULT(mdMethodDef function_token, ULONG32 il_offset,
+      HRESULT(ICorDebugBreakpoint *debug_breakpoint,
               google_cloud_debugger::IEvalCoordinator *eval_coordinator,
               ICorDebugThread *debug_thread,
               const std::vector<std::shared_ptr<
                   google_cloud_debugger_portable_pdb::IPortablePdbFile>>
                   &pdb_files));
+  MOCK_METHOD2(
+      RemoveBreakpointsInModule,
+      HRESULT(ICorDebugModule *debug_module,
+              std::vector<google::cloud::diagnostics::debug::Breakpoint>
+                  *unbound_breakpoints));
+  MOCK_METHOD0(SetPendingBreakpoints, HRESULT());
+  MOCK_METHOD0(GetLocationCount, std::size_t());
+  MOCK_METHOD0(GetPendingLocationCount, std::size_t());
 };
 
 }  // namespace google_cloud_debugger_test
@@ -276,6 +276,28 @@ class ICorDebugFunctionMock : public ICorDebugFunction {
   MOCK_METHOD1(GetCurrentVersionNumber, HRESULT(ULONG32 *pnCurrentVersion));
 };
 
+class ICorDebugCodeMock : public ICorDebugCode {
+ public:
+  IUNKNOWN_MOCK
+
+  MOCK_METHOD1(IsIL, HRESULT(BOOL *pbIL));
+  MOCK_METHOD1(GetFunction, HRESULT(ICorDebugFunction **ppFunction));
+  MOCK_METHOD1(GetAddress, HRESULT(CORDB_ADDRESS *pStart));
+  MOCK_METHOD1(GetSize, HRESULT(ULONG32 *pcBytes));
+  MOCK_METHOD2(CreateBreakpoint,
+               HRESULT(ULONG32 offset,
+                       ICorDebugFunctionBreakpoint **ppBreakpoint));
+  MOCK_METHOD5(GetCode, HRESULT(ULONG32 startOffset, ULONG32 endOffset,
+                                ULONG32 cBufferAlloc, BYTE buffer[],
+                                ULONG32 *pcBufferSize));
+  MOCK_METHOD1(GetVersionNumber, HRESULT(ULONG32 *nVersion));
+  MOCK_METHOD3(GetILToNativeMapping,
+               HRESULT(ULONG32 cMap, ULONG32 *pcMap,
+                       COR_DEBUG_IL_TO_NATIVE_MAP map[]));
+  MOCK_METHOD3(GetEnCRemapSequencePoints,
+               HRESULT(ULONG32 cMap, ULONG32 *pcMap, ULONG32 offsets[]));
+};
+
 class ICorDebugEvalMock : public ICorDebugEval {
  public:
   IUNKNOWN_MOCK
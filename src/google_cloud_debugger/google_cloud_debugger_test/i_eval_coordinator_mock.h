@@ -31,7 +31,8 @@ class IEvalCoordinatorMock : public google_cloud_debugger::IEvalCoordinator {
   MOCK_METHOD3(WaitForEval, HRESULT(BOOL *exception_thrown, ICorDebugEval *eval,
                                     ICorDebugValue **eval_result));
 
-  MOCK_METHOD1(SignalFinishedEval, void(ICorDebugThread *debug_thread));
+  MOCK_METHOD2(SignalFinishedEval,
+               void(ICorDebugThread *debug_thread, ICorDebugEval *eval));
 
   MOCK_METHOD0(HandleException, void());
 
@@ -40,7 +41,9 @@ class IEvalCoordinatorMock : public google_cloud_debugger::IEvalCoordinator {
       HRESULT(
           ICorDebugThread *debug_thread,
           google_cloud_debugger::IBreakpointCollection *breakpoint_collection,
-          std::vector<std::shared_ptr<google_cloud_debugger::DbgBreakpoint>> breakpoint,
+          const std::vector<
+              std::shared_ptr<google_cloud_debugger::DbgBreakpoint>>
+              &breakpoint,
           const std::vector<std::shared_ptr<
               google_cloud_debugger_portable_pdb::IPortablePdbFile>>
               &pdb_files));
@@ -64,6 +67,23 @@ class IEvalCoordinatorMock : public google_cloud_debugger::IEvalCoordinator {
   MOCK_METHOD1(SetMethodEvaluation, void(BOOL eval));
 
   MOCK_METHOD1(CreateStackWalk, HRESULT(ICorDebugStackWalk **debug_stack_walk));
+
+  MOCK_METHOD2(
+      WriteBreakpointsAsync,
+      HRESULT(
+          google_cloud_debugger::IBreakpointCollection *breakpoint_collection,
+          std::vector<google::cloud::diagnostics::debug::Breakpoint>
+              breakpoints));
+
+  MOCK_METHOD2(SetEvalTimeouts,
+               void(std::chrono::milliseconds eval_timeout,
+                    std::chrono::milliseconds snapshot_eval_timeout));
+
+  MOCK_METHOD0(EvalTimeExhausted, BOOL());
+
+  MOCK_METHOD1(SetPauseTimeout, void(std::chrono::milliseconds pause_timeout));
+
+  MOCK_METHOD0(PauseTimeExhausted, BOOL());
 };
 
 }  // namespace google_cloud_debugger_test
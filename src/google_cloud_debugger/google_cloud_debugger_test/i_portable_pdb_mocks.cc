@@ -17,7 +17,13 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+using google_cloud_debugger_portable_pdb::IDocumentIndex;
+using google_cloud_debugger_portable_pdb::MethodInfo;
+using google_cloud_debugger_portable_pdb::SequencePoint;
+using google_cloud_debugger_portable_pdb::SplitNormalizedFilePath;
 using std::unique_ptr;
+using ::testing::_;
+using ::testing::Invoke;
 using ::testing::Return;
 using ::testing::ReturnRef;
 
@@ -26,6 +32,7 @@ namespace google_cloud_debugger_test {
 void PortablePDBFileFixture::SetUpIPortablePDBFile(
     IPortablePdbFileMock *file_mock) {
   ON_CALL(*file_mock, ParsePdbFile()).WillByDefault(Return(true));
+  ON_CALL(*file_mock, IsParsed()).WillByDefault(Return(true));
 
   // Makes a vector with a Document Index mock
   for (auto &&document_fixture : documents_) {
@@ -36,6 +43,41 @@ void PortablePDBFileFixture::SetUpIPortablePDBFile(
     ON_CALL(*doc_index, GetFilePath())
         .WillByDefault(ReturnRef(document_fixture.file_name_));
 
+    document_fixture.file_path_segments_.clear();
+    for (const std::string &segment :
+         SplitNormalizedFilePath(document_fixture.file_name_)) {
+      document_fixture.file_path_segments_.push_back(
+          &string_pool_.Get(string_pool_.Intern(segment)));
+    }
+    ON_CALL(*doc_index, GetFilePathSegments())
+        .WillByDefault(ReturnRef(document_fixture.file_path_segments_));
+
+    document_fixture.line_index_.Build(document_fixture.methods_);
+    IDocumentIndexFixture *fixture = &document_fixture;
+    ON_CALL(*doc_index, GetMethod(_))
+        .WillByDefault(Invoke([fixture](uint32_t position) {
+          return position < fixture->methods_.size()
+                     ? &fixture->methods_[position]
+                     : nullptr;
+        }));
+    ON_CALL(*doc_index, FindBreakpointLocation(_, _, _))
+        .WillByDefault(Invoke([fixture](uint32_t line, const MethodInfo **method,
+                                        SequencePoint *sequence_point) {
+          uint32_t method_index;
+          uint32_t sequence_point_index;
+          if (!fixture->line_index_.FindBreakpointLocation(
+                  line, &method_index, &sequence_point_index)) {
+            return false;
+          }
+
+          *method = &fixture->methods_[method_index];
+          *sequence_point =
+              fixture->methods_[method_index].sequence_points.Get(
+                  sequence_point_index);
+          return true;
+        }));
+    ON_CALL(*doc_index, GetStringPool()).WillByDefault(ReturnRef(string_pool_));
+
     document_indices_.push_back(std::move(doc_index));
   }
 
@@ -43,6 +85,24 @@ void PortablePDBFileFixture::SetUpIPortablePDBFile(
   ON_CALL(*file_mock, GetDocumentIndexTable())
       .WillByDefault(ReturnRef(document_indices_));
 
+  // Looks up methods by method def in the documents.
+  PortablePDBFileFixture *fixture = this;
+  ON_CALL(*file_mock, FindMethod(_, _, _))
+      .WillByDefault(Invoke([fixture](uint32_t method_def,
+                                      const IDocumentIndex **document_index,
+                                      const MethodInfo **method) {
+        for (size_t i = 0; i < fixture->documents_.size(); ++i) {
+          for (const MethodInfo &current : fixture->documents_[i].methods_) {
+            if (current.method_def == method_def) {
+              *document_index = fixture->document_indices_[i].get();
+              *method = &current;
+              return true;
+            }
+          }
+        }
+        return false;
+      }));
+
   // Module name should be the same as file name.
   ON_CALL(*file_mock, GetModuleName()).WillByDefault(ReturnRef(module_name_));
 }
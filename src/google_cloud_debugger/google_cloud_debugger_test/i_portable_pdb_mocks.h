@@ -32,6 +32,10 @@ class IPortablePdbFileMock
   MOCK_METHOD2(Initialize, HRESULT(ICorDebugModule *debug_module,
       google_cloud_debugger::ICorDebugHelper *debug_helper));
   MOCK_METHOD0(ParsePdbFile, bool());
+  MOCK_CONST_METHOD0(IsParsed, bool());
+  MOCK_CONST_METHOD0(HasFailedToParse, bool());
+  MOCK_METHOD0(MarkUnloaded, void());
+  MOCK_CONST_METHOD0(IsUnloaded, bool());
   MOCK_CONST_METHOD2(
       GetStream,
       bool(const std::string &name,
@@ -66,11 +70,20 @@ class IPortablePdbFileMock
       GetLocalConstantTable,
       const std::vector<google_cloud_debugger_portable_pdb::LocalConstantRow>
           &());
+  MOCK_CONST_METHOD1(GetDocumentMethods,
+                     const std::vector<std::uint32_t> &(std::uint32_t doc_index));
   MOCK_CONST_METHOD0(
       GetDocumentIndexTable,
       const std::vector<
           std::unique_ptr<google_cloud_debugger_portable_pdb::IDocumentIndex>>
           &());
+  MOCK_CONST_METHOD3(
+      FindMethod,
+      bool(std::uint32_t method_def,
+           const google_cloud_debugger_portable_pdb::IDocumentIndex
+               **document_index,
+           const google_cloud_debugger_portable_pdb::MethodInfo **method));
+  MOCK_CONST_METHOD0(GetIndexMemoryUsage, std::size_t());
   MOCK_CONST_METHOD0(GetModuleName, const std::string &());
   MOCK_CONST_METHOD1(GetDebugModule, HRESULT(ICorDebugModule **debug_module));
   MOCK_CONST_METHOD1(GetMetaDataImport,
@@ -88,9 +101,24 @@ class IDocumentIndexMock
       bool(const google_cloud_debugger_portable_pdb::IPortablePdbFile &pdb,
            int doc_index));
   MOCK_CONST_METHOD0(GetFilePath, std::string &());
+  MOCK_CONST_METHOD0(GetFilePathSegments,
+                    const std::vector<const std::string *> &());
   MOCK_CONST_METHOD0(
       GetMethods,
       const std::vector<google_cloud_debugger_portable_pdb::MethodInfo> &());
+  MOCK_CONST_METHOD1(
+      GetMethod,
+      const google_cloud_debugger_portable_pdb::MethodInfo *(
+          std::uint32_t position));
+  MOCK_CONST_METHOD3(
+      FindBreakpointLocation,
+      bool(std::uint32_t line,
+           const google_cloud_debugger_portable_pdb::MethodInfo **method,
+           google_cloud_debugger_portable_pdb::SequencePoint *sequence_point));
+  MOCK_CONST_METHOD0(
+      GetStringPool,
+      const google_cloud_debugger_portable_pdb::StringPool &());
+  MOCK_CONST_METHOD0(GetMemoryUsage, std::size_t());
 };
 
 // Fixtures that contains information to mock an IDocumentIndex.
@@ -99,8 +127,14 @@ class IDocumentIndexFixture {
   // Name of the file of the document index.
   std::string file_name_;
 
+  // Segments of file_name_, interned in the string pool of the PDB file.
+  std::vector<const std::string *> file_path_segments_;
+
   // Method in the document index.
   std::vector<google_cloud_debugger_portable_pdb::MethodInfo> methods_;
+
+  // Line index over methods_, used to answer FindBreakpointLocation.
+  google_cloud_debugger_portable_pdb::DocumentLineIndex line_index_;
 };
 
 // Fixtures that contains information to mock a Portable PDB file.
@@ -115,6 +149,9 @@ class PortablePDBFileFixture {
   // Documents contained in document_indices.
   std::vector<IDocumentIndexFixture> documents_;
 
+  // String pool of the documents.
+  google_cloud_debugger_portable_pdb::StringPool string_pool_;
+
   // Document Indices that the file_mock_ contains.
   // Only contains 1 document index that has file_name_ file path.
   std::vector<
@@ -0,0 +1,137 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "indexing_thread_pool.h"
+
+using google_cloud_debugger_portable_pdb::IndexingThreadPool;
+using std::vector;
+
+namespace google_cloud_debugger_test {
+
+// Tests that every task runs exactly once, on the pool threads and the
+// calling thread.
+TEST(IndexingThreadPoolTest, RunsEveryTask) {
+  const size_t kNumTasks = 1000;
+  IndexingThreadPool thread_pool(3);
+  EXPECT_EQ(thread_pool.GetThreadCount(), 3);
+
+  vector<std::atomic<int>> runs(kNumTasks);
+  std::mutex thread_ids_mutex;
+  std::set<std::thread::id> thread_ids;
+  EXPECT_TRUE(thread_pool.Run(kNumTasks, 4, [&](size_t task) {
+    ++runs[task];
+    std::lock_guard<std::mutex> lock(thread_ids_mutex);
+    thread_ids.insert(std::this_thread::get_id());
+    return true;
+  }));
+
+  for (size_t i = 0; i < kNumTasks; ++i) {
+    EXPECT_EQ(runs[i], 1);
+  }
+  EXPECT_GE(thread_ids.size(), 1);
+  EXPECT_LE(thread_ids.size(), 4);
+
+  // Without tasks, Run returns right away.
+  EXPECT_TRUE(thread_pool.Run(0, 4, [](size_t task) { return false; }));
+}
+
+// Tests that max_threads 1 runs the tasks on the calling thread only.
+TEST(IndexingThreadPoolTest, CallingThreadOnly) {
+  IndexingThreadPool thread_pool(2);
+  std::thread::id calling_thread = std::this_thread::get_id();
+  std::atomic<int> other_threads(0);
+  EXPECT_TRUE(thread_pool.Run(100, 1, [&](size_t task) {
+    if (std::this_thread::get_id() != calling_thread) {
+      ++other_threads;
+    }
+    return true;
+  }));
+  EXPECT_EQ(other_threads, 0);
+
+  // A pool without threads still runs everything.
+  IndexingThreadPool empty_pool(0);
+  std::atomic<int> runs(0);
+  EXPECT_TRUE(empty_pool.Run(100, 8, [&](size_t task) {
+    ++runs;
+    return true;
+  }));
+  EXPECT_EQ(runs, 100);
+}
+
+// Tests that no new task starts once a task fails.
+TEST(IndexingThreadPoolTest, StopsOnFailure) {
+  IndexingThreadPool thread_pool(2);
+  std::atomic<int> runs(0);
+  EXPECT_FALSE(thread_pool.Run(10000, 1, [&](size_t task) {
+    ++runs;
+    return task != 10;
+  }));
+  EXPECT_EQ(runs, 11);
+
+  EXPECT_FALSE(thread_pool.Run(10000, 3, [&](size_t task) {
+    return task != 10;
+  }));
+}
+
+// Tests that Run calls from several threads share the pool threads and
+// all complete, even when there are more calls than pool threads.
+TEST(IndexingThreadPoolTest, ConcurrentRuns) {
+  const int kNumCallers = 6;
+  const size_t kNumTasks = 500;
+  IndexingThreadPool thread_pool(2);
+
+  vector<std::atomic<int>> completed(kNumCallers);
+  vector<std::thread> callers;
+  for (int i = 0; i < kNumCallers; ++i) {
+    callers.push_back(std::thread([&thread_pool, &completed, i]() {
+      for (int round = 0; round < 20; ++round) {
+        std::atomic<size_t> runs(0);
+        if (thread_pool.Run(kNumTasks, 8, [&runs](size_t task) {
+              ++runs;
+              return true;
+            }) &&
+            runs == kNumTasks) {
+          ++completed[i];
+        }
+      }
+    }));
+  }
+
+  for (std::thread &caller : callers) {
+    caller.join();
+  }
+
+  for (int i = 0; i < kNumCallers; ++i) {
+    EXPECT_EQ(completed[i], 20);
+  }
+}
+
+// Tests that the shared pool is created once.
+TEST(IndexingThreadPoolTest, Shared) {
+  IndexingThreadPool &shared_pool = IndexingThreadPool::GetShared();
+  EXPECT_EQ(&IndexingThreadPool::GetShared(), &shared_pool);
+  EXPECT_LT(shared_pool.GetThreadCount(),
+            std::max<size_t>(std::thread::hardware_concurrency(), 1));
+}
+
+}  // namespace google_cloud_debugger_test
@@ -0,0 +1,209 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "custom_binary_reader.h"
+#include "metadata_headers.h"
+#include "metadata_tables.h"
+
+using google_cloud_debugger_portable_pdb::CompressedMetadataTableHeader;
+using google_cloud_debugger_portable_pdb::CustomBinaryStream;
+using google_cloud_debugger_portable_pdb::DocumentRow;
+using google_cloud_debugger_portable_pdb::LocalConstantRow;
+using google_cloud_debugger_portable_pdb::LocalScopeRow;
+using google_cloud_debugger_portable_pdb::LocalVariableRow;
+using google_cloud_debugger_portable_pdb::MetadataTable;
+using google_cloud_debugger_portable_pdb::MethodDebugInformationRow;
+using std::string;
+using std::vector;
+
+namespace google_cloud_debugger_test {
+
+// Number of rows decoded from each table.
+const uint32_t kBenchmarkRows = 100000;
+
+// Number of times each table is decoded by each decoder.
+const int kBenchmarkIterations = 5;
+
+// Largest row of the tables below, with every index 4 bytes wide.
+const uint32_t kMaximumRowSize = 24;
+
+bool SameRow(const DocumentRow &first, const DocumentRow &second) {
+  return first.name == second.name &&
+         first.hash_algorithm == second.hash_algorithm &&
+         first.hash == second.hash && first.language == second.language;
+}
+
+bool SameRow(const MethodDebugInformationRow &first,
+             const MethodDebugInformationRow &second) {
+  return first.document == second.document &&
+         first.sequence_points == second.sequence_points;
+}
+
+bool SameRow(const LocalScopeRow &first, const LocalScopeRow &second) {
+  return first.method_def == second.method_def &&
+         first.import_scope == second.import_scope &&
+         first.variable_list == second.variable_list &&
+         first.constant_list == second.constant_list &&
+         first.start_offset == second.start_offset &&
+         first.length == second.length;
+}
+
+bool SameRow(const LocalVariableRow &first, const LocalVariableRow &second) {
+  return first.attributes == second.attributes &&
+         first.index == second.index && first.name == second.name;
+}
+
+bool SameRow(const LocalConstantRow &first, const LocalConstantRow &second) {
+  return first.name == second.name && first.signature == second.signature;
+}
+
+// Benchmarks ParseTable, which decodes each table with a decoder built for
+// its index sizes, against parsing the table row by row with ParseFrom,
+// which checks the size of every index it reads. Both parse the same
+// random bytes and have to produce the same rows.
+class MetadataTablesBenchmark : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    std::mt19937 generator(7);
+    std::uniform_int_distribution<int> distribution(0, 255);
+    string bytes(kBenchmarkRows * kMaximumRowSize, '\0');
+    for (char &byte : bytes) {
+      byte = static_cast<char>(distribution(generator));
+    }
+
+    std::stringstream *stream = new (std::nothrow) std::stringstream(bytes);
+    ASSERT_TRUE(stream != nullptr);
+    ASSERT_TRUE(binary_stream_.ConsumeStream(stream));
+  }
+
+  // Sets up header_ so that heap indices are 4 bytes if wide_heaps is true
+  // and indices into the tables of the PDB are 4 bytes if wide_tables is.
+  void SetIndexSizes(bool wide_heaps, bool wide_tables) {
+    header_ = CompressedMetadataTableHeader();
+    header_.heap_sizes = wide_heaps ? 0x07 : 0x00;
+    uint32_t rows = wide_tables ? 0x10000 : 0x100;
+    for (int table = MetadataTable::Document;
+         table <= MetadataTable::CustomDebugInformation; ++table) {
+      header_.valid_mask[table] = true;
+      header_.num_rows.push_back(rows);
+    }
+  }
+
+  // Parses the table with both decoders, checks that the rows match and
+  // prints how long each decoder took.
+  template <typename TableRow>
+  void RunBenchmark(const string &table_name) {
+    std::chrono::steady_clock::duration generic_time =
+        std::chrono::steady_clock::duration::zero();
+    std::chrono::steady_clock::duration specialized_time =
+        std::chrono::steady_clock::duration::zero();
+    vector<TableRow> generic_table;
+    vector<TableRow> specialized_table;
+
+    for (int i = 0; i < kBenchmarkIterations; ++i) {
+      CustomBinaryStream generic_stream = binary_stream_;
+      generic_table.clear();
+      auto start = std::chrono::steady_clock::now();
+      generic_table.resize(kBenchmarkRows + 1);
+      for (uint32_t row = 1; row <= kBenchmarkRows; ++row) {
+        ASSERT_TRUE(ParseFrom(&generic_stream, header_, &generic_table[row]));
+      }
+      generic_time += std::chrono::steady_clock::now() - start;
+
+      CustomBinaryStream specialized_stream = binary_stream_;
+      specialized_table.clear();
+      start = std::chrono::steady_clock::now();
+      ASSERT_TRUE(ParseTable(&specialized_stream, header_, kBenchmarkRows,
+                             &specialized_table));
+      specialized_time += std::chrono::steady_clock::now() - start;
+
+      // Both decoders consume the same number of bytes.
+      EXPECT_EQ(generic_stream.Current(), specialized_stream.Current());
+    }
+
+    ASSERT_EQ(generic_table.size(), specialized_table.size());
+    for (size_t row = 1; row < generic_table.size(); ++row) {
+      ASSERT_TRUE(SameRow(generic_table[row], specialized_table[row]))
+          << table_name << " row " << row;
+    }
+
+    std::cout << table_name << ": generic "
+              << std::chrono::duration<double, std::milli>(generic_time)
+                         .count() /
+                     kBenchmarkIterations
+              << " ms, specialized "
+              << std::chrono::duration<double, std::milli>(specialized_time)
+                         .count() /
+                     kBenchmarkIterations
+              << " ms per " << kBenchmarkRows << " rows" << std::endl;
+  }
+
+  // Runs the benchmark over the tables PortablePdbFile parses.
+  void RunAllTables() {
+    RunBenchmark<DocumentRow>("Document");
+    RunBenchmark<MethodDebugInformationRow>("MethodDebugInformation");
+    RunBenchmark<LocalScopeRow>("LocalScope");
+    RunBenchmark<LocalVariableRow>("LocalVariable");
+    RunBenchmark<LocalConstantRow>("LocalConstant");
+  }
+
+  // Random bytes the tables are parsed from.
+  CustomBinaryStream binary_stream_;
+
+  // Header that decides the index sizes.
+  CompressedMetadataTableHeader header_;
+};
+
+// Benchmarks tables whose indices are all 2 bytes.
+TEST_F(MetadataTablesBenchmark, NarrowIndices) {
+  SetIndexSizes(false, false);
+  RunAllTables();
+}
+
+// Benchmarks tables whose indices are all 4 bytes (apart from indices
+// into the Method table, which is not in the PDB).
+TEST_F(MetadataTablesBenchmark, WideIndices) {
+  SetIndexSizes(true, true);
+  RunAllTables();
+}
+
+// Benchmarks tables with 4-byte heap indices and 2-byte table indices.
+TEST_F(MetadataTablesBenchmark, MixedIndices) {
+  SetIndexSizes(true, false);
+  RunAllTables();
+}
+
+// Tests that ParseTable fails rather than reads past the end of the
+// stream.
+TEST_F(MetadataTablesBenchmark, TableTooLarge) {
+  SetIndexSizes(false, false);
+  vector<DocumentRow> table;
+  CustomBinaryStream binary_stream = binary_stream_;
+  EXPECT_FALSE(ParseTable(&binary_stream, header_, 0xFFFFFFFF, &table));
+  EXPECT_FALSE(ParseTable(&binary_stream, header_,
+                          kBenchmarkRows * kMaximumRowSize, &table));
+  EXPECT_TRUE(ParseTable(&binary_stream, header_, 0, &table));
+  EXPECT_EQ(table.size(), 1);
+}
+
+}  // namespace google_cloud_debugger_test
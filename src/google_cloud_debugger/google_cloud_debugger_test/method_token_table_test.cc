@@ -0,0 +1,293 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "i_cor_debug_mocks.h"
+#include "i_metadata_import_mock.h"
+#include "method_token_table.h"
+#include "string_stream_wrapper.h"
+
+using google_cloud_debugger::ConvertStringToWCharPtr;
+using google_cloud_debugger::ConvertWCharPtrToString;
+using google_cloud_debugger::MethodTokenInfo;
+using google_cloud_debugger::MethodTokenTable;
+using google_cloud_debugger::MethodTokenTableCache;
+using std::map;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Return;
+
+namespace google_cloud_debugger_test {
+
+// Class token of the Program class.
+const mdTypeDef kProgramClass = 0x02000002;
+
+// Class token of the Math class.
+const mdTypeDef kMathClass = 0x02000003;
+
+// Signature of all the methods.
+const COR_SIGNATURE kSignature[] = {0, 0, 1};
+
+// Test Fixture for MethodTokenTable tests. The fake metadata has two
+// classes and no global methods.
+class MethodTokenTableTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    AddMethod(kProgramClass, 0x06000001, "Main");
+    AddMethod(kProgramClass, 0x06000002, "Add");
+    AddMethod(kProgramClass, 0x06000003, "Add");
+    AddMethod(kMathClass, 0x06000004, "Add");
+    AddMethod(kMathClass, 0x06000005, string(300, 'M'));
+
+    ON_CALL(metadata_import_, EnumTypeDefs(_, _, _, _))
+        .WillByDefault(Invoke(this, &MethodTokenTableTest::EnumTypeDefs));
+    ON_CALL(metadata_import_, EnumMethods(_, _, _, _, _))
+        .WillByDefault(Invoke(this, &MethodTokenTableTest::EnumMethods));
+    ON_CALL(metadata_import_, GetMethodProps(_, _, _, _, _, _, _, _, _, _))
+        .WillByDefault(Invoke(this, &MethodTokenTableTest::GetMethodProps));
+  }
+
+  // Adds method method_token named name to class class_token.
+  void AddMethod(mdTypeDef class_token, mdMethodDef method_token,
+                 const string &name) {
+    methods_of_class_[class_token].push_back(method_token);
+    class_of_method_[method_token] = class_token;
+    method_names_[method_token] = name;
+  }
+
+  // Returns the tokens in tokens, starting where enumeration cor_enum
+  // stopped and at most max_tokens at a time.
+  void NextTokens(HCORENUM *cor_enum, const vector<mdToken> &tokens,
+                  mdToken result[], ULONG max_tokens, ULONG *tokens_returned) {
+    if (!*cor_enum) {
+      enum_positions_.push_back(0);
+      *cor_enum = reinterpret_cast<HCORENUM>(enum_positions_.size());
+    }
+
+    size_t &position =
+        enum_positions_[reinterpret_cast<size_t>(*cor_enum) - 1];
+    *tokens_returned = 0;
+    while (position < tokens.size() && *tokens_returned < max_tokens) {
+      result[(*tokens_returned)++] = tokens[position++];
+    }
+  }
+
+  HRESULT EnumTypeDefs(HCORENUM *cor_enum, mdTypeDef class_tokens[],
+                       ULONG max_tokens, ULONG *tokens_returned) {
+    NextTokens(cor_enum, {kProgramClass, kMathClass}, class_tokens,
+               max_tokens, tokens_returned);
+    return S_OK;
+  }
+
+  HRESULT EnumMethods(HCORENUM *cor_enum, mdTypeDef class_token,
+                      mdMethodDef method_tokens[], ULONG max_tokens,
+                      ULONG *tokens_returned) {
+    NextTokens(cor_enum, methods_of_class_[class_token], method_tokens,
+               max_tokens, tokens_returned);
+    return S_OK;
+  }
+
+  HRESULT GetMethodProps(mdMethodDef method_token, mdTypeDef *class_token,
+                         LPWSTR name, ULONG name_length,
+                         ULONG *actual_name_length, DWORD *attributes,
+                         PCCOR_SIGNATURE *signature, ULONG *signature_length,
+                         ULONG *virtual_address, DWORD *impl_flags) {
+    auto method_name = method_names_.find(method_token);
+    if (method_name == method_names_.end()) {
+      return E_FAIL;
+    }
+
+    vector<WCHAR> wchar_name = ConvertStringToWCharPtr(method_name->second);
+    *class_token = class_of_method_[method_token];
+    *actual_name_length = wchar_name.size();
+    if (name && name_length > 0) {
+      ULONG copied = std::min<ULONG>(name_length, wchar_name.size());
+      std::memcpy(name, wchar_name.data(), copied * sizeof(WCHAR));
+      name[copied - 1] = 0;
+    }
+    *attributes = 0;
+    *signature = kSignature;
+    *signature_length = sizeof(kSignature);
+    *virtual_address = 0x2000 + RidFromToken(method_token);
+    *impl_flags = 0;
+    return S_OK;
+  }
+
+  // The tokens of the methods of each class.
+  map<mdTypeDef, vector<mdToken>> methods_of_class_;
+
+  // The class of each method.
+  map<mdMethodDef, mdTypeDef> class_of_method_;
+
+  // The name of each method.
+  map<mdMethodDef, string> method_names_;
+
+  // Positions of the enumerations started so far.
+  vector<size_t> enum_positions_;
+
+  IMetaDataImportMock metadata_import_;
+};
+
+// Tests that methods are found by MethodDef row or full token.
+TEST_F(MethodTokenTableTest, FindMethod) {
+  MethodTokenTable table;
+  ASSERT_EQ(table.Initialize(&metadata_import_), S_OK);
+
+  const MethodTokenInfo *method = table.FindMethod(2);
+  ASSERT_TRUE(method != nullptr);
+  EXPECT_EQ(method->method_token, 0x06000002);
+  EXPECT_EQ(method->class_token, kProgramClass);
+  EXPECT_EQ(ConvertWCharPtrToString(method->name), "Add");
+  EXPECT_EQ(method->signature, kSignature);
+  EXPECT_EQ(method->signature_length, sizeof(kSignature));
+  EXPECT_EQ(method->virtual_address, 0x2002);
+
+  EXPECT_EQ(table.FindMethod(0x06000004), table.FindMethod(4));
+  EXPECT_TRUE(table.FindMethod(6) == nullptr);
+  EXPECT_EQ(table.GetMethodCount(), 2);
+}
+
+// Tests that a method looked up by row is read by itself, and only once,
+// while the classes of the module are never enumerated.
+TEST_F(MethodTokenTableTest, FindMethodReadsOneMethod) {
+  EXPECT_CALL(metadata_import_, EnumTypeDefs(_, _, _, _)).Times(0);
+  EXPECT_CALL(metadata_import_, EnumMethods(_, _, _, _, _)).Times(0);
+  EXPECT_CALL(metadata_import_,
+              GetMethodProps(0x06000003, _, _, _, _, _, _, _, _, _))
+      .Times(1);
+
+  MethodTokenTable table;
+  ASSERT_EQ(table.Initialize(&metadata_import_), S_OK);
+  EXPECT_EQ(table.GetMethodCount(), 0);
+  const MethodTokenInfo *method = table.FindMethod(3);
+  ASSERT_TRUE(method != nullptr);
+  EXPECT_EQ(table.FindMethod(0x06000003), method);
+  EXPECT_EQ(table.GetMethodCount(), 1);
+}
+
+// Tests that a name longer than the first buffer is read again in full.
+TEST_F(MethodTokenTableTest, LongName) {
+  MethodTokenTable table;
+  ASSERT_EQ(table.Initialize(&metadata_import_), S_OK);
+
+  const MethodTokenInfo *method = table.FindMethod(5);
+  ASSERT_TRUE(method != nullptr);
+  EXPECT_EQ(ConvertWCharPtrToString(method->name), string(300, 'M'));
+  EXPECT_EQ(method->name.size(), 301);
+}
+
+// Tests that methods are found by class and name, overloads included.
+TEST_F(MethodTokenTableTest, FindMethodsByName) {
+  MethodTokenTable table;
+  ASSERT_EQ(table.Initialize(&metadata_import_), S_OK);
+
+  vector<mdMethodDef> expected = {0x06000002, 0x06000003};
+  EXPECT_EQ(table.FindMethodsByName(kProgramClass, "Add"), expected);
+  expected = {0x06000004};
+  EXPECT_EQ(table.FindMethodsByName(kMathClass, "Add"), expected);
+  EXPECT_TRUE(table.FindMethodsByName(kMathClass, "Main").empty());
+  EXPECT_TRUE(table.FindMethodsByName(kProgramClass, "add").empty());
+}
+
+// Tests that a lookup by name reads the methods of its class only, once.
+TEST_F(MethodTokenTableTest, FindMethodsByNameReadsOneClass) {
+  EXPECT_CALL(metadata_import_, EnumMethods(_, kProgramClass, _, _, _))
+      .Times(2);
+  EXPECT_CALL(metadata_import_, EnumMethods(_, kMathClass, _, _, _))
+      .Times(0);
+
+  MethodTokenTable table;
+  ASSERT_EQ(table.Initialize(&metadata_import_), S_OK);
+  EXPECT_EQ(table.FindMethodsByName(kProgramClass, "Add").size(), 2);
+  EXPECT_EQ(table.FindMethodsByName(kProgramClass, "Main").size(), 1);
+  EXPECT_EQ(table.GetMethodCount(), 3);
+}
+
+// Tests that methods are enumerated in batches.
+TEST_F(MethodTokenTableTest, ManyMethods) {
+  for (mdMethodDef method_token = 0x06000006; method_token < 0x06000400;
+       ++method_token) {
+    AddMethod(kMathClass, method_token, "Overload");
+  }
+
+  MethodTokenTable table;
+  ASSERT_EQ(table.Initialize(&metadata_import_), S_OK);
+  EXPECT_EQ(table.FindMethodsByName(kMathClass, "Overload").size(), 0x3FA);
+  EXPECT_EQ(table.GetMethodCount(), 0x3FC);
+  ASSERT_TRUE(table.FindMethod(0x3FF) != nullptr);
+  EXPECT_EQ(table.FindMethod(0x3FF)->class_token, kMathClass);
+}
+
+// Tests that methods that cannot be read are not found, and that a class
+// with such a method is read again by the next lookup.
+TEST_F(MethodTokenTableTest, MethodPropsFailure) {
+  methods_of_class_[kMathClass].push_back(0x06000010);
+
+  MethodTokenTable table;
+  EXPECT_EQ(table.Initialize(nullptr), E_INVALIDARG);
+  ASSERT_EQ(table.Initialize(&metadata_import_), S_OK);
+  EXPECT_TRUE(table.FindMethod(0x10) == nullptr);
+  EXPECT_TRUE(table.FindMethodsByName(kMathClass, "Add").empty());
+  EXPECT_EQ(table.FindMethodsByName(kProgramClass, "Add").size(), 2);
+
+  method_names_[0x06000010] = "Sub";
+  class_of_method_[0x06000010] = kMathClass;
+  EXPECT_EQ(table.FindMethodsByName(kMathClass, "Add").size(), 1);
+  EXPECT_EQ(table.FindMethodsByName(kMathClass, "Sub").size(), 1);
+}
+
+// Tests that the cache creates the table of a module once, without reading
+// its methods, and drops it when the module is unloaded.
+TEST_F(MethodTokenTableTest, Cache) {
+  MethodTokenTableCache cache;
+  ICorDebugModuleMock app_module;
+  ICorDebugModuleMock lib_module;
+  shared_ptr<const MethodTokenTable> app_table;
+  shared_ptr<const MethodTokenTable> lib_table;
+  shared_ptr<const MethodTokenTable> cached_table;
+
+  EXPECT_CALL(metadata_import_, EnumTypeDefs(_, _, _, _)).Times(0);
+  EXPECT_CALL(metadata_import_, EnumMethods(_, _, _, _, _)).Times(0);
+  ASSERT_EQ(cache.GetTable(&app_module, &metadata_import_, &app_table), S_OK);
+  ASSERT_EQ(cache.GetTable(&lib_module, &metadata_import_, &lib_table), S_OK);
+  ASSERT_EQ(cache.GetTable(&app_module, &metadata_import_, &cached_table),
+            S_OK);
+  EXPECT_EQ(cached_table, app_table);
+  EXPECT_NE(lib_table, app_table);
+  EXPECT_EQ(cache.GetTableCount(), 2);
+
+  // Tables already handed out stay valid after the module is removed.
+  cache.RemoveModule(&app_module);
+  EXPECT_EQ(cache.GetTableCount(), 1);
+  EXPECT_TRUE(app_table->FindMethod(1) != nullptr);
+
+  EXPECT_EQ(cache.GetTable(nullptr, &metadata_import_, &cached_table),
+            E_INVALIDARG);
+  EXPECT_EQ(cache.GetTable(&app_module, nullptr, &cached_table),
+            E_INVALIDARG);
+}
+
+}  // namespace google_cloud_debugger_test
@@ -0,0 +1,99 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "module_filter.h"
+
+using google_cloud_debugger::ModuleFilter;
+using std::string;
+using std::vector;
+
+namespace google_cloud_debugger_test {
+
+// Tests the wildcards of MatchPattern.
+TEST(ModuleFilterTest, MatchPattern) {
+  EXPECT_TRUE(ModuleFilter::MatchPattern("App.dll", "App.dll"));
+  EXPECT_TRUE(ModuleFilter::MatchPattern("app.DLL", "App.dll"));
+  EXPECT_FALSE(ModuleFilter::MatchPattern("App.dll", "App.dl"));
+  EXPECT_FALSE(ModuleFilter::MatchPattern("App.dl", "App.dll"));
+
+  EXPECT_TRUE(ModuleFilter::MatchPattern("System.*", "System.Linq.dll"));
+  EXPECT_FALSE(ModuleFilter::MatchPattern("System.*", "MySystem.dll"));
+  EXPECT_TRUE(ModuleFilter::MatchPattern("*", ""));
+  EXPECT_TRUE(ModuleFilter::MatchPattern("*.dll", ".dll"));
+  EXPECT_TRUE(ModuleFilter::MatchPattern("*Core*.dll", "AspNetCore.Mvc.dll"));
+  EXPECT_TRUE(ModuleFilter::MatchPattern("a*b*c", "aXbYbZc"));
+  EXPECT_FALSE(ModuleFilter::MatchPattern("a*b*c", "aXbYbZ"));
+
+  EXPECT_TRUE(ModuleFilter::MatchPattern("App?.dll", "App1.dll"));
+  EXPECT_FALSE(ModuleFilter::MatchPattern("App?.dll", "App.dll"));
+  EXPECT_FALSE(ModuleFilter::MatchPattern("", "App.dll"));
+}
+
+// Tests that framework assemblies are excluded by default, wherever
+// they are loaded from.
+TEST(ModuleFilterTest, DefaultExcludePatterns) {
+  ModuleFilter filter;
+  EXPECT_FALSE(filter.ShouldIndex("/usr/share/dotnet/System.Runtime.dll"));
+  EXPECT_FALSE(filter.ShouldIndex("C:\\dotnet\\Microsoft.CSharp.dll"));
+  EXPECT_FALSE(filter.ShouldIndex("mscorlib.dll"));
+  EXPECT_FALSE(filter.ShouldIndex("/app/NETSTANDARD.dll"));
+  EXPECT_TRUE(filter.ShouldIndex("/app/MyApp.dll"));
+  EXPECT_TRUE(filter.ShouldIndex("/System.Apps/MyApp.dll"));
+}
+
+// Tests that include patterns override exclude patterns.
+TEST(ModuleFilterTest, IncludePatterns) {
+  ModuleFilter filter;
+  filter.SetIncludePatterns({"System.MyExtensions.*"});
+  EXPECT_TRUE(filter.ShouldIndex("/app/System.MyExtensions.dll"));
+  EXPECT_FALSE(filter.ShouldIndex("/app/System.Linq.dll"));
+  EXPECT_TRUE(filter.ShouldIndex("/app/MyApp.dll"));
+}
+
+// Tests that exclude patterns replace the default ones.
+TEST(ModuleFilterTest, ExcludePatterns) {
+  ModuleFilter filter;
+  filter.SetExcludePatterns({"Vendor.*"});
+  EXPECT_FALSE(filter.ShouldIndex("/app/Vendor.Logging.dll"));
+  EXPECT_TRUE(filter.ShouldIndex("/app/System.Linq.dll"));
+}
+
+// Tests that modules without a PDB file are not indexed again.
+TEST(ModuleFilterTest, AddModuleWithoutPdb) {
+  ModuleFilter filter;
+  EXPECT_TRUE(filter.ShouldIndex("/app/MyApp.dll"));
+  filter.AddModuleWithoutPdb("/app/MyApp.dll");
+  EXPECT_FALSE(filter.ShouldIndex("/app/MyApp.dll"));
+  EXPECT_TRUE(filter.ShouldIndex("/other/MyApp.dll"));
+
+  filter.SetIncludePatterns({"MyApp.dll"});
+  EXPECT_FALSE(filter.ShouldIndex("/app/MyApp.dll"));
+}
+
+// Tests that SplitPatterns drops empty patterns.
+TEST(ModuleFilterTest, SplitPatterns) {
+  EXPECT_TRUE(ModuleFilter::SplitPatterns("").empty());
+  EXPECT_TRUE(ModuleFilter::SplitPatterns(",,").empty());
+  EXPECT_EQ(ModuleFilter::SplitPatterns("System.*"),
+            vector<string>({"System.*"}));
+  EXPECT_EQ(ModuleFilter::SplitPatterns("A.dll,,B*,"),
+            vector<string>({"A.dll", "B*"}));
+}
+
+}  // namespace google_cloud_debugger_test
@@ -0,0 +1,239 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "document_path_index.h"
+#include "i_portable_pdb_mocks.h"
+#include "module_filter.h"
+#include "module_indexer.h"
+
+using ::testing::Invoke;
+using ::testing::Return;
+using ::testing::ReturnRef;
+using google_cloud_debugger::DocumentPathIndex;
+using google_cloud_debugger::ModuleFilter;
+using google_cloud_debugger::ModuleIndexer;
+using google_cloud_debugger::SplitNormalizedFilePath;
+using std::atomic;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+namespace google_cloud_debugger_test {
+
+// Number of PDB files queued in the tests.
+const int kNumPdbFiles = 50;
+
+// Waits up to 10 seconds for counter to reach expected.
+static bool WaitForCount(const atomic<int> &counter, int expected) {
+  for (int i = 0; i < 1000 && counter < expected; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return counter == expected;
+}
+
+// Tests that every queued PDB file is parsed exactly once.
+TEST(ModuleIndexerTest, ParsesEveryQueuedPdbFile) {
+  string module_name = "Module.dll";
+  atomic<int> parsed_count(0);
+  vector<shared_ptr<IPortablePdbFileMock>> pdb_files;
+
+  ModuleIndexer indexer(4, nullptr, nullptr);
+  for (int i = 0; i < kNumPdbFiles; ++i) {
+    shared_ptr<IPortablePdbFileMock> pdb_file(new IPortablePdbFileMock());
+    EXPECT_CALL(*pdb_file, ParsePdbFile())
+        .Times(1)
+        .WillOnce(Invoke([&parsed_count]() {
+          ++parsed_count;
+          return true;
+        }));
+    EXPECT_CALL(*pdb_file, GetModuleName())
+        .WillRepeatedly(ReturnRef(module_name));
+    pdb_files.push_back(pdb_file);
+    EXPECT_EQ(indexer.Enqueue(pdb_file), S_OK);
+  }
+
+  EXPECT_TRUE(WaitForCount(parsed_count, kNumPdbFiles));
+  indexer.Shutdown();
+}
+
+// Tests that a PDB file that fails to parse does not stop the workers.
+TEST(ModuleIndexerTest, ParseFailure) {
+  string module_name = "Module.dll";
+  atomic<int> parsed_count(0);
+
+  ModuleIndexer indexer(1, nullptr, nullptr);
+  for (int i = 0; i < 2; ++i) {
+    shared_ptr<IPortablePdbFileMock> pdb_file(new IPortablePdbFileMock());
+    bool succeeded = i != 0;
+    EXPECT_CALL(*pdb_file, ParsePdbFile())
+        .Times(1)
+        .WillOnce(Invoke([&parsed_count, succeeded]() {
+          ++parsed_count;
+          return succeeded;
+        }));
+    EXPECT_CALL(*pdb_file, GetModuleName())
+        .WillRepeatedly(ReturnRef(module_name));
+    EXPECT_EQ(indexer.Enqueue(pdb_file), S_OK);
+  }
+
+  EXPECT_TRUE(WaitForCount(parsed_count, 2));
+}
+
+// Tests that modules whose PDB files fail to parse are not indexed again.
+TEST(ModuleIndexerTest, RemembersModulesWithoutPdb) {
+  string module_name = "/app/Module.dll";
+  ModuleFilter module_filter;
+  ASSERT_TRUE(module_filter.ShouldIndex(module_name));
+
+  ModuleIndexer indexer(1, nullptr, &module_filter);
+  shared_ptr<IPortablePdbFileMock> pdb_file(new IPortablePdbFileMock());
+  EXPECT_CALL(*pdb_file, ParsePdbFile()).WillOnce(Return(false));
+  EXPECT_CALL(*pdb_file, GetModuleName())
+      .WillRepeatedly(ReturnRef(module_name));
+  EXPECT_EQ(indexer.Enqueue(pdb_file), S_OK);
+
+  for (int i = 0; i < 1000 && module_filter.ShouldIndex(module_name); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_FALSE(module_filter.ShouldIndex(module_name));
+  EXPECT_TRUE(module_filter.ShouldIndex("/app/Other.dll"));
+  indexer.Shutdown();
+}
+
+// Tests that Shutdown waits for the PDB files that are being parsed
+// and that nothing can be queued afterwards.
+TEST(ModuleIndexerTest, Shutdown) {
+  string module_name = "Module.dll";
+  atomic<int> started_count(0);
+  atomic<bool> finished(false);
+
+  ModuleIndexer indexer(1, nullptr, nullptr);
+  shared_ptr<IPortablePdbFileMock> pdb_file(new IPortablePdbFileMock());
+  EXPECT_CALL(*pdb_file, ParsePdbFile())
+      .Times(1)
+      .WillOnce(Invoke([&started_count, &finished]() {
+        ++started_count;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        finished = true;
+        return true;
+      }));
+  EXPECT_CALL(*pdb_file, GetModuleName())
+      .WillRepeatedly(ReturnRef(module_name));
+  EXPECT_EQ(indexer.Enqueue(pdb_file), S_OK);
+
+  EXPECT_TRUE(WaitForCount(started_count, 1));
+  indexer.Shutdown();
+  EXPECT_TRUE(finished);
+
+  EXPECT_EQ(indexer.Enqueue(pdb_file), E_ABORT);
+}
+
+// Tests that parsed PDB files are added to the document path index
+// and that PDB files that fail to parse are not.
+TEST(ModuleIndexerTest, AddsParsedPdbFilesToPathIndex) {
+  DocumentPathIndex path_index;
+  ModuleIndexer indexer(1, &path_index, nullptr);
+
+  PortablePDBFileFixture pdb_fixture;
+  pdb_fixture.documents_.resize(1);
+  pdb_fixture.documents_[0].file_name_ = "/app/Program.cs";
+  shared_ptr<IPortablePdbFileMock> parsed_pdb(new IPortablePdbFileMock());
+  pdb_fixture.SetUpIPortablePDBFile(parsed_pdb.get());
+
+  string module_name = "Module.dll";
+  shared_ptr<IPortablePdbFileMock> failed_pdb(new IPortablePdbFileMock());
+  EXPECT_CALL(*failed_pdb, ParsePdbFile()).WillOnce(Return(false));
+  EXPECT_CALL(*failed_pdb, GetModuleName())
+      .WillRepeatedly(ReturnRef(module_name));
+
+  // There is a single worker, so failed_pdb is done once parsed_pdb is
+  // in the index.
+  EXPECT_EQ(indexer.Enqueue(failed_pdb), S_OK);
+  EXPECT_EQ(indexer.Enqueue(parsed_pdb), S_OK);
+  for (int i = 0; i < 1000 && !path_index.HasPdbFile(parsed_pdb.get()); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  indexer.Shutdown();
+
+  EXPECT_TRUE(path_index.HasPdbFile(parsed_pdb.get()));
+  EXPECT_FALSE(path_index.HasPdbFile(failed_pdb.get()));
+  EXPECT_EQ(
+      path_index.FindDocuments(SplitNormalizedFilePath("Program.cs")).size(),
+      1);
+}
+
+// Tests that the time each PDB file takes to parse is recorded in the
+// bucket of its range, and that PDB files that fail to parse are not.
+TEST(ModuleIndexerTest, RecordsParseLatency) {
+  using std::chrono::microseconds;
+  using std::chrono::milliseconds;
+  EXPECT_EQ(ModuleIndexer::GetParseLatencyBucket(microseconds(999)), 0);
+  EXPECT_EQ(ModuleIndexer::GetParseLatencyBucket(milliseconds(1)), 1);
+  EXPECT_EQ(ModuleIndexer::GetParseLatencyBucket(microseconds(1999)), 1);
+  EXPECT_EQ(ModuleIndexer::GetParseLatencyBucket(milliseconds(2)), 2);
+  EXPECT_EQ(ModuleIndexer::GetParseLatencyBucket(milliseconds(20)), 5);
+  EXPECT_EQ(ModuleIndexer::GetParseLatencyBucket(std::chrono::hours(1)),
+            ModuleIndexer::kNumParseLatencyBuckets - 1);
+
+  string module_name = "Module.dll";
+  atomic<int> parsed_count(0);
+  ModuleIndexer indexer(1, nullptr, nullptr);
+  for (int i = 0; i < 3; ++i) {
+    shared_ptr<IPortablePdbFileMock> pdb_file(new IPortablePdbFileMock());
+    bool succeeded = i != 0;
+    EXPECT_CALL(*pdb_file, ParsePdbFile())
+        .WillOnce(Invoke([&parsed_count, succeeded]() {
+          std::this_thread::sleep_for(milliseconds(20));
+          ++parsed_count;
+          return succeeded;
+        }));
+    EXPECT_CALL(*pdb_file, GetModuleName())
+        .WillRepeatedly(ReturnRef(module_name));
+    EXPECT_EQ(indexer.Enqueue(pdb_file), S_OK);
+  }
+
+  EXPECT_TRUE(WaitForCount(parsed_count, 3));
+  indexer.Shutdown();
+
+  vector<std::uint64_t> histogram = indexer.GetParseLatencyHistogram();
+  ASSERT_EQ(histogram.size(), ModuleIndexer::kNumParseLatencyBuckets);
+  std::uint64_t slow_parses = 0;
+  for (size_t i = 0; i < histogram.size(); ++i) {
+    if (i < 5) {
+      EXPECT_EQ(histogram[i], 0);
+    } else {
+      slow_parses += histogram[i];
+    }
+  }
+  EXPECT_EQ(slow_parses, 2);
+}
+
+// Tests that null PDB files are rejected.
+TEST(ModuleIndexerTest, EnqueueNull) {
+  ModuleIndexer indexer(1, nullptr, nullptr);
+  EXPECT_EQ(indexer.Enqueue(nullptr), E_INVALIDARG);
+}
+
+}  // namespace google_cloud_debugger_test
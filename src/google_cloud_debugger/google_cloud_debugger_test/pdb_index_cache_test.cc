@@ -0,0 +1,348 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "document_index.h"
+#include "method_def_table.h"
+#include "pdb_index_cache.h"
+
+using google_cloud_debugger_portable_pdb::DocumentIndex;
+using google_cloud_debugger_portable_pdb::IDocumentIndex;
+using google_cloud_debugger_portable_pdb::MethodDefTable;
+using google_cloud_debugger_portable_pdb::MethodInfo;
+using google_cloud_debugger_portable_pdb::PdbIndexCache;
+using google_cloud_debugger_portable_pdb::Scope;
+using google_cloud_debugger_portable_pdb::ScopeLocalConstant;
+using google_cloud_debugger_portable_pdb::ScopeLocalVariable;
+using google_cloud_debugger_portable_pdb::SequencePoint;
+using google_cloud_debugger_portable_pdb::StringPool;
+using std::array;
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace google_cloud_debugger_test {
+
+// Test Fixture for PdbIndexCache.
+// Sets up 2 document indices, each with a few methods that have sequence
+// points, scopes, local variables and local constants.
+class PdbIndexCacheTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    pdb_id_.fill(0xAB);
+    other_pdb_id_.fill(0xCD);
+
+    for (uint32_t doc = 0; doc < 2; ++doc) {
+      vector<MethodInfo> methods(3);
+      for (uint32_t i = 0; i < methods.size(); ++i) {
+        MethodInfo &method = methods[i];
+        method.method_def = 0x06000001 + doc * 10 + i;
+        method.first_line = 10 * i + 1;
+        method.last_line = 10 * i + 5;
+
+        for (uint32_t line = method.first_line; line <= method.last_line;
+             ++line) {
+          SequencePoint sequence_point;
+          sequence_point.il_offset = line * 2;
+          sequence_point.start_line = line;
+          sequence_point.start_col = 4;
+          sequence_point.end_line = line;
+          sequence_point.end_col = 20;
+          sequence_point.is_hidden = line == method.last_line;
+          method.sequence_points.push_back(sequence_point);
+        }
+
+        Scope scope;
+        scope.index = i + 1;
+        scope.local_var_row_start_index = i + 1;
+        scope.local_var_row_end_index = i + 2;
+        scope.local_const_row_start_index = i + 1;
+        scope.local_const_row_end_index = i + 2;
+        scope.start_offset = 0;
+        scope.length = 42;
+
+        ScopeLocalVariable variable;
+        variable.slot = i;
+        variable.name = string_pool_->Intern("variable" + std::to_string(i));
+        variable.debugger_hidden = i == 2;
+        scope.local_variables.push_back(variable);
+
+        ScopeLocalConstant constant;
+        constant.name = string_pool_->Intern("constant" + std::to_string(i));
+        constant.signature_data =
+            string_pool_->Intern(string("\x08") + static_cast<char>(i));
+        scope.local_constants.push_back(constant);
+
+        method.local_scope.push_back(scope);
+      }
+
+      unique_ptr<DocumentIndex> document_index(new DocumentIndex(string_pool_));
+      document_index->InitializeFromSnapshot(
+          "/app/Program" + std::to_string(doc) + ".cs", methods);
+      document_indices_.push_back(std::move(document_index));
+    }
+  }
+
+  virtual void TearDown() {
+    std::remove(cache_.GetCacheFilePath(pdb_id_).c_str());
+  }
+
+  // Checks that actual has the same content as document_indices_.
+  void CheckDocumentIndices(const vector<unique_ptr<IDocumentIndex>> &actual) {
+    ASSERT_EQ(actual.size(), document_indices_.size());
+    for (size_t doc = 0; doc < actual.size(); ++doc) {
+      EXPECT_EQ(actual[doc]->GetFilePath(),
+                document_indices_[doc]->GetFilePath());
+
+      const vector<MethodInfo> &methods = actual[doc]->GetMethods();
+      const vector<MethodInfo> &expected_methods =
+          document_indices_[doc]->GetMethods();
+      ASSERT_EQ(methods.size(), expected_methods.size());
+      for (size_t i = 0; i < methods.size(); ++i) {
+        EXPECT_EQ(methods[i].method_def, expected_methods[i].method_def);
+        EXPECT_EQ(methods[i].first_line, expected_methods[i].first_line);
+        EXPECT_EQ(methods[i].last_line, expected_methods[i].last_line);
+
+        ASSERT_EQ(methods[i].sequence_points.size(),
+                  expected_methods[i].sequence_points.size());
+        for (uint32_t j = 0; j < methods[i].sequence_points.size(); ++j) {
+          SequencePoint sequence_point = methods[i].sequence_points.Get(j);
+          SequencePoint expected = expected_methods[i].sequence_points.Get(j);
+          EXPECT_EQ(sequence_point.il_offset, expected.il_offset);
+          EXPECT_EQ(sequence_point.start_line, expected.start_line);
+          EXPECT_EQ(sequence_point.start_col, expected.start_col);
+          EXPECT_EQ(sequence_point.end_line, expected.end_line);
+          EXPECT_EQ(sequence_point.end_col, expected.end_col);
+          EXPECT_EQ(sequence_point.is_hidden, expected.is_hidden);
+        }
+
+        ASSERT_EQ(methods[i].local_scope.size(), 1);
+        const Scope &scope = methods[i].local_scope[0];
+        const Scope &expected_scope = expected_methods[i].local_scope[0];
+        EXPECT_EQ(scope.index, expected_scope.index);
+        EXPECT_EQ(scope.local_var_row_start_index,
+                  expected_scope.local_var_row_start_index);
+        EXPECT_EQ(scope.local_var_row_end_index,
+                  expected_scope.local_var_row_end_index);
+        EXPECT_EQ(scope.local_const_row_start_index,
+                  expected_scope.local_const_row_start_index);
+        EXPECT_EQ(scope.local_const_row_end_index,
+                  expected_scope.local_const_row_end_index);
+        EXPECT_EQ(scope.start_offset, expected_scope.start_offset);
+        EXPECT_EQ(scope.length, expected_scope.length);
+
+        // The string ids may differ, but the strings must not.
+        const StringPool &string_pool = actual[doc]->GetStringPool();
+        ASSERT_EQ(scope.local_variables.size(), 1);
+        EXPECT_EQ(scope.local_variables[0].slot,
+                  expected_scope.local_variables[0].slot);
+        EXPECT_EQ(string_pool.Get(scope.local_variables[0].name),
+                  string_pool_->Get(expected_scope.local_variables[0].name));
+        EXPECT_EQ(scope.local_variables[0].debugger_hidden,
+                  expected_scope.local_variables[0].debugger_hidden);
+
+        ASSERT_EQ(scope.local_constants.size(), 1);
+        EXPECT_EQ(string_pool.Get(scope.local_constants[0].name),
+                  string_pool_->Get(expected_scope.local_constants[0].name));
+        EXPECT_EQ(
+            string_pool.Get(scope.local_constants[0].signature_data),
+            string_pool_->Get(expected_scope.local_constants[0].signature_data));
+      }
+    }
+  }
+
+  // The cache files are written to the working directory.
+  PdbIndexCache cache_{"."};
+
+  // Id of the PDB of document_indices_.
+  array<uint8_t, 20> pdb_id_;
+
+  // Id of a PDB that is not cached.
+  array<uint8_t, 20> other_pdb_id_;
+
+  // String pool shared by document_indices_.
+  shared_ptr<StringPool> string_pool_{new StringPool()};
+
+  vector<unique_ptr<IDocumentIndex>> document_indices_;
+};
+
+// Tests that document indices survive a round trip through the cache.
+TEST_F(PdbIndexCacheTest, StoreAndLoad) {
+  ASSERT_TRUE(cache_.Store(pdb_id_, document_indices_));
+
+  vector<unique_ptr<IDocumentIndex>> loaded;
+  MethodDefTable method_defs;
+  ASSERT_TRUE(cache_.Load(pdb_id_, &loaded, &method_defs));
+  CheckDocumentIndices(loaded);
+}
+
+// Tests that loaded document indices find methods and breakpoint locations
+// in the cache file without building the methods they do not return.
+TEST_F(PdbIndexCacheTest, LookUpInPlace) {
+  ASSERT_TRUE(cache_.Store(pdb_id_, document_indices_));
+
+  vector<unique_ptr<IDocumentIndex>> loaded;
+  MethodDefTable method_defs;
+  ASSERT_TRUE(cache_.Load(pdb_id_, &loaded, &method_defs));
+  ASSERT_EQ(loaded.size(), 2);
+  EXPECT_EQ(method_defs.GetEntryCount(), 6);
+  EXPECT_EQ(method_defs.GetMemoryUsage(), 0);
+
+  // Nothing but the file path is copied into a loaded document index.
+  size_t initial_usage = loaded[1]->GetMemoryUsage();
+  EXPECT_LT(initial_usage, document_indices_[1]->GetMemoryUsage());
+
+  uint32_t document;
+  uint32_t position;
+  ASSERT_TRUE(method_defs.Find(0x06000001 + 10 + 2, &document, &position));
+  EXPECT_EQ(document, 1);
+  EXPECT_EQ(position, 2);
+  EXPECT_FALSE(method_defs.Find(0x06000004, &document, &position));
+
+  const MethodInfo *method;
+  SequencePoint sequence_point;
+  ASSERT_TRUE(loaded[1]->FindBreakpointLocation(23, &method, &sequence_point));
+  EXPECT_EQ(method, loaded[1]->GetMethod(2));
+  EXPECT_EQ(method->method_def, 0x06000001 + 10 + 2);
+  EXPECT_EQ(sequence_point.start_line, 23);
+  EXPECT_EQ(sequence_point.il_offset, 46);
+
+  // The last line of each method only has a hidden sequence point.
+  EXPECT_FALSE(loaded[1]->FindBreakpointLocation(25, &method,
+                                                 &sequence_point));
+  EXPECT_EQ(loaded[1]->GetMethod(3), nullptr);
+
+  // Only the method that was looked up is built, and its sequence points
+  // stay in the file.
+  EXPECT_EQ(method->sequence_points.GetMemoryUsage(), 0);
+  EXPECT_LT(loaded[1]->GetMemoryUsage() - initial_usage,
+            document_indices_[1]->GetMemoryUsage());
+
+  // The file stays mapped as long as the indices are alive.
+  std::remove(cache_.GetCacheFilePath(pdb_id_).c_str());
+  EXPECT_EQ(loaded[0]->GetMethod(1)->local_scope.size(), 1);
+  EXPECT_EQ(loaded[0]->GetMethod(1)->sequence_points.size(), 5);
+}
+
+// Tests that Load fails if nothing is cached for the PDB.
+TEST_F(PdbIndexCacheTest, Miss) {
+  ASSERT_TRUE(cache_.Store(pdb_id_, document_indices_));
+
+  vector<unique_ptr<IDocumentIndex>> loaded;
+  MethodDefTable method_defs;
+  EXPECT_FALSE(cache_.Load(other_pdb_id_, &loaded, &method_defs));
+  EXPECT_TRUE(loaded.empty());
+
+  PdbIndexCache missing_directory("directory_that_does_not_exist");
+  EXPECT_FALSE(missing_directory.Load(pdb_id_, &loaded, &method_defs));
+  EXPECT_FALSE(missing_directory.Store(pdb_id_, document_indices_));
+}
+
+// Tests that Load rejects a cache file whose PDB id does not match.
+TEST_F(PdbIndexCacheTest, PdbIdMismatch) {
+  ASSERT_TRUE(cache_.Store(other_pdb_id_, document_indices_));
+  ASSERT_EQ(std::rename(cache_.GetCacheFilePath(other_pdb_id_).c_str(),
+                        cache_.GetCacheFilePath(pdb_id_).c_str()),
+            0);
+
+  vector<unique_ptr<IDocumentIndex>> loaded;
+  MethodDefTable method_defs;
+  EXPECT_FALSE(cache_.Load(pdb_id_, &loaded, &method_defs));
+  EXPECT_TRUE(loaded.empty());
+}
+
+// Tests that Load rejects truncated and corrupted cache files.
+TEST_F(PdbIndexCacheTest, Corrupted) {
+  ASSERT_TRUE(cache_.Store(pdb_id_, document_indices_));
+
+  string cache_file_path = cache_.GetCacheFilePath(pdb_id_);
+  string content;
+  {
+    std::ifstream cache_file(cache_file_path, std::ios::binary);
+    content.assign(std::istreambuf_iterator<char>(cache_file),
+                   std::istreambuf_iterator<char>());
+  }
+  ASSERT_GT(content.size(), 100);
+
+  // Truncated file.
+  {
+    std::ofstream cache_file(cache_file_path,
+                             std::ios::binary | std::ios::trunc);
+    cache_file.write(content.data(), content.size() - 10);
+  }
+  vector<unique_ptr<IDocumentIndex>> loaded;
+  MethodDefTable method_defs;
+  EXPECT_FALSE(cache_.Load(pdb_id_, &loaded, &method_defs));
+  EXPECT_TRUE(loaded.empty());
+
+  // Huge number of strings.
+  {
+    string corrupted = content;
+    // The number of strings follows the magic, the version and the id.
+    corrupted.replace(28, 4, "\xFF\xFF\xFF\x7F", 4);
+    std::ofstream cache_file(cache_file_path,
+                             std::ios::binary | std::ios::trunc);
+    cache_file.write(corrupted.data(), corrupted.size());
+  }
+  EXPECT_FALSE(cache_.Load(pdb_id_, &loaded, &method_defs));
+  EXPECT_TRUE(loaded.empty());
+}
+
+// Tests that a corrupted method record, which Load does not check, makes
+// the lookups of that method fail instead of reading out of the file.
+TEST_F(PdbIndexCacheTest, CorruptedMethodRecord) {
+  ASSERT_TRUE(cache_.Store(pdb_id_, document_indices_));
+
+  string cache_file_path = cache_.GetCacheFilePath(pdb_id_);
+  string content;
+  {
+    std::ifstream cache_file(cache_file_path, std::ios::binary);
+    content.assign(std::istreambuf_iterator<char>(cache_file),
+                   std::istreambuf_iterator<char>());
+  }
+
+  // The first method record starts with the method def of the first
+  // method. Its last field is its number of scopes.
+  size_t method_record = content.find(string("\x01\x00\x00\x06", 4));
+  ASSERT_NE(method_record, string::npos);
+  content.replace(method_record + 28, 4, "\xFF\xFF\x00\x00", 4);
+  {
+    std::ofstream cache_file(cache_file_path,
+                             std::ios::binary | std::ios::trunc);
+    cache_file.write(content.data(), content.size());
+  }
+
+  vector<unique_ptr<IDocumentIndex>> loaded;
+  MethodDefTable method_defs;
+  ASSERT_TRUE(cache_.Load(pdb_id_, &loaded, &method_defs));
+  ASSERT_EQ(loaded.size(), 2);
+  EXPECT_EQ(loaded[0]->GetMethod(0), nullptr);
+  EXPECT_NE(loaded[0]->GetMethod(1), nullptr);
+
+  const MethodInfo *method;
+  SequencePoint sequence_point;
+  EXPECT_FALSE(loaded[0]->FindBreakpointLocation(2, &method, &sequence_point));
+  EXPECT_TRUE(loaded[0]->FindBreakpointLocation(12, &method, &sequence_point));
+}
+
+}  // namespace google_cloud_debugger_test
@@ -0,0 +1,133 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "pdb_index_registry.h"
+
+using google_cloud_debugger_portable_pdb::PdbIndexRegistry;
+using google_cloud_debugger_portable_pdb::PortablePdbFile;
+using std::shared_ptr;
+using std::string;
+using std::weak_ptr;
+
+namespace google_cloud_debugger_test {
+
+// Number of times the PDB file is rebuilt in RebuiltManyTimes.
+const int kRegistryLoadCycles = 1000;
+
+// Test Fixture for PdbIndexRegistry.
+// Writes the PDB files of 2 modules to the working directory. The
+// registry never parses them, so their content does not matter.
+class PdbIndexRegistryTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    WritePdbFile(kFirstPdb, "first");
+    WritePdbFile(kSecondPdb, "second");
+  }
+
+  virtual void TearDown() {
+    std::remove(kFirstPdb.c_str());
+    std::remove(kSecondPdb.c_str());
+  }
+
+  // Writes content to the PDB file at path.
+  void WritePdbFile(const string &path, const string &content) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << content;
+  }
+
+  const string kFirstModule = "pdb_index_registry_first.dll";
+  const string kFirstPdb = "pdb_index_registry_first.pdb";
+  const string kSecondModule = "pdb_index_registry_second.dll";
+  const string kSecondPdb = "pdb_index_registry_second.pdb";
+
+  PdbIndexRegistry registry_;
+};
+
+// Tests that modules loaded from the same PDB file share its
+// PortablePdbFile, and modules loaded from other PDB files do not.
+TEST_F(PdbIndexRegistryTest, SharesSamePdbFile) {
+  shared_ptr<PortablePdbFile> first = registry_.GetPdbFile(kFirstModule);
+  shared_ptr<PortablePdbFile> first_again = registry_.GetPdbFile(kFirstModule);
+  shared_ptr<PortablePdbFile> second = registry_.GetPdbFile(kSecondModule);
+
+  ASSERT_TRUE(first != nullptr);
+  ASSERT_TRUE(second != nullptr);
+  EXPECT_EQ(first, first_again);
+  EXPECT_NE(first, second);
+  EXPECT_EQ(first->GetModuleName(), kFirstModule);
+  EXPECT_EQ(second->GetModuleName(), kSecondModule);
+  EXPECT_EQ(registry_.GetPdbFileCount(), 2);
+}
+
+// Tests that a PortablePdbFile is freed once no module uses it, and that
+// loading the module again creates a new one.
+TEST_F(PdbIndexRegistryTest, ReleasesUnusedPdbFile) {
+  weak_ptr<PortablePdbFile> released = registry_.GetPdbFile(kFirstModule);
+  EXPECT_TRUE(released.expired());
+  EXPECT_EQ(registry_.GetPdbFileCount(), 0);
+
+  shared_ptr<PortablePdbFile> reloaded = registry_.GetPdbFile(kFirstModule);
+  ASSERT_TRUE(reloaded != nullptr);
+  EXPECT_EQ(registry_.GetPdbFileCount(), 1);
+}
+
+// Tests that a PDB file that was rebuilt is not confused with the old one.
+TEST_F(PdbIndexRegistryTest, RebuiltPdbFile) {
+  shared_ptr<PortablePdbFile> old_pdb = registry_.GetPdbFile(kFirstModule);
+  WritePdbFile(kFirstPdb, "first, rebuilt");
+  shared_ptr<PortablePdbFile> new_pdb = registry_.GetPdbFile(kFirstModule);
+
+  ASSERT_TRUE(old_pdb != nullptr);
+  ASSERT_TRUE(new_pdb != nullptr);
+  EXPECT_NE(old_pdb, new_pdb);
+  EXPECT_EQ(new_pdb, registry_.GetPdbFile(kFirstModule));
+}
+
+// Tests that modules without a PDB file still get a PortablePdbFile,
+// which is not shared.
+TEST_F(PdbIndexRegistryTest, MissingPdbFile) {
+  shared_ptr<PortablePdbFile> first = registry_.GetPdbFile("missing.dll");
+  shared_ptr<PortablePdbFile> second = registry_.GetPdbFile("missing.dll");
+  shared_ptr<PortablePdbFile> not_dll = registry_.GetPdbFile("missing.exe");
+
+  ASSERT_TRUE(first != nullptr);
+  ASSERT_TRUE(second != nullptr);
+  ASSERT_TRUE(not_dll != nullptr);
+  EXPECT_NE(first, second);
+  EXPECT_EQ(registry_.GetPdbFileCount(), 0);
+  EXPECT_FALSE(not_dll->ParsePdbFile());
+}
+
+// Tests that the PortablePdbFile objects of a PDB file that is rebuilt
+// over and over are released, without affecting the other PDB files.
+TEST_F(PdbIndexRegistryTest, RebuiltManyTimes) {
+  shared_ptr<PortablePdbFile> kept = registry_.GetPdbFile(kSecondModule);
+  for (int i = 0; i < kRegistryLoadCycles; ++i) {
+    // Changing the size of the PDB file gives it a new key every time.
+    WritePdbFile(kFirstPdb, string(i + 1, 'x'));
+    EXPECT_TRUE(registry_.GetPdbFile(kFirstModule) != nullptr);
+  }
+
+  EXPECT_EQ(registry_.GetPdbFileCount(), 1);
+  EXPECT_EQ(registry_.GetPdbFile(kSecondModule), kept);
+}
+
+}  // namespace google_cloud_debugger_test
@@ -0,0 +1,133 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "constants.h"
+#include "i_cor_debug_helper_mock.h"
+#include "i_cor_debug_mocks.h"
+#include "portable_pdb_file.h"
+#include "string_stream_wrapper.h"
+
+using ::testing::_;
+using ::testing::DoAll;
+using ::testing::Return;
+using ::testing::SetArgPointee;
+using google_cloud_debugger::ConvertStringToWCharPtr;
+using google_cloud_debugger::kDllExtension;
+using google_cloud_debugger::kPdbExtension;
+using google_cloud_debugger_portable_pdb::PortablePdbFile;
+using std::string;
+using std::vector;
+
+namespace google_cloud_debugger_test {
+
+// Environment variable that points to the module (.dll) whose portable PDB
+// is used by the benchmark. The PDB has to sit next to the module.
+const char kBenchmarkModuleVariable[] = "PORTABLE_PDB_BENCHMARK_MODULE";
+
+// Number of times the PDB is parsed for each mode.
+const int kBenchmarkIterations = 10;
+
+// Benchmarks PortablePdbFile::ParsePdbFile with the PDB read through a
+// std::ifstream against the PDB mapped into memory. This needs a real
+// module on disk so it does nothing unless kBenchmarkModuleVariable is set:
+//
+//   PORTABLE_PDB_BENCHMARK_MODULE=/app/MyApp.dll ./google_cloud_debugger_test \
+//       --gtest_filter=PortablePdbFileBenchmark.*
+class PortablePdbFileBenchmark : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    const char *module = std::getenv(kBenchmarkModuleVariable);
+    if (module == nullptr) {
+      return;
+    }
+
+    module_name_ = module;
+    wchar_module_name_ = ConvertStringToWCharPtr(module_name_);
+
+    string pdb_name = module_name_.substr(
+        0, module_name_.size() - kDllExtension.size()) + kPdbExtension;
+    std::ifstream pdb_file(pdb_name, std::ios::binary | std::ios::ate);
+    pdb_size_ = pdb_file.tellg();
+
+    ON_CALL(debug_helper_, GetMetadataImportFromICorDebugModule(_, _, _))
+        .WillByDefault(Return(S_OK));
+    ON_CALL(debug_helper_, GetModuleNameFromICorDebugModule(_, _, _))
+        .WillByDefault(
+            DoAll(SetArgPointee<1>(wchar_module_name_), Return(S_OK)));
+  }
+
+  // Parses the PDB kBenchmarkIterations times and prints the average
+  // parse time and throughput. Returns the number of documents in the PDB.
+  size_t RunBenchmark(bool memory_map) {
+    std::chrono::steady_clock::duration total_time =
+        std::chrono::steady_clock::duration::zero();
+    size_t document_count = 0;
+
+    for (int i = 0; i < kBenchmarkIterations; ++i) {
+      PortablePdbFile pdb_file;
+      pdb_file.SetMemoryMapPdbFile(memory_map);
+      EXPECT_EQ(pdb_file.Initialize(&debug_module_, &debug_helper_), S_OK);
+
+      auto start = std::chrono::steady_clock::now();
+      EXPECT_TRUE(pdb_file.ParsePdbFile());
+      total_time += std::chrono::steady_clock::now() - start;
+
+      document_count = pdb_file.GetDocumentIndexTable().size();
+    }
+
+    double average_ms =
+        std::chrono::duration<double, std::milli>(total_time).count() /
+        kBenchmarkIterations;
+    double throughput = pdb_size_ / (1024.0 * 1024.0) / (average_ms / 1000.0);
+    std::cout << (memory_map ? "memory-mapped: " : "std::ifstream: ")
+              << average_ms << " ms per parse, " << throughput << " MB/s"
+              << std::endl;
+    return document_count;
+  }
+
+  // Name of the module and its wchar version.
+  string module_name_;
+  vector<WCHAR> wchar_module_name_;
+
+  // Size of the PDB file in bytes.
+  int64_t pdb_size_ = 0;
+
+  ICorDebugHelperMock debug_helper_;
+  ICorDebugModuleMock debug_module_;
+};
+
+// Compares ParsePdbFile throughput of the two CustomBinaryStream backends.
+TEST_F(PortablePdbFileBenchmark, ParsePdbFile) {
+  if (module_name_.empty()) {
+    std::cout << kBenchmarkModuleVariable << " is not set, skipping."
+              << std::endl;
+    return;
+  }
+
+  size_t stream_documents = RunBenchmark(false);
+  size_t mapped_documents = RunBenchmark(true);
+  EXPECT_EQ(stream_documents, mapped_documents);
+}
+
+}  // namespace google_cloud_debugger_test
@@ -0,0 +1,154 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "sequence_point_list.h"
+
+using google_cloud_debugger_portable_pdb::SequencePoint;
+using google_cloud_debugger_portable_pdb::SequencePointList;
+using std::vector;
+
+namespace google_cloud_debugger_test {
+
+// Returns a sequence point with the given fields.
+SequencePoint MakeSequencePoint(uint32_t il_offset, uint32_t start_line,
+                                uint32_t start_col, uint32_t end_line,
+                                uint32_t end_col, bool is_hidden) {
+  SequencePoint sequence_point;
+  sequence_point.il_offset = il_offset;
+  sequence_point.start_line = start_line;
+  sequence_point.start_col = start_col;
+  sequence_point.end_line = end_line;
+  sequence_point.end_col = end_col;
+  sequence_point.is_hidden = is_hidden;
+  return sequence_point;
+}
+
+// Checks that list holds exactly expected.
+void CheckSequencePoints(const SequencePointList &list,
+                         const vector<SequencePoint> &expected) {
+  ASSERT_EQ(list.size(), expected.size());
+  EXPECT_EQ(list.empty(), expected.empty());
+
+  uint32_t index = 0;
+  for (const SequencePoint &sequence_point : list) {
+    ASSERT_LT(index, expected.size());
+    EXPECT_EQ(sequence_point.il_offset, expected[index].il_offset);
+    EXPECT_EQ(sequence_point.start_line, expected[index].start_line);
+    EXPECT_EQ(sequence_point.start_col, expected[index].start_col);
+    EXPECT_EQ(sequence_point.end_line, expected[index].end_line);
+    EXPECT_EQ(sequence_point.end_col, expected[index].end_col);
+    EXPECT_EQ(sequence_point.is_hidden, expected[index].is_hidden);
+
+    SequencePoint random_access = list.Get(index);
+    EXPECT_EQ(random_access.il_offset, expected[index].il_offset);
+    EXPECT_EQ(random_access.start_line, expected[index].start_line);
+    ++index;
+  }
+  EXPECT_EQ(index, expected.size());
+}
+
+// Tests that sequence points, including hidden ones and fields going
+// backwards or to the extremes, are decoded as they were added.
+TEST(SequencePointListTest, RoundTrip) {
+  vector<SequencePoint> expected;
+  expected.push_back(MakeSequencePoint(0, 10, 5, 10, 20, false));
+  expected.push_back(MakeSequencePoint(4, 11, 9, 13, 2, false));
+  // Hidden sequence points use line 0xFEEFEE.
+  expected.push_back(MakeSequencePoint(10, 0xFEEFEE, 0, 0xFEEFEE, 0, true));
+  expected.push_back(MakeSequencePoint(12, 8, 1, 8, 30, false));
+  expected.push_back(MakeSequencePoint(8, 0, 0, 0, 0, false));
+  expected.push_back(
+      MakeSequencePoint(UINT32_MAX, UINT32_MAX, UINT32_MAX, 0, 0, true));
+  expected.push_back(
+      MakeSequencePoint(0, 0, 0, UINT32_MAX, UINT32_MAX, false));
+
+  SequencePointList list;
+  CheckSequencePoints(list, {});
+  for (const SequencePoint &sequence_point : expected) {
+    list.push_back(sequence_point);
+  }
+  list.ShrinkToFit();
+  CheckSequencePoints(list, expected);
+
+  vector<uint8_t> bytes(list.GetEncodedData(),
+                        list.GetEncodedData() + list.GetEncodedSize());
+  SequencePointList view;
+  ASSERT_TRUE(view.SetEncodedView(list.size(), bytes.data(), bytes.size()));
+  CheckSequencePoints(view, expected);
+  EXPECT_EQ(view.GetEncodedData(), bytes.data());
+  EXPECT_EQ(view.GetMemoryUsage(), 0);
+
+  SequencePointList copy;
+  ASSERT_TRUE(copy.SetEncodedBytes(list.size(), bytes));
+  CheckSequencePoints(copy, expected);
+
+  // Points can still be added after SetEncodedBytes.
+  expected.push_back(MakeSequencePoint(20, 30, 1, 30, 2, false));
+  copy.push_back(expected.back());
+  CheckSequencePoints(copy, expected);
+}
+
+// Tests that typical sequence points take a few bytes each.
+TEST(SequencePointListTest, Compact) {
+  const uint32_t kNumSequencePoints = 1000;
+  SequencePointList list;
+  for (uint32_t i = 0; i < kNumSequencePoints; ++i) {
+    list.push_back(MakeSequencePoint(i * 6, 100 + i, 9, 100 + i, 40, false));
+  }
+
+  EXPECT_EQ(list.size(), kNumSequencePoints);
+  EXPECT_LE(list.GetEncodedSize(), kNumSequencePoints * 6);
+}
+
+// Tests that SetEncodedBytes and SetEncodedView reject bytes that do not
+// hold the given number of sequence points.
+TEST(SequencePointListTest, InvalidEncodedBytes) {
+  SequencePointList list;
+  list.push_back(MakeSequencePoint(0, 10, 5, 10, 20, false));
+  list.push_back(MakeSequencePoint(300, 2000, 5, 2000, 20, true));
+  vector<uint8_t> bytes(list.GetEncodedData(),
+                        list.GetEncodedData() + list.GetEncodedSize());
+
+  SequencePointList copy;
+  EXPECT_FALSE(copy.SetEncodedBytes(3, bytes));
+  EXPECT_TRUE(copy.empty());
+  EXPECT_FALSE(copy.SetEncodedBytes(1, bytes));
+  EXPECT_TRUE(copy.empty());
+
+  vector<uint8_t> truncated(bytes.begin(), bytes.end() - 1);
+  EXPECT_FALSE(copy.SetEncodedBytes(2, truncated));
+
+  // A variable-length integer that never ends.
+  vector<uint8_t> unterminated(12, 0xFF);
+  EXPECT_FALSE(copy.SetEncodedBytes(1, unterminated));
+
+  EXPECT_TRUE(copy.SetEncodedBytes(0, {}));
+  EXPECT_TRUE(copy.empty());
+
+  SequencePointList view;
+  EXPECT_FALSE(view.SetEncodedView(3, bytes.data(), bytes.size()));
+  EXPECT_TRUE(view.empty());
+  EXPECT_FALSE(view.SetEncodedView(2, bytes.data(), bytes.size() - 1));
+  EXPECT_TRUE(view.empty());
+  EXPECT_FALSE(view.SetEncodedView(1, nullptr, 0));
+  EXPECT_TRUE(view.SetEncodedView(2, bytes.data(), bytes.size()));
+  EXPECT_EQ(view.size(), 2);
+}
+
+}  // namespace google_cloud_debugger_test
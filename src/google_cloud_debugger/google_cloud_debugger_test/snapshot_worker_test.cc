@@ -0,0 +1,130 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "snapshot_worker.h"
+
+using google_cloud_debugger::SnapshotWorker;
+using std::atomic;
+using std::vector;
+
+namespace google_cloud_debugger_test {
+
+// Waits up to 10 seconds for worker to complete expected tasks.
+static bool WaitForCompletedTasks(SnapshotWorker *worker,
+                                  std::uint64_t expected) {
+  for (int i = 0; i < 1000 && worker->GetCompletedTaskCount() < expected;
+       ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return worker->GetCompletedTaskCount() == expected;
+}
+
+// Tests that tasks run one at a time, in the order they were queued.
+TEST(SnapshotWorkerTest, RunsTasksInOrder) {
+  SnapshotWorker worker(100);
+  vector<int> order;
+  atomic<int> running(0);
+  bool overlapped = false;
+
+  for (int i = 0; i < 50; ++i) {
+    EXPECT_EQ(worker.Enqueue([i, &order, &running, &overlapped]() {
+      overlapped |= ++running > 1;
+      order.push_back(i);
+      --running;
+      return i % 2 == 0 ? S_OK : E_FAIL;
+    }), S_OK);
+  }
+
+  // Failed tasks do not stop the worker.
+  ASSERT_TRUE(WaitForCompletedTasks(&worker, 50));
+  EXPECT_FALSE(overlapped);
+  ASSERT_EQ(order.size(), 50);
+  for (int i = 0; i < 50; ++i) {
+    EXPECT_EQ(order[i], i);
+  }
+  EXPECT_EQ(worker.GetQueuedTaskCount(), 0);
+}
+
+// Tests that tasks that do not fit in the queue are rejected.
+TEST(SnapshotWorkerTest, BoundedQueue) {
+  SnapshotWorker worker(2);
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool started = false;
+  bool release = false;
+
+  // Blocks the worker until release is set.
+  EXPECT_EQ(worker.Enqueue([&]() {
+    std::unique_lock<std::mutex> lock(mutex);
+    started = true;
+    cv.notify_all();
+    cv.wait(lock, [&] { return release; });
+    return S_OK;
+  }), S_OK);
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return started; });
+  }
+
+  auto task = []() { return S_OK; };
+  EXPECT_EQ(worker.Enqueue(task), S_OK);
+  EXPECT_EQ(worker.Enqueue(task), S_OK);
+  EXPECT_EQ(worker.Enqueue(task), E_FAIL);
+  EXPECT_EQ(worker.GetQueuedTaskCount(), 2);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    release = true;
+  }
+  cv.notify_all();
+  ASSERT_TRUE(WaitForCompletedTasks(&worker, 3));
+  EXPECT_EQ(worker.Enqueue(task), S_OK);
+  EXPECT_TRUE(WaitForCompletedTasks(&worker, 4));
+}
+
+// Tests that Shutdown drops the queued tasks and rejects new ones.
+TEST(SnapshotWorkerTest, Shutdown) {
+  SnapshotWorker worker(10);
+  EXPECT_EQ(worker.Enqueue(nullptr), E_INVALIDARG);
+
+  atomic<int> run_count(0);
+  EXPECT_EQ(worker.Enqueue([&run_count]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ++run_count;
+    return S_OK;
+  }), S_OK);
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(worker.Enqueue([&run_count]() {
+      ++run_count;
+      return S_OK;
+    }), S_OK);
+  }
+
+  worker.Shutdown();
+  EXPECT_LE(run_count, 1);
+  EXPECT_EQ(worker.GetQueuedTaskCount(), 0);
+  EXPECT_EQ(worker.Enqueue([]() { return S_OK; }), E_ABORT);
+}
+
+}  // namespace google_cloud_debugger_test
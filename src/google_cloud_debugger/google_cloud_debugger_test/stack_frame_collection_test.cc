@@ -40,6 +40,7 @@ using google_cloud_debugger::DbgBreakpoint;
 using google_cloud_debugger::DbgObject;
 using google_cloud_debugger::DbgObjectFactory;
 using google_cloud_debugger::DbgPrimitive;
+using google_cloud_debugger::FrameSymbolCache;
 using google_cloud_debugger::ICorDebugHelper;
 using google_cloud_debugger::IDbgObjectFactory;
 using google_cloud_debugger::StackFrameCollection;
@@ -232,6 +233,8 @@ class StackFrameCollectionTest : public ::testing::Test {
     debug_helper_ = std::shared_ptr<ICorDebugHelper>(new CorDebugHelper());
     dbg_object_factory_ =
         std::shared_ptr<IDbgObjectFactory>(new DbgObjectFactory());
+    frame_symbol_cache_ =
+        std::shared_ptr<FrameSymbolCache>(new FrameSymbolCache());
   }
 
   // Sets up the StackFrameCollection to return 3 frames.
@@ -299,8 +302,9 @@ class StackFrameCollectionTest : public ::testing::Test {
 
   virtual void SetUpPDBFile() {
     MethodInfo method;
-    // Method def can just be some random number, not important here.
-    method.method_def = 4000;
+    // The method def of a method is the row id of its token, so this
+    // method is the function of the first frame.
+    method.method_def = RidFromToken(first_frame_.frame_function_token_);
 
     // Gives the method a sequence point that matches the IP Offset of the
     // first frame.
@@ -325,16 +329,6 @@ class StackFrameCollectionTest : public ::testing::Test {
     pdb_file_fixture_.SetUpIPortablePDBFile(pdb_file.get());
 
     pdb_files_.push_back(std::move(pdb_file));
-
-    // Makes this method the same as the first frame's method by giving
-    // them the same function name and virtual address.
-    EXPECT_CALL(metadata_import_, GetMethodProps(method.method_def, _, nullptr,
-                                                 0, _, _, _, _, _, _))
-        .WillRepeatedly(
-            DoAll(SetArgPointee<1>(method.method_def),
-                  SetArgPointee<4>(first_frame_.wchar_function_name_.size()),
-                  SetArgPointee<8>(first_frame_.frame_func_virtual_addr_),
-                  Return(S_OK)));
   }
 
   // ICorDebugHelper used for StackFrameCollection constructor.
@@ -343,6 +337,9 @@ class StackFrameCollectionTest : public ::testing::Test {
   // IDbgObjectFactory used for StackFrameCollection constructor.
   std::shared_ptr<IDbgObjectFactory> dbg_object_factory_;
 
+  // FrameSymbolCache used for StackFrameCollection constructor.
+  std::shared_ptr<FrameSymbolCache> frame_symbol_cache_;
+
   // Vector of PDB files that will be fed to the Initialize function
   // of StackFrameCollection.
   std::vector<shared_ptr<google_cloud_debugger_portable_pdb::IPortablePdbFile>>
@@ -391,8 +388,8 @@ class StackFrameCollectionTest : public ::testing::Test {
 // Tests the Initialize function of stack frame collection when
 // no PDB file matches the module.
 TEST_F(StackFrameCollectionTest, TestInitializeWithoutPDBFile) {
-  StackFrameCollection stack_frame_collection(debug_helper_,
-                                              dbg_object_factory_);
+  StackFrameCollection stack_frame_collection(
+      debug_helper_, dbg_object_factory_, frame_symbol_cache_, nullptr);
   SetUpStackWalk();
   HRESULT hr = stack_frame_collection.ProcessBreakpoint(
       pdb_files_, &dbg_breakpoint_, &eval_coordinator_);
@@ -402,8 +399,8 @@ TEST_F(StackFrameCollectionTest, TestInitializeWithoutPDBFile) {
 // Tests the Initialize function of stack frame collection
 // when we have a PDB that matches the module.
 TEST_F(StackFrameCollectionTest, TestInitializeWithPDBFile) {
-  StackFrameCollection stack_frame_collection(debug_helper_,
-                                              dbg_object_factory_);
+  StackFrameCollection stack_frame_collection(
+      debug_helper_, dbg_object_factory_, frame_symbol_cache_, nullptr);
   SetUpStackWalk();
   SetUpPDBFile();
   HRESULT hr = stack_frame_collection.ProcessBreakpoint(
@@ -418,8 +415,8 @@ TEST_F(StackFrameCollectionTest, TestInitializeError) {
   {
     EXPECT_CALL(debug_stack_walk_, GetFrame(_))
         .WillRepeatedly(Return(E_ACCESSDENIED));
-    StackFrameCollection stack_frame_collection(debug_helper_,
-                                                dbg_object_factory_);
+    StackFrameCollection stack_frame_collection(
+        debug_helper_, dbg_object_factory_, frame_symbol_cache_, nullptr);
     EXPECT_EQ(stack_frame_collection.ProcessBreakpoint(
                   pdb_files_, &dbg_breakpoint_, &eval_coordinator_),
               E_ACCESSDENIED);
@@ -427,8 +424,8 @@ TEST_F(StackFrameCollectionTest, TestInitializeError) {
 
   // Null tests.
   {
-    StackFrameCollection stack_frame_collection(debug_helper_,
-                                                dbg_object_factory_);
+    StackFrameCollection stack_frame_collection(
+        debug_helper_, dbg_object_factory_, frame_symbol_cache_, nullptr);
     EXPECT_EQ(stack_frame_collection.ProcessBreakpoint(pdb_files_, nullptr,
                                                        &eval_coordinator_),
               E_INVALIDARG);
@@ -441,8 +438,8 @@ TEST_F(StackFrameCollectionTest, TestInitializeError) {
 // Tests that if we have more than 20 frames, only the first
 // 20 will be processed in Initialize function.
 TEST_F(StackFrameCollectionTest, TestInitializeWithMoreThan20Frames) {
-  StackFrameCollection stack_frame_collection(debug_helper_,
-                                              dbg_object_factory_);
+  StackFrameCollection stack_frame_collection(
+      debug_helper_, dbg_object_factory_, frame_symbol_cache_, nullptr);
 
   // This should only be called 20 times.
   EXPECT_CALL(debug_stack_walk_, GetFrame(_))
@@ -461,6 +458,38 @@ TEST_F(StackFrameCollectionTest, TestInitializeWithMoreThan20Frames) {
   EXPECT_TRUE(SUCCEEDED(hr)) << "Failed with hr: " << hr;
 }
 
+// Tests that the stack walk stops once the breakpoint hit is out of
+// pause time.
+TEST_F(StackFrameCollectionTest, TestInitializePauseTimeExhausted) {
+  StackFrameCollection stack_frame_collection(
+      debug_helper_, dbg_object_factory_, frame_symbol_cache_, nullptr);
+
+  EXPECT_CALL(eval_coordinator_, PauseTimeExhausted())
+      .WillOnce(Return(FALSE))
+      .WillOnce(Return(FALSE))
+      .WillOnce(Return(FALSE))
+      .WillRepeatedly(Return(TRUE));
+
+  // Only the frames walked before the pause time runs out are read.
+  EXPECT_CALL(debug_stack_walk_, GetFrame(_))
+      .Times(3)
+      .WillRepeatedly(
+          DoAll(SetArgPointee<0>(&first_frame_.frame_), Return(S_OK)));
+  EXPECT_CALL(first_frame_.frame_, GetFunction(_))
+      .Times(3)
+      .WillRepeatedly(Return(CORDBG_E_CODE_NOT_AVAILABLE));
+
+  HRESULT hr = stack_frame_collection.ProcessBreakpoint(
+      pdb_files_, &dbg_breakpoint_, &eval_coordinator_);
+  EXPECT_TRUE(SUCCEEDED(hr)) << "Failed with hr: " << hr;
+
+  Breakpoint breakpoint;
+  hr = stack_frame_collection.PopulateStackFrames(&breakpoint,
+                                                  &eval_coordinator_);
+  EXPECT_TRUE(SUCCEEDED(hr)) << "Failed with hr: " << hr;
+  EXPECT_EQ(breakpoint.stack_frames_size(), 3);
+}
+
 // Tests that if we have more than 4 IL frames, only the first 4
 // are processed.
 TEST_F(StackFrameCollectionTest, TestInitializeWithFourILFrames) {
@@ -506,8 +535,8 @@ TEST_F(StackFrameCollectionTest, TestInitializeWithFourILFrames) {
 
   SetUpDebugModule();
 
-  StackFrameCollection stack_frame_collection(debug_helper_,
-                                              dbg_object_factory_);
+  StackFrameCollection stack_frame_collection(
+      debug_helper_, dbg_object_factory_, frame_symbol_cache_, nullptr);
   HRESULT hr = stack_frame_collection.ProcessBreakpoint(
       pdb_files_, &dbg_breakpoint_, &eval_coordinator_);
   EXPECT_TRUE(SUCCEEDED(hr)) << "Failed with hr: " << hr;
@@ -515,8 +544,8 @@ TEST_F(StackFrameCollectionTest, TestInitializeWithFourILFrames) {
 
 // Tests the PopulateStackFrames function of stack frame collection.
 TEST_F(StackFrameCollectionTest, TestPopulateStackFrames) {
-  StackFrameCollection stack_frame_collection(debug_helper_,
-                                              dbg_object_factory_);
+  StackFrameCollection stack_frame_collection(
+      debug_helper_, dbg_object_factory_, frame_symbol_cache_, nullptr);
   SetUpStackWalk();
   SetUpPDBFile();
   HRESULT hr = stack_frame_collection.ProcessBreakpoint(
@@ -544,7 +573,7 @@ TEST_F(StackFrameCollectionTest, TestPopulateStackFrames) {
   // method of the first document index.
   EXPECT_EQ(
       first_proto_frame.location().line(),
-      first_doc_.methods_[0].sequence_points[0].start_line);
+      first_doc_.methods_[0].sequence_points.Get(0).start_line);
 
   // No path or line number set for the second and third frames.
   StackFrame second_proto_frame = breakpoint.stack_frames(1);
@@ -560,11 +589,58 @@ TEST_F(StackFrameCollectionTest, TestPopulateStackFrames) {
   EXPECT_EQ(third_proto_frame.location().line(), 0);
 }
 
+// Tests that a second breakpoint hit at the same place resolves its frames
+// from the FrameSymbolCache instead of the metadata.
+TEST_F(StackFrameCollectionTest, TestFrameSymbolCache) {
+  SetUpStackWalk();
+  SetUpPDBFile();
+  {
+    StackFrameCollection stack_frame_collection(
+        debug_helper_, dbg_object_factory_, frame_symbol_cache_, nullptr);
+    HRESULT hr = stack_frame_collection.ProcessBreakpoint(
+        pdb_files_, &dbg_breakpoint_, &eval_coordinator_);
+    EXPECT_TRUE(SUCCEEDED(hr)) << "Failed with hr: " << hr;
+  }
+
+  // Walks the same 3 frames again.
+  EXPECT_CALL(debug_stack_walk_, GetFrame(_))
+      .WillOnce(DoAll(SetArgPointee<0>(&first_frame_.frame_), Return(S_OK)))
+      .WillOnce(DoAll(SetArgPointee<0>(&second_frame_.frame_), Return(S_OK)))
+      .WillOnce(DoAll(SetArgPointee<0>(&third_frame_.frame_), Return(S_OK)))
+      .WillOnce(Return(S_FALSE));
+
+  // The names of the methods and classes are cached.
+  EXPECT_CALL(metadata_import_, GetMethodProps(_, _, _, _, _, _, _, _, _, _))
+      .Times(0);
+  EXPECT_CALL(metadata_import_, GetTypeDefProps(_, _, _, _, _, _)).Times(0);
+
+  StackFrameCollection stack_frame_collection(
+      debug_helper_, dbg_object_factory_, frame_symbol_cache_, nullptr);
+  HRESULT hr = stack_frame_collection.ProcessBreakpoint(
+      pdb_files_, &dbg_breakpoint_, &eval_coordinator_);
+  EXPECT_TRUE(SUCCEEDED(hr)) << "Failed with hr: " << hr;
+
+  Breakpoint breakpoint;
+  IEvalCoordinatorMock eval_coordinator;
+  hr = stack_frame_collection.PopulateStackFrames(&breakpoint,
+                                                  &eval_coordinator);
+  EXPECT_TRUE(SUCCEEDED(hr)) << "Failed with hr: " << hr;
+
+  ASSERT_EQ(breakpoint.stack_frames_size(), 3);
+  StackFrame first_proto_frame = breakpoint.stack_frames(0);
+  EXPECT_EQ(first_proto_frame.method_name(),
+            first_frame_.GetFullMethodName(module_name_));
+  EXPECT_EQ(first_proto_frame.location().path(), first_doc_.file_name_);
+  EXPECT_EQ(first_proto_frame.location().line(), 30);
+  EXPECT_EQ(breakpoint.stack_frames(2).method_name(),
+            third_frame_.GetFullMethodName(module_name_));
+}
+
 // Tests the error case for PopulateStackFrames function of stack frame
 // collection.
 TEST_F(StackFrameCollectionTest, TestPopulateStackFramesError) {
-  StackFrameCollection stack_frame_collection(debug_helper_,
-                                              dbg_object_factory_);
+  StackFrameCollection stack_frame_collection(
+      debug_helper_, dbg_object_factory_, frame_symbol_cache_, nullptr);
   SetUpStackWalk();
   SetUpPDBFile();
   HRESULT hr = stack_frame_collection.ProcessBreakpoint(
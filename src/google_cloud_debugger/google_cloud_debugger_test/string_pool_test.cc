@@ -0,0 +1,82 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "string_pool.h"
+
+using google_cloud_debugger_portable_pdb::StringPool;
+using std::string;
+using std::vector;
+
+namespace google_cloud_debugger_test {
+
+// Tests that each distinct string is stored once.
+TEST(StringPoolTest, Intern) {
+  StringPool string_pool;
+  EXPECT_EQ(string_pool.Size(), 0);
+  EXPECT_EQ(string_pool.Get(0), "");
+
+  uint32_t first_id = string_pool.Intern("result");
+  uint32_t second_id = string_pool.Intern("i");
+  EXPECT_EQ(first_id, 0);
+  EXPECT_EQ(second_id, 1);
+  EXPECT_EQ(string_pool.Intern("result"), first_id);
+  EXPECT_EQ(string_pool.Size(), 2);
+
+  EXPECT_EQ(string_pool.Get(first_id), "result");
+  EXPECT_EQ(string_pool.Get(second_id), "i");
+  EXPECT_EQ(string_pool.Get(2), "");
+
+  // Strings can hold any bytes, such as constant signatures.
+  string signature("\x08\x00\x01", 3);
+  uint32_t signature_id = string_pool.Intern(signature);
+  EXPECT_EQ(string_pool.Get(signature_id), signature);
+  EXPECT_GT(string_pool.GetMemoryUsage(), 0);
+}
+
+// Tests that strings keep their ids and contents while other threads
+// intern strings.
+TEST(StringPoolTest, Concurrent) {
+  const int kNumThreads = 4;
+  const int kNumStrings = 1000;
+  StringPool string_pool;
+
+  vector<std::thread> threads;
+  vector<vector<uint32_t>> ids(kNumThreads);
+  for (int thread = 0; thread < kNumThreads; ++thread) {
+    threads.push_back(std::thread([&string_pool, &ids, thread]() {
+      for (int i = 0; i < kNumStrings; ++i) {
+        ids[thread].push_back(string_pool.Intern("name" + std::to_string(i)));
+      }
+    }));
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(string_pool.Size(), kNumStrings);
+  for (int thread = 0; thread < kNumThreads; ++thread) {
+    EXPECT_EQ(ids[thread], ids[0]);
+    for (int i = 0; i < kNumStrings; ++i) {
+      EXPECT_EQ(string_pool.Get(ids[thread][i]), "name" + std::to_string(i));
+    }
+  }
+}
+
+}  // namespace google_cloud_debugger_test
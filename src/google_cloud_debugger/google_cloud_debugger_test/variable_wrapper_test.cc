@@ -299,6 +299,27 @@ TEST_F(VariableWrapperTest, TestBFSTwoChildrenWithTerminatingCondition) {
   EXPECT_EQ(value_wrapper_2_.GetVariableProto()->value(), "");
 }
 
+// Tests that PerformBFS stops once the breakpoint hit is out of pause time.
+TEST_F(VariableWrapperTest, TestBFSPauseTimeExhausted) {
+  AddMembers(&members_wrapper_, value_wrapper_);
+  AddMembers(&members_wrapper_, value_wrapper_2_);
+
+  EXPECT_CALL(eval_coordinator_, PauseTimeExhausted())
+      .WillOnce(Return(FALSE))
+      .WillRepeatedly(Return(TRUE));
+
+  queue<VariableWrapper> bfs_queue;
+  bfs_queue.push(members_wrapper_);
+  HRESULT hr = VariableWrapper::PerformBFS(&bfs_queue, []() { return false; },
+                                           &eval_coordinator_);
+  EXPECT_TRUE(SUCCEEDED(hr)) << "Failed with hr: " << hr;
+
+  // Only the first item is processed.
+  CheckType(&members_wrapper_);
+  EXPECT_EQ(value_wrapper_.GetVariableProto()->type(), "");
+  EXPECT_EQ(value_wrapper_2_.GetVariableProto()->type(), "");
+}
+
 // Tests PerformBFS method when there is 1 item with 2 children
 // and 1 of the children has another 2 children. We will, however,
 // sets the BFS level so that the last 2 children won't be evaluated.